@@ -0,0 +1,160 @@
+//ParallelFor.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef COMMON_PARALLEL_FOR_HPP__
+#define COMMON_PARALLEL_FOR_HPP__
+
+/**
+ * \file ParallelFor.hpp
+ * \brief Simple data-parallel loop over index range.
+ *
+ * hydra::common::parallelFor splits range [begin, end) into contiguous
+ * subranges and handles them in several threads (boost::thread).
+ * Calling thread handles the last subrange itself, so there is no
+ * thread creation at all for small ranges.
+ * Functor is called as functor(rangeBegin, rangeEnd) and it must be safe
+ * to call it concurrently for different ranges.
+ * parallelFor always waits for all the threads. If functor throws, the
+ * exception is rethrown by parallelFor (the first one in order of subranges).
+ *
+ * Libraries which use it must be linked with boost_thread.
+ */
+
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
+#include <algorithm>
+#include <vector>
+#include <cstddef>
+
+namespace hydra{
+
+namespace common{
+
+///returns number of hardware threads (at least 1)
+inline unsigned int getHardwareThreadNum(){
+    unsigned int num = boost::thread::hardware_concurrency();
+    return (num > 0)? num: 1;
+}
+
+///task which handles one subrange of parallelFor
+template <typename F>
+struct ParallelForTask{
+    ///functor to call
+    const F* functor;
+    ///begin of subrange
+    size_t begin;
+    ///end of subrange
+    size_t end;
+    ///exception thrown by functor is stored here
+    boost::exception_ptr* error;
+
+    ///runs functor for subrange
+    inline void operator()() const{
+        try{
+            (*functor)(begin, end);
+        }
+        catch(...){
+            *error = boost::current_exception();
+        }
+    }
+};
+
+///joins all the threads of group when it goes out of scope (even if exception is thrown)
+class ThreadGroupJoiner{
+public:
+    explicit ThreadGroupJoiner(boost::thread_group& inThreads): mThreads(inThreads){
+
+    }
+
+    ~ThreadGroupJoiner(){
+        mThreads.join_all();
+    }
+
+private:
+    boost::thread_group& mThreads;
+};
+
+///\brief Calls inFunctor(rangeBegin, rangeEnd) for subranges of [inBegin, inEnd) in parallel.
+///
+///inThreadNum == 0 means number of hardware threads.
+///Subranges are not smaller than inMinRange (except the last one).
+template <typename F>
+void parallelFor(size_t inBegin, size_t inEnd, const F& inFunctor, unsigned int inThreadNum = 0, size_t inMinRange = 1024){
+    if(inEnd <= inBegin) return;
+
+    const size_t total = inEnd - inBegin;
+    size_t threadNum = (inThreadNum > 0)? inThreadNum: getHardwareThreadNum();
+    threadNum = std::max<size_t>(1, std::min(threadNum, total / std::max<size_t>(inMinRange, 1)));
+
+    if(threadNum == 1){
+        inFunctor(inBegin, inEnd);
+        return;
+    }
+
+    const size_t rangeSize = (total + threadNum - 1) / threadNum;
+    //errors must outlive threads, so they are declared before the group
+    std::vector<boost::exception_ptr> errors(threadNum);
+    {
+        boost::thread_group threads;
+        ThreadGroupJoiner joiner(threads);
+        ParallelForTask<F> task;
+        task.functor = &inFunctor;
+
+        size_t index = 0;
+        for(size_t begin = inBegin; begin < inEnd; begin += rangeSize, ++index){
+            task.begin = begin;
+            task.end = std::min(inEnd, begin + rangeSize);
+            task.error = &errors[index];
+            //calling thread stores its exception too, so the first subrange's one is rethrown
+            if(task.end == inEnd) task();
+            else threads.create_thread(task);
+        }
+    }
+
+    for(size_t i = 0; i < errors.size(); ++i){
+        if(errors[i]) boost::rethrow_exception(errors[i]);
+    }
+}
+
+} //common namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -28,7 +28,9 @@
  * and 4 links to neighbours. User may store some additional data expanding template.
  * Implementation does not use pointers and dynamic memory
  * but it uses std::vector and indices.
- * Maximum quad tree resolution is 8 levels.
+ * Maximum quad tree resolution depends on type of nodes' indices:
+ * it is 8 levels for default 16-bit indices and 16 levels for 32-bit ones
+ * (see getMaxResolution()).
  * Minimum resolution is 1.
  *
  * QuadTree may be built for square matrix of size (2^n + 1).
@@ -40,16 +42,19 @@
 #include <vector>
 #include <stdexcept>
 #include <utility>
+#include <limits>
 #include <cassert>
 
 namespace hydra{
 
 namespace common{
     
-template <typename NODE_DATA>
+template <typename NODE_DATA, typename NODE_ID = unsigned short>
 class QuadTree{
 
 public:
+    ///type of node's index (it limits number of nodes, so resolution of tree)
+    typedef NODE_ID NodeId;
 
     /** 
      * \brief Represents node of QuadTree.
@@ -60,13 +65,13 @@ public:
      */
     struct Node{
         ///children (if 0 - no son)
-        unsigned short nodes[4];
+        NodeId nodes[4];
 
         ///neighbours (0 - no neighbour)
-        unsigned short neighbours[4];
+        NodeId neighbours[4];
 
         ///parent node
-        unsigned short parent;
+        NodeId parent;
 
         ///your data
         NODE_DATA data;
@@ -77,7 +82,7 @@ public:
         ///virtual empty destructor
         virtual ~NodeFunctor(){}
         ///operator() to handle node. User should implement it.
-        virtual void operator()(QuadTree<NODE_DATA>& tree, Node& inNode) = 0;
+        virtual void operator()(QuadTree<NODE_DATA, NODE_ID>& tree, Node& inNode) = 0;
     };
 
 
@@ -103,13 +108,13 @@ public:
     QuadTree(unsigned int inResolution);
     
     ///returns reference to node with specified id
-    inline Node& getNode(unsigned short inIndex);
+    inline Node& getNode(NodeId inIndex);
 
     ///returns const reference to node with specified id
-    inline const Node& getNode(unsigned short inIndex) const;
+    inline const Node& getNode(NodeId inIndex) const;
 
     ///returns id of node specified by stack of positions
-    inline unsigned short getNodeID(const std::vector<int>& inStack) const;
+    inline NodeId getNodeID(const std::vector<int>& inStack) const;
     
     ///returns reference to root node
     inline Node& getRoot();
@@ -117,6 +122,26 @@ public:
     ///returns const reference to root node
     inline const Node& getRoot() const;
 
+    ///returns maximal resolution for which indices of all nodes fit in NodeId
+    static inline unsigned int getMaxResolution(){
+        //each level adds 4 times more nodes than the previous one
+        const double maxId = static_cast<double>(std::numeric_limits<NodeId>::max());
+        unsigned int result = 1;
+        double nextNodeNum = 5.0;
+        while(result < 16 && nextNodeNum - 1.0 <= maxId){
+            ++result;
+            nextNodeNum = nextNodeNum * 4.0 + 1.0;
+        }
+        return result;
+    }
+
+    ///returns number of nodes in tree of specified resolution (1 + 4 + 16 + ...)
+    static inline unsigned int getNodeNum(unsigned int inResolution){
+        unsigned int result = 0;
+        for(unsigned int i = 0, nextNum = 1; i < inResolution; ++i, nextNum <<= 2) result += nextNum;
+        return result;
+    }
+
     ///returns value of resoultion (log2(size - 1))
     inline unsigned int getResolution() const{
         return mResolution;
@@ -126,7 +151,7 @@ public:
     ///Works recursively. You should specify oprientation of subtrees:
     ///for example, if NORTH is specified, first subtree argument will be north subtree
     ///and second one is southern.
-    void clueSubtrees(unsigned short inFirstTree, unsigned short inSecondTree, NeighbourPos inOrient);
+    void clueSubtrees(NodeId inFirstTree, NodeId inSecondTree, NeighbourPos inOrient);
 
     ///returns opposite direction for specified one.
     ///For example: if NORTH is specified - SOUTH will be returned.
@@ -214,8 +239,8 @@ private:
 };
 
 
-template <typename NODE_DATA>
-void QuadTree<NODE_DATA>::clueSubtrees(unsigned short inFirstTree, unsigned short inSecondTree, NeighbourPos inOrient){
+template <typename NODE_DATA, typename NODE_ID>
+void QuadTree<NODE_DATA, NODE_ID>::clueSubtrees(NodeId inFirstTree, NodeId inSecondTree, NeighbourPos inOrient){
     //first clue roots
     getNode(inFirstTree).neighbours[getOpposite(inOrient)] = inSecondTree;
     getNode(inSecondTree).neighbours[inOrient] = inFirstTree;
@@ -223,7 +248,7 @@ void QuadTree<NODE_DATA>::clueSubtrees(unsigned short inFirstTree, unsigned shor
     //now we should clue subtrees
     //we will always have only 2 border elements
     std::pair<NodePos, NodePos> borders = getQuadsByDirection(inOrient);
-    unsigned short borderNodes[2];
+    NodeId borderNodes[2];
     //get border nodes' codes (for first subtree)
     borderNodes[0] = getNode(inFirstTree).nodes[getOpposite(borders.first, inOrient)];
     borderNodes[1] = getNode(inFirstTree).nodes[getOpposite(borders.second, inOrient)];
@@ -236,18 +261,12 @@ void QuadTree<NODE_DATA>::clueSubtrees(unsigned short inFirstTree, unsigned shor
 }
 
 
-template <typename NODE_DATA>
-QuadTree<NODE_DATA>::QuadTree(unsigned int inResolution): mResolution(inResolution){
-    if(inResolution > 8) throw std::runtime_error("Can't create quad tree with such resolution. Too big.");
+template <typename NODE_DATA, typename NODE_ID>
+QuadTree<NODE_DATA, NODE_ID>::QuadTree(unsigned int inResolution): mResolution(inResolution){
+    if(inResolution > getMaxResolution()) throw std::runtime_error("Can't create quad tree with such resolution. Too big.");
     else if(inResolution < 1) throw std::runtime_error("Too small resolution to build quad tree");
 
-    size_t size = 0;
-    unsigned int nextNum = 1;
-    for(size_t i = 0; i < inResolution; ++i){
-        size += nextNum;
-        nextNum <<= 2; // 1 4 16 64 ...
-    }
-
+    const size_t size = getNodeNum(inResolution);
     mNodes.resize(size);
 
     //for 1 level we have root only
@@ -313,19 +332,19 @@ QuadTree<NODE_DATA>::QuadTree(unsigned int inResolution): mResolution(inResoluti
     clueSubtrees(1 + 2 * stride, 1 + 3 * stride, SOUTH);
 }
 
-template<typename NODE_DATA>
-typename QuadTree<NODE_DATA>::Node& QuadTree<NODE_DATA>::getNode(unsigned short inIndex){
+template<typename NODE_DATA, typename NODE_ID>
+typename QuadTree<NODE_DATA, NODE_ID>::Node& QuadTree<NODE_DATA, NODE_ID>::getNode(NodeId inIndex){
     return mNodes.at(inIndex);
 }
 
-template<typename NODE_DATA>
-const typename QuadTree<NODE_DATA>::Node& QuadTree<NODE_DATA>::getNode(unsigned short inIndex) const{
+template<typename NODE_DATA, typename NODE_ID>
+const typename QuadTree<NODE_DATA, NODE_ID>::Node& QuadTree<NODE_DATA, NODE_ID>::getNode(NodeId inIndex) const{
     return mNodes.at(inIndex);
 }
 
-template<typename NODE_DATA>
-unsigned short QuadTree<NODE_DATA>::getNodeID(const std::vector<int>& inStack) const{
-    unsigned short result = 0;
+template<typename NODE_DATA, typename NODE_ID>
+typename QuadTree<NODE_DATA, NODE_ID>::NodeId QuadTree<NODE_DATA, NODE_ID>::getNodeID(const std::vector<int>& inStack) const{
+    NodeId result = 0;
     for(size_t i = 0; i < inStack.size(); ++i){
         assert(inStack[i] < 4 && inStack[i] >= 0);
         result = getNode(result).nodes[inStack[i]];
@@ -333,23 +352,23 @@ unsigned short QuadTree<NODE_DATA>::getNodeID(const std::vector<int>& inStack) c
     return result;
 }
 
-template<typename NODE_DATA>
-typename QuadTree<NODE_DATA>::Node& QuadTree<NODE_DATA>::getRoot(){
+template<typename NODE_DATA, typename NODE_ID>
+typename QuadTree<NODE_DATA, NODE_ID>::Node& QuadTree<NODE_DATA, NODE_ID>::getRoot(){
     return mNodes.at(0);
 }
 
-template<typename NODE_DATA>
-const typename QuadTree<NODE_DATA>::Node& QuadTree<NODE_DATA>::getRoot() const{
+template<typename NODE_DATA, typename NODE_ID>
+const typename QuadTree<NODE_DATA, NODE_ID>::Node& QuadTree<NODE_DATA, NODE_ID>::getRoot() const{
     return mNodes.at(0);
 }
 
 ///helper function (for internal use only)
-template<typename NODE_DATA>
-void doApplyToLevel(QuadTree<NODE_DATA>& tree, 
-                    typename QuadTree<NODE_DATA>::Node& node, 
+template<typename NODE_DATA, typename NODE_ID>
+void doApplyToLevel(QuadTree<NODE_DATA, NODE_ID>& tree, 
+                    typename QuadTree<NODE_DATA, NODE_ID>::Node& node, 
                     size_t currentLevel, 
                     size_t level, 
-                    typename QuadTree<NODE_DATA>::NodeFunctor& func){
+                    typename QuadTree<NODE_DATA, NODE_ID>::NodeFunctor& func){
 
     if(currentLevel < level){
         if(!(node.nodes[0] && node.nodes[1] && node.nodes[2] && node.nodes[3])){
@@ -369,8 +388,8 @@ void doApplyToLevel(QuadTree<NODE_DATA>& tree,
 }
 
 ///applies user's function to all nodes of specified level in quad tree
-template<typename NODE_DATA>
-void applyToLevel(QuadTree<NODE_DATA>& inTree, size_t inLevel, typename QuadTree<NODE_DATA>::NodeFunctor& inFunc){
+template<typename NODE_DATA, typename NODE_ID>
+void applyToLevel(QuadTree<NODE_DATA, NODE_ID>& inTree, size_t inLevel, typename QuadTree<NODE_DATA, NODE_ID>::NodeFunctor& inFunc){
     doApplyToLevel(inTree, inTree.getRoot(), 0, inLevel, inFunc);
 }
 
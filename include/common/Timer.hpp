@@ -64,6 +64,12 @@ public:
         return static_cast<long>((boost::posix_time::microsec_clock::universal_time() - mStartTime).total_milliseconds());
     }
 
+    ///Returns amount of time elapsed from timer's start in microseconds.
+    ///Produce undefined behaviour if timer hasn't been started yet.
+    inline long getMicroseconds(){
+        return static_cast<long>((boost::posix_time::microsec_clock::universal_time() - mStartTime).total_microseconds());
+    }
+
 private:
     boost::posix_time::ptime mStartTime;
 };
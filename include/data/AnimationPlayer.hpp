@@ -0,0 +1,253 @@
+//AnimationPlayer.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef ANIMATION_PLAYER_HPP__
+#define ANIMATION_PLAYER_HPP__
+
+/**
+ * \class hydra::data::AnimationPlayer
+ * \brief Samples and blends animations to a Pose.
+ *
+ * Player has a number of layers, each one plays an animation with its
+ * own time, speed and weight. Weight of a layer may be faded to some
+ * value during specified time, crossFade() uses it to switch smoothly
+ * from current animations to a new one.
+ *
+ * Animations are sampled between two nearest frames, orientations are
+ * interpolated along the shortest path with normalized lerp (fast, used by
+ * default) or with slerp (constant angular speed).
+ *
+ * Ordinary layers are blended together: pose is the weighted average of
+ * their samples (weights are normalized). Then additive layers are applied
+ * in order of adding: difference between the sample of additive layer and
+ * its reference pose (the first frame by default) is added to the pose
+ * with the weight of layer. Each layer may have per-bone mask, so an
+ * animation may affect only a part of the body (for example, upper body
+ * shooting over walking legs). If no layer affects a bone, it gets the
+ * identity transformation.
+ *
+ * Player doesn't care about space of bone transformations, it only
+ * requires all the animations to have the same bones. Frames of
+ * animations added to Model are transformations from bind pose,
+ * so the evaluated pose may be passed directly to MeshSkinner::Palette.
+ *
+ * evaluate() uses internal buffers, so one player must not be evaluated
+ * by several threads at once; different players may be. updateAndEvaluate()
+ * processes many players (for example, a crowd) in parallel.
+ *
+ * \see hydra::data::Pose
+ * \see hydra::data::Animation
+ */
+
+#include "data/Animation.hpp"
+#include "data/Pose.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace hydra{
+
+namespace data{
+
+class AnimationPlayer{
+
+public:
+    ///interpolation of orientations
+    enum Interpolation{
+        ///normalized linear interpolation
+        NLERP = 0,
+        ///spherical linear interpolation
+        SLERP
+    };
+
+    ///animation played by player
+    struct Layer{
+        ///builds empty layer
+        Layer();
+
+        ///played animation
+        hydra::data::AnimationPtr mAnimation;
+        ///current time (seconds)
+        float mTime;
+        ///speed of playing (1 is normal, negative values play backwards)
+        float mSpeed;
+        ///weight of layer
+        float mWeight;
+        ///weight which layer is faded to
+        float mTargetWeight;
+        ///change of weight per second while fading
+        float mFadeSpeed;
+        ///animation is looped (otherwise it stops at the last frame)
+        bool mLoop;
+        ///layer is additive
+        bool mAdditive;
+        ///layer is removed when its weight is faded to zero
+        bool mRemoveWhenFaded;
+        ///\brief Weights of bones (multiplied by weight of layer).
+        ///
+        ///Must have a value for each bone, all the bones have weight 1 if it is empty.
+        std::vector<float> mBoneMask;
+        ///pose which additive layer is relative to
+        hydra::data::Pose mReference;
+    };
+
+    ///container for layers
+    typedef std::vector<Layer> LayerCont;
+
+    ///builds player without layers
+    explicit AnimationPlayer(size_t inBoneNum = 0, AnimationPlayer::Interpolation inInterpolation = NLERP);
+
+    ///\brief Adds ordinary layer.
+    ///
+    ///Returns index of layer.
+    size_t addLayer(hydra::data::AnimationPtr inAnimation, float inWeight = 1.0f, bool inLoop = true);
+
+    ///\brief Adds additive layer.
+    ///
+    ///Reference pose is the first frame of animation, it may be changed later.
+    ///Returns index of layer.
+    size_t addAdditiveLayer(hydra::data::AnimationPtr inAnimation, float inWeight = 1.0f, bool inLoop = true);
+
+    ///returns layer
+    inline AnimationPlayer::Layer& getLayer(size_t inLayer){
+        return mLayers[inLayer];
+    }
+
+    ///returns layer
+    inline const AnimationPlayer::Layer& getLayer(size_t inLayer) const{
+        return mLayers[inLayer];
+    }
+
+    ///returns number of layers
+    inline size_t getLayerNum() const{
+        return mLayers.size();
+    }
+
+    ///removes layer (indices of the next layers are decreased)
+    void removeLayer(size_t inLayer);
+
+    ///removes all the layers
+    void clearLayers();
+
+    ///\brief Changes weight of layer to inTargetWeight during inDuration seconds.
+    ///
+    ///Weight is set immediately if duration is not positive.
+    void fadeLayer(size_t inLayer, float inTargetWeight, float inDuration);
+
+    ///\brief Switches to animation smoothly.
+    ///
+    ///All the ordinary layers are faded out (and removed), new layer is faded in.
+    ///Additive layers are not changed. Returns index of new layer.
+    size_t crossFade(hydra::data::AnimationPtr inAnimation, float inDuration, bool inLoop = true);
+
+    ///advances time of layers and their fading
+    void update(float inDeltaSeconds);
+
+    ///evaluates pose for current time of layers
+    void evaluate(hydra::data::Pose& outPose) const;
+
+    ///returns number of bones of evaluated poses
+    inline size_t getBoneNum() const{
+        return mBoneNum;
+    }
+
+    ///sets number of bones of evaluated poses
+    inline void setBoneNum(size_t inBoneNum){
+        mBoneNum = inBoneNum;
+    }
+
+    ///returns interpolation of orientations
+    inline AnimationPlayer::Interpolation getInterpolation() const{
+        return mInterpolation;
+    }
+
+    ///sets interpolation of orientations
+    inline void setInterpolation(AnimationPlayer::Interpolation inInterpolation){
+        mInterpolation = inInterpolation;
+    }
+
+    ///\brief Samples animation at specified time.
+    ///
+    ///Time is wrapped if animation is looped, otherwise it is clamped.
+    ///The last frame of looped animation is interpolated with the first one.
+    static void sample(const hydra::data::Animation& inAnimation, float inTime, bool inLoop,
+                       AnimationPlayer::Interpolation inInterpolation, hydra::data::Pose& outPose);
+
+    ///\brief Blends poses with weights.
+    ///
+    ///Weights are normalized, orientations are blended along the shortest path
+    ///(relative to the first pose with non-zero weight).
+    static void blend(const hydra::data::Pose* const* inPoses, const float* inWeights, size_t inPoseNum, hydra::data::Pose& outPose);
+
+    ///\brief Adds difference between inAdditive and inReference to pose.
+    ///
+    ///inBoneMask may be 0 (all the bones have weight 1).
+    ///Weights are clamped to 1.
+    static void addAdditive(const hydra::data::Pose& inAdditive, const hydra::data::Pose& inReference, float inWeight,
+                            const float* inBoneMask, hydra::data::Pose& inoutPose);
+
+    ///\brief Updates and evaluates many players in parallel.
+    ///
+    ///inThreadNum == 0 means number of hardware threads.
+    static void updateAndEvaluate(AnimationPlayer* const* inPlayers, size_t inPlayerNum, float inDeltaSeconds,
+                                  hydra::data::Pose* outPoses, unsigned int inThreadNum = 0);
+
+private:
+    ///layers
+    LayerCont mLayers;
+
+    ///number of bones
+    size_t mBoneNum;
+
+    ///interpolation of orientations
+    Interpolation mInterpolation;
+
+    ///samples of layers (buffers of evaluate())
+    mutable std::vector<hydra::data::Pose> mSamples;
+
+    ///sums of weights of bones (buffer of evaluate())
+    mutable std::vector<float> mWeightSums;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
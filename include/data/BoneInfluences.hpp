@@ -0,0 +1,199 @@
+//BoneInfluences.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef BONE_INFLUENCES_HPP__
+#define BONE_INFLUENCES_HPP__
+
+/**
+ * \class hydra::data::BoneInfluences
+ * \brief Compact bone indices and weights of mesh's vertices.
+ *
+ * Mesh keeps MAX_BONES_PER_VERTEX ints and floats per vertex (72 bytes)
+ * which are mostly zeros. BoneInfluences keeps up to 4 influences per
+ * vertex: 4 x 8-bit bone indices and 4 x unsigned normalized weights
+ * (8 or 16 bits), so vertex needs 8 or 12 bytes.
+ *
+ * build() sorts influences of each vertex by weight, keeps 4 heaviest
+ * ones and renormalizes them. Quantized weights of a vertex always sum
+ * to exactly 1 (255 or 65535), rounding error goes to the heaviest one.
+ * Weight mass dropped by truncation is reported by getReport().
+ * Unused slots have zero weight and index 0.
+ *
+ * Data is interleaved (indices, then weights) and may be uploaded to
+ * video memory as is:
+ *  - indices: 4 x GL_UNSIGNED_BYTE at getIndexOffset(), not normalized;
+ *  - weights: 4 x GL_UNSIGNED_BYTE or GL_UNSIGNED_SHORT at getWeightOffset(),
+ *    normalized;
+ *  - stride is getStride().
+ * See shaders/cg/v_shader_anim.cg. On CPU the data is used by
+ * MeshSkinner::setup().
+ *
+ * \see hydra::data::Mesh
+ * \see hydra::data::MeshSkinner
+ */
+
+#include "data/Mesh.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+namespace hydra{
+
+namespace data{
+
+class BoneInfluences{
+
+public:
+    ///maximal number of influences per vertex
+    static const int MAX_INFLUENCES = 4;
+
+    ///maximal bone index
+    static const int MAX_BONE = 255;
+
+    ///encoding of weights
+    enum WeightType{
+        ///8-bit unsigned normalized
+        UNORM8 = 0,
+        ///16-bit unsigned normalized
+        UNORM16
+    };
+
+    ///statistics of conversion
+    struct Report{
+        ///builds empty report
+        inline Report(): truncatedVertexNum(0), maxDroppedWeight(0.0f), totalDroppedWeight(0.0), maxQuantizationError(0.0f){
+
+        }
+
+        ///number of vertices which had more than MAX_INFLUENCES influences
+        size_t truncatedVertexNum;
+        ///maximal weight mass dropped from a vertex
+        float maxDroppedWeight;
+        ///sum of dropped weight mass of all vertices
+        double totalDroppedWeight;
+        ///maximal difference between renormalized and quantized weight
+        float maxQuantizationError;
+    };
+
+    ///builds empty container
+    BoneInfluences();
+
+    ///\brief Converts bone arrays of mesh.
+    ///
+    ///Mesh without bones gives empty container.
+    ///Throws std::out_of_range if some bone index is bigger than MAX_BONE.
+    void build(const hydra::data::Mesh& inMesh, BoneInfluences::WeightType inWeightType = UNORM8);
+
+    ///drops data
+    void clear();
+
+    ///returns number of vertices
+    inline size_t getVertexNum() const{
+        return mStride? mData.size() / mStride: 0;
+    }
+
+    ///returns encoding of weights
+    inline BoneInfluences::WeightType getWeightType() const{
+        return mWeightType;
+    }
+
+    ///returns size of single vertex's data in bytes
+    inline size_t getStride() const{
+        return mStride;
+    }
+
+    ///returns offset of indices from the start of vertex's data
+    inline size_t getIndexOffset() const{
+        return 0;
+    }
+
+    ///returns offset of weights from the start of vertex's data
+    inline size_t getWeightOffset() const{
+        return MAX_INFLUENCES;
+    }
+
+    ///returns interleaved data
+    inline const boost::uint8_t* getData() const{
+        return mData.empty()? 0: &mData[0];
+    }
+
+    ///returns size of data in bytes
+    inline size_t getDataSize() const{
+        return mData.size();
+    }
+
+    ///returns bone index of vertex's influence
+    inline int getBone(size_t inVertex, int inSlot) const{
+        return mData[inVertex * mStride + inSlot];
+    }
+
+    ///returns weight of vertex's influence
+    float getWeight(size_t inVertex, int inSlot) const;
+
+    ///\brief Converts back to bone arrays of Mesh.
+    ///
+    ///Unused slots get zero weight and index 0.
+    void unpack(hydra::data::Mesh::BoneCont& outBones, hydra::data::Mesh::BoneWeightCont& outWeights) const;
+
+    ///returns statistics of the last build()
+    inline const BoneInfluences::Report& getReport() const{
+        return mReport;
+    }
+
+private:
+    ///interleaved indices and weights
+    std::vector<boost::uint8_t> mData;
+
+    ///encoding of weights
+    WeightType mWeightType;
+
+    ///size of vertex's data
+    size_t mStride;
+
+    ///statistics
+    Report mReport;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -25,6 +25,9 @@
  * or you want to make some implementation-specific
  * stuff you should look to implementation details
  * (particularly to HeightMapGen).
+ * Heights may be read one by one (get() is virtual) or in bulk with
+ * getHeights() and getTile(), which should be used for processing
+ * of whole lines or tiles.
  *
  * \see hydra::data::HeightMapGen
  * 
@@ -92,6 +95,22 @@ public:
     inline float operator[](unsigned int inIndex) const{
         return get(inIndex);
     }
+
+    ///\brief Reads inNum heights starting from specified index.
+    ///
+    ///Implementations override it to read heights without a virtual call per height.
+    virtual void getHeights(unsigned int inIndex, unsigned int inNum, float* outHeights) const{
+        for(unsigned int i = 0; i < inNum; ++i) outHeights[i] = get(inIndex + i);
+    }
+
+    ///\brief Reads rectangular part of height map.
+    ///
+    ///Heights are written line by line, outHeights must have place for inWidth * inHeight values.
+    inline void getTile(unsigned int inFirstLine, unsigned int inFirstColumn, unsigned int inWidth, unsigned int inHeight, float* outHeights) const{
+        for(unsigned int i = 0; i < inHeight; ++i){
+            getHeights((inFirstLine + i) * getSize() + inFirstColumn, inWidth, outHeights + i * inWidth);
+        }
+    }
     
     ///get width of heightmap (height supposed to be same)
     virtual unsigned int getSize() const = 0;
@@ -100,12 +119,41 @@ public:
 ///smart pointer to heightmap
 typedef hydra::common::SharedPtr<HeightMap>::Type HeightMapPtr;
 
+///\brief Converts stored heights of HeightMapGen to float.
+///
+///Path is selected at compile time: non-integer values are returned 'as is',
+///integer ones are scaled to interval [inMinHeight, inMinHeight + inRange]:
+///numeric_limits<T>::min() gives inMinHeight (for signed types too) and
+///numeric_limits<T>::max() gives inMinHeight + inRange.
+template <typename T, bool IsInteger = std::numeric_limits<T>::is_integer>
+struct HeightDecoder{
+    ///returns value 'as is'
+    static inline float decode(T inValue, float /*inMinHeight*/, float /*inRange*/){
+        return static_cast<float>(inValue);
+    }
+};
+
+///decoder of integer heights
+template <typename T>
+struct HeightDecoder<T, true>{
+    ///decodes integer value using min height and range of heights
+    static inline float decode(T inValue, float inMinHeight, float inRange){
+        //max - min computed in unsigned arithmetic (no overflow for signed types)
+        const unsigned int totalNumbersNum = static_cast<unsigned int>(std::numeric_limits<T>::max()) -
+                                             static_cast<unsigned int>(std::numeric_limits<T>::min());
+        //signed values are offset by -min(), so all integer types share the same mapping
+        float floatValue = (static_cast<float>(inValue) - static_cast<float>(std::numeric_limits<T>::min())) / totalNumbersNum;
+        float result = static_cast<float>(inMinHeight + floatValue * inRange);
+        return result;
+    }
+};
+
 template <typename T>
 class HeightMapGen: public HeightMap{
 
 public:
     ///ctor. Data which is passed will be released in destructor.
-    inline HeightMapGen(unsigned int inSize, T* inData): mData(inData), mSize(inSize){
+    inline HeightMapGen(unsigned int inSize, T* inData): mMaxHeight(0.0f), mMinHeight(0.0f), mData(inData), mSize(inSize){
         
     }
 
@@ -169,33 +217,23 @@ public:
         assert(mData);
         assert(inIndex < (mSize * mSize));
 
-        //get value
-        T value = mData[inIndex];
-        
-        //decode value
-        if(!std::numeric_limits<T>::is_integer){
-            //for non-integer types just return value
-            return static_cast<float>(value);
-        }
-        else{
-            //integer types should be converted to float
-            //using max and min values
-            return decode(value);
-        }
+        assert(!std::numeric_limits<T>::is_integer || mMinHeight < mMaxHeight);
+        return HeightDecoder<T>::decode(mData[inIndex], mMinHeight, mMaxHeight - mMinHeight);
     }
 
-private:
-    ///decodes integer value and converts to float in specified interval [MinHeight, MaxHeight].
-    inline float decode(T inValue) const{
-        assert(mMinHeight < mMaxHeight);
-        unsigned int totalNumbersNum = 
-                static_cast<unsigned int>((std::numeric_limits<T>::min() < 0)?(- std::numeric_limits<T>::min()): std::numeric_limits<T>::min()) +
-                std::numeric_limits<T>::max();
-        float floatValue = static_cast<float>(inValue) / totalNumbersNum;
-        float result = static_cast<float>(mMinHeight + floatValue * abs(mMaxHeight - mMinHeight));
-        return result;
+    ///Reads converted values (see get()) of inNum heights starting from specified index.
+    virtual void getHeights(unsigned int inIndex, unsigned int inNum, float* outHeights) const{
+        assert(mData);
+        assert(inIndex + inNum <= (mSize * mSize));
+
+        assert(!std::numeric_limits<T>::is_integer || mMinHeight < mMaxHeight);
+        const T* data = mData + inIndex;
+        const float minHeight = mMinHeight;
+        const float range = mMaxHeight - mMinHeight;
+        for(unsigned int i = 0; i < inNum; ++i) outHeights[i] = HeightDecoder<T>::decode(data[i], minHeight, range);
     }
 
+private:
     ///maximum height value
     float mMaxHeight;
 
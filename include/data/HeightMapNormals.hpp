@@ -0,0 +1,91 @@
+//HeightMapNormals.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef HEIGHT_MAP_NORMALS_HPP__
+#define HEIGHT_MAP_NORMALS_HPP__
+
+/**
+ * \class hydra::data::HeightMapNormals
+ * \brief Calculates vertex normals of regular grid of heights.
+ *
+ * Vertex of line i and column j has coordinates (i, height, j).
+ * Every cell of grid is split into two triangles by the diagonal
+ * from its (i - 1, j - 1) corner to (i + 1, j + 1) one (as terrain
+ * preprocessor does), so normal of vertex is the normalized sum of
+ * (not normalized) normals of up to 6 triangles around it.
+ *
+ * Lines are processed by 4 vertices at a time with SSE (if available).
+ * Results are the same as the ones of scalar calculation.
+ *
+ * \see hydra::data::HeightMap
+ */
+
+#include "math/Vector3D.hpp"
+
+#include <vector>
+
+namespace hydra{
+
+namespace data{
+
+class HeightMap;
+
+class HeightMapNormals{
+
+public:
+    ///\brief Calculates unit normals of vertices of a line.
+    ///
+    ///inPrevious and inNext are heights of neighbouring lines (line - 1
+    ///and line + 1), they are 0 for the first and the last line.
+    ///All lines and outputs have inSize values.
+    static void calcLine(const float* inPrevious, const float* inLine, const float* inNext, unsigned int inSize, 
+                         float* outX, float* outY, float* outZ);
+
+    ///\brief Calculates unit normals of all vertices of height map.
+    ///
+    ///Normals are stored in the same order as heights.
+    static void calc(const hydra::data::HeightMap& inHeights, std::vector<hydra::math::Vector3D>& outNormals);
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -24,7 +24,9 @@
  * some kinds of texture objects.
  * It incapsulates:
  *  - pixels (bytes)
- *  - format of bytes (mode)
+ *  - format of bytes (mode); colour images are 8 bits per channel,
+ *    single channel modes with higher precision are used for data
+ *    such as height maps (values are stored in native byte order)
  *  - size (width and height in pixels)
  * 
  * The pimpl idiom is used to separate interface from implementation.
@@ -54,7 +56,13 @@ public:
     enum Mode{
         NONE = 0,
         RGBA,
-        RGB
+        RGB,
+        ///single channel, 16-bit unsigned integer per pixel (e.g. height maps).
+        ///Loaders produce it only on request (see hydra::loading::initFactories).
+        LUMINANCE16,
+        ///single channel, 32-bit float per pixel (e.g. height maps).
+        ///Loaders produce it only on request (see hydra::loading::initFactories).
+        LUMINANCE_FLOAT
     };
 
     ///creates empty Image object
@@ -103,6 +111,9 @@ public:
     ///sets pixel format
     void setMode(Image::Mode inMode);
 
+    ///returns size of pixel (in bytes) of specified format
+    static unsigned int getBytesPerPixel(Image::Mode inMode);
+
 private:
     ///pimpl idiom
     struct ImageImpl;
@@ -0,0 +1,327 @@
+//IndexBuffer.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef INDEX_BUFFER_HPP__
+#define INDEX_BUFFER_HPP__
+
+/**
+ * \class hydra::data::IndexBuffer
+ * \brief Container of vertex indices with adaptive width.
+ *
+ * Indices are stored as 16-bit values while all of them fit into 16 bits
+ * and as 32-bit values otherwise. Buffer is widened automatically when
+ * a big index is added; assign() always picks the smallest width.
+ * Values are always read and written as unsigned int, so code which
+ * processes indices does not depend on width. Raw data (getData(),
+ * getDataSize(), getWidth()) may be passed to video card as is.
+ *
+ * Buffer may be encoded to compact byte stream for storage: the number of
+ * indices and differences of consecutive indices (zigzag-encoded) are
+ * written as variable-length integers (7 bits per byte).
+ *
+ * \see hydra::data::Mesh
+ */
+
+#include <vector>
+#include <cstddef>
+#include <iterator>
+#include <cassert>
+#include <boost/cstdint.hpp>
+
+namespace hydra{
+
+namespace data{
+
+class IndexBuffer{
+
+public:
+    ///type of index
+    typedef unsigned int value_type;
+
+    ///container to copy indices to (and from)
+    typedef std::vector<value_type> IndexCont;
+
+    ///width of stored index (in bytes)
+    enum Width{
+        WIDTH_16 = 2,
+        WIDTH_32 = 4
+    };
+
+    ///random access iterator which returns indices by value
+    class const_iterator{
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef IndexBuffer::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type* pointer;
+        typedef value_type reference;
+
+        inline const_iterator(): mBuffer(0), mPos(0){
+
+        }
+
+        inline const_iterator(const IndexBuffer* inBuffer, size_t inPos): mBuffer(inBuffer), mPos(inPos){
+
+        }
+
+        inline value_type operator*() const{
+            return (*mBuffer)[mPos];
+        }
+
+        inline value_type operator[](difference_type inOffset) const{
+            return (*mBuffer)[mPos + inOffset];
+        }
+
+        inline const_iterator& operator++(){
+            ++mPos;
+            return *this;
+        }
+
+        inline const_iterator operator++(int){
+            const_iterator result(*this);
+            ++mPos;
+            return result;
+        }
+
+        inline const_iterator& operator--(){
+            --mPos;
+            return *this;
+        }
+
+        inline const_iterator operator--(int){
+            const_iterator result(*this);
+            --mPos;
+            return result;
+        }
+
+        inline const_iterator& operator+=(difference_type inOffset){
+            mPos += inOffset;
+            return *this;
+        }
+
+        inline const_iterator& operator-=(difference_type inOffset){
+            mPos -= inOffset;
+            return *this;
+        }
+
+        inline const_iterator operator+(difference_type inOffset) const{
+            return const_iterator(mBuffer, mPos + inOffset);
+        }
+
+        inline const_iterator operator-(difference_type inOffset) const{
+            return const_iterator(mBuffer, mPos - inOffset);
+        }
+
+        inline difference_type operator-(const const_iterator& rhv) const{
+            return static_cast<difference_type>(mPos) - static_cast<difference_type>(rhv.mPos);
+        }
+
+        inline bool operator==(const const_iterator& rhv) const{
+            return mPos == rhv.mPos;
+        }
+
+        inline bool operator!=(const const_iterator& rhv) const{
+            return mPos != rhv.mPos;
+        }
+
+        inline bool operator<(const const_iterator& rhv) const{
+            return mPos < rhv.mPos;
+        }
+
+        inline bool operator>(const const_iterator& rhv) const{
+            return mPos > rhv.mPos;
+        }
+
+        inline bool operator<=(const const_iterator& rhv) const{
+            return mPos <= rhv.mPos;
+        }
+
+        inline bool operator>=(const const_iterator& rhv) const{
+            return mPos >= rhv.mPos;
+        }
+
+    private:
+        const IndexBuffer* mBuffer;
+        size_t mPos;
+    };
+
+    ///indices can't be changed through iterators
+    typedef const_iterator iterator;
+
+    ///builds empty 16-bit buffer
+    inline IndexBuffer(): mWidth(WIDTH_16){
+
+    }
+
+    ///builds buffer of the smallest width which holds specified indices
+    explicit IndexBuffer(const IndexBuffer::IndexCont& inIndices);
+
+    ///returns number of indices
+    inline size_t size() const{
+        return (mWidth == WIDTH_16)? mData16.size(): mData32.size();
+    }
+
+    ///returns true if there are no indices
+    inline bool empty() const{
+        return size() == 0;
+    }
+
+    ///returns index at specified position
+    inline value_type operator[](size_t inPos) const{
+        assert(inPos < size());
+        return (mWidth == WIDTH_16)? mData16[inPos]: mData32[inPos];
+    }
+
+    ///returns first index
+    inline value_type front() const{
+        return (*this)[0];
+    }
+
+    ///returns last index
+    inline value_type back() const{
+        return (*this)[size() - 1];
+    }
+
+    ///changes index at specified position (buffer is widened if needed)
+    inline void set(size_t inPos, value_type inIndex){
+        assert(inPos < size());
+        if(mWidth == WIDTH_32) mData32[inPos] = inIndex;
+        else if(inIndex <= MAX_INDEX_16) mData16[inPos] = static_cast<boost::uint16_t>(inIndex);
+        else{
+            setWidth(WIDTH_32);
+            mData32[inPos] = inIndex;
+        }
+    }
+
+    ///adds index to the end (buffer is widened if needed)
+    inline void push_back(value_type inIndex){
+        if(mWidth == WIDTH_32) mData32.push_back(inIndex);
+        else if(inIndex <= MAX_INDEX_16) mData16.push_back(static_cast<boost::uint16_t>(inIndex));
+        else{
+            setWidth(WIDTH_32);
+            mData32.push_back(inIndex);
+        }
+    }
+
+    ///changes number of indices (new indices are zero)
+    void resize(size_t inSize);
+
+    ///reserves memory for specified number of indices
+    void reserve(size_t inSize);
+
+    ///drops all indices (width becomes 16 bits)
+    void clear();
+
+    ///exchanges contents of buffers
+    void swap(IndexBuffer& inoutBuffer);
+
+    ///replaces indices with specified ones using the smallest width which holds them
+    void assign(const IndexBuffer::IndexCont& inIndices);
+
+    ///copies indices to container
+    void copyTo(IndexBuffer::IndexCont& outIndices) const;
+
+    ///returns iterator to the first index
+    inline const_iterator begin() const{
+        return const_iterator(this, 0);
+    }
+
+    ///returns iterator past the last index
+    inline const_iterator end() const{
+        return const_iterator(this, size());
+    }
+
+    ///returns width of stored indices
+    inline IndexBuffer::Width getWidth() const{
+        return mWidth;
+    }
+
+    ///\brief Changes width of stored indices.
+    ///
+    ///Returns false (and does nothing) if some index does not fit into 16 bits.
+    bool setWidth(IndexBuffer::Width inWidth);
+
+    ///returns raw data (getDataSize() bytes of getWidth()-byte indices)
+    inline const void* getData() const{
+        if(empty()) return 0;
+        return (mWidth == WIDTH_16)? static_cast<const void*>(&mData16[0]): static_cast<const void*>(&mData32[0]);
+    }
+
+    ///returns size of raw data in bytes
+    inline size_t getDataSize() const{
+        return size() * mWidth;
+    }
+
+    ///returns the largest index (0 for empty buffer)
+    value_type getMaxIndex() const;
+
+    ///\brief Encodes indices to compact byte stream.
+    ///
+    ///Encoded data is appended to outData.
+    void encode(std::vector<unsigned char>& outData) const;
+
+    ///\brief Replaces indices with ones decoded from byte stream.
+    ///
+    ///Returns number of bytes read.
+    ///Throws std::runtime_error if data is corrupted.
+    size_t decode(const unsigned char* inData, size_t inSize);
+
+    ///largest index which may be stored with 16-bit width
+    static const value_type MAX_INDEX_16 = 0xffff;
+
+private:
+    ///width of indices
+    Width mWidth;
+
+    ///indices if width is 16 bits
+    std::vector<boost::uint16_t> mData16;
+
+    ///indices if width is 32 bits
+    std::vector<boost::uint32_t> mData32;
+};
+
+///compares indices (not widths) of buffers
+bool operator==(const IndexBuffer& lhv, const IndexBuffer& rhv);
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -103,6 +103,9 @@ inline bool compareByOpacity(const hydra::data::Material& inMat1, const hydra::d
     return (inMat1.mTransparency > inMat2.mTransparency);
 }
 
+///compares all the properties of materials (including name and image ids)
+bool operator==(const hydra::data::Material& lhv, const hydra::data::Material& rhv);
+
 } //data namespace
 
 } //hydra
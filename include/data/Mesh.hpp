@@ -34,9 +34,11 @@
 #include <boost/array.hpp>
 
 #include "data/Vertex.hpp"
+#include "data/IndexBuffer.hpp"
 #include "common/SharedPtr.hpp"
 #include "math/Vector3D.hpp"
 #include "math/AABB.hpp"
+#include "math/BoundingSphere.hpp"
 
 namespace hydra{
 
@@ -44,6 +46,9 @@ namespace data{
 
 class Material;
 typedef common::SharedPtr<Material>::Type MaterialPtr;
+class VertexFormat;
+struct PackedVertices;
+struct Skeleton;
 
 class Mesh{
 
@@ -71,9 +76,14 @@ public:
     ///type of index (basic type) needed to build polygons
     typedef unsigned int index_t;
 
+    ///value of remap table entry for dropped vertex
+    static const index_t UNUSED_INDEX = static_cast<index_t>(-1);
+
     ///\brief Face container type.
     ///
-    ///Faces (polygons) contain vertex indices
+    ///Faces (polygons) contain vertex indices.
+    ///Used by processing routines and for remap tables; mesh itself
+    ///keeps indices in hydra::data::IndexBuffer.
     typedef std::vector<index_t> IndexCont;
    
     ///container for vertices (type)
@@ -91,6 +101,58 @@ public:
     ///container for weights
     typedef std::vector<BoneWeights> BoneWeightCont;
 
+    ///\brief Level of detail of mesh.
+    ///
+    ///Simplified triangle list which uses vertices of the mesh.
+    ///\see hydra::data::MeshSimplifier
+    struct LOD{
+        ///indices of simplified triangle list
+        hydra::data::IndexBuffer mIndices;
+        ///\brief Bound of distance from surface of mesh indices (in mesh units).
+        ///
+        ///Simplified surface never deviates more than that (see MeshSimplifier::simplify()),
+        ///so it may be projected to screen as a bound of error.
+        float mError;
+    };
+
+    ///container for levels of detail
+    typedef std::vector<LOD> LODCont;
+
+    ///\brief Part of mesh which came from another mesh.
+    ///
+    ///Merged meshes (see hydra::data::MeshMerger) keep ranges of their
+    ///source meshes, so the sources may still be drawn (or picked) separately.
+    ///Vertex ranges are valid until vertices are renumbered (weldVertices(),
+    ///optimizeVertexFetch()), index ranges are valid until indices are
+    ///reordered (hydra::rendering::MeshOptimizer).
+    struct SubMesh{
+        ///first index of source mesh in mIndices
+        size_t mFirstIndex;
+        ///number of indices of source mesh
+        size_t mIndexNum;
+        ///first vertex of source mesh in mVertices
+        size_t mFirstVertex;
+        ///number of vertices of source mesh
+        size_t mVertexNum;
+    };
+
+    ///container for ranges of source meshes
+    typedef std::vector<SubMesh> SubMeshCont;
+
+    ///bounds of vertices influenced by a bone (in bind pose)
+    struct BoneBounds{
+        ///index of bone
+        int mBone;
+        ///bounds of vertices which have non-zero weight of the bone
+        hydra::math::AABB mAABB;
+    };
+
+    ///container for bounds of bones
+    typedef std::vector<BoneBounds> BoneBoundsCont;
+
+    ///builds empty mesh
+    Mesh();
+
     ///adds new Face to mesh. It is guarantied that last added face 
     ///is added to the end of container (becomes last one).
     void addIndex(const index_t inIndex);
@@ -112,22 +174,111 @@ public:
     ///\brief Finds and deletes redundant vertices of mesh.
     ///
     /// Changes number of vertices and also changes some values of indices.
-    /// \warning Use this function only for static mesh! 
-    /// Do not use this function with mesh which contains animation data 
-    /// (bones and weights) as it will be corrupted!
+    /// Same as weldVertices() with zero tolerance.
     void deleteRedundantVertices();
 
-    ///generates normals from mesh data
+    ///\brief Merges equal vertices and drops unused ones in a single pass over indices.
+    ///
+    /// Vertices are looked up in open-addressing hash table, so no
+    /// per-vertex allocations and no sorting are made. Vertices are placed
+    /// in order of their first use by indices.
+    /// With zero tolerance only exact duplicates are merged (0.0 and -0.0 are equal).
+    /// With positive tolerance vertices are merged if all their components
+    /// (coordinate, texture coordinate, normal) differ not more than inEpsilon;
+    /// the first used vertex of a group is kept.
+    /// Bone data (if present for each vertex) is remapped too and
+    /// vertices with different bones or weights are never merged.
+    /// Levels of detail (mLODs) are remapped too.
+    /// Returns remap table: new index for each old vertex or
+    /// Mesh::UNUSED_INDEX for vertices which are not referenced.
+    IndexCont weldVertices(float inEpsilon = 0.0f);
+
+    ///\brief Renumbers vertices in order of their first use by indices.
+    ///
+    /// This makes vertex fetch order match index order (better memory locality).
+    /// Call it after index order is final (after hydra::rendering::MeshOptimizer).
+    /// Unused vertices are dropped. Bone data (if present for each vertex)
+    /// and levels of detail (mLODs) are reordered too.
+    /// Returns remap table like weldVertices().
+    IndexCont optimizeVertexFetch();
+
+    ///\brief Generates normals from mesh data.
+    ///
+    ///Faces are weighted by their area. Use hydra::data::NormalGenerator
+    ///directly for other weightings or smoothing angle.
     void generateNormals();
 
-    ///generates axis aligned bounding box for mesh
+    ///\brief Selects level of detail by screen-space error.
+    ///
+    ///inProjectionScale is viewportHeight / (2 * tan(fovY / 2)), so error e
+    ///of level seen from distance d is e * inProjectionScale / d pixels.
+    ///Returns the coarsest level whose error does not exceed inMaxPixelError:
+    ///0 means the mesh itself (mIndices), i > 0 means mLODs[i - 1].
+    size_t selectLOD(float inDistance, float inProjectionScale, float inMaxPixelError = 1.0f) const;
+
+    ///returns indices of specified level of detail (0 means mIndices)
+    const hydra::data::IndexBuffer& getLODIndices(size_t inLevel) const;
+
+    ///\brief Generates axis aligned bounding box for mesh.
+    ///
+    ///Walks all the indices; use getAABB() to get cached bounds.
     hydra::math::AABB calcAABB() const;
 
+    ///\brief Returns cached axis aligned bounding box of vertices used by indices.
+    ///
+    ///Bounds are computed on the first request after mesh is changed (or by
+    ///updateBounds()), later requests just return them.
+    const hydra::math::AABB& getAABB() const;
+
+    ///returns cached bounding sphere of vertices used by indices (see getAABB())
+    const hydra::math::BoundingSphere& getBoundingSphere() const;
+
+    ///\brief Returns cached bounds of vertices influenced by each bone.
+    ///
+    ///Empty if mesh has no bone data.
+    const BoneBoundsCont& getBoneBounds() const;
+
+    ///\brief Computes bounds of animated mesh.
+    ///
+    ///inPose contains bone transformations relative to bind pose (like frames
+    ///of hydra::data::Animation added to model). Bounds of bones are transformed,
+    ///so it takes time proportional to the number of bones, not vertices.
+    ///Result contains all the skinned vertices but is not tight.
+    ///For meshes without bone data returns getAABB().
+    hydra::math::AABB calcPoseAABB(const hydra::data::Skeleton& inPose) const;
+
+    ///\brief Computes cached bounds now.
+    ///
+    ///Call it before mesh is used from several threads: lazy computation
+    ///of bounds in const methods is not thread-safe.
+    void updateBounds() const;
+
+    ///\brief Marks cached bounds as outdated.
+    ///
+    ///Methods of mesh which move vertices call it themselves. Call it
+    ///after changing mVertices, mIndices or bone data directly.
+    void invalidateBounds();
+
+    ///\brief Encodes all the vertices of mesh using specified format.
+    ///
+    ///Bounds of vertices are stored with packed data. They are needed
+    ///to decode normalized positions.
+    ///\see hydra::data::VertexFormat
+    void packVertices(const hydra::data::VertexFormat& inFormat, hydra::data::PackedVertices& outPacked) const;
+
+    ///\brief Replaces vertices of mesh with ones decoded from packed data.
+    ///
+    ///Indices are not changed, so the number of packed vertices should
+    ///be the same as the one used to build indices.
+    void unpackVertices(const hydra::data::PackedVertices& inPacked);
+
     ///assemble mode of primitives of this mesh
     PrimitiveAssembleMode mMode;
 
-    ///all the indices to build polygons of mesh
-    IndexCont mIndices;
+    ///\brief All the indices to build polygons of mesh.
+    ///
+    ///They are stored with 16-bit width if all of them fit into 16 bits.
+    hydra::data::IndexBuffer mIndices;
 
     ///all the vertices of mesh
     VertexCont mVertices;
@@ -140,6 +291,28 @@ public:
 
     ///Bone weights
     BoneWeightCont mBoneWeights;
+
+    ///\brief Coarser levels of detail ordered by increasing error.
+    ///
+    ///Their indices always form triangle lists. Vertex welding and
+    ///vertex fetch optimization remap them together with mIndices.
+    LODCont mLODs;
+
+    ///ranges of source meshes if this mesh is a result of merging (empty otherwise)
+    SubMeshCont mSubMeshes;
+
+private:
+    ///whether cached bounds are up to date
+    mutable bool mBoundsValid;
+
+    ///cached bounding box
+    mutable hydra::math::AABB mAABB;
+
+    ///cached bounding sphere
+    mutable hydra::math::BoundingSphere mBoundingSphere;
+
+    ///cached bounds of bones
+    mutable BoneBoundsCont mBoneBounds;
 };
 
 ///pointer (smart) to Mesh object
@@ -0,0 +1,235 @@
+//MeshBVH.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef MESH_BVH_HPP__
+#define MESH_BVH_HPP__
+
+/**
+ * \class hydra::data::MeshBVH
+ * \brief Bounding volume hierarchy over triangles of a mesh.
+ *
+ * Used for ray casting (picking), segment tests (line of sight)
+ * and searching triangles in some box (collision).
+ *
+ * Tree is built with surface area heuristic evaluated over 16 bins
+ * along each axis. Subtrees of big meshes are built in parallel; the
+ * result does not depend on number of threads. Nodes are stored
+ * in one array in depth-first order (left child follows its parent),
+ * triangles are stored in order of leaves with precomputed edges, so
+ * the tree does not reference the mesh after building and must be
+ * rebuilt if mesh is changed.
+ *
+ * Triangles are identified by position of their first index in
+ * Mesh::mIndices (3 * i for i-th triangle of list, i for strips).
+ * Triangles are two-sided. Degenerate triangles of strips are skipped.
+ * Only triangle lists and triangle strips are supported.
+ *
+ * Groups of rays may be traced as packets of 4 rays with SSE
+ * (if available); packets are faster for coherent rays
+ * (for example, rays through neighbouring pixels).
+ *
+ * \see hydra::data::Mesh
+ */
+
+#include "math/Vector3D.hpp"
+#include "math/AABB.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+namespace hydra{
+
+namespace data{
+
+class Mesh;
+
+class MeshBVH{
+
+public:
+    ///value of Hit::triangle if nothing is hit
+    static const size_t NO_HIT = static_cast<size_t>(-1);
+
+    ///properties of builder
+    struct Properties{
+        ///builds default properties
+        inline Properties(): maxLeafTriangles(4), threadNum(0){
+
+        }
+
+        ///nodes with this number of triangles (or less) are not split
+        unsigned int maxLeafTriangles;
+
+        ///number of threads (0 - number of hardware threads)
+        unsigned int threadNum;
+    };
+
+    ///result of ray cast
+    struct Hit{
+        ///position of the first index of hit triangle in Mesh::mIndices (NO_HIT if nothing is hit)
+        size_t triangle;
+        ///hit point is origin + distance * direction
+        float distance;
+        ///barycentric coordinate of hit point (weight of the second vertex of triangle)
+        float u;
+        ///barycentric coordinate of hit point (weight of the third vertex of triangle)
+        float v;
+    };
+
+    ///\brief Node of tree.
+    ///
+    ///Exposed for debug drawing and statistics.
+    struct Node{
+        ///minimal corner of bounds
+        float min[3];
+        ///maximal corner of bounds
+        float max[3];
+        ///first triangle of leaf or offset of the right child from this node for inner nodes
+        boost::uint32_t offset;
+        ///number of triangles of leaf (0 for inner nodes)
+        boost::uint16_t triangleNum;
+        ///axis of split of inner node
+        boost::uint16_t axis;
+    };
+
+    ///triangle with precomputed edges
+    struct Triangle{
+        ///the first vertex
+        float v0[3];
+        ///edge from the first vertex to the second one
+        float e1[3];
+        ///edge from the first vertex to the third one
+        float e2[3];
+        ///position of the first index of triangle in Mesh::mIndices
+        boost::uint32_t index;
+    };
+
+    ///container for nodes
+    typedef std::vector<Node> NodeCont;
+
+    ///container for triangles
+    typedef std::vector<Triangle> TriangleCont;
+
+    ///container for ids of triangles (positions of their first indices)
+    typedef std::vector<size_t> TriangleIdCont;
+
+    ///builds empty tree with specified properties
+    explicit MeshBVH(const MeshBVH::Properties& inProps = MeshBVH::Properties());
+
+    ///\brief (Re)builds tree for mesh.
+    ///
+    ///Tree is empty for meshes which are not triangle lists or strips.
+    void build(const hydra::data::Mesh& inMesh);
+
+    ///drops tree
+    void clear();
+
+    ///\brief Finds the closest hit of ray.
+    ///
+    ///Direction need not be unit; only hits with distance in (0, inMaxDistance)
+    ///are reported (distance is measured in lengths of direction).
+    ///Returns false if nothing is hit.
+    bool intersectRay(const hydra::math::Vector3D& inOrigin, const hydra::math::Vector3D& inDirection,
+                      MeshBVH::Hit& outHit, float inMaxDistance = 1e30f) const;
+
+    ///\brief Finds the closest hit of segment.
+    ///
+    ///Distance of hit is in [0, 1] (fraction of segment).
+    bool intersectSegment(const hydra::math::Vector3D& inStart, const hydra::math::Vector3D& inEnd,
+                          MeshBVH::Hit& outHit) const;
+
+    ///\brief Checks if segment crosses any triangle.
+    ///
+    ///Faster than intersectSegment() since it stops at the first hit found.
+    bool testSegment(const hydra::math::Vector3D& inStart, const hydra::math::Vector3D& inEnd) const;
+
+    ///\brief Traces many rays.
+    ///
+    ///Rays are traced in packets of 4 (neighbouring rays should be
+    ///coherent to gain from it). Same as intersectRay() for every ray;
+    ///Hit::triangle is NO_HIT for rays which hit nothing.
+    void intersectRays(const hydra::math::Vector3D* inOrigins, const hydra::math::Vector3D* inDirections,
+                       size_t inNum, MeshBVH::Hit* outHits, float inMaxDistance = 1e30f) const;
+
+    ///\brief Finds triangles which intersect box.
+    ///
+    ///Triangles are tested exactly (separating axis test), ids are
+    ///appended to outTriangles. Returns number of found triangles.
+    size_t queryAABB(const hydra::math::AABB& inBox, MeshBVH::TriangleIdCont& outTriangles) const;
+
+    ///returns nodes (the first one is the root)
+    inline const MeshBVH::NodeCont& getNodes() const{
+        return mNodes;
+    }
+
+    ///returns triangles in order of leaves
+    inline const MeshBVH::TriangleCont& getTriangles() const{
+        return mTriangles;
+    }
+
+    ///returns depth of tree (0 for empty tree)
+    inline unsigned int getDepth() const{
+        return mDepth;
+    }
+
+    ///returns properties
+    inline const MeshBVH::Properties& getProperties() const{
+        return mProps;
+    }
+
+private:
+    ///properties
+    Properties mProps;
+
+    ///nodes in depth-first order
+    NodeCont mNodes;
+
+    ///triangles in order of leaves
+    TriangleCont mTriangles;
+
+    ///depth of tree
+    unsigned int mDepth;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,144 @@
+//MeshMerger.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef MESH_MERGER_HPP__
+#define MESH_MERGER_HPP__
+
+/**
+ * \class hydra::data::MeshMerger
+ * \brief Merges meshes with the same material to reduce number of draw calls.
+ *
+ * Meshes are merged if they have equal materials (same object or
+ * equal properties), the same primitive assemble mode and either all
+ * of them have bone data or none of them has it.
+ * Only triangle lists and triangle strips are merged (strips are joined
+ * with degenerate triangles); meshes of other modes are kept separate.
+ * Merged mesh keeps ranges of its sources in Mesh::mSubMeshes.
+ * Levels of detail are merged if all the sources have the same number
+ * of them, otherwise merged mesh has no levels of detail.
+ *
+ * Merged mesh takes the place of its first source, so order of meshes
+ * made by Model::sortMeshesByOpacity() is kept (merged meshes have
+ * equal materials and so equal opacity).
+ * Number of vertices of merged mesh is limited (65536 by default), so
+ * merged meshes may still use 16-bit indices. Meshes which are bigger
+ * than the limit are not merged.
+ *
+ * Merger may also build a static model from several pre-transformed
+ * model instances (for example, props placed over the level): meshes of
+ * all instances are transformed to world space and merged as above.
+ * Bone data is not kept in this case.
+ *
+ * \see hydra::data::Model::mergeMeshes()
+ * \see hydra::data::Mesh::SubMesh
+ */
+
+#include "data/Model.hpp"
+#include "math/Matrix.hpp"
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace hydra{
+
+namespace data{
+
+class MeshMerger{
+
+public:
+    ///default limit of number of vertices in merged mesh (16-bit indices)
+    static const size_t DEFAULT_MAX_VERTEX_NUM = 65536;
+
+    ///builds merger with specified limit of number of vertices in merged mesh
+    explicit MeshMerger(size_t inMaxVertexNum = DEFAULT_MAX_VERTEX_NUM);
+
+    ///\brief Merges meshes of container in place.
+    ///
+    ///Meshes which have nothing to merge with are kept (not copied).
+    void mergeMeshes(hydra::data::Model::MeshCont& inoutMeshes) const;
+
+    ///\brief Adds model instance for static merging.
+    ///
+    ///inTransform is applied to vertex positions (as in Vector3D * Matrix),
+    ///normals are transformed by inverse transposed matrix.
+    ///Mirroring transformations flip winding of triangles back.
+    void addInstance(hydra::data::ModelPtr inModel, const hydra::math::Matrix& inTransform);
+
+    ///\brief Builds model from merged pre-transformed meshes of all the added instances.
+    ///
+    ///Images of all the instances are added to the model.
+    ///Skeletons and animations are not copied.
+    hydra::data::ModelPtr buildStaticModel(const std::string& inName) const;
+
+    ///drops all the added instances
+    void clearInstances();
+
+    ///returns number of added instances
+    inline size_t getInstanceNum() const{
+        return mInstances.size();
+    }
+
+    ///returns limit of number of vertices in merged mesh
+    inline size_t getMaxVertexNum() const{
+        return mMaxVertexNum;
+    }
+
+private:
+    ///model placed in the world
+    struct Instance{
+        ///model
+        hydra::data::ModelPtr mModel;
+        ///model to world transformation
+        hydra::math::Matrix mTransform;
+    };
+
+    ///limit of number of vertices in merged mesh
+    size_t mMaxVertexNum;
+
+    ///instances for static merging
+    std::vector<Instance> mInstances;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,139 @@
+//MeshSimplifier.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef MESH_SIMPLIFIER_HPP__
+#define MESH_SIMPLIFIER_HPP__
+
+/**
+ * \class hydra::data::MeshSimplifier
+ * \brief Builds simplified versions (levels of detail) of triangle meshes.
+ *
+ * Simplifier makes quadric error metric driven edge collapses
+ * (see "Surface Simplification Using Quadric Error Metrics" by Garland and Heckbert).
+ * Collapses are half-edge ones: vertex is moved to its neighbour, so
+ * simplified triangle lists use vertices of the original mesh and do not
+ * need vertex containers of their own.
+ *
+ * Vertices with the same position but different attributes (texture coordinate
+ * seams, hard normal edges, different bone weights) are collapsed together,
+ * and only along edges which keep the seam: each copy of the vertex must have
+ * exactly one copy of the target vertex among its neighbours.
+ * Open borders are kept by additional quadrics and vertices of borders
+ * move along border edges only. Collapses which flip triangles are rejected.
+ * Difference of normals, texture coordinates and bone weights of merged
+ * vertices is added to collapse cost, so cheap collapses keep attributes.
+ *
+ * Collapses are made in passes: in each pass the cheapest collapses which
+ * do not touch each other are made, until target number of triangles is reached
+ * or no collapse is possible.
+ *
+ * Only triangle lists are supported.
+ *
+ * \see hydra::data::Mesh::LOD
+ */
+
+#include "data/Mesh.hpp"
+
+#include <vector>
+
+namespace hydra{
+
+namespace data{
+
+class MeshSimplifier{
+
+public:
+    ///properties of simplifier
+    struct Properties{
+        ///builds default properties
+        inline Properties(): normalWeight(0.5f), texCoordWeight(1.0f), boneWeight(1.0f), borderWeight(10.0f){
+
+        }
+
+        ///weight of squared difference of normals in collapse cost
+        float normalWeight;
+
+        ///weight of squared difference of texture coordinates in collapse cost
+        float texCoordWeight;
+
+        ///weight of squared difference of bone weights in collapse cost
+        float boneWeight;
+
+        ///weight of quadrics which keep open borders
+        float borderWeight;
+    };
+
+    ///builds simplifier with specified properties
+    explicit MeshSimplifier(const MeshSimplifier::Properties& inProps = MeshSimplifier::Properties());
+
+    ///\brief Simplifies triangle list which uses vertices of mesh.
+    ///
+    ///inIndices may be mesh's own indices or indices of some level of detail.
+    ///Degenerate triangles are dropped. Returns conservative bound of distance
+    ///between result and inIndices surfaces (in mesh units): the largest sum of
+    ///lengths of collapsed edges which a source vertex moved along. Quadrics only
+    ///order collapses, the bound does not depend on them.
+    float simplify(const hydra::data::Mesh& inMesh, const hydra::data::Mesh::IndexCont& inIndices,
+                   size_t inTargetTriangles, hydra::data::Mesh::IndexCont& outIndices) const;
+
+    ///\brief Generates chain of levels of detail (Mesh::mLODs).
+    ///
+    ///inRatios are target numbers of triangles relative to the mesh
+    ///(for example 0.5, 0.25, 0.125). Each level is made from the previous one
+    ///and its error is the sum of errors of all steps (so it stays a bound). Generation stops
+    ///if level can't be simplified any more. Old levels of detail are dropped.
+    ///Mesh must be triangle list, otherwise it is not changed.
+    void generateLODs(hydra::data::Mesh& inoutMesh, const std::vector<float>& inRatios) const;
+
+    ///returns properties
+    inline const MeshSimplifier::Properties& getProperties() const{
+        return mProps;
+    }
+
+private:
+    ///properties
+    Properties mProps;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
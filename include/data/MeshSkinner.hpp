@@ -0,0 +1,232 @@
+//MeshSkinner.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef MESH_SKINNER_HPP__
+#define MESH_SKINNER_HPP__
+
+/**
+ * \class hydra::data::MeshSkinner
+ * \brief CPU skinning of meshes with matrix palette.
+ *
+ * setup() converts vertices of mesh to internal streams: positions,
+ * normals and bone influences are stored in separate arrays, positions
+ * and normals are padded to 4 floats. Influences of each vertex are
+ * sorted by weight and truncated to MAX_INFLUENCES, weights of kept
+ * influences are renormalized (the biggest dropped weight may be
+ * checked with getMaxDroppedWeight()).
+ *
+ * Every frame pose is converted to MeshSkinner::Palette (one 3x4 matrix
+ * per bone) and skin() writes skinned positions and normals to buffer
+ * provided by caller (for example, copy of Mesh::mVertices or mapped
+ * vertex buffer). Bone matrices of vertex are blended first, then
+ * position and normal are transformed by the blended matrix; this is done
+ * with SSE if it is available. Big meshes are processed by several threads.
+ *
+ * Palette is built from pose where bones transform bind pose vertices
+ * (as frames of hydra::data::Animation after Model::addAnimation()):
+ * skinned position is sum of weight * (orient.rotate(coord) + pos).
+ * Normals are rotated by the same matrices and are not renormalized.
+ *
+ * \see hydra::data::Mesh
+ * \see hydra::data::Skeleton
+ */
+
+#include "math/Vector3D.hpp"
+#include "math/Quat.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+namespace hydra{
+
+namespace data{
+
+class Mesh;
+struct Vertex;
+struct Skeleton;
+struct Pose;
+class BoneInfluences;
+
+class MeshSkinner{
+
+public:
+    ///maximal number of bones which affect a vertex
+    static const int MAX_INFLUENCES = 4;
+
+    ///properties of skinner
+    struct Properties{
+        ///builds default properties
+        inline Properties(): threadNum(0), minVerticesPerThread(4096){
+
+        }
+
+        ///number of threads (0 - number of hardware threads)
+        unsigned int threadNum;
+
+        ///meshes are not split to ranges smaller than this
+        size_t minVerticesPerThread;
+    };
+
+    /**
+     * \class hydra::data::MeshSkinner::Palette
+     * \brief Matrices of bones of a pose.
+     *
+     * Each matrix is stored as 4 columns of 4 floats: 3 columns of rotation
+     * and translation (the last component of columns is not used).
+     */
+    class Palette{
+
+    public:
+        ///number of floats per matrix
+        static const size_t MATRIX_SIZE = 16;
+
+        ///builds matrices for bones of pose
+        void build(const hydra::data::Skeleton& inPose);
+
+        ///builds matrices for bones of pose
+        void build(const hydra::data::Pose& inPose);
+
+        ///returns number of bones
+        inline size_t getBoneNum() const{
+            return mMatrices.size() / MATRIX_SIZE;
+        }
+
+        ///returns matrix of bone
+        inline const float* getMatrix(size_t inBone) const{
+            return &mMatrices[inBone * MATRIX_SIZE];
+        }
+
+        ///returns matrix of bone to be filled directly (see PoseComposer)
+        inline float* getMatrix(size_t inBone){
+            return &mMatrices[inBone * MATRIX_SIZE];
+        }
+
+        ///sets number of bones, values of new matrices are undefined
+        inline void resize(size_t inBoneNum){
+            mMatrices.resize(inBoneNum * MATRIX_SIZE);
+        }
+
+    private:
+        ///sets matrix of bone
+        void setMatrix(size_t inBone, const hydra::math::Quat& inOrient, const hydra::math::Vector3D& inPos);
+
+        ///matrices of all bones
+        std::vector<float> mMatrices;
+    };
+
+    ///builds empty skinner with specified properties
+    explicit MeshSkinner(const MeshSkinner::Properties& inProps = MeshSkinner::Properties());
+
+    ///\brief Prepares vertices of mesh for skinning.
+    ///
+    ///Vertices without bone influences (or all the vertices if mesh has
+    ///no bones) are copied by skin() without transformation.
+    void setup(const hydra::data::Mesh& inMesh);
+
+    ///\brief Prepares vertices of mesh for skinning with compact influences.
+    ///
+    ///Influences must be built for the same mesh (otherwise vertices are
+    ///copied by skin() without transformation).
+    void setup(const hydra::data::Mesh& inMesh, const hydra::data::BoneInfluences& inInfluences);
+
+    ///drops prepared data
+    void clear();
+
+    ///returns number of prepared vertices
+    inline size_t getVertexNum() const{
+        return mInfluenceNum.size();
+    }
+
+    ///returns maximal sum of weights dropped from a vertex by setup()
+    inline float getMaxDroppedWeight() const{
+        return mMaxDroppedWeight;
+    }
+
+    ///returns number of vertices which had more than MAX_INFLUENCES bones
+    inline size_t getTruncatedVertexNum() const{
+        return mTruncatedVertexNum;
+    }
+
+    ///\brief Skins vertices to strided buffers.
+    ///
+    ///Three floats are written to each position and normal, i-th vertex
+    ///is written to outPositions + i * inStride (inStride is in bytes).
+    ///outNormals may be 0, then normals are not calculated.
+    ///Palette must contain all the bones used by mesh.
+    void skin(const MeshSkinner::Palette& inPalette, float* outPositions, float* outNormals, size_t inStride) const;
+
+    ///\brief Skins vertices to array of getVertexNum() vertices.
+    ///
+    ///Only coordinates and normals are written, texture coordinates are left intact.
+    void skin(const MeshSkinner::Palette& inPalette, hydra::data::Vertex* outVertices) const;
+
+private:
+    ///copies positions and normals, vertices get no influences
+    void copyVertices(const hydra::data::Mesh& inMesh);
+
+    ///properties
+    Properties mProps;
+
+    ///positions (x, y, z, 1)
+    std::vector<float> mPositions;
+
+    ///normals (x, y, z, 0)
+    std::vector<float> mNormals;
+
+    ///MAX_INFLUENCES bones per vertex
+    std::vector<boost::uint16_t> mInfluenceBones;
+
+    ///MAX_INFLUENCES weights per vertex
+    std::vector<float> mInfluenceWeights;
+
+    ///number of used influences of each vertex
+    std::vector<boost::uint8_t> mInfluenceNum;
+
+    ///statistics of setup()
+    float mMaxDroppedWeight;
+    size_t mTruncatedVertexNum;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
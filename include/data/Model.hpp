@@ -28,6 +28,8 @@
  */
 
 #include "common/SharedPtr.hpp"
+#include "math/AABB.hpp"
+#include "math/BoundingSphere.hpp"
 #include <vector>
 #include <map>
 #include <string>
@@ -92,12 +94,44 @@ public:
     ///sorts meshes by their material's opacity
     void sortMeshesByOpacity();
 
+    ///\brief Merges meshes with equal materials and primitive assemble modes.
+    ///
+    ///Merged meshes take place of their first sources, so it may be called
+    ///after sortMeshesByOpacity(). Merged meshes have at most inMaxVertexNum vertices.
+    ///\see hydra::data::MeshMerger
+    void mergeMeshes(size_t inMaxVertexNum = 65536);
+
     ///drops unused (empty) meshes if any
     void dropEmptyMeshes();
 
     ///clears all data
     void clear();
 
+    ///\brief Returns cached bounding box of all the meshes.
+    ///
+    ///Bounds are computed on the first request after model is changed
+    ///(or by updateBounds()), later requests just return them.
+    ///Methods of model which change meshes invalidate bounds themselves;
+    ///call invalidateBounds() after changing meshes directly.
+    const hydra::math::AABB& getAABB() const;
+
+    ///returns cached bounding sphere of all the meshes (see getAABB())
+    const hydra::math::BoundingSphere& getBoundingSphere() const;
+
+    ///\brief Computes bounds of animated model.
+    ///
+    ///Uses bounds of bones of meshes (see Mesh::calcPoseAABB()), so it does
+    ///not depend on the number of vertices.
+    hydra::math::AABB calcPoseAABB(const hydra::data::Skeleton& inPose) const;
+
+    ///\brief Computes cached bounds of model and all its meshes now.
+    ///
+    ///Loaders call it, so bounds of loaded models are ready to use.
+    void updateBounds() const;
+
+    ///marks cached bounds of model as outdated (bounds of meshes are not changed)
+    void invalidateBounds();
+
     ///adds animation an makes important conversions to frame's skeletons
     ///(it changes the object you put, not a copy)
     void addAnimation(hydra::data::AnimationPtr inAnimation);
@@ -135,6 +169,15 @@ private:
     ///animations (sequences of frames)
     AnimationCont mAnims;
 
+    ///whether cached bounds are up to date
+    mutable bool mBoundsValid;
+
+    ///cached bounding box
+    mutable hydra::math::AABB mAABB;
+
+    ///cached bounding sphere
+    mutable hydra::math::BoundingSphere mBoundingSphere;
+
 };
 
 ///pointer (smart) to Model object
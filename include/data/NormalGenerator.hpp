@@ -0,0 +1,126 @@
+//NormalGenerator.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef NORMAL_GENERATOR_HPP__
+#define NORMAL_GENERATOR_HPP__
+
+/**
+ * \class hydra::data::NormalGenerator
+ * \brief Generates vertex normals of a mesh.
+ *
+ * Generator builds vertex to face adjacency (in compressed sparse row form)
+ * once and then computes normal of every vertex independently by gathering
+ * normals of adjacent faces. So vertices are processed in parallel with
+ * no synchronization. Face normals are computed with SSE if it is available.
+ *
+ * Faces may be weighted by their area (this is what Mesh::generateNormals does)
+ * or by the angle of face at vertex.
+ * If smoothing angle is specified, faces whose normals differ more than that
+ * angle do not share normal, so vertices on hard edges are split (duplicated).
+ * Splitting works for triangle lists only.
+ *
+ * Only triangle lists and triangle strips are supported. Other meshes
+ * are not changed.
+ *
+ * \see hydra::data::Mesh
+ */
+
+#include "common/SharedPtr.hpp"
+
+namespace hydra{
+
+namespace data{
+
+class Mesh;
+
+class NormalGenerator{
+
+public:
+    ///how contributions of faces are weighted
+    enum Weighting{
+        ///by face area
+        AREA_WEIGHTED = 0,
+        ///by face angle at vertex
+        ANGLE_WEIGHTED
+    };
+
+    ///properties of generator
+    struct Properties{
+        ///builds default properties (area weighting, no splitting, all threads)
+        inline Properties(): weighting(AREA_WEIGHTED), smoothingAngle(0.0f), threadNum(0){
+
+        }
+
+        ///weighting of face contributions
+        Weighting weighting;
+
+        ///Maximum angle (radians) between faces sharing normal.
+        ///Zero or negative value disables vertex splitting.
+        float smoothingAngle;
+
+        ///number of threads (0 - number of hardware threads)
+        unsigned int threadNum;
+    };
+
+    ///builds generator with specified properties
+    explicit NormalGenerator(const NormalGenerator::Properties& inProps = NormalGenerator::Properties());
+
+    ///\brief Generates normals for all vertices of mesh.
+    ///
+    ///Vertices which are not used by any face get zero normals.
+    ///If vertices are split, they are appended to the end of vertex
+    ///container (with their bone data if any) and indices are changed.
+    void generate(hydra::data::Mesh& inoutMesh) const;
+
+    ///returns properties
+    inline const NormalGenerator::Properties& getProperties() const{
+        return mProps;
+    }
+
+private:
+    ///properties
+    Properties mProps;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,117 @@
+//Pose.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef POSE_HPP__
+#define POSE_HPP__
+
+/**
+ * \struct hydra::data::Pose
+ * \brief Transformations of bones without names and hierarchy.
+ *
+ * Lightweight alternative to hydra::data::Skeleton used for sampling
+ * and blending of animations: positions and orientations are stored
+ * in separate arrays and there are no strings to copy.
+ *
+ * \see hydra::data::AnimationPlayer
+ */
+
+#include "data/Skeleton.hpp"
+#include "math/Vector3D.hpp"
+#include "math/Quat.hpp"
+#include <vector>
+
+namespace hydra{
+
+namespace data{
+
+struct Pose{
+
+    ///container for positions
+    typedef std::vector<hydra::math::Vector3D> PositionCont;
+
+    ///container for orientations
+    typedef std::vector<hydra::math::Quat> OrientCont;
+
+    ///returns number of bones
+    inline size_t getBoneNum() const{
+        return mPositions.size();
+    }
+
+    ///\brief Sets identity transformations for specified number of bones.
+    ///
+    ///For frames of animations added to Model it is the bind pose.
+    inline void setIdentity(size_t inBoneNum){
+        mPositions.assign(inBoneNum, hydra::math::Vector3D());
+        mOrients.assign(inBoneNum, hydra::math::Quat(0.0f, 0.0f, 0.0f, 1.0f));
+    }
+
+    ///copies transformations of bones
+    inline void fromSkeleton(const hydra::data::Skeleton& inSkeleton){
+        mPositions.resize(inSkeleton.mBones.size());
+        mOrients.resize(inSkeleton.mBones.size());
+        for(size_t i = 0; i < inSkeleton.mBones.size(); ++i){
+            mPositions[i] = inSkeleton.mBones[i].mPos;
+            mOrients[i] = inSkeleton.mBones[i].mOrient;
+        }
+    }
+
+    ///\brief Sets transformations of skeleton's bones.
+    ///
+    ///Skeleton is resized to the number of bones, names and parents of existing bones are kept.
+    inline void toSkeleton(hydra::data::Skeleton& outSkeleton) const{
+        outSkeleton.mBones.resize(mPositions.size());
+        for(size_t i = 0; i < mPositions.size(); ++i){
+            outSkeleton.mBones[i].mPos = mPositions[i];
+            outSkeleton.mBones[i].mOrient = mOrients[i];
+        }
+    }
+
+    ///positions of bones
+    PositionCont mPositions;
+
+    ///orientations of bones
+    OrientCont mOrients;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
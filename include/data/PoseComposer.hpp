@@ -0,0 +1,161 @@
+//PoseComposer.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef POSE_COMPOSER_HPP__
+#define POSE_COMPOSER_HPP__
+
+/**
+ * \class hydra::data::PoseComposer
+ * \brief Converts poses between spaces of skeleton's hierarchy.
+ *
+ * Poses may be expressed in three spaces:
+ *  - local: transformation of each bone is relative to its parent
+ *    (as joints of MD5 animations);
+ *  - model: transformations are relative to the model (as frames after
+ *    loading and Model::mBindSkel);
+ *  - relative to bind pose: model space transformation multiplied by the
+ *    inverse bind pose transformation (as frames after Model::addAnimation()),
+ *    these ones are used for skinning.
+ *
+ * setup() orders bones by depth in hierarchy, so bones of the same depth
+ * are independent and are composed with their parents 4 at a time with SSE
+ * (if available). Transformations are stored as separate arrays of
+ * components (structure of arrays) in this order; poses are converted from
+ * and to bone order of skeleton when they are passed in and out.
+ * Inverse bind pose is precomputed, so local pose may be converted to
+ * relative one or directly to skinning palette in one pass.
+ * Input poses must have at least as many bones as the skeleton,
+ * otherwise std::out_of_range is thrown.
+ *
+ * Conversions use internal buffers, so one composer must not be used
+ * by several threads at once; copies of it may be.
+ *
+ * \see hydra::data::Pose
+ * \see hydra::data::MeshSkinner::Palette
+ */
+
+#include "data/MeshSkinner.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace hydra{
+
+namespace data{
+
+struct Skeleton;
+struct Pose;
+
+class PoseComposer{
+
+public:
+    ///builds composer without bones
+    PoseComposer();
+
+    ///\brief Prepares composer for skeleton.
+    ///
+    ///Hierarchy is taken from parents of bones (bones with wrong parent
+    ///indices are treated as roots). Transformations of bones are treated
+    ///as model space bind pose, they are used by the conversions to
+    ///relative space only.
+    void setup(const hydra::data::Skeleton& inSkeleton);
+
+    ///returns number of bones
+    inline size_t getBoneNum() const{
+        return mOrder.size();
+    }
+
+    ///returns number of levels of hierarchy
+    inline size_t getDepth() const{
+        return mLevels.empty()? 0: mLevels.size() - 1;
+    }
+
+    ///converts local pose to model space
+    void compose(const hydra::data::Pose& inLocal, hydra::data::Pose& outModel) const;
+
+    ///converts local pose to space relative to bind pose
+    void composeRelative(const hydra::data::Pose& inLocal, hydra::data::Pose& outRelative) const;
+
+    ///converts local pose to matrices for skinning
+    void composePalette(const hydra::data::Pose& inLocal, hydra::data::MeshSkinner::Palette& outPalette) const;
+
+    ///converts model space pose to space relative to bind pose
+    void makeRelative(const hydra::data::Pose& inModel, hydra::data::Pose& outRelative) const;
+
+private:
+    ///what is written by compose functions
+    enum Output{
+        MODEL = 0,
+        RELATIVE,
+        PALETTE
+    };
+
+    ///converts local pose to specified output
+    void composeTo(const hydra::data::Pose& inLocal, PoseComposer::Output inOutput,
+                   hydra::data::Pose* outPose, hydra::data::MeshSkinner::Palette* outPalette) const;
+
+    ///index of bone in skeleton for each position in order of depth
+    std::vector<size_t> mOrder;
+
+    ///position of parent in order of depth (identity slot for roots)
+    std::vector<size_t> mParents;
+
+    ///start of each level in order of depth (with the end of the last one)
+    std::vector<size_t> mLevels;
+
+    ///\brief Components of inverse bind pose.
+    ///
+    ///Order is qx, qy, qz, qw, px, py, pz; each array has padded
+    ///number of bones.
+    std::vector<float> mInverseBind;
+
+    ///number of bones rounded up to 4 (with identity slot)
+    size_t mPaddedNum;
+
+    ///buffers of components of local and composed transformations
+    mutable std::vector<float> mLocal;
+    mutable std::vector<float> mComposed;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
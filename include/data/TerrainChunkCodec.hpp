@@ -0,0 +1,106 @@
+//TerrainChunkCodec.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef TERRAIN_CHUNK_CODEC_HPP__
+#define TERRAIN_CHUNK_CODEC_HPP__
+
+/**
+ * \class hydra::data::TerrainChunkCodec
+ * \brief Compresses indices of terrain chunks.
+ *
+ * Chunks of preprocessed terrain are triangle lists of restricted quadtree
+ * triangulation. Triangles are ordered like in strip: almost every triangle
+ * has two vertices of the previous one, but indices of the third vertices
+ * are spread over the whole vertex LOD (skirts and vertices of different
+ * levels lie far from each other), so plain delta encoding gives little.
+ * Codec stores every triangle as code byte and only new (literal) indices:
+ *  - number of indices and number of literals (variable-length integers);
+ *  - code of every triangle: 2 bits per vertex, 0 means literal,
+ *    1-3 means copy of vertex 0-2 of the previous triangle; bits 6-7 choose
+ *    predictor of literals of the triangle: 0 - previous literal,
+ *    1-3 - vertex 0-2 of the previous triangle;
+ *  - literals as zigzag-encoded 16-bit differences with predictor split into
+ *    byte planes: bit masks of non-zero high bytes (a byte per 8 literals),
+ *    low bytes of all literals and then high bytes of marked ones.
+ * Previous triangle of the first one is (0, 0, 0), previous literal is 0.
+ * Last triangle may be incomplete, so any sequence of indices may be encoded.
+ *
+ * Decoder restores differences of literals with SSE2 (8 at once) and then
+ * builds triangles. Typical chunk takes ~40% of its raw size.
+ *
+ * \see hydra::data::TerrainChunk
+ */
+
+#include "data/TerrainChunk.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace hydra{
+
+namespace data{
+
+class TerrainChunkCodec{
+
+public:
+    ///appends encoded indices to outData
+    static void encode(const TerrainChunk::index_t* inIndices, size_t inNum, std::vector<unsigned char>& outData);
+
+    ///appends encoded indices of chunk to outData
+    static void encode(const TerrainChunk& inChunk, std::vector<unsigned char>& outData);
+
+    ///returns number of indices in encoded data (throws std::runtime_error)
+    static size_t getIndexNum(const unsigned char* inData, size_t inSize);
+
+    ///\brief Decodes indices.
+    ///
+    ///outIndices must have room for getIndexNum() indices.
+    ///Returns number of bytes read, throws std::runtime_error if data is corrupted.
+    static size_t decode(const unsigned char* inData, size_t inSize, TerrainChunk::index_t* outIndices);
+
+    ///decodes indices to chunk, returns number of bytes read (throws std::runtime_error)
+    static size_t decode(const unsigned char* inData, size_t inSize, TerrainChunk& outChunk);
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -125,6 +125,29 @@ struct TerrainFragment{
     ///type of container for vertices
     typedef std::vector<CompressedVertex> VertexCont;
 
+    ///\brief Terrain vertex packed to 8 bytes.
+    ///
+    ///Height is normalized to heights of fragment, normal is stored
+    ///in octahedral encoding (y axis is up).
+    ///\see hydra::data::TerrainVertexCodec
+    struct PackedVertex{
+        ///x coordinate
+        boost::uint16_t x;
+
+        ///z coordinate
+        boost::uint16_t z;
+
+        ///height (unsigned normalized)
+        boost::uint16_t height;
+
+        ///octahedral coordinates of normal vector (signed normalized)
+        boost::int8_t normalU;
+        boost::int8_t normalV;
+    };
+
+    ///type of container for packed vertices
+    typedef std::vector<PackedVertex> PackedVertexCont;
+
     ///quad tree which contains chunks for different levels of details
     QuadTreeOfChunksPtr tree;
 
@@ -0,0 +1,110 @@
+//TerrainVertexCodec.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef TERRAIN_VERTEX_CODEC_HPP__
+#define TERRAIN_VERTEX_CODEC_HPP__
+
+/**
+ * \class hydra::data::TerrainVertexCodec
+ * \brief Converts terrain vertices to 8-byte packed form and back.
+ *
+ * TerrainFragment::CompressedVertex takes 16 bytes and is expanded to
+ * 36-byte hydra::data::Vertex before upload to video memory.
+ * TerrainFragment::PackedVertex takes 8 bytes:
+ *  - x and z are copied as is;
+ *  - height is 16-bit unsigned normalized value in fragment's height
+ *    bounds: y = minHeight + height * (heightRange / 65535);
+ *  - normal is mapped onto octahedron (y axis is up) and stored as two
+ *    8-bit signed normalized values.
+ *
+ * Packed vertices may be uploaded to video memory as is, shaders/cg/v_terrain_packed.cg
+ * shows how they are decoded in vertex shader (it does the same as unpack()).
+ *
+ * \see hydra::data::TerrainFragment
+ */
+
+#include "data/TerrainFragment.hpp"
+#include "data/Vertex.hpp"
+
+#include <cstddef>
+
+namespace hydra{
+
+namespace data{
+
+class TerrainVertexCodec{
+
+public:
+    ///size of packed vertex in bytes
+    static const unsigned int PACKED_SIZE = 8;
+
+    ///\brief Returns bounds of heights of fragment's chunks (union of their bounding boxes).
+    ///
+    ///inFragment must have quad tree of chunks.
+    static void getHeightBounds(const TerrainFragment& inFragment, float& outMinHeight, float& outHeightRange);
+
+    ///\brief Packs vertices.
+    ///
+    ///Heights out of bounds are clamped.
+    static void pack(const TerrainFragment::CompressedVertex* inVertices, size_t inNum, float inMinHeight, float inHeightRange,
+                     TerrainFragment::PackedVertex* outVertices);
+
+    ///unpacks vertices (y component of normal is assumed to be positive)
+    static void unpack(const TerrainFragment::PackedVertex* inVertices, size_t inNum, float inMinHeight, float inHeightRange,
+                       TerrainFragment::CompressedVertex* outVertices);
+
+    ///\brief Unpacks vertices to the form used for rendering.
+    ///
+    ///Texture coordinates are (z * inTexCoordScale, x * inTexCoordScale).
+    static void unpack(const TerrainFragment::PackedVertex* inVertices, size_t inNum, float inMinHeight, float inHeightRange,
+                       float inTexCoordScale, hydra::data::Vertex* outVertices);
+
+    ///\brief Expands compressed vertices to the form used for rendering.
+    ///
+    ///Texture coordinates are (z * inTexCoordScale, x * inTexCoordScale).
+    static void expand(const TerrainFragment::CompressedVertex* inVertices, size_t inNum, float inTexCoordScale,
+                       hydra::data::Vertex* outVertices);
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
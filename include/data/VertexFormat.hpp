@@ -0,0 +1,232 @@
+//VertexFormat.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef VERTEX_FORMAT_HPP__
+#define VERTEX_FORMAT_HPP__
+
+/**
+ * \class hydra::data::VertexFormat
+ * \brief Descriptor of packed (compact) vertex layout.
+ *
+ * hydra::data::Vertex is a fixed 36-byte structure which is convenient
+ * for processing but wasteful for storage and for video memory.
+ * VertexFormat describes an interleaved layout of vertex attributes:
+ * which attributes are present, how each one is encoded and at which
+ * offset it is placed. Offsets are aligned to 4 bytes so the layout
+ * may be used directly as vertex attribute pointers.
+ *
+ * Supported encodings:
+ *  - full floats (FLOAT3, FLOAT2);
+ *  - half floats for texture coordinates (HALF2);
+ *  - positions as unsigned/signed normalized 16-bit integers relative to
+ *    mesh's AABB (UNORM16_3, SNORM16_3);
+ *  - normals in octahedral encoding with 2 x 16-bit or 2 x 8-bit
+ *    signed normalized integers (OCT16, OCT8).
+ *
+ * Use Mesh::packVertices() and Mesh::unpackVertices() to convert
+ * Mesh::VertexCont to and from hydra::data::PackedVertices.
+ *
+ * \see hydra::data::PackedVertices
+ * \see hydra::data::Mesh
+ */
+
+#include <vector>
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+#include "math/AABB.hpp"
+#include "math/Vector3D.hpp"
+
+namespace hydra{
+
+namespace data{
+
+struct Vertex;
+
+class VertexFormat{
+
+public:
+    ///vertex attributes which may be stored
+    enum Attribute{
+        POSITION = 0,
+        TEX_COORD,
+        NORMAL,
+        ATTRIBUTE_NUM
+    };
+
+    ///encodings of attributes
+    enum Type{
+        ///attribute is not present
+        NONE = 0,
+        ///3 x 32-bit float
+        FLOAT3,
+        ///2 x 32-bit float (z component is dropped)
+        FLOAT2,
+        ///2 x 16-bit half float (z component is dropped)
+        HALF2,
+        ///3 x 16-bit unsigned normalized, relative to bounds' corner and vector
+        UNORM16_3,
+        ///3 x 16-bit signed normalized, relative to bounds' center and half vector
+        SNORM16_3,
+        ///octahedral unit vector, 2 x 16-bit signed normalized
+        OCT16,
+        ///octahedral unit vector, 2 x 8-bit signed normalized
+        OCT8
+    };
+
+    ///single attribute of vertex layout
+    struct Element{
+        ///what is stored
+        Attribute attribute;
+        ///how it is stored
+        Type type;
+        ///offset (in bytes) from the start of vertex
+        unsigned int offset;
+    };
+
+    ///container for elements
+    typedef std::vector<Element> ElementCont;
+
+    ///builds empty format (no attributes, stride is 0)
+    VertexFormat();
+
+    ///\brief Appends attribute with specified encoding.
+    ///
+    ///Offset is calculated automatically (aligned to 4 bytes).
+    ///Adding attribute which is already present or adding with NONE type does nothing.
+    ///Returns reference to this object so calls may be chained.
+    VertexFormat& add(VertexFormat::Attribute inAttribute, VertexFormat::Type inType);
+
+    ///returns element describing specified attribute or 0 if attribute is absent
+    const VertexFormat::Element* find(VertexFormat::Attribute inAttribute) const;
+
+    ///returns all elements in order of offsets
+    inline const VertexFormat::ElementCont& getElements() const{
+        return mElements;
+    }
+
+    ///returns size of a single packed vertex in bytes
+    inline unsigned int getStride() const{
+        return mStride;
+    }
+
+    ///returns size (in bytes) of attribute encoded with specified type
+    static unsigned int getTypeSize(VertexFormat::Type inType);
+
+    ///format which matches hydra::data::Vertex (36 bytes)
+    static VertexFormat createFull();
+
+    ///\brief Compact format (16 bytes).
+    ///
+    ///UNORM16_3 position, HALF2 texture coordinate, OCT16 normal.
+    static VertexFormat createCompact();
+
+    ///\brief Encodes vertices to buffer.
+    ///
+    ///Buffer must have at least inNum * getStride() bytes.
+    ///Bounds are used by normalized position encodings only.
+    void encode(const hydra::data::Vertex* inVertices, size_t inNum, const hydra::math::AABB& inBounds, unsigned char* outData) const;
+
+    ///\brief Decodes vertices from buffer.
+    ///
+    ///Attributes which are absent in format are set to zero.
+    void decode(const unsigned char* inData, size_t inNum, const hydra::math::AABB& inBounds, hydra::data::Vertex* outVertices) const;
+
+    ///converts float to 16-bit half float (rounds to nearest)
+    static boost::uint16_t floatToHalf(float inValue);
+
+    ///converts 16-bit half float to float
+    static float halfToFloat(boost::uint16_t inValue);
+
+    ///\brief Maps unit vector onto octahedron.
+    ///
+    ///Results are in interval [-1, 1].
+    static void encodeOctahedral(const hydra::math::Vector3D& inNormal, float& outU, float& outV);
+
+    ///restores unit vector from octahedral coordinates
+    static hydra::math::Vector3D decodeOctahedral(float inU, float inV);
+
+private:
+    ///elements of layout
+    ElementCont mElements;
+
+    ///size of vertex
+    unsigned int mStride;
+};
+
+/**
+ * \struct hydra::data::PackedVertices
+ * \brief Vertices encoded with some VertexFormat.
+ *
+ * Contains raw interleaved data together with format and bounds
+ * which are needed to decode it.
+ *
+ * \see hydra::data::VertexFormat
+ */
+struct PackedVertices{
+
+    ///builds empty container
+    inline PackedVertices(): mNum(0){
+
+    }
+
+    ///returns size of data in bytes
+    inline size_t getSize() const{
+        return mData.size();
+    }
+
+    ///layout of data
+    hydra::data::VertexFormat mFormat;
+
+    ///bounds used to encode normalized positions
+    hydra::math::AABB mBounds;
+
+    ///number of vertices
+    size_t mNum;
+
+    ///encoded data
+    std::vector<unsigned char> mData;
+};
+
+} //data namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -52,8 +52,12 @@ class Manager;
 class ILImageLoader: public hydra::loading::Loader<hydra::data::Image>{
 
 public:
-    ///Default constructor. Does almost nothing. Does not provide init.
-	ILImageLoader();
+    ///\brief Constructor. Does almost nothing. Does not provide init.
+    ///
+    ///By default all images are converted to Image::RGBA. If inKeepLuminancePrecision
+    ///is true, single channel images with more than 8 bits per channel (height maps)
+    ///are loaded as Image::LUMINANCE16 or Image::LUMINANCE_FLOAT.
+	explicit ILImageLoader(bool inKeepLuminancePrecision = false);
 
     ///Destructor.
 	virtual ~ILImageLoader();
@@ -75,7 +75,10 @@ typename hydra::common::SharedPtr<T>::Type loadFromZipFile(const std::string& in
 ///
 /// Function which register all the known loaders at factories.
 /// Must be called before loading any kind of objects.
-void initFactories();
+/// Images are loaded as RGBA unless inKeepImagePrecision is true: then single
+/// channel images with more than 8 bits per channel (height maps) are loaded as
+/// Image::LUMINANCE16 or Image::LUMINANCE_FLOAT, so users must check Image::getMode().
+void initFactories(bool inKeepImagePrecision = false);
 
 ///\brief Drops all the loaders from factories.
 ///
@@ -0,0 +1,213 @@
+//TerrainIndex.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef TERRAIN_INDEX_HPP__
+#define TERRAIN_INDEX_HPP__
+
+/**
+ * \class hydra::loading::TerrainIndex
+ * \brief Binary metadata of whole preprocessed terrain.
+ *
+ * Contains everything loaders need to build quad trees of chunks
+ * (maximum errors, levels, bounding boxes, numbers of indices and vertices)
+ * in fixed-size records, so fragment's tree is built without any parsing.
+ * It is used together with packed fragments (hydra::loading::TerrainPack),
+ * XML metadata may be exported for debugging.
+ *
+ * File consists of:
+ *  - blocks of fragments: block header (numbers of index and vertex LODs),
+ *    ChunkRecord for every chunk (in order of positions in quad tree),
+ *    number of vertices (uint32) for every vertex LOD;
+ *  - fragment table: FragmentRecord for every fragment (8-byte aligned);
+ *  - trailer (magic "HTFI", version, sizes of terrain, number of fragments,
+ *    offset of fragment table).
+ * Trailer is at the end, so fragments may be appended in any order as soon
+ * as they are preprocessed. All the values are in native byte order.
+ *
+ * Index is read to memory once, records are used in place.
+ *
+ * \see hydra::loading::TerrainPack
+ */
+
+#include "common/PimplPtr.hpp"
+#include "common/SharedPtr.hpp"
+#include "data/TerrainFragment.hpp"
+#include "data/TerrainFragmentId.hpp"
+
+#include <string>
+#include <istream>
+#include <ostream>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace hydra{
+
+namespace loading{
+
+class TerrainIndex: private boost::noncopyable{
+
+public:
+    ///metadata of chunk (36 bytes)
+    struct ChunkRecord{
+        ///maximum error (in world space) of chunk
+        float maxError;
+
+        ///vertices' level of detail
+        boost::uint8_t vertices;
+
+        ///index level of detail
+        boost::uint8_t level;
+
+        ///not used (zero)
+        boost::uint16_t reserved;
+
+        ///number of indices
+        boost::uint32_t indexNum;
+
+        ///corner of bounding box
+        float corner[3];
+
+        ///vector of bounding box
+        float vector[3];
+    };
+
+    ///entry of fragment table (24 bytes)
+    struct FragmentRecord{
+        ///position of fragment
+        boost::int32_t x;
+        boost::int32_t y;
+
+        ///offset of fragment's block
+        boost::uint64_t offset;
+
+        ///size of fragment's block in bytes
+        boost::uint64_t size;
+    };
+
+    /**
+     * \class hydra::loading::TerrainIndex::Writer
+     * \brief Appends blocks of fragments to stream and finishes index.
+     */
+    class Writer: private boost::noncopyable{
+
+    public:
+        ///stream must live while writer is used
+        explicit Writer(std::ostream& outStream);
+
+        ~Writer();
+
+        ///appends block built with TerrainIndex::encodeFragment (throws std::runtime_error)
+        void addFragment(hydra::data::TerrainFragmentId inId, const std::string& inBlock);
+
+        ///writes fragment table and trailer (throws std::runtime_error)
+        void finish(unsigned int inFragmentWidth, unsigned int inTerrainWidth, unsigned int inTerrainHeight);
+
+    private:
+        //pimpl
+        struct Impl;
+        hydra::common::PimplPtr<Impl>::Type mImpl;
+    };
+
+    ///\brief Builds block of fragment's metadata.
+    ///
+    ///Blocks may be built in any thread and then added by Writer.
+    static std::string encodeFragment(const hydra::data::TerrainFragment& inFragment);
+
+    ///returns name of fragment's pack relative to terrain's directory ("X_Y/X_Y.tfpack")
+    static std::string getPackFilename(hydra::data::TerrainFragmentId inId);
+
+    ///reads whole index from current position to the end of seekable stream (throws std::runtime_error)
+    explicit TerrainIndex(std::istream& inStream);
+
+    ///frees memory
+    ~TerrainIndex();
+
+    ///returns width of fragment in samples
+    unsigned int getFragmentWidth() const;
+
+    ///returns width of terrain in samples
+    unsigned int getTerrainWidth() const;
+
+    ///returns height of terrain in samples
+    unsigned int getTerrainHeight() const;
+
+    ///returns number of fragments
+    unsigned int getFragmentNum() const;
+
+    ///returns id of fragment with specified number (in order of fragment table)
+    hydra::data::TerrainFragmentId getFragmentId(unsigned int inNum) const;
+
+    ///returns true if index contains specified fragment
+    bool hasFragment(hydra::data::TerrainFragmentId inId) const;
+
+    ///returns number of index levels of details (resolution of quad tree) of fragment (throws std::runtime_error)
+    unsigned int getIndexLODNum(hydra::data::TerrainFragmentId inId) const;
+
+    ///returns number of chunks of fragment (throws std::runtime_error)
+    unsigned int getChunkNum(hydra::data::TerrainFragmentId inId) const;
+
+    ///returns records of fragment's chunks, there are getChunkNum() of them (throws std::runtime_error)
+    const TerrainIndex::ChunkRecord* getChunks(hydra::data::TerrainFragmentId inId) const;
+
+    ///returns number of vertex levels of details of fragment (throws std::runtime_error)
+    unsigned int getVertexLODNum(hydra::data::TerrainFragmentId inId) const;
+
+    ///returns number of vertices of fragment's vertex levels, there are getVertexLODNum() of them (throws std::runtime_error)
+    const boost::uint32_t* getVertexNums(hydra::data::TerrainFragmentId inId) const;
+
+    ///\brief Builds quad tree of fragment's chunks (throws std::runtime_error)
+    ///
+    ///Chunks are UNLOADED and have no data.
+    hydra::data::TerrainFragment::QuadTreeOfChunksPtr createTree(hydra::data::TerrainFragmentId inId) const;
+
+private:
+    //pimpl
+    struct Impl;
+    hydra::common::PimplPtr<Impl>::Type mImpl;
+};
+
+///smart pointer to TerrainIndex
+typedef hydra::common::SharedPtr<TerrainIndex>::Type TerrainIndexPtr;
+
+} //loading namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
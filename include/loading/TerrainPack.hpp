@@ -0,0 +1,142 @@
+//TerrainPack.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef TERRAIN_PACK_HPP__
+#define TERRAIN_PACK_HPP__
+
+/**
+ * \class hydra::loading::TerrainPack
+ * \brief Single file with all the binary data of terrain fragment.
+ *
+ * Preprocessed fragment consists of indices of every chunk and of
+ * several vertex levels of details. Storing each of them in its own file
+ * gives hundreds of thousands of tiny files for large terrains, and
+ * opening them costs much more than reading. Pack stores them in one file:
+ *  - header (magic "HTFP", version, numbers of chunks and vertex LODs, alignment, flags);
+ *  - offset table: offset, number of elements and size of payload of every
+ *    chunk (in order of positions in quad tree) and of every vertex LOD;
+ *  - payloads, each one starts at offset aligned to 4 KB.
+ *
+ * Indices are compressed with hydra::data::TerrainChunkCodec (or stored as
+ * TerrainChunk::index_t if pack is written without compression, see flags),
+ * vertices are stored as 16-byte records (x, z, y, normalX, normalZ)
+ * like in per-file layout. All the values are in native byte order.
+ *
+ * Pack object opens file once and reads only requested ranges with
+ * positional reads, so it may be used by several threads at once.
+ *
+ * \see hydra::data::TerrainFragment
+ */
+
+#include "common/PimplPtr.hpp"
+#include "common/SharedPtr.hpp"
+#include "data/TerrainFragment.hpp"
+#include "data/TerrainChunk.hpp"
+
+#include <string>
+#include <ostream>
+#include <boost/noncopyable.hpp>
+
+namespace hydra{
+
+namespace loading{
+
+class TerrainPack: private boost::noncopyable{
+
+public:
+    ///alignment (in bytes) of payloads
+    static const unsigned int ALIGNMENT = 4096;
+
+    ///size of vertex record (in bytes)
+    static const unsigned int VERTEX_SIZE = 16;
+
+    ///\brief Writes binary data of fragment to stream.
+    ///
+    ///Chunks without data are written as empty ones.
+    ///Throws std::runtime_error if stream fails.
+    static void write(const hydra::data::TerrainFragment& inFragment, std::ostream& outStream, bool inCompressIndices = true);
+
+    ///converts vertices to records (outData must have inNum * VERTEX_SIZE bytes)
+    static void encodeVertices(const hydra::data::TerrainFragment::CompressedVertex* inVertices, size_t inNum, char* outData);
+
+    ///converts records to vertices
+    static void decodeVertices(const char* inData, size_t inNum, hydra::data::TerrainFragment::CompressedVertex* outVertices);
+
+    ///opens pack and reads its header and offset table (throws std::runtime_error)
+    explicit TerrainPack(const std::string& inPath);
+
+    ///closes file
+    ~TerrainPack();
+
+    ///returns number of chunks (nodes of quad tree)
+    unsigned int getChunkNum() const;
+
+    ///returns number of vertex levels of details
+    unsigned int getVertexLODNum() const;
+
+    ///returns true if indices of chunks are compressed
+    bool hasCompressedIndices() const;
+
+    ///returns number of indices of chunk
+    unsigned int getIndexNum(unsigned int inPosition) const;
+
+    ///returns number of vertices of vertex level of details
+    unsigned int getVertexNum(unsigned int inLevel) const;
+
+    ///reads indices of chunk with specified position in quad tree (throws std::runtime_error)
+    void readChunk(unsigned int inPosition, hydra::data::TerrainChunk& outChunk) const;
+
+    ///reads vertex level of details (throws std::runtime_error)
+    void readVertexLOD(unsigned int inLevel, hydra::data::TerrainFragment::VertexCont& outVertices) const;
+
+private:
+    //pimpl
+    struct Impl;
+    hydra::common::PimplPtr<Impl>::Type mImpl;
+};
+
+///smart pointer to TerrainPack
+typedef hydra::common::SharedPtr<TerrainPack>::Type TerrainPackPtr;
+
+} //loading namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
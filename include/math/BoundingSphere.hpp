@@ -0,0 +1,116 @@
+//BoundingSphere.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef BOUNDING_SPHERE_HPP__
+#define BOUNDING_SPHERE_HPP__
+
+/**
+ * \class hydra::math::BoundingSphere
+ * \brief Sphere which contains some 3D object.
+ *
+ * Cheaper to test against frustum planes or to transform than AABB,
+ * but usually less tight.
+ *
+ * \see hydra::math::AABB
+ */
+
+#include "math/Vector3D.hpp"
+
+#include <cmath>
+
+namespace hydra{
+
+namespace math{
+
+class BoundingSphere{
+
+public:
+    ///builds empty sphere (zero radius at (0, 0, 0))
+    inline BoundingSphere(): mRadius(0.0f){
+
+    }
+
+    ///builds sphere with specified center and radius
+    inline BoundingSphere(const hydra::math::Vector3D& inCenter, float inRadius): mCenter(inCenter), mRadius(inRadius){
+
+    }
+
+    ///whether specified point is inside sphere
+    inline bool isInside(const hydra::math::Vector3D& inPoint) const{
+        return (inPoint - mCenter).getSquareMagnitude() <= mRadius * mRadius;
+    }
+
+    ///extends sphere to contain another one
+    inline void merge(const hydra::math::BoundingSphere& inSphere){
+        hydra::math::Vector3D diff = inSphere.mCenter - mCenter;
+        float distance = diff.getMagnitude();
+        //one sphere contains another
+        if(distance + inSphere.mRadius <= mRadius) return;
+        if(distance + mRadius <= inSphere.mRadius){
+            *this = inSphere;
+            return;
+        }
+        float radius = 0.5f * (distance + mRadius + inSphere.mRadius);
+        mCenter += diff * ((radius - mRadius) / distance);
+        mRadius = radius;
+    }
+
+    ///returns center of sphere
+    inline const hydra::math::Vector3D& getCenter() const{
+        return mCenter;
+    }
+
+    ///returns radius of sphere
+    inline float getRadius() const{
+        return mRadius;
+    }
+
+private:
+    ///center of sphere
+    hydra::math::Vector3D mCenter;
+    ///radius of sphere
+    float mRadius;
+};
+
+} //math namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
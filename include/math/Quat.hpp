@@ -115,7 +115,9 @@ public:
     ///returns square magnitude (sometimes you don't need magnitude)
     float getSquareMagnitude() const;
 
-    ///sets values to 4x4 matrix
+    ///\brief Writes 3x3 rotation matrix (9 floats, row by row).
+    ///
+    ///Quaternion must be normalized. Matrix rotates vectors as rotate() does.
     void getRotationMatrix(float* inoutMatrix) const;
 
 private:
@@ -22,9 +22,20 @@
  *
  * MeshOptimizer optimizes mesh which contains irredundant data (there are
  * no equal vertices in vertex container). It does not change vertices but
- * changes indices. For now optimizer convert mesh index from triangle list to triangle strip.
+ * changes indices. Optimizer has 2 modes:
+ *  - STRIPIFY (default) converts mesh from triangle list to a single triangle strip
+ *    (strips are linked using degenerate triangles);
+ *  - VERTEX_CACHE reorders triangles of triangle list for post-transform vertex
+ *    cache (Forsyth's linear-speed algorithm). Mesh stays a triangle list and
+ *    number of indices does not change.
+ *
  * So you should check mesh's mode (Mesh::mMode) after optimization and before rendering.
- * Video-card's vertex cache usage is also optimized.
+ * Use analyzeVertexCache() to measure results (ACMR and ATVR) for simulated FIFO cache.
+ *
+ * Triangle lists optimized for vertex cache may be reordered once more to reduce
+ * overdraw (optimizeOverdraw()) and then vertices may be renumbered for vertex
+ * fetch (Mesh::optimizeVertexFetch()). Use analyzeOverdraw() and analyzeVertexFetch()
+ * to measure results.
  *
  * \warning Do not try to optimize meshes which contain redundant data as you may
  * get poor results. You can call Mesh::deleteRedundantVertices() to drop redundancy.
@@ -38,6 +49,8 @@
 #include "common/SharedPtr.hpp"
 #include "common/PimplPtr.hpp"
 
+#include <cstddef>
+
 namespace hydra{
 
 namespace data{
@@ -52,6 +65,60 @@ namespace rendering{
 class MeshOptimizer{
 
 public:
+    ///what optimizer does with mesh
+    enum Mode{
+        ///convert triangle list to triangle strip
+        STRIPIFY = 0,
+        ///reorder triangles of triangle list for vertex cache
+        VERTEX_CACHE
+    };
+
+    /**
+     * \brief Results of post-transform vertex cache simulation.
+     *
+     * \see MeshOptimizer::analyzeVertexCache
+     */
+    struct CacheStatistics{
+        ///number of indices
+        size_t indices;
+        ///number of non-degenerate triangles
+        size_t triangles;
+        ///number of referenced vertices
+        size_t vertices;
+        ///number of cache misses (vertex shader invocations)
+        size_t transformedVertices;
+        ///average cache miss ratio (transformed vertices per triangle)
+        float acmr;
+        ///average transformed vertex ratio (transformed vertices per referenced vertex)
+        float atvr;
+    };
+
+    /**
+     * \brief Results of overdraw estimation.
+     *
+     * \see MeshOptimizer::analyzeOverdraw
+     */
+    struct OverdrawStatistics{
+        ///number of pixels covered by mesh (summed over all viewpoints)
+        size_t pixelsCovered;
+        ///number of pixels which passed depth test (summed over all viewpoints)
+        size_t pixelsShaded;
+        ///shaded pixels per covered pixel (1 means no overdraw)
+        float overdraw;
+    };
+
+    /**
+     * \brief Results of vertex fetch simulation.
+     *
+     * \see MeshOptimizer::analyzeVertexFetch
+     */
+    struct FetchStatistics{
+        ///number of bytes read from memory
+        size_t bytesFetched;
+        ///fetched bytes per byte of vertex data (1 means each vertex is read once)
+        float overfetch;
+    };
+
     ///builds empty object
     MeshOptimizer();
 
@@ -68,9 +135,49 @@ public:
     ///your mesh will be modified
     void optimizeMesh(hydra::data::MeshPtr inMesh) const;
 
-    ///sets size of vcache to optimize for
+    ///sets size of vcache to optimize for (10 by default)
     void setCacheSize(unsigned int inSize);
 
+    ///returns size of vcache to optimize for
+    unsigned int getCacheSize() const;
+
+    ///sets optimization mode (STRIPIFY by default)
+    void setMode(MeshOptimizer::Mode inMode);
+
+    ///returns optimization mode
+    MeshOptimizer::Mode getMode() const;
+
+    ///\brief Simulates FIFO post-transform vertex cache of specified size.
+    ///
+    ///Works for triangle lists and triangle strips. Degenerate triangles
+    ///are not counted as triangles but their indices do pass through the cache.
+    static MeshOptimizer::CacheStatistics analyzeVertexCache(const hydra::data::Mesh& inMesh, unsigned int inCacheSize);
+
+    ///\brief Reorders triangles of triangle list to reduce overdraw.
+    ///
+    ///Call it after optimization for vertex cache (VERTEX_CACHE mode).
+    ///Triangle list is split into clusters at points where vertex cache is flushed
+    ///and clusters are sorted so outer (occluding) ones are drawn first.
+    ///inThreshold limits ACMR loss: clusters are made smaller while their ACMR
+    ///does not exceed inThreshold * (ACMR of the original cluster).
+    ///New order is kept only if analyzeOverdraw() reports less overdraw than before.
+    void optimizeOverdraw(hydra::data::MeshPtr inMesh, float inThreshold = 1.05f) const;
+
+    ///\brief Estimates overdraw by rasterizing mesh on CPU.
+    ///
+    ///Mesh is rendered with depth test and back-face culling (counter-clockwise
+    ///front faces) using orthographic projection from 14 fixed viewpoints
+    ///(6 axis-aligned and 8 diagonal ones) to inResolution x inResolution target.
+    ///Works for triangle lists and triangle strips.
+    static MeshOptimizer::OverdrawStatistics analyzeOverdraw(const hydra::data::Mesh& inMesh, unsigned int inResolution = 256);
+
+    ///\brief Simulates memory reads of vertices when indices are processed.
+    ///
+    ///Memory is read by 64-byte lines through FIFO cache of 4 Kb.
+    ///inVertexSize is size of a single vertex in bytes (size of hydra::data::Vertex
+    ///or stride of hydra::data::VertexFormat).
+    static MeshOptimizer::FetchStatistics analyzeVertexFetch(const hydra::data::Mesh& inMesh, unsigned int inVertexSize);
+
 private:
     ///implementation
     struct MeshOptImpl;
@@ -27,6 +27,9 @@
  * Current implementation uses quad tree to optimize landscape.
  * Triangulation generates triangle list wich may be optimized using
  * hydra::rendering::MeshOptimizer.
+ * Optimizer may use several threads for a single height map: errors,
+ * enable flags and triangulation of independent subtrees are calculated
+ * in parallel. Results are identical to the ones of a single thread.
  *
  * \author A.V.Medvedev
  * \date 18.08.2010
@@ -51,11 +54,20 @@ namespace rendering{
 class TerrainOptimizer: public boost::noncopyable{
 
 public:
-    ///builds optimizer from height map data
-    TerrainOptimizer(const hydra::data::HeightMap& inHeights);
+    ///\brief Builds optimizer from height map data.
+    ///
+    ///inThreadNum is the number of threads used by optimizer
+    ///(0 means number of hardware threads).
+    TerrainOptimizer(const hydra::data::HeightMap& inHeights, unsigned int inThreadNum = 1);
 
     ~TerrainOptimizer();
 
+    ///sets number of threads used by the next calls (0 means number of hardware threads)
+    void setThreadNum(unsigned int inThreadNum);
+
+    ///returns number of threads used by optimizer
+    unsigned int getThreadNum() const;
+
     ///Rebuild optimizer to work with new height map data
     ///If new height map's size is same, tree will not be recreated
     ///which is very good optimization
@@ -65,6 +77,9 @@ public:
     ///returns nothing.
     ///This must be called before building triangulation.
     ///After generating LOD you may use same data to build several triangulations.
+    ///LODs are generated incrementally if error decreases: elements enabled
+    ///for previous LOD are kept and only the new ones are added, so call it
+    ///from the least detailed LOD to the most detailed one when you need several.
     void generateLOD(float inMaxError);
 
     ///Builds triangulation and returns it (for whole chunk).
@@ -50,6 +50,12 @@ public:
      * User may configure preprocessor for his needs.
      */
     struct Properties{
+        ///builds default properties
+        inline Properties(): numOfLODs(4), maxError(1.0f), LODErrorFactor(0.25f), vertexLODFactor(0.5f),
+            generateSkirts(true), optimizerThreadNum(1){
+
+        }
+
         ///Number of levels of details.
         ///Preprocessor will try to build lods. If it is
         ///not possible for given maxError and errorFactor values
@@ -82,6 +88,25 @@ public:
         ///It is intended to cover the cracks between chunks with different
         ///levels during rendering. See 'Chunked LOD' for more info.
         bool generateSkirts;
+
+        ///Number of threads used by TerrainOptimizer to build the error tree
+        ///and triangulations of a single fragment (0 means number of hardware threads).
+        ///More than 1 is useful when fragments are not processed in parallel.
+        unsigned int optimizerThreadNum;
+    };
+
+    ///\brief Time (in microseconds) spent in stages of the last process() call.
+    ///
+    ///Intended for progress reports of offline tools.
+    struct Timings{
+        ///building vertices and normals from heightmap
+        long vertices;
+
+        ///building error tree and choosing vertices of levels of details (TerrainOptimizer)
+        long optimization;
+
+        ///building chunks: triangulations, skirts, vertex levels and bounding boxes
+        long chunks;
     };
 
     ///creates optimizer with specified properties
@@ -97,6 +122,9 @@ public:
     ///returns properties
     TerrainPreprocessor::Properties getProperties() const;
 
+    ///returns timings of the last process() call (zeros if it hasn't been called)
+    const TerrainPreprocessor::Timings& getTimings() const;
+
 private:
     //pimpl
     struct Impl;
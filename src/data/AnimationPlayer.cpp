@@ -0,0 +1,424 @@
+//AnimationPlayer.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/AnimationPlayer.hpp"
+#include "data/Animation.hpp"
+#include "data/Pose.hpp"
+#include "math/Vector3D.hpp"
+#include "math/Quat.hpp"
+#include "common/ParallelFor.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+using hydra::data::AnimationPlayer;
+using hydra::data::Animation;
+using hydra::data::AnimationPtr;
+using hydra::data::Pose;
+using hydra::data::Skeleton;
+using hydra::data::Bone;
+using hydra::math::Vector3D;
+using hydra::math::Quat;
+
+namespace{
+
+//quaternions closer than this are interpolated linearly by slerp
+const float SLERP_THRESHOLD = 0.9995f;
+
+//quaternion as plain values (operations of math classes are not inlined)
+struct QuatData{
+    float x, y, z, w;
+};
+
+inline QuatData load(const Quat& inQuat){
+    const QuatData result = {inQuat.getVec().x(), inQuat.getVec().y(), inQuat.getVec().z(), inQuat.getScalar()};
+    return result;
+}
+
+inline void store(const QuatData& inData, Quat& outQuat){
+    Vector3D vec = outQuat.getVec();
+    vec.setX(inData.x);
+    vec.setY(inData.y);
+    vec.setZ(inData.z);
+    outQuat.setVec(vec);
+    outQuat.setScalar(inData.w);
+}
+
+inline float dot(const QuatData& inQuat1, const QuatData& inQuat2){
+    return inQuat1.x * inQuat2.x + inQuat1.y * inQuat2.y + inQuat1.z * inQuat2.z + inQuat1.w * inQuat2.w;
+}
+
+//returns weighted sum of quaternions
+inline QuatData combine(const QuatData& inQuat1, float inFactor1, const QuatData& inQuat2, float inFactor2){
+    const QuatData result = {inQuat1.x * inFactor1 + inQuat2.x * inFactor2, inQuat1.y * inFactor1 + inQuat2.y * inFactor2,
+                             inQuat1.z * inFactor1 + inQuat2.z * inFactor2, inQuat1.w * inFactor1 + inQuat2.w * inFactor2};
+    return result;
+}
+
+//returns normalized quaternion (identity for zero one)
+inline QuatData normalize(const QuatData& inQuat){
+    const float squareMagnitude = dot(inQuat, inQuat);
+    if(squareMagnitude < 1e-12f){
+        const QuatData identity = {0.0f, 0.0f, 0.0f, 1.0f};
+        return identity;
+    }
+    const float scale = 1.0f / sqrtf(squareMagnitude);
+    const QuatData result = {inQuat.x * scale, inQuat.y * scale, inQuat.z * scale, inQuat.w * scale};
+    return result;
+}
+
+//interpolates along the shortest path, result is normalized
+inline QuatData nlerp(const QuatData& inQuat1, const QuatData& inQuat2, float inFactor){
+    const float factor2 = (dot(inQuat1, inQuat2) < 0.0f)? -inFactor: inFactor;
+    return normalize(combine(inQuat1, 1.0f - inFactor, inQuat2, factor2));
+}
+
+//spherical interpolation along the shortest path
+inline QuatData slerp(const QuatData& inQuat1, const QuatData& inQuat2, float inFactor){
+    float cosAngle = dot(inQuat1, inQuat2);
+    const float sign = (cosAngle < 0.0f)? -1.0f: 1.0f;
+    cosAngle *= sign;
+    if(cosAngle > SLERP_THRESHOLD) return nlerp(inQuat1, inQuat2, inFactor);
+
+    const float angle = acosf(cosAngle);
+    const float invSin = 1.0f / sinf(angle);
+    return combine(inQuat1, sinf((1.0f - inFactor) * angle) * invSin, inQuat2, sinf(inFactor * angle) * invSin * sign);
+}
+
+//returns product of quaternions (rotation by inQuat2, then by inQuat1)
+inline QuatData multiply(const QuatData& inQuat1, const QuatData& inQuat2){
+    const QuatData result = {inQuat1.w * inQuat2.x + inQuat1.x * inQuat2.w + inQuat1.y * inQuat2.z - inQuat1.z * inQuat2.y,
+                             inQuat1.w * inQuat2.y + inQuat1.y * inQuat2.w + inQuat1.z * inQuat2.x - inQuat1.x * inQuat2.z,
+                             inQuat1.w * inQuat2.z + inQuat1.z * inQuat2.w + inQuat1.x * inQuat2.y - inQuat1.y * inQuat2.x,
+                             inQuat1.w * inQuat2.w - inQuat1.x * inQuat2.x - inQuat1.y * inQuat2.y - inQuat1.z * inQuat2.z};
+    return result;
+}
+
+//rotates vector by unit quaternion
+inline void rotate(const QuatData& inQuat, const float* inVec, float* outVec){
+    const float tx = 2.0f * (inQuat.y * inVec[2] - inQuat.z * inVec[1]);
+    const float ty = 2.0f * (inQuat.z * inVec[0] - inQuat.x * inVec[2]);
+    const float tz = 2.0f * (inQuat.x * inVec[1] - inQuat.y * inVec[0]);
+    outVec[0] = inVec[0] + inQuat.w * tx + inQuat.y * tz - inQuat.z * ty;
+    outVec[1] = inVec[1] + inQuat.w * ty + inQuat.z * tx - inQuat.x * tz;
+    outVec[2] = inVec[2] + inQuat.w * tz + inQuat.x * ty - inQuat.y * tx;
+}
+
+inline void setVector(float inX, float inY, float inZ, Vector3D& outVec){
+    outVec.setX(inX);
+    outVec.setY(inY);
+    outVec.setZ(inZ);
+}
+
+//returns length of animation in seconds
+float getDuration(const Animation& inAnimation, bool inLoop){
+    if(inAnimation.mFrames.empty() || inAnimation.mFramerate < 0.001f) return 0.0f;
+    const size_t intervals = inLoop? inAnimation.mFrames.size(): inAnimation.mFrames.size() - 1;
+    return intervals / inAnimation.mFramerate;
+}
+
+//clears accumulators of blending
+void beginBlend(size_t inBoneNum, Pose& outPose, std::vector<float>& outTotals){
+    outPose.mPositions.resize(inBoneNum);
+    outPose.mOrients.resize(inBoneNum);
+    for(size_t i = 0; i < inBoneNum; ++i){
+        setVector(0.0f, 0.0f, 0.0f, outPose.mPositions[i]);
+        const QuatData zero = {0.0f, 0.0f, 0.0f, 0.0f};
+        store(zero, outPose.mOrients[i]);
+    }
+    outTotals.assign(inBoneNum, 0.0f);
+}
+
+//adds weighted pose to accumulators
+void accumulate(const Pose& inPose, float inWeight, const float* inBoneMask, Pose& inoutPose, std::vector<float>& inoutTotals){
+    assert(inPose.getBoneNum() >= inoutPose.getBoneNum());
+    for(size_t i = 0; i < inoutPose.getBoneNum(); ++i){
+        const float weight = inBoneMask? inWeight * inBoneMask[i]: inWeight;
+        if(!(weight > 0.0f)) continue;
+
+        //the same hemisphere as accumulated orientation
+        const QuatData orient = load(inoutPose.mOrients[i]);
+        const QuatData nextOrient = load(inPose.mOrients[i]);
+        const float orientWeight = (dot(orient, nextOrient) < 0.0f)? -weight: weight;
+        store(combine(orient, 1.0f, nextOrient, orientWeight), inoutPose.mOrients[i]);
+
+        Vector3D& pos = inoutPose.mPositions[i];
+        const Vector3D& nextPos = inPose.mPositions[i];
+        setVector(pos.x() + nextPos.x() * weight, pos.y() + nextPos.y() * weight, pos.z() + nextPos.z() * weight, pos);
+        inoutTotals[i] += weight;
+    }
+}
+
+//normalizes accumulated values, bones without weights get identity
+void endBlend(Pose& inoutPose, const std::vector<float>& inTotals){
+    for(size_t i = 0; i < inoutPose.getBoneNum(); ++i){
+        store(normalize(load(inoutPose.mOrients[i])), inoutPose.mOrients[i]);
+        if(inTotals[i] > 0.0f){
+            Vector3D& pos = inoutPose.mPositions[i];
+            const float scale = 1.0f / inTotals[i];
+            setVector(pos.x() * scale, pos.y() * scale, pos.z() * scale, pos);
+        }
+    }
+}
+
+//updates and evaluates subrange of players
+struct UpdateRange{
+    AnimationPlayer* const* players;
+    Pose* poses;
+    float delta;
+
+    void operator()(size_t inBegin, size_t inEnd) const{
+        for(size_t i = inBegin; i < inEnd; ++i){
+            players[i]->update(delta);
+            players[i]->evaluate(poses[i]);
+        }
+    }
+};
+
+} //anonymous namespace
+
+AnimationPlayer::Layer::Layer(): mTime(0.0f), mSpeed(1.0f), mWeight(1.0f), mTargetWeight(1.0f), mFadeSpeed(0.0f),
+        mLoop(true), mAdditive(false), mRemoveWhenFaded(false){
+
+}
+
+AnimationPlayer::AnimationPlayer(size_t inBoneNum, AnimationPlayer::Interpolation inInterpolation):
+        mBoneNum(inBoneNum), mInterpolation(inInterpolation){
+
+}
+
+size_t AnimationPlayer::addLayer(AnimationPtr inAnimation, float inWeight, bool inLoop){
+    Layer layer;
+    layer.mAnimation = inAnimation;
+    layer.mWeight = layer.mTargetWeight = inWeight;
+    layer.mLoop = inLoop;
+    mLayers.push_back(layer);
+    return mLayers.size() - 1;
+}
+
+size_t AnimationPlayer::addAdditiveLayer(AnimationPtr inAnimation, float inWeight, bool inLoop){
+    const size_t result = addLayer(inAnimation, inWeight, inLoop);
+    mLayers[result].mAdditive = true;
+    if(!inAnimation->mFrames.empty()) mLayers[result].mReference.fromSkeleton(inAnimation->mFrames[0]);
+    return result;
+}
+
+void AnimationPlayer::removeLayer(size_t inLayer){
+    assert(inLayer < mLayers.size());
+    mLayers.erase(mLayers.begin() + inLayer);
+}
+
+void AnimationPlayer::clearLayers(){
+    mLayers.clear();
+}
+
+void AnimationPlayer::fadeLayer(size_t inLayer, float inTargetWeight, float inDuration){
+    assert(inLayer < mLayers.size());
+    Layer& layer = mLayers[inLayer];
+    layer.mTargetWeight = inTargetWeight;
+    if(inDuration > 0.0f){
+        layer.mFadeSpeed = fabsf(inTargetWeight - layer.mWeight) / inDuration;
+    }
+    else{
+        layer.mWeight = inTargetWeight;
+        layer.mFadeSpeed = 0.0f;
+    }
+}
+
+size_t AnimationPlayer::crossFade(AnimationPtr inAnimation, float inDuration, bool inLoop){
+    for(size_t i = 0; i < mLayers.size(); ++i){
+        if(mLayers[i].mAdditive) continue;
+        fadeLayer(i, 0.0f, inDuration);
+        mLayers[i].mRemoveWhenFaded = true;
+    }
+    const size_t result = addLayer(inAnimation, 0.0f, inLoop);
+    fadeLayer(result, 1.0f, inDuration);
+
+    //layers faded immediately are removed now
+    update(0.0f);
+    return mLayers.size() - 1;
+}
+
+void AnimationPlayer::update(float inDeltaSeconds){
+    for(size_t i = 0; i < mLayers.size(); ){
+        Layer& layer = mLayers[i];
+
+        const float duration = getDuration(*layer.mAnimation, layer.mLoop);
+        layer.mTime += inDeltaSeconds * layer.mSpeed;
+        if(layer.mLoop && duration > 0.0f){
+            layer.mTime = fmodf(layer.mTime, duration);
+            if(layer.mTime < 0.0f) layer.mTime += duration;
+        }
+        else{
+            layer.mTime = std::max(0.0f, std::min(layer.mTime, duration));
+        }
+
+        if(layer.mWeight != layer.mTargetWeight){
+            const float step = layer.mFadeSpeed * inDeltaSeconds;
+            if(fabsf(layer.mTargetWeight - layer.mWeight) <= step) layer.mWeight = layer.mTargetWeight;
+            else layer.mWeight += (layer.mTargetWeight > layer.mWeight)? step: -step;
+        }
+
+        if(layer.mRemoveWhenFaded && layer.mWeight <= 0.0f && layer.mTargetWeight <= 0.0f){
+            mLayers.erase(mLayers.begin() + i);
+        }
+        else{
+            ++i;
+        }
+    }
+}
+
+void AnimationPlayer::evaluate(Pose& outPose) const{
+    mSamples.resize(mLayers.size());
+
+    //weighted average of ordinary layers
+    beginBlend(mBoneNum, outPose, mWeightSums);
+    for(size_t i = 0; i < mLayers.size(); ++i){
+        const Layer& layer = mLayers[i];
+        if(layer.mAdditive || !(layer.mWeight > 0.0f)) continue;
+        assert(layer.mBoneMask.empty() || layer.mBoneMask.size() >= mBoneNum);
+        sample(*layer.mAnimation, layer.mTime, layer.mLoop, mInterpolation, mSamples[i]);
+        accumulate(mSamples[i], layer.mWeight, layer.mBoneMask.empty()? 0: &layer.mBoneMask[0], outPose, mWeightSums);
+    }
+    endBlend(outPose, mWeightSums);
+
+    for(size_t i = 0; i < mLayers.size(); ++i){
+        const Layer& layer = mLayers[i];
+        if(!layer.mAdditive || !(layer.mWeight > 0.0f)) continue;
+        assert(layer.mBoneMask.empty() || layer.mBoneMask.size() >= mBoneNum);
+        sample(*layer.mAnimation, layer.mTime, layer.mLoop, mInterpolation, mSamples[i]);
+        addAdditive(mSamples[i], layer.mReference, layer.mWeight, layer.mBoneMask.empty()? 0: &layer.mBoneMask[0], outPose);
+    }
+}
+
+void AnimationPlayer::sample(const Animation& inAnimation, float inTime, bool inLoop,
+                             AnimationPlayer::Interpolation inInterpolation, Pose& outPose){
+    const size_t frameNum = inAnimation.getFrameNum();
+    if(!frameNum){
+        outPose.setIdentity(0);
+        return;
+    }
+
+    //position between frames
+    float frame = inTime * inAnimation.mFramerate;
+    size_t first, second;
+    if(inLoop){
+        frame = fmodf(frame, static_cast<float>(frameNum));
+        if(frame < 0.0f) frame += frameNum;
+        first = std::min(static_cast<size_t>(frame), frameNum - 1);
+        second = (first + 1 < frameNum)? first + 1: 0;
+    }
+    else{
+        frame = std::max(0.0f, std::min(frame, static_cast<float>(frameNum - 1)));
+        first = std::min(static_cast<size_t>(frame), frameNum - 1);
+        second = std::min(first + 1, frameNum - 1);
+    }
+    const float factor = frame - first;
+
+    const Skeleton& firstFrame = inAnimation.mFrames[first];
+    const Skeleton& secondFrame = inAnimation.mFrames[second];
+    const size_t boneNum = firstFrame.mBones.size();
+    assert(secondFrame.mBones.size() == boneNum);
+    outPose.mPositions.resize(boneNum);
+    outPose.mOrients.resize(boneNum);
+    for(size_t i = 0; i < boneNum; ++i){
+        const Bone& firstBone = firstFrame.mBones[i];
+        const Bone& secondBone = secondFrame.mBones[i];
+        setVector(firstBone.mPos.x() + (secondBone.mPos.x() - firstBone.mPos.x()) * factor,
+                  firstBone.mPos.y() + (secondBone.mPos.y() - firstBone.mPos.y()) * factor,
+                  firstBone.mPos.z() + (secondBone.mPos.z() - firstBone.mPos.z()) * factor, outPose.mPositions[i]);
+        const QuatData firstOrient = load(firstBone.mOrient);
+        const QuatData secondOrient = load(secondBone.mOrient);
+        store((inInterpolation == SLERP)? slerp(firstOrient, secondOrient, factor): nlerp(firstOrient, secondOrient, factor),
+              outPose.mOrients[i]);
+    }
+}
+
+void AnimationPlayer::blend(const Pose* const* inPoses, const float* inWeights, size_t inPoseNum, Pose& outPose){
+    size_t boneNum = inPoseNum? inPoses[0]->getBoneNum(): 0;
+    for(size_t i = 1; i < inPoseNum; ++i) boneNum = std::min(boneNum, inPoses[i]->getBoneNum());
+
+    std::vector<float> weightSums;
+    beginBlend(boneNum, outPose, weightSums);
+    for(size_t i = 0; i < inPoseNum; ++i) accumulate(*inPoses[i], inWeights[i], 0, outPose, weightSums);
+    endBlend(outPose, weightSums);
+}
+
+void AnimationPlayer::addAdditive(const Pose& inAdditive, const Pose& inReference, float inWeight,
+                                  const float* inBoneMask, Pose& inoutPose){
+    const QuatData identity = {0.0f, 0.0f, 0.0f, 1.0f};
+    const size_t boneNum = std::min(inoutPose.getBoneNum(), std::min(inAdditive.getBoneNum(), inReference.getBoneNum()));
+    for(size_t i = 0; i < boneNum; ++i){
+        const float weight = std::min(inBoneMask? inWeight * inBoneMask[i]: inWeight, 1.0f);
+        if(!(weight > 0.0f)) continue;
+
+        //difference transforms reference to additive pose:
+        //rotation additive * reference^-1, translation additive - rotated reference
+        QuatData inverse = normalize(load(inReference.mOrients[i]));
+        inverse.x = -inverse.x;
+        inverse.y = -inverse.y;
+        inverse.z = -inverse.z;
+        QuatData delta = normalize(multiply(load(inAdditive.mOrients[i]), inverse));
+        float referencePos[3], rotated[3];
+        inReference.mPositions[i].get(referencePos);
+        rotate(delta, referencePos, rotated);
+        const Vector3D& additivePos = inAdditive.mPositions[i];
+        const float deltaPos[3] = {additivePos.x() - rotated[0], additivePos.y() - rotated[1], additivePos.z() - rotated[2]};
+
+        //difference scaled by weight is applied after pose
+        if(weight < 1.0f) delta = nlerp(identity, delta, weight);
+        float pos[3];
+        inoutPose.mPositions[i].get(pos);
+        rotate(delta, pos, rotated);
+        setVector(rotated[0] + deltaPos[0] * weight, rotated[1] + deltaPos[1] * weight, rotated[2] + deltaPos[2] * weight,
+                  inoutPose.mPositions[i]);
+        store(normalize(multiply(delta, load(inoutPose.mOrients[i]))), inoutPose.mOrients[i]);
+    }
+}
+
+void AnimationPlayer::updateAndEvaluate(AnimationPlayer* const* inPlayers, size_t inPlayerNum, float inDeltaSeconds,
+                                        Pose* outPoses, unsigned int inThreadNum){
+    UpdateRange task;
+    task.players = inPlayers;
+    task.poses = outPoses;
+    task.delta = inDeltaSeconds;
+    hydra::common::parallelFor(0, inPlayerNum, task, inThreadNum, 16);
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,162 @@
+//BoneInfluences.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/BoneInfluences.hpp"
+#include "data/Mesh.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <boost/cstdint.hpp>
+
+using hydra::data::BoneInfluences;
+using hydra::data::Mesh;
+
+namespace{
+
+//orders influences by decreasing weight
+struct CompareInfluences{
+    bool operator()(const std::pair<float, int>& lhv, const std::pair<float, int>& rhv) const{
+        return lhv.first > rhv.first;
+    }
+};
+
+} //anonymous namespace
+
+BoneInfluences::BoneInfluences(): mWeightType(UNORM8), mStride(0){
+
+}
+
+void BoneInfluences::build(const Mesh& inMesh, BoneInfluences::WeightType inWeightType){
+    clear();
+    mWeightType = inWeightType;
+    const size_t vertexNum = inMesh.getVertexNum();
+    if(!vertexNum || inMesh.mBones.size() != vertexNum || inMesh.mBoneWeights.size() != vertexNum) return;
+
+    const size_t weightSize = (inWeightType == UNORM16)? 2: 1;
+    const unsigned int maxValue = (inWeightType == UNORM16)? 0xffff: 0xff;
+    mStride = MAX_INFLUENCES * (1 + weightSize);
+    mData.resize(vertexNum * mStride, 0);
+
+    std::vector<std::pair<float, int> > influences;
+    for(size_t i = 0; i < vertexNum; ++i){
+        //keep the heaviest influences
+        influences.clear();
+        float totalWeight = 0.0f;
+        for(int j = 0; j < Mesh::MAX_BONES_PER_VERTEX; ++j){
+            if(!(inMesh.mBoneWeights[i][j] > 0.0f)) continue;
+            if(inMesh.mBones[i][j] < 0 || inMesh.mBones[i][j] > MAX_BONE){
+                clear();
+                throw std::out_of_range("BoneInfluences: bone index doesn't fit 8 bits");
+            }
+            influences.push_back(std::make_pair(inMesh.mBoneWeights[i][j], inMesh.mBones[i][j]));
+            totalWeight += inMesh.mBoneWeights[i][j];
+        }
+        if(influences.empty()) continue;
+        std::stable_sort(influences.begin(), influences.end(), CompareInfluences());
+        if(influences.size() > static_cast<size_t>(MAX_INFLUENCES)){
+            influences.resize(MAX_INFLUENCES);
+            ++mReport.truncatedVertexNum;
+        }
+
+        float keptWeight = 0.0f;
+        for(size_t j = 0; j < influences.size(); ++j) keptWeight += influences[j].first;
+        const float dropped = (totalWeight - keptWeight) / totalWeight;
+        mReport.maxDroppedWeight = std::max(mReport.maxDroppedWeight, dropped);
+        mReport.totalDroppedWeight += dropped;
+
+        //quantized weights sum to maxValue, remainder of rounding goes to the heaviest one
+        unsigned int quantized[MAX_INFLUENCES] = {0};
+        unsigned int sum = 0;
+        for(size_t j = 0; j < influences.size(); ++j){
+            quantized[j] = static_cast<unsigned int>(influences[j].first / keptWeight * maxValue + 0.5f);
+            sum += quantized[j];
+        }
+        quantized[0] = quantized[0] + maxValue - sum;
+
+        boost::uint8_t* vertexData = &mData[i * mStride];
+        for(size_t j = 0; j < influences.size(); ++j){
+            vertexData[j] = static_cast<boost::uint8_t>(influences[j].second);
+            if(inWeightType == UNORM16){
+                const boost::uint16_t value = static_cast<boost::uint16_t>(quantized[j]);
+                memcpy(vertexData + MAX_INFLUENCES + 2 * j, &value, sizeof(value));
+            }
+            else{
+                vertexData[MAX_INFLUENCES + j] = static_cast<boost::uint8_t>(quantized[j]);
+            }
+            const float error = fabsf(static_cast<float>(quantized[j]) / maxValue - influences[j].first / keptWeight);
+            mReport.maxQuantizationError = std::max(mReport.maxQuantizationError, error);
+        }
+    }
+}
+
+void BoneInfluences::clear(){
+    mData.clear();
+    mStride = 0;
+    mReport = Report();
+}
+
+float BoneInfluences::getWeight(size_t inVertex, int inSlot) const{
+    assert(inVertex < getVertexNum() && inSlot >= 0 && inSlot < MAX_INFLUENCES);
+    const boost::uint8_t* vertexData = &mData[inVertex * mStride + MAX_INFLUENCES];
+    if(mWeightType == UNORM16){
+        boost::uint16_t value;
+        memcpy(&value, vertexData + 2 * inSlot, sizeof(value));
+        return value / 65535.0f;
+    }
+    return vertexData[inSlot] / 255.0f;
+}
+
+void BoneInfluences::unpack(Mesh::BoneCont& outBones, Mesh::BoneWeightCont& outWeights) const{
+    const size_t vertexNum = getVertexNum();
+    outBones.resize(vertexNum);
+    outWeights.resize(vertexNum);
+    for(size_t i = 0; i < vertexNum; ++i){
+        outBones[i].assign(0);
+        outWeights[i].assign(0.0f);
+        for(int j = 0; j < MAX_INFLUENCES; ++j){
+            outBones[i][j] = getBone(i, j);
+            outWeights[i][j] = getWeight(i, j);
+        }
+    }
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
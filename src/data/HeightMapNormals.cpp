@@ -0,0 +1,198 @@
+//HeightMapNormals.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/HeightMapNormals.hpp"
+#include "data/HeightMap.hpp"
+
+#include <cmath>
+#include <cassert>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define HEIGHT_MAP_NORMALS_USE_SSE
+#endif
+
+using hydra::data::HeightMapNormals;
+using hydra::data::HeightMap;
+using hydra::math::Vector3D;
+
+namespace{
+
+//Both versions do the same operations in the same order (cross product of
+//triangle's edges, sum of triangles, normalization), so results are identical.
+//Coordinates along the lines (x) and columns (z) are relative to vertex,
+//differences of them are exact.
+
+//adds normal of triangle to sum
+inline void addTriangle(float inX1, float inY1, float inZ1, float inX2, float inY2, float inZ2, float inX3, float inY3, float inZ3,
+                        float& outX, float& outY, float& outZ){
+    const float ax = inX2 - inX1, ay = inY2 - inY1, az = inZ2 - inZ1;
+    const float bx = inX3 - inX1, by = inY3 - inY1, bz = inZ3 - inZ1;
+    outX += ay * bz - az * by;
+    outY += -(ax * bz - az * bx);
+    outZ += ax * by - ay * bx;
+}
+
+//calculates normal of single vertex
+void calcVertex(const float* inPrevious, const float* inLine, const float* inNext, unsigned int inSize, unsigned int inColumn,
+                float* outX, float* outY, float* outZ){
+    const unsigned int j = inColumn;
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+
+    if(inPrevious){
+        if(j != 0){
+            addTriangle(-1.0f, inPrevious[j - 1], -1.0f, 0.0f, inLine[j - 1], -1.0f, 0.0f, inLine[j], 0.0f, x, y, z);
+            addTriangle(-1.0f, inPrevious[j - 1], -1.0f, 0.0f, inLine[j], 0.0f, -1.0f, inPrevious[j], 0.0f, x, y, z);
+        }
+        if(j != inSize - 1){
+            addTriangle(-1.0f, inPrevious[j], 0.0f, 0.0f, inLine[j], 0.0f, 0.0f, inLine[j + 1], 1.0f, x, y, z);
+        }
+    }
+    if(inNext){
+        if(j != 0){
+            addTriangle(0.0f, inLine[j - 1], -1.0f, 1.0f, inNext[j], 0.0f, 0.0f, inLine[j], 0.0f, x, y, z);
+        }
+        if(j != inSize - 1){
+            addTriangle(1.0f, inNext[j], 0.0f, 1.0f, inNext[j + 1], 1.0f, 0.0f, inLine[j], 0.0f, x, y, z);
+            addTriangle(0.0f, inLine[j + 1], 1.0f, 0.0f, inLine[j], 0.0f, 1.0f, inNext[j + 1], 1.0f, x, y, z);
+        }
+    }
+
+    const float magnitude = sqrtf(x * x + y * y + z * z);
+    if(magnitude != 0.0f){
+        x /= magnitude;
+        y /= magnitude;
+        z /= magnitude;
+    }
+    outX[j] = x;
+    outY[j] = y;
+    outZ[j] = z;
+}
+
+#ifdef HEIGHT_MAP_NORMALS_USE_SSE
+
+//adds normals of triangles of 4 neighbouring vertices to their sums
+inline void addTriangle(float inX1, __m128 inY1, float inZ1, float inX2, __m128 inY2, float inZ2, float inX3, __m128 inY3, float inZ3,
+                        __m128& outX, __m128& outY, __m128& outZ){
+    const __m128 ax = _mm_set1_ps(inX2 - inX1), ay = _mm_sub_ps(inY2, inY1), az = _mm_set1_ps(inZ2 - inZ1);
+    const __m128 bx = _mm_set1_ps(inX3 - inX1), by = _mm_sub_ps(inY3, inY1), bz = _mm_set1_ps(inZ3 - inZ1);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    outX = _mm_add_ps(outX, _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)));
+    outY = _mm_add_ps(outY, _mm_xor_ps(sign, _mm_sub_ps(_mm_mul_ps(ax, bz), _mm_mul_ps(az, bx))));
+    outZ = _mm_add_ps(outZ, _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx)));
+}
+
+//calculates normals of 4 vertices which have all 6 triangles around
+inline void calcInnerVertices(const float* inPrevious, const float* inLine, const float* inNext, unsigned int inColumn,
+                              float* outX, float* outY, float* outZ){
+    const unsigned int j = inColumn;
+    const __m128 previousLeft = _mm_loadu_ps(inPrevious + j - 1), previous = _mm_loadu_ps(inPrevious + j);
+    const __m128 lineLeft = _mm_loadu_ps(inLine + j - 1), line = _mm_loadu_ps(inLine + j), lineRight = _mm_loadu_ps(inLine + j + 1);
+    const __m128 next = _mm_loadu_ps(inNext + j), nextRight = _mm_loadu_ps(inNext + j + 1);
+
+    __m128 x = _mm_setzero_ps(), y = _mm_setzero_ps(), z = _mm_setzero_ps();
+    addTriangle(-1.0f, previousLeft, -1.0f, 0.0f, lineLeft, -1.0f, 0.0f, line, 0.0f, x, y, z);
+    addTriangle(-1.0f, previousLeft, -1.0f, 0.0f, line, 0.0f, -1.0f, previous, 0.0f, x, y, z);
+    addTriangle(-1.0f, previous, 0.0f, 0.0f, line, 0.0f, 0.0f, lineRight, 1.0f, x, y, z);
+    addTriangle(0.0f, lineLeft, -1.0f, 1.0f, next, 0.0f, 0.0f, line, 0.0f, x, y, z);
+    addTriangle(1.0f, next, 0.0f, 1.0f, nextRight, 1.0f, 0.0f, line, 0.0f, x, y, z);
+    addTriangle(0.0f, lineRight, 1.0f, 0.0f, line, 0.0f, 1.0f, nextRight, 1.0f, x, y, z);
+
+    //zero vectors are not normalized
+    const __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+    const __m128 nonZero = _mm_cmpneq_ps(magnitude, _mm_setzero_ps());
+    x = _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(x, magnitude)), _mm_andnot_ps(nonZero, x));
+    y = _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(y, magnitude)), _mm_andnot_ps(nonZero, y));
+    z = _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(z, magnitude)), _mm_andnot_ps(nonZero, z));
+    _mm_storeu_ps(outX + j, x);
+    _mm_storeu_ps(outY + j, y);
+    _mm_storeu_ps(outZ + j, z);
+}
+
+#endif
+
+} //unnamed namespace
+
+void HeightMapNormals::calcLine(const float* inPrevious, const float* inLine, const float* inNext, unsigned int inSize, 
+                                float* outX, float* outY, float* outZ){
+    assert(inLine);
+    unsigned int j = 0;
+
+#ifdef HEIGHT_MAP_NORMALS_USE_SSE
+    //inner vertices of inner lines are processed by 4
+    if(inPrevious && inNext && inSize > 5){
+        calcVertex(inPrevious, inLine, inNext, inSize, 0, outX, outY, outZ);
+        for(j = 1; j + 4 < inSize; j += 4){
+            calcInnerVertices(inPrevious, inLine, inNext, j, outX, outY, outZ);
+        }
+    }
+#endif
+
+    for(; j < inSize; ++j){
+        calcVertex(inPrevious, inLine, inNext, inSize, j, outX, outY, outZ);
+    }
+}
+
+void HeightMapNormals::calc(const HeightMap& inHeights, std::vector<Vector3D>& outNormals){
+    const unsigned int size = inHeights.getSize();
+    outNormals.resize(size * size);
+    if(size == 0) return;
+
+    //3 lines of heights are kept, the next one is read in place of the oldest one
+    std::vector<float> heights(3 * size);
+    std::vector<float> normals(3 * size);
+    float* lines[3] = {&heights[0], &heights[size], &heights[2 * size]};
+    inHeights.getHeights(0, size, lines[1]);
+    if(size > 1) inHeights.getHeights(size, size, lines[2]);
+
+    for(unsigned int i = 0; i < size; ++i){
+        HeightMapNormals::calcLine((i != 0)? lines[0]: 0, lines[1], (i != size - 1)? lines[2]: 0, size,
+                                   &normals[0], &normals[size], &normals[2 * size]);
+        for(unsigned int j = 0; j < size; ++j){
+            outNormals[i * size + j] = Vector3D(normals[j], normals[size + j], normals[2 * size + j]);
+        }
+
+        //shift lines
+        float* oldest = lines[0];
+        lines[0] = lines[1];
+        lines[1] = lines[2];
+        lines[2] = oldest;
+        if(i + 2 < size) inHeights.getHeights((i + 2) * size, size, lines[2]);
+    }
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
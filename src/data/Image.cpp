@@ -57,9 +57,7 @@ Image::Image(const Image& inImage): mImpl(new ImageImpl()){
     const unsigned char* copyData = inImage.getData();
     //if any data to copy
     if(copyData){
-        int bpp = 0; //bytes per pixel
-        if(inImage.getMode() == RGB) bpp = 3;
-        else if(inImage.getMode() == RGBA) bpp = 4;
+        int bpp = getBytesPerPixel(inImage.getMode()); //bytes per pixel
         //allocate memory for new image
         mImpl->mData = new unsigned char[inImage.getWidth()*inImage.getHeight()*bpp];
         //copy image data
@@ -128,6 +126,16 @@ void Image::setMode(Image::Mode inMode){
     mImpl->mMode = inMode;
 }
 
+unsigned int Image::getBytesPerPixel(Image::Mode inMode){
+    switch(inMode){
+        case RGBA: return 4;
+        case RGB: return 3;
+        case LUMINANCE16: return 2;
+        case LUMINANCE_FLOAT: return 4;
+        default: return 0;
+    }
+}
+
 
 
 /*
@@ -0,0 +1,151 @@
+//IndexBuffer.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/IndexBuffer.hpp"
+#include "VarintCodec.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using hydra::data::IndexBuffer;
+using namespace hydra::VarintCodec;
+
+const IndexBuffer::value_type IndexBuffer::MAX_INDEX_16;
+
+IndexBuffer::IndexBuffer(const IndexBuffer::IndexCont& inIndices): mWidth(WIDTH_16){
+    assign(inIndices);
+}
+
+void IndexBuffer::resize(size_t inSize){
+    if(mWidth == WIDTH_16) mData16.resize(inSize, 0);
+    else mData32.resize(inSize, 0);
+}
+
+void IndexBuffer::reserve(size_t inSize){
+    if(mWidth == WIDTH_16) mData16.reserve(inSize);
+    else mData32.reserve(inSize);
+}
+
+void IndexBuffer::clear(){
+    std::vector<boost::uint16_t>().swap(mData16);
+    std::vector<boost::uint32_t>().swap(mData32);
+    mWidth = WIDTH_16;
+}
+
+void IndexBuffer::swap(IndexBuffer& inoutBuffer){
+    std::swap(mWidth, inoutBuffer.mWidth);
+    mData16.swap(inoutBuffer.mData16);
+    mData32.swap(inoutBuffer.mData32);
+}
+
+void IndexBuffer::assign(const IndexBuffer::IndexCont& inIndices){
+    const value_type maxIndex = inIndices.empty()? 0: *std::max_element(inIndices.begin(), inIndices.end());
+    if(maxIndex <= MAX_INDEX_16){
+        std::vector<boost::uint32_t>().swap(mData32);
+        mData16.assign(inIndices.begin(), inIndices.end());
+        mWidth = WIDTH_16;
+    }
+    else{
+        std::vector<boost::uint16_t>().swap(mData16);
+        mData32.assign(inIndices.begin(), inIndices.end());
+        mWidth = WIDTH_32;
+    }
+}
+
+void IndexBuffer::copyTo(IndexBuffer::IndexCont& outIndices) const{
+    if(mWidth == WIDTH_16) outIndices.assign(mData16.begin(), mData16.end());
+    else outIndices.assign(mData32.begin(), mData32.end());
+}
+
+bool IndexBuffer::setWidth(IndexBuffer::Width inWidth){
+    if(inWidth == mWidth) return true;
+
+    if(inWidth == WIDTH_32){
+        mData32.assign(mData16.begin(), mData16.end());
+        std::vector<boost::uint16_t>().swap(mData16);
+    }
+    else{
+        if(getMaxIndex() > MAX_INDEX_16) return false;
+        mData16.assign(mData32.begin(), mData32.end());
+        std::vector<boost::uint32_t>().swap(mData32);
+    }
+    mWidth = inWidth;
+    return true;
+}
+
+IndexBuffer::value_type IndexBuffer::getMaxIndex() const{
+    if(empty()) return 0;
+    return (mWidth == WIDTH_16)? *std::max_element(mData16.begin(), mData16.end()): *std::max_element(mData32.begin(), mData32.end());
+}
+
+void IndexBuffer::encode(std::vector<unsigned char>& outData) const{
+    const size_t num = size();
+    outData.reserve(outData.size() + num + 5);
+    writeVarint(static_cast<boost::uint32_t>(num), outData);
+
+    boost::uint32_t last = 0;
+    for(size_t i = 0; i < num; ++i){
+        const boost::uint32_t next = (*this)[i];
+        writeVarint(zigzag(static_cast<boost::int32_t>(next - last)), outData);
+        last = next;
+    }
+}
+
+size_t IndexBuffer::decode(const unsigned char* inData, size_t inSize){
+    const unsigned char* data = inData;
+    const unsigned char* end = inData + inSize;
+
+    const boost::uint32_t num = readVarint(data, end, "IndexBuffer");
+    //each index takes at least one byte
+    if(num > static_cast<size_t>(end - data)) throw std::runtime_error("IndexBuffer: unexpected end of encoded data");
+
+    IndexCont indices(num);
+    boost::uint32_t last = 0;
+    for(boost::uint32_t i = 0; i < num; ++i){
+        last += static_cast<boost::uint32_t>(unzigzag(readVarint(data, end, "IndexBuffer")));
+        indices[i] = last;
+    }
+    assign(indices);
+    return data - inData;
+}
+
+bool hydra::data::operator==(const IndexBuffer& lhv, const IndexBuffer& rhv){
+    if(lhv.size() != rhv.size()) return false;
+    return std::equal(lhv.begin(), lhv.end(), rhv.begin());
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -23,7 +23,8 @@ using hydra::data::Color;
 Material::Material(): mName("default"), mAmbient(1.0f, 1.0f, 1.0f),
         mDiffuse(1.0f, 1.0f, 1.0f), mSpecular(1.0f, 1.0f, 1.0f), 
         mEmissive(0.0f, 0.0f, 0.0f),
-        mTransparency(0.0f), mTexture(), mBump(), mRefl(){}
+        mTransparency(0.0f), mSpecularExponent(0.0f), mOpticalDensity(1.0f),
+        mTexture(), mBump(), mRefl(){}
 
 Material::Material(const std::string& inName, const Color& inAmbient, 
                             const Color& inSpecular, const Color& inDiffuse, 
@@ -32,11 +33,31 @@ Material::Material(const std::string& inName, const Color& inAmbient,
           //initializers
           mName(inName), mAmbient(inAmbient), mDiffuse(inDiffuse),
           mSpecular(inSpecular), mEmissive(inEmissive), 
-          mTransparency(inTransparency), mTexture(inTexture), 
+          mTransparency(inTransparency), mSpecularExponent(0.0f),
+          mOpticalDensity(1.0f), mTexture(inTexture), 
           mBump(), mRefl(){
 
 }
 
+static bool isEqualColor(const Color& lhv, const Color& rhv){
+    return lhv.r() == rhv.r() && lhv.g() == rhv.g() && lhv.b() == rhv.b() && lhv.a() == rhv.a();
+}
+
+bool hydra::data::operator==(const Material& lhv, const Material& rhv){
+    return lhv.mName == rhv.mName
+        && isEqualColor(lhv.mAmbient, rhv.mAmbient)
+        && isEqualColor(lhv.mDiffuse, rhv.mDiffuse)
+        && isEqualColor(lhv.mSpecular, rhv.mSpecular)
+        && isEqualColor(lhv.mEmissive, rhv.mEmissive)
+        && lhv.mTransparency == rhv.mTransparency
+        && lhv.mSpecularExponent == rhv.mSpecularExponent
+        && lhv.mOpticalDensity == rhv.mOpticalDensity
+        && isEqualColor(lhv.mTransmissionFilter, rhv.mTransmissionFilter)
+        && lhv.mTexture == rhv.mTexture
+        && lhv.mBump == rhv.mBump
+        && lhv.mRefl == rhv.mRefl;
+}
+
 /*
  *   Copyright 2010-2011 Alexander Medvedev
  *
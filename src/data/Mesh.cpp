@@ -15,107 +15,299 @@
 #include "data/Mesh.hpp"
 #include "data/Material.hpp"
 #include "data/Vertex.hpp"
+#include "data/VertexFormat.hpp"
+#include "data/NormalGenerator.hpp"
+#include "data/Skeleton.hpp"
 #include "common/SharedPtr.hpp"
 #include "math/Vector3D.hpp"
 #include "math/Point.hpp"
 #include "math/AABB.hpp"
+#include "math/BoundingSphere.hpp"
+#include "math/Quat.hpp"
 
 #include <vector>
-#include <map>
 #include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cassert>
 #include <boost/foreach.hpp>
+#include <boost/cstdint.hpp>
 
 using hydra::data::Mesh;
 using hydra::data::Vertex;
+using hydra::data::VertexFormat;
+using hydra::data::PackedVertices;
+using hydra::data::Skeleton;
 using hydra::math::Vector3D;
 using hydra::math::AABB;
 using hydra::math::Point;
+using hydra::math::BoundingSphere;
+using hydra::math::Quat;
+
+const Mesh::index_t Mesh::UNUSED_INDEX;
+
+Mesh::Mesh(): mMode(NONE), mBoundsValid(false){
+
+}
 
 void Mesh::addIndex(const Mesh::index_t inIndex){
     mIndices.push_back(inIndex);
+    mBoundsValid = false;
 }
 
 void Mesh::addVertex(const Vertex& inVertex){
     mVertices.push_back(inVertex);
+    mBoundsValid = false;
 }
 
-void Mesh::deleteRedundantVertices(){
-    //if empty do nothing
-    if(!(getVertexNum() && getIndexNum())) return;
+//helpers for vertex welding
+namespace{
 
-    typedef std::vector<Mesh::index_t*> IndicesList;
-    typedef std::map<Vertex, IndicesList> VertexMap;
-    VertexMap vertexMap;
+//mixes bits of 32-bit word into hash value
+inline boost::uint32_t hashCombine(boost::uint32_t inHash, boost::uint32_t inValue){
+    inValue *= 0xcc9e2d51u;
+    inValue = (inValue << 15) | (inValue >> 17);
+    inValue *= 0x1b873593u;
+    inHash ^= inValue;
+    inHash = (inHash << 13) | (inHash >> 19);
+    return inHash * 5u + 0xe6546b64u;
+}
 
-    //fill the map
-    //same vertices will be merged; unused will be droped
-    for(size_t i = 0; i < mIndices.size(); ++i){
-        vertexMap[mVertices[mIndices[i]]].push_back(&(mIndices[i]));
-    }
+//bits of float; -0.0 is treated as 0.0 to be consistent with comparison operators
+inline boost::uint32_t floatBits(float inValue){
+    inValue += 0.0f;
+    boost::uint32_t bits;
+    memcpy(&bits, &inValue, sizeof(bits));
+    return bits;
+}
+
+//number of floats which are compared by weld routine
+const size_t WELD_COMPONENTS = 9;
+
+inline void getComponents(const Vertex& inVertex, float* outComponents){
+    outComponents[0] = inVertex.mCoord.x;
+    outComponents[1] = inVertex.mCoord.y;
+    outComponents[2] = inVertex.mCoord.z;
+    outComponents[3] = inVertex.mTexCoord.x;
+    outComponents[4] = inVertex.mTexCoord.y;
+    outComponents[5] = inVertex.mTexCoord.z;
+    inVertex.mNormal.get(outComponents + 6);
+}
 
-    mVertices.clear();
-    mVertices.reserve(vertexMap.size());
+inline boost::uint32_t hashExact(const Vertex& inVertex){
+    float components[WELD_COMPONENTS];
+    getComponents(inVertex, components);
+    boost::uint32_t hash = 0x9747b28cu;
+    for(size_t i = 0; i < WELD_COMPONENTS; ++i) hash = hashCombine(hash, floatBits(components[i]));
+    return hash;
+}
+
+inline boost::uint32_t hashCell(const boost::int32_t* inCell){
+    boost::uint32_t hash = 0x9747b28cu;
+    for(size_t i = 0; i < 3; ++i) hash = hashCombine(hash, static_cast<boost::uint32_t>(inCell[i]));
+    return hash;
+}
 
-    typedef VertexMap::value_type vertexMapPair;
-    BOOST_FOREACH(const vertexMapPair& nextPair, vertexMap){
-        mVertices.push_back(nextPair.first);
-        BOOST_FOREACH(index_t* nextIndexPtr, nextPair.second)
-            *nextIndexPtr = mVertices.size() - 1;
+inline void getCell(const Vertex& inVertex, float inInvCellSize, boost::int32_t* outCell){
+    outCell[0] = static_cast<boost::int32_t>(floorf(inVertex.mCoord.x * inInvCellSize));
+    outCell[1] = static_cast<boost::int32_t>(floorf(inVertex.mCoord.y * inInvCellSize));
+    outCell[2] = static_cast<boost::int32_t>(floorf(inVertex.mCoord.z * inInvCellSize));
+}
+
+inline bool equalWithin(const Vertex& inVertex1, const Vertex& inVertex2, float inEpsilon){
+    float components1[WELD_COMPONENTS];
+    float components2[WELD_COMPONENTS];
+    getComponents(inVertex1, components1);
+    getComponents(inVertex2, components2);
+    for(size_t i = 0; i < WELD_COMPONENTS; ++i){
+        //for zero epsilon it is exact comparison
+        if(!(fabsf(components1[i] - components2[i]) <= inEpsilon)) return false;
     }
+    return true;
 }
 
-void Mesh::generateNormals(){
-    if(mMode != Mesh::TRIANGLE_STRIP && mMode != Mesh::TRIANGLE_LIST) return;
+//levels of detail use subsets of vertices used by mesh itself
+void remapLODs(Mesh::LODCont& inoutLODs, const Mesh::IndexCont& inRemap){
+    Mesh::IndexCont indices;
+    BOOST_FOREACH(Mesh::LOD& nextLOD, inoutLODs){
+        nextLOD.mIndices.copyTo(indices);
+        BOOST_FOREACH(Mesh::index_t& nextIndex, indices){
+            assert(inRemap[nextIndex] != Mesh::UNUSED_INDEX);
+            nextIndex = inRemap[nextIndex];
+        }
+        nextLOD.mIndices.assign(indices);
+    }
+}
 
-    //set all normals to zero
-    for(size_t i = 0; i < mVertices.size(); ++i)
-        mVertices[i].mNormal = Vector3D(0.0f, 0.0f, 0.0f);
+} //unnamed namespace
 
-    //build normals from triangles
-    size_t numTriangles;
-    if(mMode == Mesh::TRIANGLE_LIST) numTriangles = mIndices.size() / 3;
-    else if(mMode == Mesh::TRIANGLE_STRIP) numTriangles = mIndices.size() - 2;
-    else return;
+void Mesh::deleteRedundantVertices(){
+    weldVertices(0.0f);
+}
 
-    for(size_t i = 0; i < numTriangles; ++i){
+Mesh::IndexCont Mesh::weldVertices(float inEpsilon){
+    IndexCont remap(mVertices.size(), UNUSED_INDEX);
 
-        Vertex* vert1;
-        Vertex* vert2;
-        Vertex* vert3;
+    //if empty do nothing
+    if(!(getVertexNum() && getIndexNum())) return remap;
 
-        if(mMode == Mesh::TRIANGLE_LIST){
-            vert1 = &mVertices[mIndices[3*i]];
-            vert2 = &mVertices[mIndices[3*i + 1]];
-            vert3 = &mVertices[mIndices[3*i + 2]];
+    IndexCont indices;
+    mIndices.copyTo(indices);
+
+    const bool exact = !(inEpsilon > 0.0f);
+    const bool hasBones = (mBones.size() == mVertices.size() && mBoneWeights.size() == mVertices.size());
+    const float invCellSize = exact? 0.0f: 1.0f / inEpsilon;
+
+    //open-addressing hash table of new vertex indices (at most half-full)
+    size_t tableSize = 16;
+    while(tableSize < mVertices.size() * 2) tableSize <<= 1;
+    const size_t tableMask = tableSize - 1;
+    IndexCont table(tableSize, UNUSED_INDEX);
+
+    VertexCont newVertices;
+    newVertices.reserve(mVertices.size());
+    BoneCont newBones;
+    BoneWeightCont newWeights;
+
+    //cells of new vertices (used with positive tolerance only)
+    std::vector<boost::int32_t> cells;
+
+    for(size_t i = 0; i < indices.size(); ++i){
+        const index_t oldIndex = indices[i];
+        assert(oldIndex < mVertices.size());
+
+        if(remap[oldIndex] != UNUSED_INDEX){
+            indices[i] = remap[oldIndex];
+            continue;
         }
-        else if(mMode == Mesh::TRIANGLE_STRIP){
-            vert1 = &mVertices[mIndices[i + 0]];
-            vert2 = &mVertices[mIndices[i + 1]];
-            vert3 = &mVertices[mIndices[i + 2]];
-
-            //if the triangle num id even we should swap orientation
-            if(i % 2 != 0){
-                Vertex* temp = vert1;
-                vert1 = vert3;
-                vert3 = temp;
+
+        const Vertex& vertex = mVertices[oldIndex];
+        index_t found = UNUSED_INDEX;
+        size_t insertSlot = 0;
+
+        if(exact){
+            size_t slot = hashExact(vertex) & tableMask;
+            for(; table[slot] != UNUSED_INDEX; slot = (slot + 1) & tableMask){
+                const index_t candidate = table[slot];
+                if(equalWithin(newVertices[candidate], vertex, 0.0f) &&
+                   (!hasBones || (newBones[candidate] == mBones[oldIndex] && newWeights[candidate] == mBoneWeights[oldIndex]))){
+                    found = candidate;
+                    break;
+                }
+            }
+            insertSlot = slot;
+        }
+        else{
+            boost::int32_t cell[3];
+            getCell(vertex, invCellSize, cell);
+
+            //similar vertex may be in any of neighbouring cells
+            for(int dx = -1; dx <= 1 && found == UNUSED_INDEX; ++dx)
+            for(int dy = -1; dy <= 1 && found == UNUSED_INDEX; ++dy)
+            for(int dz = -1; dz <= 1 && found == UNUSED_INDEX; ++dz){
+                boost::int32_t neighbour[3] = {cell[0] + dx, cell[1] + dy, cell[2] + dz};
+                for(size_t slot = hashCell(neighbour) & tableMask; table[slot] != UNUSED_INDEX; slot = (slot + 1) & tableMask){
+                    const index_t candidate = table[slot];
+                    const boost::int32_t* candidateCell = &cells[3 * candidate];
+                    if(candidateCell[0] == neighbour[0] && candidateCell[1] == neighbour[1] && candidateCell[2] == neighbour[2] &&
+                       equalWithin(newVertices[candidate], vertex, inEpsilon) &&
+                       (!hasBones || (newBones[candidate] == mBones[oldIndex] && newWeights[candidate] == mBoneWeights[oldIndex]))){
+                        found = candidate;
+                        break;
+                    }
+                }
+            }
+
+            if(found == UNUSED_INDEX){
+                insertSlot = hashCell(cell) & tableMask;
+                while(table[insertSlot] != UNUSED_INDEX) insertSlot = (insertSlot + 1) & tableMask;
+                cells.insert(cells.end(), cell, cell + 3);
+            }
+        }
+
+        if(found == UNUSED_INDEX){
+            found = static_cast<index_t>(newVertices.size());
+            table[insertSlot] = found;
+            newVertices.push_back(vertex);
+            if(hasBones){
+                newBones.push_back(mBones[oldIndex]);
+                newWeights.push_back(mBoneWeights[oldIndex]);
+            }
+        }
+
+        remap[oldIndex] = found;
+        indices[i] = found;
+    }
+    mIndices.assign(indices);
+    remapLODs(mLODs, remap);
+
+    mVertices.swap(newVertices);
+    if(hasBones){
+        mBones.swap(newBones);
+        mBoneWeights.swap(newWeights);
+    }
+    invalidateBounds();
+    return remap;
+}
+
+Mesh::IndexCont Mesh::optimizeVertexFetch(){
+    IndexCont remap(mVertices.size(), UNUSED_INDEX);
+    if(!(getVertexNum() && getIndexNum())) return remap;
+
+    IndexCont indices;
+    mIndices.copyTo(indices);
+
+    const bool hasBones = (mBones.size() == mVertices.size() && mBoneWeights.size() == mVertices.size());
+    VertexCont newVertices;
+    newVertices.reserve(mVertices.size());
+    BoneCont newBones;
+    BoneWeightCont newWeights;
+
+    for(size_t i = 0; i < indices.size(); ++i){
+        const index_t oldIndex = indices[i];
+        assert(oldIndex < mVertices.size());
+
+        if(remap[oldIndex] == UNUSED_INDEX){
+            remap[oldIndex] = static_cast<index_t>(newVertices.size());
+            newVertices.push_back(mVertices[oldIndex]);
+            if(hasBones){
+                newBones.push_back(mBones[oldIndex]);
+                newWeights.push_back(mBoneWeights[oldIndex]);
             }
         }
-        else return;
+        indices[i] = remap[oldIndex];
+    }
+    mIndices.assign(indices);
+    remapLODs(mLODs, remap);
+
+    mVertices.swap(newVertices);
+    if(hasBones){
+        mBones.swap(newBones);
+        mBoneWeights.swap(newWeights);
+    }
+    return remap;
+}
+
+void Mesh::generateNormals(){
+    NormalGenerator generator;
+    generator.generate(*this);
+}
 
-        Vector3D vec1(vert2->mCoord.x - vert1->mCoord.x, vert2->mCoord.y - vert1->mCoord.y, vert2->mCoord.z - vert1->mCoord.z);
-        Vector3D vec2(vert3->mCoord.x - vert1->mCoord.x, vert3->mCoord.y - vert1->mCoord.y, vert3->mCoord.z - vert1->mCoord.z);
+size_t Mesh::selectLOD(float inDistance, float inProjectionScale, float inMaxPixelError) const{
+    if(inDistance <= 0.0f) return 0;
 
-        //find cross product
-        Vector3D contribution = vec1.cross(vec2);
-        
-        vert1->mNormal += contribution;
-        vert2->mNormal += contribution;
-        vert3->mNormal += contribution;
+    //errors grow with level, so the first level which is too coarse stops the search
+    size_t level = 0;
+    for(size_t i = 0; i < mLODs.size(); ++i){
+        if(mLODs[i].mError * inProjectionScale / inDistance > inMaxPixelError) break;
+        level = i + 1;
     }
+    return level;
+}
 
-    //normalization
-    for(size_t i = 0; i < mVertices.size(); ++i)
-        mVertices[i].mNormal.normalize();
+const hydra::data::IndexBuffer& Mesh::getLODIndices(size_t inLevel) const{
+    assert(inLevel <= mLODs.size());
+    return (inLevel == 0)? mIndices: mLODs[inLevel - 1].mIndices;
 }
 
 AABB Mesh::calcAABB() const{
@@ -149,6 +341,136 @@ AABB Mesh::calcAABB() const{
     return AABB(Vector3D(minX, minY, minZ), Vector3D(maxX - minX, maxY - minY, maxZ - minZ));
 }
 
+const AABB& Mesh::getAABB() const{
+    if(!mBoundsValid) updateBounds();
+    return mAABB;
+}
+
+const BoundingSphere& Mesh::getBoundingSphere() const{
+    if(!mBoundsValid) updateBounds();
+    return mBoundingSphere;
+}
+
+const Mesh::BoneBoundsCont& Mesh::getBoneBounds() const{
+    if(!mBoundsValid) updateBounds();
+    return mBoneBounds;
+}
+
+void Mesh::updateBounds() const{
+    mAABB = calcAABB();
+    mBoneBounds.clear();
+
+    //sphere is centered in box, radius is the distance to the farthest vertex
+    float squareRadius = 0.0f;
+    const Vector3D center = mAABB.getCenter();
+    if(getVertexNum()){
+        BOOST_FOREACH(Mesh::index_t index, mIndices){
+            squareRadius = std::max(squareRadius, (Vector3D(mVertices[index].mCoord) - center).getSquareMagnitude());
+        }
+    }
+    mBoundingSphere = BoundingSphere(center, sqrtf(squareRadius));
+
+    const bool hasBones = (mBones.size() == mVertices.size() && mBoneWeights.size() == mVertices.size());
+    if(hasBones && getIndexNum()){
+        //bounds of vertices which are used by indices, for each bone
+        std::vector<Vector3D> minCorners, maxCorners;
+        std::vector<bool> used(mVertices.size(), false);
+        BOOST_FOREACH(Mesh::index_t index, mIndices){
+            if(used[index]) continue;
+            used[index] = true;
+            const Vector3D coord(mVertices[index].mCoord);
+            for(int j = 0; j < MAX_BONES_PER_VERTEX; ++j){
+                if(!(mBoneWeights[index][j] > 0.0f)) continue;
+                const int bone = mBones[index][j];
+                assert(bone >= 0);
+                if(static_cast<size_t>(bone) >= minCorners.size()){
+                    minCorners.resize(bone + 1, Vector3D(1e30f, 1e30f, 1e30f));
+                    maxCorners.resize(bone + 1, Vector3D(-1e30f, -1e30f, -1e30f));
+                }
+                Vector3D& minCorner = minCorners[bone];
+                Vector3D& maxCorner = maxCorners[bone];
+                minCorner = Vector3D(std::min(minCorner.x(), coord.x()), std::min(minCorner.y(), coord.y()), std::min(minCorner.z(), coord.z()));
+                maxCorner = Vector3D(std::max(maxCorner.x(), coord.x()), std::max(maxCorner.y(), coord.y()), std::max(maxCorner.z(), coord.z()));
+            }
+        }
+        for(size_t bone = 0; bone < minCorners.size(); ++bone){
+            if(minCorners[bone].x() > maxCorners[bone].x()) continue;
+            BoneBounds bounds;
+            bounds.mBone = static_cast<int>(bone);
+            bounds.mAABB = AABB(minCorners[bone], maxCorners[bone] - minCorners[bone]);
+            mBoneBounds.push_back(bounds);
+        }
+    }
+    mBoundsValid = true;
+}
+
+void Mesh::invalidateBounds(){
+    mBoundsValid = false;
+}
+
+AABB Mesh::calcPoseAABB(const Skeleton& inPose) const{
+    const BoneBoundsCont& boneBounds = getBoneBounds();
+    if(boneBounds.empty()) return getAABB();
+
+    Vector3D minCorner(1e30f, 1e30f, 1e30f), maxCorner(-1e30f, -1e30f, -1e30f);
+    BOOST_FOREACH(const BoneBounds& nextBounds, boneBounds){
+        assert(static_cast<size_t>(nextBounds.mBone) < inPose.mBones.size());
+        const Quat& orient = inPose.mBones[nextBounds.mBone].mOrient;
+
+        //columns of rotation matrix
+        Vector3D axes[3] = {Vector3D(1.0f, 0.0f, 0.0f), Vector3D(0.0f, 1.0f, 0.0f), Vector3D(0.0f, 0.0f, 1.0f)};
+        for(int k = 0; k < 3; ++k) orient.rotate(axes[k]);
+
+        //rotated box is bounded by box with the same center and extents
+        //of absolute values of rotation matrix times half vector
+        const Vector3D half = nextBounds.mAABB.getVector() * 0.5f;
+        Vector3D center = nextBounds.mAABB.getCenter();
+        orient.rotate(center);
+        center += inPose.mBones[nextBounds.mBone].mPos;
+        const Vector3D extent(fabsf(axes[0].x()) * half.x() + fabsf(axes[1].x()) * half.y() + fabsf(axes[2].x()) * half.z(),
+                              fabsf(axes[0].y()) * half.x() + fabsf(axes[1].y()) * half.y() + fabsf(axes[2].y()) * half.z(),
+                              fabsf(axes[0].z()) * half.x() + fabsf(axes[1].z()) * half.y() + fabsf(axes[2].z()) * half.z());
+
+        minCorner = Vector3D(std::min(minCorner.x(), center.x() - extent.x()), std::min(minCorner.y(), center.y() - extent.y()),
+                             std::min(minCorner.z(), center.z() - extent.z()));
+        maxCorner = Vector3D(std::max(maxCorner.x(), center.x() + extent.x()), std::max(maxCorner.y(), center.y() + extent.y()),
+                             std::max(maxCorner.z(), center.z() + extent.z()));
+    }
+    return AABB(minCorner, maxCorner - minCorner);
+}
+
+void Mesh::packVertices(const VertexFormat& inFormat, PackedVertices& outPacked) const{
+    outPacked.mFormat = inFormat;
+    outPacked.mNum = mVertices.size();
+    outPacked.mData.resize(mVertices.size() * inFormat.getStride());
+    outPacked.mBounds = AABB();
+    if(mVertices.empty()) return;
+
+    //bounds of all the vertices (even unused ones)
+    Point minCoord = mVertices[0].mCoord;
+    Point maxCoord = mVertices[0].mCoord;
+    BOOST_FOREACH(const Vertex& nextVertex, mVertices){
+        minCoord.x = std::min(minCoord.x, nextVertex.mCoord.x);
+        minCoord.y = std::min(minCoord.y, nextVertex.mCoord.y);
+        minCoord.z = std::min(minCoord.z, nextVertex.mCoord.z);
+
+        maxCoord.x = std::max(maxCoord.x, nextVertex.mCoord.x);
+        maxCoord.y = std::max(maxCoord.y, nextVertex.mCoord.y);
+        maxCoord.z = std::max(maxCoord.z, nextVertex.mCoord.z);
+    }
+    outPacked.mBounds = AABB(Vector3D(minCoord), Vector3D(maxCoord) - Vector3D(minCoord));
+
+    inFormat.encode(&mVertices[0], mVertices.size(), outPacked.mBounds, &outPacked.mData[0]);
+}
+
+void Mesh::unpackVertices(const PackedVertices& inPacked){
+    invalidateBounds();
+    mVertices.resize(inPacked.mNum);
+    if(!inPacked.mNum) return;
+
+    inPacked.mFormat.decode(&inPacked.mData[0], inPacked.mNum, inPacked.mBounds, &mVertices[0]);
+}
+
 /*
  *   Copyright 2010-2011 Alexander Medvedev
  *
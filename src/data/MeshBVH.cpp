@@ -0,0 +1,718 @@
+//MeshBVH.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/MeshBVH.hpp"
+#include "data/Mesh.hpp"
+#include "data/Vertex.hpp"
+#include "math/Vector3D.hpp"
+#include "math/Point.hpp"
+#include "math/AABB.hpp"
+#include "common/ParallelFor.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define MESH_BVH_USE_SSE
+#endif
+
+using hydra::data::MeshBVH;
+using hydra::data::Mesh;
+using hydra::data::Vertex;
+using hydra::math::Vector3D;
+using hydra::math::Point;
+using hydra::math::AABB;
+
+namespace{
+
+//number of bins of surface area heuristic
+const unsigned int BIN_NUM = 16;
+
+//costs of surface area heuristic
+const float TRAVERSAL_COST = 1.0f;
+const float INTERSECTION_COST = 1.0f;
+
+//nodes with more triangles are always split
+const size_t MAX_LEAF_TRIANGLES = 16;
+
+//below this depth nodes are split by surface area heuristic, deeper ones
+//are split in halves, so depth is limited by MAX_SAH_DEPTH + 32
+const unsigned int MAX_SAH_DEPTH = 32;
+
+//size of traversal stack (not less than maximal depth)
+const size_t STACK_SIZE = 64;
+
+//subtrees with more triangles are built in separate threads
+const size_t MIN_PARALLEL_BUILD = 16384;
+
+//minimal number of triangles handled by one thread while preparing
+const size_t MIN_PARALLEL_RANGE = 4096;
+
+//determinants of smaller absolute value mean ray is parallel to triangle
+const float DETERMINANT_EPSILON = 1e-20f;
+
+//replacement of infinite reciprocal of zero direction component
+const float HUGE_RECIPROCAL = 1e30f;
+
+struct Bounds{
+    float min[3];
+    float max[3];
+
+    void reset(){
+        for(int k = 0; k < 3; ++k){
+            min[k] = 1e30f;
+            max[k] = -1e30f;
+        }
+    }
+
+    void add(const float* inPoint){
+        for(int k = 0; k < 3; ++k){
+            min[k] = std::min(min[k], inPoint[k]);
+            max[k] = std::max(max[k], inPoint[k]);
+        }
+    }
+
+    void add(const Bounds& inBounds){
+        for(int k = 0; k < 3; ++k){
+            min[k] = std::min(min[k], inBounds.min[k]);
+            max[k] = std::max(max[k], inBounds.max[k]);
+        }
+    }
+
+    //half of surface area
+    float getArea() const{
+        float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+        if(dx < 0.0f) return 0.0f;
+        return dx * dy + dy * dz + dz * dx;
+    }
+};
+
+//triangle while building
+struct TriangleRef{
+    Bounds bounds;
+    float centroid[3];
+    //position of triangle in list of collected triangles
+    boost::uint32_t id;
+};
+
+//computes bounds of collected triangles
+struct PrepareTask{
+    const MeshBVH::Triangle* triangles;
+    TriangleRef* refs;
+
+    void operator()(size_t inBegin, size_t inEnd) const{
+        for(size_t i = inBegin; i < inEnd; ++i){
+            const MeshBVH::Triangle& tri = triangles[i];
+            TriangleRef& ref = refs[i];
+            float v1[3], v2[3];
+            for(int k = 0; k < 3; ++k){
+                v1[k] = tri.v0[k] + tri.e1[k];
+                v2[k] = tri.v0[k] + tri.e2[k];
+            }
+            ref.bounds.reset();
+            ref.bounds.add(tri.v0);
+            ref.bounds.add(v1);
+            ref.bounds.add(v2);
+            for(int k = 0; k < 3; ++k) ref.centroid[k] = 0.5f * (ref.bounds.min[k] + ref.bounds.max[k]);
+            ref.id = static_cast<boost::uint32_t>(i);
+        }
+    }
+};
+
+//checks if centroid is on the left side of split
+struct IsLeftOfSplit{
+    int axis;
+    float minCentroid;
+    float binScale;
+    unsigned int split;
+
+    bool operator()(const TriangleRef& inRef) const{
+        unsigned int bin = static_cast<unsigned int>((inRef.centroid[axis] - minCentroid) * binScale);
+        return std::min(bin, BIN_NUM - 1) < split;
+    }
+};
+
+//builds subtrees (recursively, several threads for big subtrees)
+class Builder{
+public:
+    Builder(std::vector<TriangleRef>& inoutRefs, size_t inMaxLeafTriangles, unsigned int inParallelDepth):
+        mRefs(inoutRefs), mMaxLeafTriangles(std::max<size_t>(1, std::min(inMaxLeafTriangles, MAX_LEAF_TRIANGLES))),
+        mParallelDepth(inParallelDepth){
+
+    }
+
+    //appends nodes of subtree; returns depth of subtree
+    unsigned int build(size_t inBegin, size_t inEnd, MeshBVH::NodeCont& outNodes, unsigned int inDepth) const{
+        Bounds bounds, centroidBounds;
+        bounds.reset();
+        centroidBounds.reset();
+        for(size_t i = inBegin; i < inEnd; ++i){
+            bounds.add(mRefs[i].bounds);
+            centroidBounds.add(mRefs[i].centroid);
+        }
+
+        const size_t nodePos = outNodes.size();
+        MeshBVH::Node node;
+        for(int k = 0; k < 3; ++k){
+            node.min[k] = bounds.min[k];
+            node.max[k] = bounds.max[k];
+        }
+        node.offset = static_cast<boost::uint32_t>(inBegin);
+        node.triangleNum = static_cast<boost::uint16_t>(inEnd - inBegin);
+        node.axis = 0;
+        outNodes.push_back(node);
+
+        const size_t mid = split(inBegin, inEnd, bounds, centroidBounds, inDepth, node.axis);
+        if(mid == inBegin || mid == inEnd) return 1;
+
+        outNodes[nodePos].triangleNum = 0;
+        outNodes[nodePos].axis = node.axis;
+        unsigned int depth = 0;
+        if(inDepth < mParallelDepth && inEnd - inBegin >= MIN_PARALLEL_BUILD){
+            MeshBVH::NodeCont left, right;
+            unsigned int leftDepth = 0;
+            boost::thread thread(boost::bind(&Builder::buildTask, this, inBegin, mid, boost::ref(left), inDepth + 1, &leftDepth));
+            depth = build(mid, inEnd, right, inDepth + 1);
+            thread.join();
+            depth = std::max(depth, leftDepth);
+
+            outNodes[nodePos].offset = static_cast<boost::uint32_t>(left.size() + 1);
+            outNodes.insert(outNodes.end(), left.begin(), left.end());
+            outNodes.insert(outNodes.end(), right.begin(), right.end());
+        }
+        else{
+            depth = build(inBegin, mid, outNodes, inDepth + 1);
+            outNodes[nodePos].offset = static_cast<boost::uint32_t>(outNodes.size() - nodePos);
+            depth = std::max(depth, build(mid, inEnd, outNodes, inDepth + 1));
+        }
+        return depth + 1;
+    }
+
+private:
+    void buildTask(size_t inBegin, size_t inEnd, MeshBVH::NodeCont& outNodes, unsigned int inDepth, unsigned int* outDepth) const{
+        *outDepth = build(inBegin, inEnd, outNodes, inDepth);
+    }
+
+    //partitions triangles; returns inBegin (or inEnd) if node should be a leaf
+    size_t split(size_t inBegin, size_t inEnd, const Bounds& inBounds, const Bounds& inCentroidBounds,
+                 unsigned int inDepth, boost::uint16_t& outAxis) const{
+        const size_t count = inEnd - inBegin;
+        if(count <= mMaxLeafTriangles) return inBegin;
+
+        //the longest axis of centroid bounds
+        int longest = 0;
+        for(int k = 1; k < 3; ++k){
+            if(inCentroidBounds.max[k] - inCentroidBounds.min[k] > inCentroidBounds.max[longest] - inCentroidBounds.min[longest]) longest = k;
+        }
+
+        if(inDepth < MAX_SAH_DEPTH){
+            float bestCost = 1e30f;
+            int bestAxis = -1;
+            unsigned int bestSplit = 0;
+            for(int axis = 0; axis < 3; ++axis){
+                const float extent = inCentroidBounds.max[axis] - inCentroidBounds.min[axis];
+                if(!(extent > 0.0f)) continue;
+                const float binScale = BIN_NUM / extent;
+
+                Bounds bins[BIN_NUM];
+                size_t counts[BIN_NUM];
+                for(unsigned int b = 0; b < BIN_NUM; ++b){
+                    bins[b].reset();
+                    counts[b] = 0;
+                }
+                for(size_t i = inBegin; i < inEnd; ++i){
+                    unsigned int bin = static_cast<unsigned int>((mRefs[i].centroid[axis] - inCentroidBounds.min[axis]) * binScale);
+                    bin = std::min(bin, BIN_NUM - 1);
+                    bins[bin].add(mRefs[i].bounds);
+                    ++counts[bin];
+                }
+
+                //areas and counts of right sides
+                float rightArea[BIN_NUM];
+                size_t rightCount[BIN_NUM];
+                Bounds right;
+                right.reset();
+                size_t rightNum = 0;
+                for(unsigned int b = BIN_NUM - 1; b > 0; --b){
+                    right.add(bins[b]);
+                    rightNum += counts[b];
+                    rightArea[b] = right.getArea();
+                    rightCount[b] = rightNum;
+                }
+
+                Bounds left;
+                left.reset();
+                size_t leftNum = 0;
+                for(unsigned int b = 1; b < BIN_NUM; ++b){
+                    left.add(bins[b - 1]);
+                    leftNum += counts[b - 1];
+                    if(leftNum == 0 || rightCount[b] == 0) continue;
+                    float cost = left.getArea() * leftNum + rightArea[b] * rightCount[b];
+                    if(cost < bestCost){
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b;
+                    }
+                }
+            }
+
+            if(bestAxis >= 0){
+                const float area = inBounds.getArea();
+                const float splitCost = TRAVERSAL_COST + INTERSECTION_COST * ((area > 0.0f)? bestCost / area: count);
+                if(splitCost >= INTERSECTION_COST * count && count <= MAX_LEAF_TRIANGLES) return inBegin;
+
+                IsLeftOfSplit isLeft;
+                isLeft.axis = bestAxis;
+                isLeft.minCentroid = inCentroidBounds.min[bestAxis];
+                isLeft.binScale = BIN_NUM / (inCentroidBounds.max[bestAxis] - inCentroidBounds.min[bestAxis]);
+                isLeft.split = bestSplit;
+                outAxis = static_cast<boost::uint16_t>(bestAxis);
+                return std::partition(mRefs.begin() + inBegin, mRefs.begin() + inEnd, isLeft) - mRefs.begin();
+            }
+        }
+
+        //centroids coincide or tree is too deep: split in halves
+        if(count <= MAX_LEAF_TRIANGLES && inDepth < MAX_SAH_DEPTH) return inBegin;
+        const size_t mid = inBegin + count / 2;
+        CompareCentroids compare;
+        compare.axis = longest;
+        std::nth_element(mRefs.begin() + inBegin, mRefs.begin() + mid, mRefs.begin() + inEnd, compare);
+        outAxis = static_cast<boost::uint16_t>(longest);
+        return mid;
+    }
+
+    struct CompareCentroids{
+        int axis;
+
+        bool operator()(const TriangleRef& lhv, const TriangleRef& rhv) const{
+            if(lhv.centroid[axis] != rhv.centroid[axis]) return lhv.centroid[axis] < rhv.centroid[axis];
+            return lhv.id < rhv.id;
+        }
+    };
+
+    std::vector<TriangleRef>& mRefs;
+    size_t mMaxLeafTriangles;
+    unsigned int mParallelDepth;
+};
+
+//ray with precomputed reciprocals of direction
+struct Ray{
+    Ray(const Vector3D& inOrigin, const Vector3D& inDirection){
+        inOrigin.get(origin);
+        inDirection.get(direction);
+        for(int k = 0; k < 3; ++k){
+            inverse[k] = (fabsf(direction[k]) > 1.0f / HUGE_RECIPROCAL)? 1.0f / direction[k]:
+                ((direction[k] < 0.0f)? -HUGE_RECIPROCAL: HUGE_RECIPROCAL);
+            negative[k] = (direction[k] < 0.0f);
+        }
+    }
+
+    float origin[3];
+    float direction[3];
+    float inverse[3];
+    bool negative[3];
+};
+
+inline bool intersectNode(const MeshBVH::Node& inNode, const Ray& inRay, float inMaxDistance){
+    float tNear = 0.0f;
+    float tFar = inMaxDistance;
+    for(int k = 0; k < 3; ++k){
+        float t0 = (inNode.min[k] - inRay.origin[k]) * inRay.inverse[k];
+        float t1 = (inNode.max[k] - inRay.origin[k]) * inRay.inverse[k];
+        if(t0 > t1) std::swap(t0, t1);
+        tNear = std::max(tNear, t0);
+        tFar = std::min(tFar, t1);
+    }
+    return tNear <= tFar;
+}
+
+//Moller-Trumbore test; updates hit if triangle is closer than inoutHit.distance
+inline bool intersectTriangle(const MeshBVH::Triangle& inTri, const Ray& inRay, MeshBVH::Hit& inoutHit){
+    const float* d = inRay.direction;
+    const float* e1 = inTri.e1;
+    const float* e2 = inTri.e2;
+    float p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+    float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if(fabsf(det) < DETERMINANT_EPSILON) return false;
+    float invDet = 1.0f / det;
+
+    float s[3] = {inRay.origin[0] - inTri.v0[0], inRay.origin[1] - inTri.v0[1], inRay.origin[2] - inTri.v0[2]};
+    float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+    if(u < 0.0f || u > 1.0f) return false;
+
+    float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+    float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * invDet;
+    if(v < 0.0f || u + v > 1.0f) return false;
+
+    float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+    if(!(t > 0.0f && t < inoutHit.distance)) return false;
+
+    inoutHit.triangle = inTri.index;
+    inoutHit.distance = t;
+    inoutHit.u = u;
+    inoutHit.v = v;
+    return true;
+}
+
+//traverses tree with single ray; stops at the first hit if inAnyHit
+bool traverse(const MeshBVH::NodeCont& inNodes, const MeshBVH::TriangleCont& inTriangles,
+              const Ray& inRay, bool inAnyHit, MeshBVH::Hit& inoutHit){
+    if(inNodes.empty()) return false;
+
+    bool found = false;
+    size_t stack[STACK_SIZE];
+    size_t top = 0;
+    size_t current = 0;
+    while(true){
+        const MeshBVH::Node& node = inNodes[current];
+        if(intersectNode(node, inRay, inoutHit.distance)){
+            if(node.triangleNum == 0){
+                size_t near = current + 1;
+                size_t far = current + node.offset;
+                if(inRay.negative[node.axis]) std::swap(near, far);
+                assert(top < STACK_SIZE);
+                stack[top++] = far;
+                current = near;
+                continue;
+            }
+            for(size_t i = node.offset; i < node.offset + node.triangleNum; ++i){
+                if(intersectTriangle(inTriangles[i], inRay, inoutHit)){
+                    found = true;
+                    if(inAnyHit) return true;
+                }
+            }
+        }
+        if(top == 0) break;
+        current = stack[--top];
+    }
+    return found;
+}
+
+#ifdef MESH_BVH_USE_SSE
+
+inline __m128 select(__m128 inMask, __m128 inTrue, __m128 inFalse){
+    return _mm_or_ps(_mm_and_ps(inMask, inTrue), _mm_andnot_ps(inMask, inFalse));
+}
+
+//traces 4 rays at once
+void tracePacket(const MeshBVH::NodeCont& inNodes, const MeshBVH::TriangleCont& inTriangles,
+                 const Ray* inRays, float inMaxDistance, MeshBVH::Hit* outHits){
+    float buffer[3][4];
+    __m128 origin[3], direction[3], inverse[3];
+    for(int k = 0; k < 3; ++k){
+        for(int r = 0; r < 4; ++r) buffer[0][r] = inRays[r].origin[k];
+        for(int r = 0; r < 4; ++r) buffer[1][r] = inRays[r].direction[k];
+        for(int r = 0; r < 4; ++r) buffer[2][r] = inRays[r].inverse[k];
+        origin[k] = _mm_loadu_ps(buffer[0]);
+        direction[k] = _mm_loadu_ps(buffer[1]);
+        inverse[k] = _mm_loadu_ps(buffer[2]);
+    }
+
+    __m128 distance = _mm_set1_ps(inMaxDistance);
+    __m128 hitU = _mm_setzero_ps();
+    __m128 hitV = _mm_setzero_ps();
+    size_t hitTriangles[4] = {MeshBVH::NO_HIT, MeshBVH::NO_HIT, MeshBVH::NO_HIT, MeshBVH::NO_HIT};
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 epsilon = _mm_set1_ps(DETERMINANT_EPSILON);
+
+    size_t stack[STACK_SIZE];
+    size_t top = 0;
+    size_t current = 0;
+    while(true){
+        const MeshBVH::Node& node = inNodes[current];
+
+        __m128 tNear = zero;
+        __m128 tFar = distance;
+        for(int k = 0; k < 3; ++k){
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min[k]), origin[k]), inverse[k]);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max[k]), origin[k]), inverse[k]);
+            tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+            tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+        }
+
+        if(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar))){
+            if(node.triangleNum == 0){
+                size_t near = current + 1;
+                size_t far = current + node.offset;
+                if(inRays[0].negative[node.axis]) std::swap(near, far);
+                assert(top < STACK_SIZE);
+                stack[top++] = far;
+                current = near;
+                continue;
+            }
+
+            for(size_t i = node.offset; i < node.offset + node.triangleNum; ++i){
+                const MeshBVH::Triangle& tri = inTriangles[i];
+                const __m128 e1x = _mm_set1_ps(tri.e1[0]), e1y = _mm_set1_ps(tri.e1[1]), e1z = _mm_set1_ps(tri.e1[2]);
+                const __m128 e2x = _mm_set1_ps(tri.e2[0]), e2y = _mm_set1_ps(tri.e2[1]), e2z = _mm_set1_ps(tri.e2[2]);
+
+                __m128 px = _mm_sub_ps(_mm_mul_ps(direction[1], e2z), _mm_mul_ps(direction[2], e2y));
+                __m128 py = _mm_sub_ps(_mm_mul_ps(direction[2], e2x), _mm_mul_ps(direction[0], e2z));
+                __m128 pz = _mm_sub_ps(_mm_mul_ps(direction[0], e2y), _mm_mul_ps(direction[1], e2x));
+                __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+                __m128 mask = _mm_cmpge_ps(_mm_max_ps(det, _mm_sub_ps(zero, det)), epsilon);
+                __m128 invDet = _mm_div_ps(one, det);
+
+                __m128 sx = _mm_sub_ps(origin[0], _mm_set1_ps(tri.v0[0]));
+                __m128 sy = _mm_sub_ps(origin[1], _mm_set1_ps(tri.v0[1]));
+                __m128 sz = _mm_sub_ps(origin[2], _mm_set1_ps(tri.v0[2]));
+                __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+                __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+                __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+                __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+                __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction[0], qx), _mm_mul_ps(direction[1], qy)),
+                                                 _mm_mul_ps(direction[2], qz)), invDet);
+                __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+                mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+                mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+                mask = _mm_and_ps(mask, _mm_cmplt_ps(t, distance));
+
+                const int hits = _mm_movemask_ps(mask);
+                if(hits){
+                    distance = select(mask, t, distance);
+                    hitU = select(mask, u, hitU);
+                    hitV = select(mask, v, hitV);
+                    for(int r = 0; r < 4; ++r){
+                        if(hits & (1 << r)) hitTriangles[r] = tri.index;
+                    }
+                }
+            }
+        }
+        if(top == 0) break;
+        current = stack[--top];
+    }
+
+    float distances[4], us[4], vs[4];
+    _mm_storeu_ps(distances, distance);
+    _mm_storeu_ps(us, hitU);
+    _mm_storeu_ps(vs, hitV);
+    for(int r = 0; r < 4; ++r){
+        outHits[r].triangle = hitTriangles[r];
+        outHits[r].distance = (hitTriangles[r] != MeshBVH::NO_HIT)? distances[r]: inMaxDistance;
+        outHits[r].u = us[r];
+        outHits[r].v = vs[r];
+    }
+}
+
+#endif
+
+//projects triangle (relative to box center) onto axis and compares with box
+inline bool isSeparatingAxis(const float* inAxis, const float inVertices[3][3], const float* inHalfSize){
+    float p0 = inAxis[0] * inVertices[0][0] + inAxis[1] * inVertices[0][1] + inAxis[2] * inVertices[0][2];
+    float p1 = inAxis[0] * inVertices[1][0] + inAxis[1] * inVertices[1][1] + inAxis[2] * inVertices[1][2];
+    float p2 = inAxis[0] * inVertices[2][0] + inAxis[1] * inVertices[2][1] + inAxis[2] * inVertices[2][2];
+    float radius = inHalfSize[0] * fabsf(inAxis[0]) + inHalfSize[1] * fabsf(inAxis[1]) + inHalfSize[2] * fabsf(inAxis[2]);
+    return std::min(p0, std::min(p1, p2)) > radius || std::max(p0, std::max(p1, p2)) < -radius;
+}
+
+//separating axis test of triangle and box (Akenine-Moller)
+bool intersectTriangleBox(const MeshBVH::Triangle& inTri, const float* inCenter, const float* inHalfSize){
+    float vertices[3][3];
+    for(int k = 0; k < 3; ++k){
+        vertices[0][k] = inTri.v0[k] - inCenter[k];
+        vertices[1][k] = vertices[0][k] + inTri.e1[k];
+        vertices[2][k] = vertices[0][k] + inTri.e2[k];
+    }
+
+    //axes of box
+    for(int k = 0; k < 3; ++k){
+        float minValue = std::min(vertices[0][k], std::min(vertices[1][k], vertices[2][k]));
+        float maxValue = std::max(vertices[0][k], std::max(vertices[1][k], vertices[2][k]));
+        if(minValue > inHalfSize[k] || maxValue < -inHalfSize[k]) return false;
+    }
+
+    //normal of triangle
+    const float* e1 = inTri.e1;
+    const float* e2 = inTri.e2;
+    float normal[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+    if(isSeparatingAxis(normal, vertices, inHalfSize)) return false;
+
+    //cross products of box axes and triangle edges
+    for(int e = 0; e < 3; ++e){
+        const float* from = vertices[e];
+        const float* to = vertices[(e + 1) % 3];
+        float edge[3] = {to[0] - from[0], to[1] - from[1], to[2] - from[2]};
+        float axes[3][3] = {{0.0f, -edge[2], edge[1]}, {edge[2], 0.0f, -edge[0]}, {-edge[1], edge[0], 0.0f}};
+        for(int k = 0; k < 3; ++k){
+            if(isSeparatingAxis(axes[k], vertices, inHalfSize)) return false;
+        }
+    }
+    return true;
+}
+
+} //unnamed namespace
+
+MeshBVH::MeshBVH(const MeshBVH::Properties& inProps): mProps(inProps), mDepth(0){
+
+}
+
+void MeshBVH::build(const Mesh& inMesh){
+    clear();
+    if(inMesh.mMode != Mesh::TRIANGLES && inMesh.mMode != Mesh::TRIANGLE_STRIP) return;
+
+    //collect non-degenerate triangles
+    const IndexBuffer& indices = inMesh.mIndices;
+    const size_t step = (inMesh.mMode == Mesh::TRIANGLES)? 3: 1;
+    TriangleCont triangles;
+    triangles.reserve(indices.size() / step);
+    for(size_t i = 0; i + 2 < indices.size(); i += step){
+        const Mesh::index_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if(a == b || b == c || a == c) continue;
+        if(a >= inMesh.getVertexNum() || b >= inMesh.getVertexNum() || c >= inMesh.getVertexNum()) continue;
+
+        const Point& p0 = inMesh.mVertices[a].mCoord;
+        const Point& p1 = inMesh.mVertices[b].mCoord;
+        const Point& p2 = inMesh.mVertices[c].mCoord;
+        Triangle tri;
+        tri.v0[0] = p0.x; tri.v0[1] = p0.y; tri.v0[2] = p0.z;
+        tri.e1[0] = p1.x - p0.x; tri.e1[1] = p1.y - p0.y; tri.e1[2] = p1.z - p0.z;
+        tri.e2[0] = p2.x - p0.x; tri.e2[1] = p2.y - p0.y; tri.e2[2] = p2.z - p0.z;
+        tri.index = static_cast<boost::uint32_t>(i);
+        triangles.push_back(tri);
+    }
+    if(triangles.empty()) return;
+
+    const unsigned int threadNum = (mProps.threadNum > 0)? mProps.threadNum: hydra::common::getHardwareThreadNum();
+    std::vector<TriangleRef> refs(triangles.size());
+    PrepareTask prepare;
+    prepare.triangles = &triangles[0];
+    prepare.refs = &refs[0];
+    hydra::common::parallelFor(0, triangles.size(), prepare, threadNum, MIN_PARALLEL_RANGE);
+
+    //each level of parallel building doubles number of threads
+    unsigned int parallelDepth = 0;
+    while((1u << parallelDepth) < threadNum) ++parallelDepth;
+
+    Builder builder(refs, mProps.maxLeafTriangles, parallelDepth);
+    mNodes.reserve(2 * triangles.size() / std::max(1u, mProps.maxLeafTriangles) + 1);
+    mDepth = builder.build(0, refs.size(), mNodes, 0);
+    assert(mDepth <= STACK_SIZE);
+
+    //place triangles in order of leaves
+    mTriangles.resize(triangles.size());
+    for(size_t i = 0; i < refs.size(); ++i) mTriangles[i] = triangles[refs[i].id];
+}
+
+void MeshBVH::clear(){
+    mNodes.clear();
+    mTriangles.clear();
+    mDepth = 0;
+}
+
+bool MeshBVH::intersectRay(const Vector3D& inOrigin, const Vector3D& inDirection, MeshBVH::Hit& outHit, float inMaxDistance) const{
+    outHit.triangle = NO_HIT;
+    outHit.distance = inMaxDistance;
+    outHit.u = outHit.v = 0.0f;
+    return traverse(mNodes, mTriangles, Ray(inOrigin, inDirection), false, outHit);
+}
+
+bool MeshBVH::intersectSegment(const Vector3D& inStart, const Vector3D& inEnd, MeshBVH::Hit& outHit) const{
+    return intersectRay(inStart, inEnd - inStart, outHit, 1.0f);
+}
+
+bool MeshBVH::testSegment(const Vector3D& inStart, const Vector3D& inEnd) const{
+    Hit hit;
+    hit.triangle = NO_HIT;
+    hit.distance = 1.0f;
+    return traverse(mNodes, mTriangles, Ray(inStart, inEnd - inStart), true, hit);
+}
+
+void MeshBVH::intersectRays(const Vector3D* inOrigins, const Vector3D* inDirections, size_t inNum,
+                            MeshBVH::Hit* outHits, float inMaxDistance) const{
+    size_t i = 0;
+#ifdef MESH_BVH_USE_SSE
+    if(!mNodes.empty()){
+        for(; i + 4 <= inNum; i += 4){
+            Ray rays[4] = {Ray(inOrigins[i], inDirections[i]), Ray(inOrigins[i + 1], inDirections[i + 1]),
+                           Ray(inOrigins[i + 2], inDirections[i + 2]), Ray(inOrigins[i + 3], inDirections[i + 3])};
+            tracePacket(mNodes, mTriangles, rays, inMaxDistance, outHits + i);
+        }
+    }
+#endif
+    for(; i < inNum; ++i) intersectRay(inOrigins[i], inDirections[i], outHits[i], inMaxDistance);
+}
+
+size_t MeshBVH::queryAABB(const AABB& inBox, MeshBVH::TriangleIdCont& outTriangles) const{
+    if(mNodes.empty()) return 0;
+
+    float boxMin[3], boxMax[3], center[3], halfSize[3];
+    inBox.getCorner().get(boxMin);
+    (inBox.getCorner() + inBox.getVector()).get(boxMax);
+    for(int k = 0; k < 3; ++k){
+        center[k] = 0.5f * (boxMin[k] + boxMax[k]);
+        halfSize[k] = 0.5f * (boxMax[k] - boxMin[k]);
+    }
+
+    const size_t oldSize = outTriangles.size();
+    size_t stack[STACK_SIZE];
+    size_t top = 0;
+    size_t current = 0;
+    while(true){
+        const Node& node = mNodes[current];
+        bool overlaps = true;
+        for(int k = 0; k < 3; ++k){
+            if(node.min[k] > boxMax[k] || node.max[k] < boxMin[k]) overlaps = false;
+        }
+        if(overlaps){
+            if(node.triangleNum == 0){
+                stack[top++] = current + node.offset;
+                current = current + 1;
+                continue;
+            }
+            for(size_t i = node.offset; i < node.offset + node.triangleNum; ++i){
+                if(intersectTriangleBox(mTriangles[i], center, halfSize)) outTriangles.push_back(mTriangles[i].index);
+            }
+        }
+        if(top == 0) break;
+        current = stack[--top];
+    }
+    return outTriangles.size() - oldSize;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
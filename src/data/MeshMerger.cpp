@@ -0,0 +1,359 @@
+//MeshMerger.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/MeshMerger.hpp"
+#include "data/Model.hpp"
+#include "data/Mesh.hpp"
+#include "data/Material.hpp"
+#include "data/Vertex.hpp"
+#include "math/Matrix.hpp"
+#include "math/Vector3D.hpp"
+#include "math/Point.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <boost/foreach.hpp>
+
+using hydra::data::MeshMerger;
+using hydra::data::Model;
+using hydra::data::ModelPtr;
+using hydra::data::Mesh;
+using hydra::data::MeshPtr;
+using hydra::data::MaterialPtr;
+using hydra::data::Vertex;
+using hydra::math::Matrix;
+using hydra::math::Vector3D;
+using hydra::math::Point;
+
+namespace{
+
+//model to world transformation of vertices
+class Transform{
+public:
+    explicit Transform(const Matrix& inMatrix): mMatrix(inMatrix), mNormalMatrix(inMatrix){
+        const float* m = inMatrix.get();
+        float det = m[0] * (m[5] * m[10] - m[6] * m[9])
+                  - m[1] * (m[4] * m[10] - m[6] * m[8])
+                  + m[2] * (m[4] * m[9] - m[5] * m[8]);
+        mIsMirroring = (det < 0.0f);
+        mNormalMatrix.invert();
+    }
+
+    Point transformPoint(const Point& inPoint) const{
+        Vector3D result = Vector3D(inPoint) * mMatrix;
+        return Point(result.x(), result.y(), result.z());
+    }
+
+    //multiplies normal by inverse transposed matrix
+    Vector3D transformNormal(const Vector3D& inNormal) const{
+        const float* m = mNormalMatrix.get();
+        Vector3D result(m[0] * inNormal.x() + m[4] * inNormal.y() + m[8] * inNormal.z(),
+                        m[1] * inNormal.x() + m[5] * inNormal.y() + m[9] * inNormal.z(),
+                        m[2] * inNormal.x() + m[6] * inNormal.y() + m[10] * inNormal.z());
+        if(result.getSquareMagnitude() > 0.0f) result.normalize();
+        return result;
+    }
+
+    //transformation changes winding of triangles
+    bool isMirroring() const{
+        return mIsMirroring;
+    }
+
+private:
+    Matrix mMatrix;
+    Matrix mNormalMatrix;
+    bool mIsMirroring;
+};
+
+//mesh to merge
+struct Source{
+    MeshPtr mesh;
+    //0 if mesh is not transformed
+    const Transform* transform;
+};
+
+//meshes which are merged together
+struct Batch{
+    std::vector<size_t> members;
+    size_t vertexNum;
+    //position of merged mesh in result
+    size_t position;
+};
+
+bool hasBoneData(const Mesh& inMesh){
+    return !inMesh.mVertices.empty()
+        && inMesh.mBones.size() == inMesh.mVertices.size()
+        && inMesh.mBoneWeights.size() == inMesh.mVertices.size();
+}
+
+bool isMergeable(const Mesh& inMesh){
+    return inMesh.mMode == Mesh::TRIANGLES || inMesh.mMode == Mesh::TRIANGLE_STRIP;
+}
+
+bool isSameMaterial(const MaterialPtr& lhv, const MaterialPtr& rhv){
+    if(lhv == rhv) return true;
+    if(!lhv || !rhv) return false;
+    return *lhv == *rhv;
+}
+
+bool canMerge(const Mesh& lhv, const Mesh& rhv, bool inKeepBones){
+    if(lhv.mMode != rhv.mMode) return false;
+    if(inKeepBones && hasBoneData(lhv) != hasBoneData(rhv)) return false;
+    return isSameMaterial(lhv.mMaterial, rhv.mMaterial);
+}
+
+//appends (transformed) vertices of source
+void appendVertices(Mesh& outMesh, const Mesh& inMesh, const Transform* inTransform, bool inKeepBones){
+    if(inTransform){
+        BOOST_FOREACH(const Vertex& nextVertex, inMesh.mVertices){
+            Vertex vertex = nextVertex;
+            vertex.mCoord = inTransform->transformPoint(nextVertex.mCoord);
+            vertex.mNormal = inTransform->transformNormal(nextVertex.mNormal);
+            outMesh.mVertices.push_back(vertex);
+        }
+    }
+    else outMesh.mVertices.insert(outMesh.mVertices.end(), inMesh.mVertices.begin(), inMesh.mVertices.end());
+
+    if(inKeepBones && hasBoneData(inMesh)){
+        outMesh.mBones.insert(outMesh.mBones.end(), inMesh.mBones.begin(), inMesh.mBones.end());
+        outMesh.mBoneWeights.insert(outMesh.mBoneWeights.end(), inMesh.mBoneWeights.begin(), inMesh.mBoneWeights.end());
+    }
+}
+
+//appends triangle list with shifted indices, flips winding if needed
+void appendTriangles(Mesh::IndexCont& outIndices, const hydra::data::IndexBuffer& inIndices, Mesh::index_t inBase, bool inFlip){
+    for(size_t i = 0; i + 2 < inIndices.size(); i += 3){
+        outIndices.push_back(inBase + inIndices[i]);
+        outIndices.push_back(inBase + inIndices[i + (inFlip? 2: 1)]);
+        outIndices.push_back(inBase + inIndices[i + (inFlip? 1: 2)]);
+    }
+}
+
+//\brief Appends triangle strip joining it with degenerate triangles.
+//
+//Returns position of the first index of appended strip. Strip starts
+//at even position, or at odd one if winding is flipped; in the latter
+//case returned range starts with extra index to keep the parity.
+size_t appendStrip(Mesh::IndexCont& outIndices, const hydra::data::IndexBuffer& inIndices, Mesh::index_t inBase, bool inFlip){
+    if(inIndices.empty()) return outIndices.size();
+
+    const Mesh::index_t first = inBase + inIndices[0];
+    if(!outIndices.empty()){
+        outIndices.push_back(outIndices.back());
+        outIndices.push_back(first);
+    }
+    if((outIndices.size() % 2 == 1) != inFlip) outIndices.push_back(first);
+
+    const size_t start = inFlip? outIndices.size() - 1: outIndices.size();
+    for(size_t i = 0; i < inIndices.size(); ++i) outIndices.push_back(inBase + inIndices[i]);
+    return start;
+}
+
+MeshPtr mergeBatch(const std::vector<Source>& inSources, const Batch& inBatch, bool inKeepBones){
+    const Mesh& firstMesh = *inSources[inBatch.members[0]].mesh;
+
+    MeshPtr result(new Mesh());
+    result->mMode = firstMesh.mMode;
+    result->mMaterial = firstMesh.mMaterial;
+    result->mVertices.reserve(inBatch.vertexNum);
+    const bool keepBones = inKeepBones && hasBoneData(firstMesh);
+    if(keepBones){
+        result->mBones.reserve(inBatch.vertexNum);
+        result->mBoneWeights.reserve(inBatch.vertexNum);
+    }
+
+    //levels of detail are merged only if every source has the same number of them
+    size_t lodNum = (result->mMode == Mesh::TRIANGLES)? firstMesh.mLODs.size(): 0;
+    size_t indexNum = 0;
+    BOOST_FOREACH(size_t nextMember, inBatch.members){
+        const Mesh& mesh = *inSources[nextMember].mesh;
+        if(mesh.mLODs.size() != lodNum) lodNum = 0;
+        indexNum += mesh.getIndexNum();
+    }
+
+    Mesh::IndexCont indices;
+    indices.reserve(indexNum + 3 * inBatch.members.size());
+    std::vector<Mesh::IndexCont> lodIndices(lodNum);
+    result->mLODs.resize(lodNum);
+    for(size_t i = 0; i < lodNum; ++i) result->mLODs[i].mError = 0.0f;
+
+    BOOST_FOREACH(size_t nextMember, inBatch.members){
+        const Mesh& mesh = *inSources[nextMember].mesh;
+        const Transform* transform = inSources[nextMember].transform;
+        const bool flip = transform && transform->isMirroring();
+        const Mesh::index_t base = static_cast<Mesh::index_t>(result->mVertices.size());
+
+        Mesh::SubMesh subMesh;
+        subMesh.mFirstVertex = base;
+        subMesh.mVertexNum = mesh.getVertexNum();
+        appendVertices(*result, mesh, transform, keepBones);
+
+        if(result->mMode == Mesh::TRIANGLES){
+            subMesh.mFirstIndex = indices.size();
+            appendTriangles(indices, mesh.mIndices, base, flip);
+        }
+        else subMesh.mFirstIndex = appendStrip(indices, mesh.mIndices, base, flip);
+        subMesh.mIndexNum = indices.size() - subMesh.mFirstIndex;
+        result->mSubMeshes.push_back(subMesh);
+
+        for(size_t i = 0; i < lodNum; ++i){
+            appendTriangles(lodIndices[i], mesh.mLODs[i].mIndices, base, flip);
+            result->mLODs[i].mError = std::max(result->mLODs[i].mError, mesh.mLODs[i].mError);
+        }
+    }
+
+    result->mIndices.assign(indices);
+    for(size_t i = 0; i < lodNum; ++i) result->mLODs[i].mIndices.assign(lodIndices[i]);
+    return result;
+}
+
+//copies mesh which is not merged with anything
+MeshPtr copyMesh(const Source& inSource, bool inKeepBones){
+    if(!inSource.transform && inKeepBones) return inSource.mesh;
+
+    MeshPtr result(new Mesh(*inSource.mesh));
+    if(!inKeepBones){
+        result->mBones.clear();
+        result->mBoneWeights.clear();
+    }
+    if(inSource.transform){
+        result->mVertices.clear();
+        appendVertices(*result, *inSource.mesh, inSource.transform, false);
+        result->invalidateBounds();
+    }
+    return result;
+}
+
+void mergeSources(const std::vector<Source>& inSources, bool inKeepBones, size_t inMaxVertexNum, Model::MeshCont& outMeshes){
+    std::vector<Batch> batches;
+    //batches which may get more meshes
+    std::vector<size_t> openBatches;
+
+    outMeshes.clear();
+    for(size_t i = 0; i < inSources.size(); ++i){
+        const Mesh& mesh = *inSources[i].mesh;
+        if(!isMergeable(mesh) || mesh.getVertexNum() > inMaxVertexNum){
+            outMeshes.push_back(copyMesh(inSources[i], inKeepBones));
+            continue;
+        }
+
+        size_t found = batches.size();
+        for(size_t j = 0; j < openBatches.size(); ++j){
+            Batch& batch = batches[openBatches[j]];
+            if(!canMerge(*inSources[batch.members[0]].mesh, mesh, inKeepBones)) continue;
+            if(batch.vertexNum + mesh.getVertexNum() <= inMaxVertexNum) found = openBatches[j];
+            //batch is full, new one is started
+            else openBatches.erase(openBatches.begin() + j);
+            break;
+        }
+
+        if(found == batches.size()){
+            Batch batch;
+            batch.vertexNum = 0;
+            batch.position = outMeshes.size();
+            batches.push_back(batch);
+            openBatches.push_back(found);
+            outMeshes.push_back(MeshPtr());
+        }
+        batches[found].members.push_back(i);
+        batches[found].vertexNum += mesh.getVertexNum();
+    }
+
+    BOOST_FOREACH(const Batch& nextBatch, batches){
+        if(nextBatch.members.size() == 1) outMeshes[nextBatch.position] = copyMesh(inSources[nextBatch.members[0]], inKeepBones);
+        else outMeshes[nextBatch.position] = mergeBatch(inSources, nextBatch, inKeepBones);
+    }
+}
+
+} //unnamed namespace
+
+MeshMerger::MeshMerger(size_t inMaxVertexNum): mMaxVertexNum(inMaxVertexNum){
+
+}
+
+void MeshMerger::mergeMeshes(Model::MeshCont& inoutMeshes) const{
+    std::vector<Source> sources;
+    sources.reserve(inoutMeshes.size());
+    BOOST_FOREACH(const MeshPtr& nextMesh, inoutMeshes){
+        if(!nextMesh) continue;
+        Source source;
+        source.mesh = nextMesh;
+        source.transform = 0;
+        sources.push_back(source);
+    }
+    mergeSources(sources, true, mMaxVertexNum, inoutMeshes);
+}
+
+void MeshMerger::addInstance(ModelPtr inModel, const Matrix& inTransform){
+    assert(inModel);
+    Instance instance;
+    instance.mModel = inModel;
+    instance.mTransform = inTransform;
+    mInstances.push_back(instance);
+}
+
+ModelPtr MeshMerger::buildStaticModel(const std::string& inName) const{
+    ModelPtr result(new Model(inName));
+
+    //transformations must not be moved while sources point to them
+    std::vector<Transform> transforms;
+    transforms.reserve(mInstances.size());
+    std::vector<Source> sources;
+    BOOST_FOREACH(const Instance& nextInstance, mInstances){
+        transforms.push_back(Transform(nextInstance.mTransform));
+        BOOST_FOREACH(const MeshPtr& nextMesh, nextInstance.mModel->mMeshes){
+            if(!nextMesh) continue;
+            Source source;
+            source.mesh = nextMesh;
+            source.transform = &transforms.back();
+            sources.push_back(source);
+        }
+        for(Model::ImageCont::const_iterator iter = nextInstance.mModel->mImages.begin();
+                iter != nextInstance.mModel->mImages.end(); ++iter){
+            result->addImage(iter->first, iter->second);
+        }
+    }
+    mergeSources(sources, false, mMaxVertexNum, result->mMeshes);
+    return result;
+}
+
+void MeshMerger::clearInstances(){
+    mInstances.clear();
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
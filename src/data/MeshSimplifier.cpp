@@ -0,0 +1,521 @@
+//MeshSimplifier.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/MeshSimplifier.hpp"
+#include "data/Mesh.hpp"
+#include "data/Vertex.hpp"
+#include "math/Vector3D.hpp"
+#include "math/Point.hpp"
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <boost/foreach.hpp>
+#include <boost/cstdint.hpp>
+
+using hydra::data::MeshSimplifier;
+using hydra::data::Mesh;
+using hydra::data::Vertex;
+using hydra::math::Vector3D;
+using hydra::math::Point;
+
+namespace{
+
+//sum of weighted squared distances to planes
+struct Quadric{
+    Quadric(): a00(0.0), a01(0.0), a02(0.0), a11(0.0), a12(0.0), a22(0.0),
+        b0(0.0), b1(0.0), b2(0.0), c(0.0), w(0.0){
+
+    }
+
+    //adds plane inNormal * p + inD = 0 (normal is unit)
+    void addPlane(const Vector3D& inNormal, double inD, double inWeight){
+        const double x = inNormal.x();
+        const double y = inNormal.y();
+        const double z = inNormal.z();
+        a00 += inWeight * x * x;
+        a01 += inWeight * x * y;
+        a02 += inWeight * x * z;
+        a11 += inWeight * y * y;
+        a12 += inWeight * y * z;
+        a22 += inWeight * z * z;
+        b0 += inWeight * x * inD;
+        b1 += inWeight * y * inD;
+        b2 += inWeight * z * inD;
+        c += inWeight * inD * inD;
+        w += inWeight;
+    }
+
+    void add(const Quadric& rhv){
+        a00 += rhv.a00; a01 += rhv.a01; a02 += rhv.a02;
+        a11 += rhv.a11; a12 += rhv.a12; a22 += rhv.a22;
+        b0 += rhv.b0; b1 += rhv.b1; b2 += rhv.b2;
+        c += rhv.c;
+        w += rhv.w;
+    }
+
+    //weighted sum of squared distances from point to planes
+    double eval(const Point& inPoint) const{
+        const double x = inPoint.x;
+        const double y = inPoint.y;
+        const double z = inPoint.z;
+        return a00 * x * x + a11 * y * y + a22 * z * z
+            + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+            + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+    }
+
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double w;
+};
+
+//orders vertices by position
+struct PositionLess{
+    const Mesh::VertexCont* vertices;
+
+    bool operator()(Mesh::index_t lhv, Mesh::index_t rhv) const{
+        const Point& a = (*vertices)[lhv].mCoord;
+        const Point& b = (*vertices)[rhv].mCoord;
+        if(a.x != b.x) return a.x < b.x;
+        if(a.y != b.y) return a.y < b.y;
+        return a.z < b.z;
+    }
+};
+
+//directed edge between position groups
+inline boost::uint64_t edgeKey(unsigned int inFrom, unsigned int inTo){
+    return (static_cast<boost::uint64_t>(inFrom) << 32) | inTo;
+}
+
+//move of all vertices of one position group to another one
+struct Collapse{
+    unsigned int from;
+    unsigned int to;
+    //order of collapses
+    float cost;
+};
+
+struct CollapseLess{
+    bool operator()(const Collapse& lhv, const Collapse& rhv) const{
+        return lhv.cost < rhv.cost;
+    }
+};
+
+//vertex of collapsed group and vertex it is moved to
+typedef std::pair<Mesh::index_t, Mesh::index_t> WedgePair;
+typedef std::vector<WedgePair> WedgePairCont;
+
+//state of simplification of a single triangle list
+class Simplifier{
+public:
+    Simplifier(const Mesh& inMesh, const Mesh::IndexCont& inIndices, const MeshSimplifier::Properties& inProps):
+        mMesh(inMesh), mProps(inProps){
+
+        const Mesh::VertexCont& vertices = inMesh.mVertices;
+        mHasBones = (inMesh.mBones.size() == vertices.size() && inMesh.mBoneWeights.size() == vertices.size());
+
+        //vertices with equal positions form groups
+        std::vector<Mesh::index_t> order(vertices.size());
+        for(size_t i = 0; i < order.size(); ++i) order[i] = static_cast<Mesh::index_t>(i);
+        PositionLess less = {&vertices};
+        std::sort(order.begin(), order.end(), less);
+
+        mGroups.resize(vertices.size());
+        unsigned int groupNum = 0;
+        for(size_t i = 0; i < order.size(); ++i){
+            if(i > 0 && less(order[i - 1], order[i])){
+                mGroupVertex.push_back(order[i - 1]);
+                ++groupNum;
+            }
+            mGroups[order[i]] = groupNum;
+        }
+        if(!order.empty()) mGroupVertex.push_back(order.back());
+        mQuadrics.resize(mGroupVertex.size());
+        mDistances.resize(mQuadrics.size(), 0.0f);
+        mLocked.resize(mQuadrics.size());
+        mRemap.resize(vertices.size());
+
+        for(size_t i = 0; i + 2 < inIndices.size(); i += 3){
+            const Mesh::index_t* tri = &inIndices[i];
+            if(isDegenerate(tri[0], tri[1], tri[2])) continue;
+            mTriangles.insert(mTriangles.end(), tri, tri + 3);
+        }
+
+        //planes of triangles
+        buildAdjacency();
+        for(size_t t = 0; t < mTriangles.size(); t += 3){
+            const Point& a = vertices[mTriangles[t]].mCoord;
+            Vector3D normal = (Vector3D(vertices[mTriangles[t + 1]].mCoord) - a).cross(Vector3D(vertices[mTriangles[t + 2]].mCoord) - a);
+            const float length = normal.getMagnitude();
+            if(length <= 0.0f) continue;
+            normal /= length;
+            const double d = -(normal * Vector3D(a));
+
+            for(size_t k = 0; k < 3; ++k){
+                mQuadrics[mGroups[mTriangles[t + k]]].addPlane(normal, d, 0.5 * length);
+            }
+
+            //planes which are perpendicular to triangle at open borders
+            for(size_t k = 0; k < 3; ++k){
+                const Mesh::index_t v0 = mTriangles[t + k];
+                const Mesh::index_t v1 = mTriangles[t + (k + 1) % 3];
+                if(hasEdge(mGroups[v1], mGroups[v0])) continue;
+
+                const Vector3D edge = Vector3D(vertices[v1].mCoord) - Vector3D(vertices[v0].mCoord);
+                const Vector3D borderNormal = edge.cross(normal).getUnit();
+                const double borderD = -(borderNormal * Vector3D(vertices[v0].mCoord));
+                const double weight = mProps.borderWeight * edge.getSquareMagnitude();
+                mQuadrics[mGroups[v0]].addPlane(borderNormal, borderD, weight);
+                mQuadrics[mGroups[v1]].addPlane(borderNormal, borderD, weight);
+            }
+        }
+    }
+
+    //returns bound of distance between result and source surfaces (see mDistances)
+    float run(size_t inTargetTriangles, Mesh::IndexCont& outIndices){
+        float maxError = 0.0f;
+
+        std::vector<Collapse> collapses;
+        WedgePairCont pairs;
+        while(mTriangles.size() / 3 > inTargetTriangles){
+            buildAdjacency();
+            for(size_t i = 0; i < mRemap.size(); ++i) mRemap[i] = static_cast<Mesh::index_t>(i);
+            std::fill(mLocked.begin(), mLocked.end(), false);
+
+            //each edge is checked in both directions once
+            collapses.clear();
+            collapses.reserve(mEdges.size() / 2);
+            for(size_t i = 0; i < mEdges.size(); ++i){
+                if(i > 0 && mEdges[i] == mEdges[i - 1]) continue;
+                const unsigned int a = static_cast<unsigned int>(mEdges[i] >> 32);
+                const unsigned int b = static_cast<unsigned int>(mEdges[i] & 0xffffffffu);
+                if(a > b && hasEdge(b, a)) continue;
+
+                Collapse forward, backward;
+                const bool forwardValid = evaluate(a, b, pairs, forward);
+                const bool backwardValid = evaluate(b, a, pairs, backward);
+                if(forwardValid && (!backwardValid || forward.cost <= backward.cost)) collapses.push_back(forward);
+                else if(backwardValid) collapses.push_back(backward);
+            }
+            if(collapses.empty()) break;
+            //each collapse removes about 2 triangles, so only the cheapest
+            //collapses are sorted (the rest is sorted if none of them can be made)
+            const size_t needed = mTriangles.size() / 3 - inTargetTriangles;
+            const size_t limitIndex = std::min(collapses.size() - 1, needed / 2);
+            std::nth_element(collapses.begin(), collapses.begin() + limitIndex, collapses.end(), CollapseLess());
+            std::sort(collapses.begin(), collapses.begin() + limitIndex + 1, CollapseLess());
+
+            size_t removed = 0;
+            size_t made = 0;
+            for(size_t i = 0; i < collapses.size() && removed < needed; ++i){
+                if(i == limitIndex + 1){
+                    if(made > 0) break;
+                    std::sort(collapses.begin() + i, collapses.end(), CollapseLess());
+                }
+                const Collapse& nextCollapse = collapses[i];
+                if(mLocked[nextCollapse.from] || mLocked[nextCollapse.to]) continue;
+                if(!collectPairs(nextCollapse.from, nextCollapse.to, pairs) || hasFlips(nextCollapse.from, nextCollapse.to)) continue;
+
+                BOOST_FOREACH(const WedgePair& nextPair, pairs) mRemap[nextPair.first] = nextPair.second;
+                removed += countShared(nextCollapse.from, nextCollapse.to);
+                mQuadrics[nextCollapse.to].add(mQuadrics[nextCollapse.from]);
+                const float distance = (Vector3D(getPosition(nextCollapse.from)) - Vector3D(getPosition(nextCollapse.to))).getMagnitude();
+                mDistances[nextCollapse.to] = std::max(mDistances[nextCollapse.to], mDistances[nextCollapse.from] + distance);
+                mLocked[nextCollapse.from] = true;
+                mLocked[nextCollapse.to] = true;
+                maxError = std::max(maxError, mDistances[nextCollapse.to]);
+                ++made;
+            }
+            if(made == 0) break;
+
+            //apply collapses and drop collapsed triangles
+            size_t triNum = 0;
+            for(size_t t = 0; t < mTriangles.size(); t += 3){
+                const Mesh::index_t a = mRemap[mTriangles[t]];
+                const Mesh::index_t b = mRemap[mTriangles[t + 1]];
+                const Mesh::index_t c = mRemap[mTriangles[t + 2]];
+                if(isDegenerate(a, b, c)) continue;
+                mTriangles[triNum++] = a;
+                mTriangles[triNum++] = b;
+                mTriangles[triNum++] = c;
+            }
+            mTriangles.resize(triNum);
+        }
+
+        outIndices = mTriangles;
+        return maxError;
+    }
+
+private:
+    inline bool isDegenerate(Mesh::index_t inA, Mesh::index_t inB, Mesh::index_t inC) const{
+        return mGroups[inA] == mGroups[inB] || mGroups[inA] == mGroups[inC] || mGroups[inB] == mGroups[inC];
+    }
+
+    inline const Point& getPosition(unsigned int inGroup) const{
+        return mMesh.mVertices[mGroupVertex[inGroup]].mCoord;
+    }
+
+    inline bool hasEdge(unsigned int inFrom, unsigned int inTo) const{
+        return std::binary_search(mEdges.begin(), mEdges.end(), edgeKey(inFrom, inTo));
+    }
+
+    //builds group to triangle adjacency and sorted list of directed edges
+    void buildAdjacency(){
+        const size_t groupNum = mQuadrics.size();
+        mOffsets.assign(groupNum + 1, 0);
+        for(size_t i = 0; i < mTriangles.size(); ++i) ++mOffsets[mGroups[mTriangles[i]] + 1];
+        for(size_t i = 0; i < groupNum; ++i) mOffsets[i + 1] += mOffsets[i];
+
+        mAdjacency.resize(mTriangles.size());
+        std::vector<unsigned int> filled(mOffsets.begin(), mOffsets.end() - 1);
+        mEdges.resize(mTriangles.size());
+        for(size_t i = 0; i < mTriangles.size(); ++i){
+            const size_t t = i / 3;
+            const unsigned int group = mGroups[mTriangles[i]];
+            mAdjacency[filled[group]++] = static_cast<unsigned int>(t);
+            mEdges[i] = edgeKey(group, mGroups[mTriangles[3 * t + (i % 3 + 1) % 3]]);
+        }
+        std::sort(mEdges.begin(), mEdges.end());
+
+        mBorder.assign(groupNum, false);
+        for(size_t i = 0; i < mEdges.size(); ++i){
+            const unsigned int a = static_cast<unsigned int>(mEdges[i] >> 32);
+            const unsigned int b = static_cast<unsigned int>(mEdges[i] & 0xffffffffu);
+            if(!hasEdge(b, a)) mBorder[a] = mBorder[b] = true;
+        }
+    }
+
+    //finds vertex of group inTo for each vertex of group inFrom
+    //returns false if some vertex has no target or several targets
+    bool collectPairs(unsigned int inFrom, unsigned int inTo, WedgePairCont& outPairs) const{
+        outPairs.clear();
+        std::vector<Mesh::index_t>& seen = mSeen;
+        seen.clear();
+        for(unsigned int i = mOffsets[inFrom]; i < mOffsets[inFrom + 1]; ++i){
+            const size_t t = 3 * mAdjacency[i];
+            Mesh::index_t wedge = 0;
+            Mesh::index_t target = 0;
+            bool hasTarget = false;
+            for(size_t k = 0; k < 3; ++k){
+                const Mesh::index_t corner = mRemap[mTriangles[t + k]];
+                if(mGroups[corner] == inFrom) wedge = corner;
+                else if(mGroups[corner] == inTo){
+                    target = corner;
+                    hasTarget = true;
+                }
+            }
+            if(std::find(seen.begin(), seen.end(), wedge) == seen.end()) seen.push_back(wedge);
+            if(!hasTarget) continue;
+
+            bool found = false;
+            BOOST_FOREACH(const WedgePair& nextPair, outPairs){
+                if(nextPair.first != wedge) continue;
+                if(nextPair.second != target) return false;
+                found = true;
+            }
+            if(!found) outPairs.push_back(WedgePair(wedge, target));
+        }
+        return outPairs.size() == seen.size();
+    }
+
+    //checks whether moving group inFrom to position of group inTo turns over some triangle
+    bool hasFlips(unsigned int inFrom, unsigned int inTo) const{
+        const Vector3D target(getPosition(inTo));
+        for(unsigned int i = mOffsets[inFrom]; i < mOffsets[inFrom + 1]; ++i){
+            const size_t t = 3 * mAdjacency[i];
+            unsigned int groups[3];
+            for(size_t k = 0; k < 3; ++k) groups[k] = mGroups[mRemap[mTriangles[t + k]]];
+            if(groups[0] == groups[1] || groups[0] == groups[2] || groups[1] == groups[2]) continue;
+            if(groups[0] == inTo || groups[1] == inTo || groups[2] == inTo) continue;
+
+            Vector3D before[3];
+            Vector3D after[3];
+            for(size_t k = 0; k < 3; ++k){
+                before[k] = Vector3D(getPosition(groups[k]));
+                after[k] = (groups[k] == inFrom)? target: before[k];
+            }
+            const Vector3D normalBefore = (before[1] - before[0]).cross(before[2] - before[0]);
+            const Vector3D normalAfter = (after[1] - after[0]).cross(after[2] - after[0]);
+            if(normalBefore * normalAfter <= 0.0f) return true;
+        }
+        return false;
+    }
+
+    //number of live triangles which contain both groups
+    size_t countShared(unsigned int inFrom, unsigned int inTo) const{
+        size_t result = 0;
+        for(unsigned int i = mOffsets[inFrom]; i < mOffsets[inFrom + 1]; ++i){
+            const size_t t = 3 * mAdjacency[i];
+            const Mesh::index_t a = mRemap[mTriangles[t]];
+            const Mesh::index_t b = mRemap[mTriangles[t + 1]];
+            const Mesh::index_t c = mRemap[mTriangles[t + 2]];
+            if(isDegenerate(a, b, c)) continue;
+            if(mGroups[a] == inTo || mGroups[b] == inTo || mGroups[c] == inTo) ++result;
+        }
+        return result;
+    }
+
+    //sum of absolute differences of bone weights
+    float boneDifference(Mesh::index_t inA, Mesh::index_t inB) const{
+        const Mesh::BoneIndices& bonesA = mMesh.mBones[inA];
+        const Mesh::BoneIndices& bonesB = mMesh.mBones[inB];
+        const Mesh::BoneWeights& weightsA = mMesh.mBoneWeights[inA];
+        const Mesh::BoneWeights& weightsB = mMesh.mBoneWeights[inB];
+
+        float result = 0.0f;
+        for(int i = 0; i < Mesh::MAX_BONES_PER_VERTEX; ++i){
+            if(weightsA[i] == 0.0f) continue;
+            float other = 0.0f;
+            for(int j = 0; j < Mesh::MAX_BONES_PER_VERTEX; ++j){
+                if(bonesB[j] == bonesA[i]) other += weightsB[j];
+            }
+            result += fabsf(weightsA[i] - other);
+        }
+        for(int j = 0; j < Mesh::MAX_BONES_PER_VERTEX; ++j){
+            if(weightsB[j] == 0.0f) continue;
+            bool shared = false;
+            for(int i = 0; i < Mesh::MAX_BONES_PER_VERTEX; ++i){
+                if(bonesA[i] == bonesB[j] && weightsA[i] != 0.0f) shared = true;
+            }
+            if(!shared) result += weightsB[j];
+        }
+        return result;
+    }
+
+    //fills collapse if it is allowed
+    bool evaluate(unsigned int inFrom, unsigned int inTo, WedgePairCont& outPairs, Collapse& outCollapse) const{
+        //vertices of borders move along borders only
+        if(mBorder[inFrom] && hasEdge(inFrom, inTo) == hasEdge(inTo, inFrom)) return false;
+        if(!collectPairs(inFrom, inTo, outPairs)) return false;
+
+        Quadric quadric = mQuadrics[inFrom];
+        quadric.add(mQuadrics[inTo]);
+        const Point& target = getPosition(inTo);
+        const double error = (quadric.w > 0.0)? std::max(0.0, quadric.eval(target) / quadric.w): 0.0;
+
+        //attribute differences are scaled by squared edge length to have units of squared distance
+        const float edgeLength = (Vector3D(getPosition(inFrom)) - Vector3D(target)).getSquareMagnitude();
+        float attributes = 0.0f;
+        BOOST_FOREACH(const WedgePair& nextPair, outPairs){
+            const Vertex& a = mMesh.mVertices[nextPair.first];
+            const Vertex& b = mMesh.mVertices[nextPair.second];
+            const float du = a.mTexCoord.x - b.mTexCoord.x;
+            const float dv = a.mTexCoord.y - b.mTexCoord.y;
+            attributes += mProps.normalWeight * (a.mNormal - b.mNormal).getSquareMagnitude();
+            attributes += mProps.texCoordWeight * (du * du + dv * dv);
+            if(mHasBones){
+                const float bones = boneDifference(nextPair.first, nextPair.second);
+                attributes += mProps.boneWeight * bones * bones;
+            }
+        }
+
+        outCollapse.from = inFrom;
+        outCollapse.to = inTo;
+        outCollapse.cost = static_cast<float>(error) + attributes * edgeLength;
+        return true;
+    }
+
+    const Mesh& mMesh;
+    const MeshSimplifier::Properties& mProps;
+    bool mHasBones;
+
+    //position group of each vertex
+    std::vector<unsigned int> mGroups;
+    //some vertex of each group
+    std::vector<Mesh::index_t> mGroupVertex;
+    //quadrics of groups
+    std::vector<Quadric> mQuadrics;
+    //bounds of distances which source vertices moved to groups (sums of collapsed edges).
+    //Each triangle is moved with its vertices, so the largest one bounds Hausdorff
+    //distance between source and simplified surfaces.
+    std::vector<float> mDistances;
+    //groups with open border edges
+    std::vector<bool> mBorder;
+    //groups changed in current pass
+    std::vector<bool> mLocked;
+
+    //current triangles
+    Mesh::IndexCont mTriangles;
+    //vertices moved in current pass
+    Mesh::IndexCont mRemap;
+    //triangles of groups (compressed sparse rows)
+    std::vector<unsigned int> mOffsets;
+    std::vector<unsigned int> mAdjacency;
+    //sorted directed edges between groups
+    std::vector<boost::uint64_t> mEdges;
+    //vertices of collapsed group (scratch buffer)
+    mutable std::vector<Mesh::index_t> mSeen;
+};
+
+} //unnamed namespace
+
+MeshSimplifier::MeshSimplifier(const MeshSimplifier::Properties& inProps): mProps(inProps){
+
+}
+
+float MeshSimplifier::simplify(const Mesh& inMesh, const Mesh::IndexCont& inIndices,
+                               size_t inTargetTriangles, Mesh::IndexCont& outIndices) const{
+    Simplifier simplifier(inMesh, inIndices, mProps);
+    return simplifier.run(inTargetTriangles, outIndices);
+}
+
+void MeshSimplifier::generateLODs(Mesh& inoutMesh, const std::vector<float>& inRatios) const{
+    if(inoutMesh.mMode != Mesh::TRIANGLES) return;
+    inoutMesh.mLODs.clear();
+
+    const size_t triangles = inoutMesh.getIndexNum() / 3;
+    Mesh::IndexCont source;
+    inoutMesh.mIndices.copyTo(source);
+    Mesh::IndexCont simplified;
+    float error = 0.0f;
+    BOOST_FOREACH(float nextRatio, inRatios){
+        const size_t target = static_cast<size_t>(nextRatio * triangles);
+        error += simplify(inoutMesh, source, target, simplified);
+        if(simplified.empty() || simplified.size() >= source.size()) break;
+
+        Mesh::LOD lod;
+        lod.mIndices.assign(simplified);
+        lod.mError = error;
+        inoutMesh.mLODs.push_back(lod);
+        source.swap(simplified);
+    }
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
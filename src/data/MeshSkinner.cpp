@@ -0,0 +1,337 @@
+//MeshSkinner.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/MeshSkinner.hpp"
+#include "data/Mesh.hpp"
+#include "data/Vertex.hpp"
+#include "data/Skeleton.hpp"
+#include "data/Bone.hpp"
+#include "data/Pose.hpp"
+#include "data/BoneInfluences.hpp"
+#include "math/Quat.hpp"
+#include "math/Vector3D.hpp"
+#include "common/ParallelFor.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <cassert>
+#include <cstring>
+#include <boost/cstdint.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define MESH_SKINNER_USE_SSE
+#endif
+
+using hydra::data::MeshSkinner;
+using hydra::data::Mesh;
+using hydra::data::Vertex;
+using hydra::data::Skeleton;
+using hydra::data::Pose;
+using hydra::data::BoneInfluences;
+using hydra::math::Quat;
+using hydra::math::Vector3D;
+
+namespace{
+
+//skins subrange of vertices
+struct SkinRange{
+    const float* positions;
+    const float* normals;
+    const boost::uint16_t* bones;
+    const float* weights;
+    const boost::uint8_t* influenceNum;
+    const MeshSkinner::Palette* palette;
+    unsigned char* outPositions;
+    unsigned char* outNormals;
+    size_t stride;
+
+    void operator()(size_t inBegin, size_t inEnd) const;
+};
+
+#ifdef MESH_SKINNER_USE_SSE
+
+void SkinRange::operator()(size_t inBegin, size_t inEnd) const{
+    float result[4];
+    for(size_t i = inBegin; i < inEnd; ++i){
+        const __m128 position = _mm_loadu_ps(positions + 4 * i);
+        float* outPosition = reinterpret_cast<float*>(outPositions + i * stride);
+        float* outNormal = outNormals? reinterpret_cast<float*>(outNormals + i * stride): 0;
+        const unsigned int num = influenceNum[i];
+        if(!num){
+            memcpy(outPosition, positions + 4 * i, 3 * sizeof(float));
+            if(outNormal) memcpy(outNormal, normals + 4 * i, 3 * sizeof(float));
+            continue;
+        }
+
+        //blend columns of bone matrices
+        const boost::uint16_t* vertexBones = bones + MeshSkinner::MAX_INFLUENCES * i;
+        const float* vertexWeights = weights + MeshSkinner::MAX_INFLUENCES * i;
+        const float* matrix = palette->getMatrix(vertexBones[0]);
+        __m128 weight = _mm_set1_ps(vertexWeights[0]);
+        __m128 c0 = _mm_mul_ps(weight, _mm_loadu_ps(matrix));
+        __m128 c1 = _mm_mul_ps(weight, _mm_loadu_ps(matrix + 4));
+        __m128 c2 = _mm_mul_ps(weight, _mm_loadu_ps(matrix + 8));
+        __m128 c3 = _mm_mul_ps(weight, _mm_loadu_ps(matrix + 12));
+        for(unsigned int j = 1; j < num; ++j){
+            matrix = palette->getMatrix(vertexBones[j]);
+            weight = _mm_set1_ps(vertexWeights[j]);
+            c0 = _mm_add_ps(c0, _mm_mul_ps(weight, _mm_loadu_ps(matrix)));
+            c1 = _mm_add_ps(c1, _mm_mul_ps(weight, _mm_loadu_ps(matrix + 4)));
+            c2 = _mm_add_ps(c2, _mm_mul_ps(weight, _mm_loadu_ps(matrix + 8)));
+            c3 = _mm_add_ps(c3, _mm_mul_ps(weight, _mm_loadu_ps(matrix + 12)));
+        }
+
+        //transform position and normal
+        __m128 transformed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(position, position, _MM_SHUFFLE(0, 0, 0, 0))),
+                                                   _mm_mul_ps(c1, _mm_shuffle_ps(position, position, _MM_SHUFFLE(1, 1, 1, 1)))),
+                                        _mm_add_ps(_mm_mul_ps(c2, _mm_shuffle_ps(position, position, _MM_SHUFFLE(2, 2, 2, 2))), c3));
+        _mm_storeu_ps(result, transformed);
+        memcpy(outPosition, result, 3 * sizeof(float));
+
+        if(outNormal){
+            const __m128 normal = _mm_loadu_ps(normals + 4 * i);
+            transformed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(normal, normal, _MM_SHUFFLE(0, 0, 0, 0))),
+                                                _mm_mul_ps(c1, _mm_shuffle_ps(normal, normal, _MM_SHUFFLE(1, 1, 1, 1)))),
+                                     _mm_mul_ps(c2, _mm_shuffle_ps(normal, normal, _MM_SHUFFLE(2, 2, 2, 2))));
+            _mm_storeu_ps(result, transformed);
+            memcpy(outNormal, result, 3 * sizeof(float));
+        }
+    }
+}
+
+#else
+
+void SkinRange::operator()(size_t inBegin, size_t inEnd) const{
+    for(size_t i = inBegin; i < inEnd; ++i){
+        const float* position = positions + 4 * i;
+        const float* normal = normals + 4 * i;
+        float* outPosition = reinterpret_cast<float*>(outPositions + i * stride);
+        float* outNormal = outNormals? reinterpret_cast<float*>(outNormals + i * stride): 0;
+        const unsigned int num = influenceNum[i];
+        if(!num){
+            memcpy(outPosition, position, 3 * sizeof(float));
+            if(outNormal) memcpy(outNormal, normal, 3 * sizeof(float));
+            continue;
+        }
+
+        //blend bone matrices
+        float blended[MeshSkinner::Palette::MATRIX_SIZE] = {0.0f};
+        for(unsigned int j = 0; j < num; ++j){
+            const float* matrix = palette->getMatrix(bones[MeshSkinner::MAX_INFLUENCES * i + j]);
+            const float weight = weights[MeshSkinner::MAX_INFLUENCES * i + j];
+            for(size_t k = 0; k < MeshSkinner::Palette::MATRIX_SIZE; ++k) blended[k] += weight * matrix[k];
+        }
+
+        for(int k = 0; k < 3; ++k){
+            outPosition[k] = blended[k] * position[0] + blended[4 + k] * position[1] + blended[8 + k] * position[2] + blended[12 + k];
+        }
+        if(outNormal){
+            for(int k = 0; k < 3; ++k){
+                outNormal[k] = blended[k] * normal[0] + blended[4 + k] * normal[1] + blended[8 + k] * normal[2];
+            }
+        }
+    }
+}
+
+#endif
+
+//orders influences by decreasing weight
+struct CompareInfluences{
+    bool operator()(const std::pair<float, int>& lhv, const std::pair<float, int>& rhv) const{
+        return lhv.first > rhv.first;
+    }
+};
+
+} //anonymous namespace
+
+void MeshSkinner::Palette::build(const Skeleton& inPose){
+    mMatrices.resize(inPose.mBones.size() * MATRIX_SIZE);
+    for(size_t i = 0; i < inPose.mBones.size(); ++i) setMatrix(i, inPose.mBones[i].mOrient, inPose.mBones[i].mPos);
+}
+
+void MeshSkinner::Palette::build(const Pose& inPose){
+    mMatrices.resize(inPose.getBoneNum() * MATRIX_SIZE);
+    for(size_t i = 0; i < inPose.getBoneNum(); ++i) setMatrix(i, inPose.mOrients[i], inPose.mPositions[i]);
+}
+
+void MeshSkinner::Palette::setMatrix(size_t inBone, const Quat& inOrient, const Vector3D& inPos){
+    Quat orient = inOrient;
+    orient.normalize();
+    float rotation[9];
+    orient.getRotationMatrix(rotation);
+
+    //columns of rotation and translation
+    float* matrix = &mMatrices[inBone * MATRIX_SIZE];
+    for(int column = 0; column < 3; ++column){
+        matrix[4 * column] = rotation[column];
+        matrix[4 * column + 1] = rotation[3 + column];
+        matrix[4 * column + 2] = rotation[6 + column];
+        matrix[4 * column + 3] = 0.0f;
+    }
+    matrix[12] = inPos.x();
+    matrix[13] = inPos.y();
+    matrix[14] = inPos.z();
+    matrix[15] = 1.0f;
+}
+
+MeshSkinner::MeshSkinner(const MeshSkinner::Properties& inProps): mProps(inProps), mMaxDroppedWeight(0.0f), mTruncatedVertexNum(0){
+
+}
+
+void MeshSkinner::setup(const Mesh& inMesh){
+    copyVertices(inMesh);
+    const size_t vertexNum = inMesh.getVertexNum();
+    const bool hasBones = (inMesh.mBones.size() == vertexNum && inMesh.mBoneWeights.size() == vertexNum);
+    if(!hasBones) return;
+
+    std::vector<std::pair<float, int> > influences;
+    for(size_t i = 0; i < vertexNum; ++i){
+        //keep the heaviest influences
+        influences.clear();
+        float totalWeight = 0.0f;
+        for(int j = 0; j < Mesh::MAX_BONES_PER_VERTEX; ++j){
+            if(!(inMesh.mBoneWeights[i][j] > 0.0f)) continue;
+            influences.push_back(std::make_pair(inMesh.mBoneWeights[i][j], inMesh.mBones[i][j]));
+            totalWeight += inMesh.mBoneWeights[i][j];
+        }
+        if(influences.empty()) continue;
+        std::stable_sort(influences.begin(), influences.end(), CompareInfluences());
+        if(influences.size() > static_cast<size_t>(MAX_INFLUENCES)){
+            influences.resize(MAX_INFLUENCES);
+            ++mTruncatedVertexNum;
+        }
+
+        float keptWeight = 0.0f;
+        for(size_t j = 0; j < influences.size(); ++j) keptWeight += influences[j].first;
+        mMaxDroppedWeight = std::max(mMaxDroppedWeight, totalWeight - keptWeight);
+
+        //weights are renormalized to the sum of source weights
+        const float scale = totalWeight / keptWeight;
+        for(size_t j = 0; j < influences.size(); ++j){
+            assert(influences[j].second >= 0 && influences[j].second <= 0xffff);
+            mInfluenceBones[MAX_INFLUENCES * i + j] = static_cast<boost::uint16_t>(influences[j].second);
+            mInfluenceWeights[MAX_INFLUENCES * i + j] = influences[j].first * scale;
+        }
+        mInfluenceNum[i] = static_cast<boost::uint8_t>(influences.size());
+    }
+}
+
+void MeshSkinner::setup(const Mesh& inMesh, const BoneInfluences& inInfluences){
+    copyVertices(inMesh);
+    const size_t vertexNum = inMesh.getVertexNum();
+    if(inInfluences.getVertexNum() != vertexNum) return;
+
+    for(size_t i = 0; i < vertexNum; ++i){
+        //unused slots have zero weights and are at the end
+        unsigned int num = 0;
+        for(int j = 0; j < MAX_INFLUENCES; ++j){
+            const float weight = inInfluences.getWeight(i, j);
+            if(!(weight > 0.0f)) break;
+            mInfluenceBones[MAX_INFLUENCES * i + j] = static_cast<boost::uint16_t>(inInfluences.getBone(i, j));
+            mInfluenceWeights[MAX_INFLUENCES * i + j] = weight;
+            ++num;
+        }
+        mInfluenceNum[i] = static_cast<boost::uint8_t>(num);
+    }
+    mMaxDroppedWeight = inInfluences.getReport().maxDroppedWeight;
+    mTruncatedVertexNum = inInfluences.getReport().truncatedVertexNum;
+}
+
+void MeshSkinner::copyVertices(const Mesh& inMesh){
+    clear();
+    const size_t vertexNum = inMesh.getVertexNum();
+    mPositions.resize(4 * vertexNum);
+    mNormals.resize(4 * vertexNum);
+    mInfluenceBones.resize(MAX_INFLUENCES * vertexNum, 0);
+    mInfluenceWeights.resize(MAX_INFLUENCES * vertexNum, 0.0f);
+    mInfluenceNum.resize(vertexNum, 0);
+
+    for(size_t i = 0; i < vertexNum; ++i){
+        const Vertex& vertex = inMesh.mVertices[i];
+        mPositions[4 * i] = vertex.mCoord.x;
+        mPositions[4 * i + 1] = vertex.mCoord.y;
+        mPositions[4 * i + 2] = vertex.mCoord.z;
+        mPositions[4 * i + 3] = 1.0f;
+        mNormals[4 * i] = vertex.mNormal.x();
+        mNormals[4 * i + 1] = vertex.mNormal.y();
+        mNormals[4 * i + 2] = vertex.mNormal.z();
+        mNormals[4 * i + 3] = 0.0f;
+    }
+}
+
+void MeshSkinner::clear(){
+    mPositions.clear();
+    mNormals.clear();
+    mInfluenceBones.clear();
+    mInfluenceWeights.clear();
+    mInfluenceNum.clear();
+    mMaxDroppedWeight = 0.0f;
+    mTruncatedVertexNum = 0;
+}
+
+void MeshSkinner::skin(const MeshSkinner::Palette& inPalette, float* outPositions, float* outNormals, size_t inStride) const{
+    if(mInfluenceNum.empty()) return;
+
+#ifndef NDEBUG
+    for(size_t i = 0; i < mInfluenceNum.size(); ++i){
+        for(unsigned int j = 0; j < mInfluenceNum[i]; ++j) assert(mInfluenceBones[MAX_INFLUENCES * i + j] < inPalette.getBoneNum());
+    }
+#endif
+
+    SkinRange task;
+    task.positions = &mPositions[0];
+    task.normals = &mNormals[0];
+    task.bones = &mInfluenceBones[0];
+    task.weights = &mInfluenceWeights[0];
+    task.influenceNum = &mInfluenceNum[0];
+    task.palette = &inPalette;
+    task.outPositions = reinterpret_cast<unsigned char*>(outPositions);
+    task.outNormals = reinterpret_cast<unsigned char*>(outNormals);
+    task.stride = inStride;
+    hydra::common::parallelFor(0, mInfluenceNum.size(), task, mProps.threadNum, mProps.minVerticesPerThread);
+}
+
+void MeshSkinner::skin(const MeshSkinner::Palette& inPalette, Vertex* outVertices) const{
+    if(mInfluenceNum.empty()) return;
+    //Point and Vector3D are 3 floats (vertices are passed to video memory as is)
+    skin(inPalette, &outVertices[0].mCoord.x, reinterpret_cast<float*>(&outVertices[0].mNormal), sizeof(Vertex));
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -14,13 +14,18 @@
 
 #include "data/Model.hpp"
 #include "data/Mesh.hpp"
+#include "data/MeshMerger.hpp"
 #include "data/Material.hpp"
 #include "data/Image.hpp"
 #include "data/Bone.hpp"
 #include "data/Skeleton.hpp"
 #include "data/Animation.hpp"
+#include "data/Pose.hpp"
+#include "data/PoseComposer.hpp"
 #include "math/Vector3D.hpp"
 #include "math/Quat.hpp"
+#include "math/AABB.hpp"
+#include "math/BoundingSphere.hpp"
 
 #include <algorithm>
 #include <boost/foreach.hpp>
@@ -29,24 +34,30 @@ using hydra::data::Model;
 using hydra::data::ModelPtr;
 using hydra::data::Mesh;
 using hydra::data::MeshPtr;
+using hydra::data::MeshMerger;
 using hydra::data::Image;
 using hydra::data::ImagePtr;
 using hydra::data::Skeleton;
 using hydra::data::SkeletonPtr;
 using hydra::data::Animation;
 using hydra::data::AnimationPtr;
+using hydra::data::Pose;
+using hydra::data::PoseComposer;
 using hydra::math::Vector3D;
 using hydra::math::Quat;
+using hydra::math::AABB;
+using hydra::math::BoundingSphere;
 
-Model::Model(){
+Model::Model(): mBoundsValid(false){
  
 }
 
-Model::Model(const std::string& inName): mName(inName){
+Model::Model(const std::string& inName): mName(inName), mBoundsValid(false){
 
 }
 
-Model::Model(const Model& inModel): mName(inModel.mName), mImages(inModel.mImages), mAnims(inModel.mAnims){
+Model::Model(const Model& inModel): mName(inModel.mName), mImages(inModel.mImages), mAnims(inModel.mAnims),
+        mBoundsValid(inModel.mBoundsValid), mAABB(inModel.mAABB), mBoundingSphere(inModel.mBoundingSphere){
     //copy Meshes
     BOOST_FOREACH(const MeshPtr& nextMesh, inModel.mMeshes)
         mMeshes.push_back(MeshPtr(new Mesh(*nextMesh)));
@@ -62,6 +73,7 @@ Model& Model::operator=(const Model& inModel){
 
     mName = inModel.mName;
     //create a copy of Meshes
+    mMeshes.clear();
     BOOST_FOREACH(const MeshPtr& nextMesh, inModel.mMeshes)
         mMeshes.push_back(MeshPtr(new Mesh(*nextMesh)));
     //do not copy images, only pointers!
@@ -70,6 +82,7 @@ Model& Model::operator=(const Model& inModel){
     if(inModel.mBindSkel){
         mBindSkel = SkeletonPtr(new Skeleton(*inModel.mBindSkel));
     }
+    invalidateBounds();
     return (*this);
 }
 
@@ -88,6 +101,11 @@ void Model::sortMeshesByOpacity(){
     std::sort(mMeshes.begin(), mMeshes.end(), compareMeshesByOpacity);
 }
 
+void Model::mergeMeshes(size_t inMaxVertexNum){
+    MeshMerger(inMaxVertexNum).mergeMeshes(mMeshes);
+    invalidateBounds();
+}
+
 void Model::dropEmptyMeshes(){
     //temporary model
     Model model;
@@ -115,6 +133,7 @@ void Model::dropEmptyMeshes(){
      //save non-empty meshes
      mMeshes = model.mMeshes;
      mImages = model.mImages;
+     invalidateBounds();
 }
 
 void Model::clear(){
@@ -123,19 +142,73 @@ void Model::clear(){
     mImages.clear();
     mBindSkel.reset();
     mAnims.clear();
+    invalidateBounds();
 }
 
 void Model::addAnimation(AnimationPtr inAnim){
     mAnims.push_back(inAnim);
+    //frames are converted to space relative to bind pose
+    PoseComposer composer;
+    composer.setup(*mBindSkel);
+    Pose model, relative;
     BOOST_FOREACH(Skeleton& nextSkel, mAnims.back()->mFrames){
-        for(size_t i = 0; i < nextSkel.mBones.size(); ++i){
-            nextSkel.mBones[i].mOrient = nextSkel.mBones[i].mOrient * mBindSkel->mBones[i].mOrient.getInverse();
-            nextSkel.mBones[i].mOrient.normalize();
-            Vector3D temp = mBindSkel->mBones[i].mPos;
-            nextSkel.mBones[i].mOrient.rotate(temp);
-            nextSkel.mBones[i].mPos -= temp;
-         }
+        model.fromSkeleton(nextSkel);
+        composer.makeRelative(model, relative);
+        relative.toSkeleton(nextSkel);
+    }
+}
+
+const AABB& Model::getAABB() const{
+    if(!mBoundsValid) updateBounds();
+    return mAABB;
+}
+
+const BoundingSphere& Model::getBoundingSphere() const{
+    if(!mBoundsValid) updateBounds();
+    return mBoundingSphere;
+}
+
+//extends box to contain another one
+static void mergeAABB(Vector3D& inoutMin, Vector3D& inoutMax, const AABB& inBox){
+    const Vector3D& corner = inBox.getCorner();
+    const Vector3D opposite = corner + inBox.getVector();
+    inoutMin = Vector3D(std::min(inoutMin.x(), corner.x()), std::min(inoutMin.y(), corner.y()), std::min(inoutMin.z(), corner.z()));
+    inoutMax = Vector3D(std::max(inoutMax.x(), opposite.x()), std::max(inoutMax.y(), opposite.y()), std::max(inoutMax.z(), opposite.z()));
+}
+
+AABB Model::calcPoseAABB(const Skeleton& inPose) const{
+    Vector3D minCorner(1e30f, 1e30f, 1e30f), maxCorner(-1e30f, -1e30f, -1e30f);
+    BOOST_FOREACH(const MeshPtr& nextMesh, mMeshes){
+        if(nextMesh->getIndexNum()) mergeAABB(minCorner, maxCorner, nextMesh->calcPoseAABB(inPose));
     }
+    if(minCorner.x() > maxCorner.x()) return AABB();
+    return AABB(minCorner, maxCorner - minCorner);
+}
+
+void Model::updateBounds() const{
+    Vector3D minCorner(1e30f, 1e30f, 1e30f), maxCorner(-1e30f, -1e30f, -1e30f);
+    BOOST_FOREACH(const MeshPtr& nextMesh, mMeshes){
+        nextMesh->updateBounds();
+        if(nextMesh->getIndexNum()) mergeAABB(minCorner, maxCorner, nextMesh->getAABB());
+    }
+    mAABB = (minCorner.x() > maxCorner.x())? AABB(): AABB(minCorner, maxCorner - minCorner);
+
+    //spheres of meshes are merged, result is limited by sphere around the box
+    mBoundingSphere = BoundingSphere();
+    bool first = true;
+    BOOST_FOREACH(const MeshPtr& nextMesh, mMeshes){
+        if(!nextMesh->getIndexNum()) continue;
+        if(first) mBoundingSphere = nextMesh->getBoundingSphere();
+        else mBoundingSphere.merge(nextMesh->getBoundingSphere());
+        first = false;
+    }
+    const float boxRadius = mAABB.getVector().getMagnitude() * 0.5f;
+    if(boxRadius < mBoundingSphere.getRadius()) mBoundingSphere = BoundingSphere(mAABB.getCenter(), boxRadius);
+    mBoundsValid = true;
+}
+
+void Model::invalidateBounds(){
+    mBoundsValid = false;
 }
 
 /*
@@ -0,0 +1,353 @@
+//NormalGenerator.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/NormalGenerator.hpp"
+#include "data/Mesh.hpp"
+#include "data/Vertex.hpp"
+#include "math/Vector3D.hpp"
+#include "math/Point.hpp"
+#include "common/ParallelFor.hpp"
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <boost/cstdint.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define NORMAL_GENERATOR_USE_SSE
+#endif
+
+using hydra::data::NormalGenerator;
+using hydra::data::Mesh;
+using hydra::data::Vertex;
+using hydra::math::Vector3D;
+using hydra::math::Point;
+
+namespace{
+
+//minimal number of faces or vertices handled by one thread
+const size_t MIN_PARALLEL_RANGE = 4096;
+
+//face normals in SoA layout
+struct FaceNormals{
+    //unnormalized normals (length is twice the area of face)
+    std::vector<float> x, y, z;
+    //reciprocal lengths (0 for degenerate faces)
+    std::vector<float> invLength;
+};
+
+//computes face normals for range of faces
+struct FaceNormalTask{
+    const Vertex* vertices;
+    const Mesh::index_t* faces;
+    FaceNormals* normals;
+
+    void operator()(size_t inBegin, size_t inEnd) const{
+        size_t f = inBegin;
+#ifdef NORMAL_GENERATOR_USE_SSE
+        for(; f + 4 <= inEnd; f += 4){
+            float ax[4], ay[4], az[4], bx[4], by[4], bz[4], cx[4], cy[4], cz[4];
+            for(size_t k = 0; k < 4; ++k){
+                const Point& a = vertices[faces[3 * (f + k)]].mCoord;
+                const Point& b = vertices[faces[3 * (f + k) + 1]].mCoord;
+                const Point& c = vertices[faces[3 * (f + k) + 2]].mCoord;
+                ax[k] = a.x; ay[k] = a.y; az[k] = a.z;
+                bx[k] = b.x; by[k] = b.y; bz[k] = b.z;
+                cx[k] = c.x; cy[k] = c.y; cz[k] = c.z;
+            }
+            __m128 vax = _mm_loadu_ps(ax), vay = _mm_loadu_ps(ay), vaz = _mm_loadu_ps(az);
+            __m128 e1x = _mm_sub_ps(_mm_loadu_ps(bx), vax);
+            __m128 e1y = _mm_sub_ps(_mm_loadu_ps(by), vay);
+            __m128 e1z = _mm_sub_ps(_mm_loadu_ps(bz), vaz);
+            __m128 e2x = _mm_sub_ps(_mm_loadu_ps(cx), vax);
+            __m128 e2y = _mm_sub_ps(_mm_loadu_ps(cy), vay);
+            __m128 e2z = _mm_sub_ps(_mm_loadu_ps(cz), vaz);
+
+            //same operations (and rounding) as Vector3D::cross
+            __m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+            __m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+            __m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+
+            __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+            __m128 nonZero = _mm_cmpgt_ps(lengthSq, _mm_setzero_ps());
+            __m128 invLength = _mm_and_ps(nonZero, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSq)));
+
+            _mm_storeu_ps(&normals->x[f], nx);
+            _mm_storeu_ps(&normals->y[f], ny);
+            _mm_storeu_ps(&normals->z[f], nz);
+            _mm_storeu_ps(&normals->invLength[f], invLength);
+        }
+#endif
+        for(; f < inEnd; ++f){
+            const Point& a = vertices[faces[3 * f]].mCoord;
+            const Point& b = vertices[faces[3 * f + 1]].mCoord;
+            const Point& c = vertices[faces[3 * f + 2]].mCoord;
+            Vector3D normal = Vector3D(b.x - a.x, b.y - a.y, b.z - a.z).cross(Vector3D(c.x - a.x, c.y - a.y, c.z - a.z));
+            float length = normal.getMagnitude();
+            normals->x[f] = normal.x();
+            normals->y[f] = normal.y();
+            normals->z[f] = normal.z();
+            normals->invLength[f] = (length > 0.0f)? (1.0f / length): 0.0f;
+        }
+    }
+};
+
+//computes normals of vertices (or of vertex corners if splitting is on)
+struct VertexNormalTask{
+    const Vertex* vertices;
+    const Mesh::index_t* faces;
+    const FaceNormals* normals;
+    const boost::uint32_t* offsets;
+    const boost::uint32_t* corners;
+    NormalGenerator::Weighting weighting;
+    float cosSmoothingAngle;
+
+    //output for smooth normals (one per vertex)
+    Vertex* outVertices;
+    //output for split normals (one per corner); not used if 0
+    Vector3D* outCornerNormals;
+
+    //returns weighted contribution of face corner
+    inline Vector3D getContribution(boost::uint32_t inCorner) const{
+        const size_t f = inCorner / 3;
+        if(weighting == NormalGenerator::AREA_WEIGHTED){
+            return Vector3D(normals->x[f], normals->y[f], normals->z[f]);
+        }
+
+        //angle of face at vertex
+        const size_t k = inCorner % 3;
+        const Point& p = vertices[faces[3 * f + k]].mCoord;
+        const Point& p1 = vertices[faces[3 * f + (k + 1) % 3]].mCoord;
+        const Point& p2 = vertices[faces[3 * f + (k + 2) % 3]].mCoord;
+        Vector3D e1(p1.x - p.x, p1.y - p.y, p1.z - p.z);
+        Vector3D e2(p2.x - p.x, p2.y - p.y, p2.z - p.z);
+        float lengths = e1.getMagnitude() * e2.getMagnitude();
+        if(!(lengths > 0.0f)) return Vector3D();
+        float angle = acosf(std::max(-1.0f, std::min(1.0f, (e1 * e2) / lengths)));
+
+        float scale = angle * normals->invLength[f];
+        return Vector3D(normals->x[f] * scale, normals->y[f] * scale, normals->z[f] * scale);
+    }
+
+    //cosine of angle between normals of 2 faces
+    inline float getCos(size_t inFace1, size_t inFace2) const{
+        return (normals->x[inFace1] * normals->x[inFace2] + normals->y[inFace1] * normals->y[inFace2] +
+                normals->z[inFace1] * normals->z[inFace2]) * normals->invLength[inFace1] * normals->invLength[inFace2];
+    }
+
+    void operator()(size_t inBegin, size_t inEnd) const{
+        for(size_t v = inBegin; v < inEnd; ++v){
+            const boost::uint32_t begin = offsets[v];
+            const boost::uint32_t end = offsets[v + 1];
+
+            if(!outCornerNormals){
+                Vector3D normal(0.0f, 0.0f, 0.0f);
+                for(boost::uint32_t i = begin; i < end; ++i) normal += getContribution(corners[i]);
+                normal.normalize();
+                outVertices[v].mNormal = normal;
+                continue;
+            }
+
+            //each corner gathers faces which are smooth relative to its own face
+            for(boost::uint32_t i = begin; i < end; ++i){
+                const size_t face = corners[i] / 3;
+                Vector3D normal(0.0f, 0.0f, 0.0f);
+                for(boost::uint32_t j = begin; j < end; ++j){
+                    if(j == i || getCos(face, corners[j] / 3) >= cosSmoothingAngle) normal += getContribution(corners[j]);
+                }
+                normal.normalize();
+                outCornerNormals[corners[i]] = normal;
+            }
+        }
+    }
+};
+
+inline bool equalNormals(const Vector3D& inNormal1, const Vector3D& inNormal2){
+    return inNormal1.x() == inNormal2.x() && inNormal1.y() == inNormal2.y() && inNormal1.z() == inNormal2.z();
+}
+
+} //unnamed namespace
+
+NormalGenerator::NormalGenerator(const NormalGenerator::Properties& inProps): mProps(inProps){
+
+}
+
+void NormalGenerator::generate(Mesh& inoutMesh) const{
+    if(inoutMesh.mMode != Mesh::TRIANGLE_STRIP && inoutMesh.mMode != Mesh::TRIANGLE_LIST) return;
+
+    const size_t vertexNum = inoutMesh.getVertexNum();
+    Mesh::IndexCont indices;
+    inoutMesh.mIndices.copyTo(indices);
+
+    //faces as triples of indices
+    //strips are converted to lists (with respect to orientation)
+    Mesh::IndexCont stripFaces;
+    const Mesh::index_t* faces = 0;
+    size_t faceNum = 0;
+
+    if(inoutMesh.mMode == Mesh::TRIANGLE_LIST){
+        faceNum = indices.size() / 3;
+        if(faceNum) faces = &indices[0];
+    }
+    else if(indices.size() >= 3){
+        faceNum = indices.size() - 2;
+        stripFaces.resize(faceNum * 3);
+        for(size_t i = 0; i < faceNum; ++i){
+            //odd triangles have opposite orientation
+            stripFaces[3 * i] = indices[(i % 2 == 0)? i: i + 2];
+            stripFaces[3 * i + 1] = indices[i + 1];
+            stripFaces[3 * i + 2] = indices[(i % 2 == 0)? i + 2: i];
+        }
+        faces = &stripFaces[0];
+    }
+
+    if(!faceNum){
+        for(size_t i = 0; i < vertexNum; ++i) inoutMesh.mVertices[i].mNormal = Vector3D(0.0f, 0.0f, 0.0f);
+        return;
+    }
+
+    const bool split = (mProps.smoothingAngle > 0.0f && inoutMesh.mMode == Mesh::TRIANGLE_LIST);
+    const unsigned int threadNum = (mProps.threadNum > 0)? mProps.threadNum: hydra::common::getHardwareThreadNum();
+
+    //adjacency pays off only in parallel; serial area weighting is a simple scatter
+    //(it gives exactly the same result as faces are handled in the same order)
+    if(!split && mProps.weighting == AREA_WEIGHTED && (threadNum == 1 || vertexNum < MIN_PARALLEL_RANGE)){
+        Vertex* vertices = &inoutMesh.mVertices[0];
+        for(size_t i = 0; i < vertexNum; ++i) vertices[i].mNormal = Vector3D(0.0f, 0.0f, 0.0f);
+        for(size_t f = 0; f < faceNum; ++f){
+            Vertex& a = vertices[faces[3 * f]];
+            Vertex& b = vertices[faces[3 * f + 1]];
+            Vertex& c = vertices[faces[3 * f + 2]];
+            Vector3D contribution = Vector3D(b.mCoord.x - a.mCoord.x, b.mCoord.y - a.mCoord.y, b.mCoord.z - a.mCoord.z).cross(
+                    Vector3D(c.mCoord.x - a.mCoord.x, c.mCoord.y - a.mCoord.y, c.mCoord.z - a.mCoord.z));
+            a.mNormal += contribution;
+            b.mNormal += contribution;
+            c.mNormal += contribution;
+        }
+        for(size_t i = 0; i < vertexNum; ++i) vertices[i].mNormal.normalize();
+        return;
+    }
+
+    //vertex to face adjacency (CSR); corners are stored in order of faces
+    std::vector<boost::uint32_t> offsets(vertexNum + 1, 0);
+    for(size_t i = 0; i < faceNum * 3; ++i){
+        assert(faces[i] < vertexNum);
+        ++offsets[faces[i] + 1];
+    }
+    for(size_t i = 0; i < vertexNum; ++i) offsets[i + 1] += offsets[i];
+
+    std::vector<boost::uint32_t> corners(faceNum * 3);
+    {
+        std::vector<boost::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < faceNum * 3; ++i) corners[fill[faces[i]]++] = static_cast<boost::uint32_t>(i);
+    }
+
+    //face normals
+    FaceNormals normals;
+    normals.x.resize(faceNum);
+    normals.y.resize(faceNum);
+    normals.z.resize(faceNum);
+    normals.invLength.resize(faceNum);
+
+    FaceNormalTask faceTask;
+    faceTask.vertices = &inoutMesh.mVertices[0];
+    faceTask.faces = faces;
+    faceTask.normals = &normals;
+    hydra::common::parallelFor(0, faceNum, faceTask, threadNum, MIN_PARALLEL_RANGE);
+
+    //vertex normals
+    std::vector<Vector3D> cornerNormals(split? faceNum * 3: 0);
+
+    VertexNormalTask vertexTask;
+    vertexTask.vertices = &inoutMesh.mVertices[0];
+    vertexTask.faces = faces;
+    vertexTask.normals = &normals;
+    vertexTask.offsets = &offsets[0];
+    vertexTask.corners = &corners[0];
+    vertexTask.weighting = mProps.weighting;
+    vertexTask.cosSmoothingAngle = cosf(mProps.smoothingAngle);
+    vertexTask.outVertices = &inoutMesh.mVertices[0];
+    vertexTask.outCornerNormals = split? &cornerNormals[0]: 0;
+    hydra::common::parallelFor(0, vertexNum, vertexTask, threadNum, MIN_PARALLEL_RANGE);
+
+    if(!split) return;
+
+    //split vertices which have several different corner normals
+    const bool hasBones = (inoutMesh.mBones.size() == vertexNum && inoutMesh.mBoneWeights.size() == vertexNum);
+    std::vector<Mesh::index_t> variants;
+
+    for(size_t v = 0; v < vertexNum; ++v){
+        if(offsets[v] == offsets[v + 1]) inoutMesh.mVertices[v].mNormal = Vector3D(0.0f, 0.0f, 0.0f);
+        variants.clear();
+        for(boost::uint32_t i = offsets[v]; i < offsets[v + 1]; ++i){
+            const boost::uint32_t corner = corners[i];
+            const Vector3D& normal = cornerNormals[corner];
+
+            Mesh::index_t target = Mesh::UNUSED_INDEX;
+            for(size_t j = 0; j < variants.size(); ++j){
+                if(equalNormals(inoutMesh.mVertices[variants[j]].mNormal, normal)){
+                    target = variants[j];
+                    break;
+                }
+            }
+
+            if(target == Mesh::UNUSED_INDEX){
+                if(variants.empty()){
+                    target = static_cast<Mesh::index_t>(v);
+                }
+                else{
+                    target = static_cast<Mesh::index_t>(inoutMesh.mVertices.size());
+                    Vertex copy = inoutMesh.mVertices[v];
+                    inoutMesh.mVertices.push_back(copy);
+                    if(hasBones){
+                        Mesh::BoneIndices bones = inoutMesh.mBones[v];
+                        Mesh::BoneWeights weights = inoutMesh.mBoneWeights[v];
+                        inoutMesh.mBones.push_back(bones);
+                        inoutMesh.mBoneWeights.push_back(weights);
+                    }
+                }
+                inoutMesh.mVertices[target].mNormal = normal;
+                variants.push_back(target);
+            }
+            inoutMesh.mIndices.set(corner, target);
+        }
+    }
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,424 @@
+//PoseComposer.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/PoseComposer.hpp"
+#include "data/MeshSkinner.hpp"
+#include "data/Skeleton.hpp"
+#include "data/Bone.hpp"
+#include "data/Pose.hpp"
+#include "math/Vector3D.hpp"
+#include "math/Quat.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define POSE_COMPOSER_USE_SSE
+#endif
+
+using hydra::data::PoseComposer;
+using hydra::data::MeshSkinner;
+using hydra::data::Skeleton;
+using hydra::data::Pose;
+using hydra::math::Vector3D;
+using hydra::math::Quat;
+
+namespace{
+
+//components of transformation in arrays of composer
+enum Component{
+    QX = 0, QY, QZ, QW, PX, PY, PZ, COMPONENT_NUM
+};
+
+//4 floats processed together
+#ifdef POSE_COMPOSER_USE_SSE
+
+struct Float4{
+    __m128 v;
+};
+
+inline Float4 make(__m128 inValue){
+    Float4 result = {inValue};
+    return result;
+}
+
+inline Float4 load(const float* inData){
+    return make(_mm_loadu_ps(inData));
+}
+
+inline void store(const Float4& inValue, float* outData){
+    _mm_storeu_ps(outData, inValue.v);
+}
+
+inline Float4 set(float in0, float in1, float in2, float in3){
+    return make(_mm_setr_ps(in0, in1, in2, in3));
+}
+
+inline Float4 splat(float inValue){
+    return make(_mm_set1_ps(inValue));
+}
+
+inline Float4 operator+(const Float4& lhv, const Float4& rhv){
+    return make(_mm_add_ps(lhv.v, rhv.v));
+}
+
+inline Float4 operator-(const Float4& lhv, const Float4& rhv){
+    return make(_mm_sub_ps(lhv.v, rhv.v));
+}
+
+inline Float4 operator*(const Float4& lhv, const Float4& rhv){
+    return make(_mm_mul_ps(lhv.v, rhv.v));
+}
+
+inline Float4 invSqrt(const Float4& inValue){
+    return make(_mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(inValue.v)));
+}
+
+#else
+
+struct Float4{
+    float v[4];
+};
+
+inline Float4 load(const float* inData){
+    Float4 result = {{inData[0], inData[1], inData[2], inData[3]}};
+    return result;
+}
+
+inline void store(const Float4& inValue, float* outData){
+    for(int i = 0; i < 4; ++i) outData[i] = inValue.v[i];
+}
+
+inline Float4 set(float in0, float in1, float in2, float in3){
+    Float4 result = {{in0, in1, in2, in3}};
+    return result;
+}
+
+inline Float4 splat(float inValue){
+    return set(inValue, inValue, inValue, inValue);
+}
+
+inline Float4 operator+(const Float4& lhv, const Float4& rhv){
+    return set(lhv.v[0] + rhv.v[0], lhv.v[1] + rhv.v[1], lhv.v[2] + rhv.v[2], lhv.v[3] + rhv.v[3]);
+}
+
+inline Float4 operator-(const Float4& lhv, const Float4& rhv){
+    return set(lhv.v[0] - rhv.v[0], lhv.v[1] - rhv.v[1], lhv.v[2] - rhv.v[2], lhv.v[3] - rhv.v[3]);
+}
+
+inline Float4 operator*(const Float4& lhv, const Float4& rhv){
+    return set(lhv.v[0] * rhv.v[0], lhv.v[1] * rhv.v[1], lhv.v[2] * rhv.v[2], lhv.v[3] * rhv.v[3]);
+}
+
+inline Float4 invSqrt(const Float4& inValue){
+    return set(1.0f / sqrtf(inValue.v[0]), 1.0f / sqrtf(inValue.v[1]), 1.0f / sqrtf(inValue.v[2]), 1.0f / sqrtf(inValue.v[3]));
+}
+
+#endif
+
+//transformations of 4 bones
+struct Transform4{
+    Float4 q[4];
+    Float4 p[3];
+};
+
+//loads transformations at position of arrays
+inline Transform4 loadTransform(const float* inData, size_t inPaddedNum, size_t inPos){
+    Transform4 result;
+    for(int i = 0; i < 4; ++i) result.q[i] = load(inData + i * inPaddedNum + inPos);
+    for(int i = 0; i < 3; ++i) result.p[i] = load(inData + (PX + i) * inPaddedNum + inPos);
+    return result;
+}
+
+//loads transformations at 4 different positions of arrays
+inline Transform4 gatherTransform(const float* inData, size_t inPaddedNum, const size_t* inPos){
+    Transform4 result;
+    for(int i = 0; i < COMPONENT_NUM; ++i){
+        const float* component = inData + i * inPaddedNum;
+        const Float4 value = set(component[inPos[0]], component[inPos[1]], component[inPos[2]], component[inPos[3]]);
+        if(i < PX) result.q[i] = value;
+        else result.p[i - PX] = value;
+    }
+    return result;
+}
+
+inline void storeTransform(const Transform4& inTransform, float* outData, size_t inPaddedNum, size_t inPos){
+    for(int i = 0; i < 4; ++i) store(inTransform.q[i], outData + i * inPaddedNum + inPos);
+    for(int i = 0; i < 3; ++i) store(inTransform.p[i], outData + (PX + i) * inPaddedNum + inPos);
+}
+
+//transformation by inChild, then by inParent (rotation is normalized)
+inline Transform4 combine(const Transform4& inParent, const Transform4& inChild){
+    const Float4* a = inParent.q;
+    const Float4* b = inChild.q;
+    Transform4 result;
+    result.q[QX] = a[QW] * b[QX] + a[QX] * b[QW] + a[QY] * b[QZ] - a[QZ] * b[QY];
+    result.q[QY] = a[QW] * b[QY] + a[QY] * b[QW] + a[QZ] * b[QX] - a[QX] * b[QZ];
+    result.q[QZ] = a[QW] * b[QZ] + a[QZ] * b[QW] + a[QX] * b[QY] - a[QY] * b[QX];
+    result.q[QW] = a[QW] * b[QW] - a[QX] * b[QX] - a[QY] * b[QY] - a[QZ] * b[QZ];
+    const Float4 scale = invSqrt(result.q[QX] * result.q[QX] + result.q[QY] * result.q[QY] +
+                                 result.q[QZ] * result.q[QZ] + result.q[QW] * result.q[QW]);
+    for(int i = 0; i < 4; ++i) result.q[i] = result.q[i] * scale;
+
+    //position of child is rotated by parent: v + w * t + q x t, where t = 2 * q x v
+    const Float4* v = inChild.p;
+    const Float4 two = splat(2.0f);
+    const Float4 tx = two * (a[QY] * v[2] - a[QZ] * v[1]);
+    const Float4 ty = two * (a[QZ] * v[0] - a[QX] * v[2]);
+    const Float4 tz = two * (a[QX] * v[1] - a[QY] * v[0]);
+    result.p[0] = v[0] + a[QW] * tx + (a[QY] * tz - a[QZ] * ty) + inParent.p[0];
+    result.p[1] = v[1] + a[QW] * ty + (a[QZ] * tx - a[QX] * tz) + inParent.p[1];
+    result.p[2] = v[2] + a[QW] * tz + (a[QX] * ty - a[QY] * tx) + inParent.p[2];
+    return result;
+}
+
+//copies transformations of pose to arrays in order of composer
+void loadPose(const Pose& inPose, const std::vector<size_t>& inOrder, size_t inPaddedNum, float* outData){
+    if(inPose.getBoneNum() < inOrder.size()) throw std::out_of_range("pose has less bones than skeleton");
+    for(size_t i = 0; i < inOrder.size(); ++i){
+        const Quat& orient = inPose.mOrients[inOrder[i]];
+        const Vector3D& pos = inPose.mPositions[inOrder[i]];
+        outData[QX * inPaddedNum + i] = orient.getVec().x();
+        outData[QY * inPaddedNum + i] = orient.getVec().y();
+        outData[QZ * inPaddedNum + i] = orient.getVec().z();
+        outData[QW * inPaddedNum + i] = orient.getScalar();
+        outData[PX * inPaddedNum + i] = pos.x();
+        outData[PY * inPaddedNum + i] = pos.y();
+        outData[PZ * inPaddedNum + i] = pos.z();
+    }
+}
+
+//sets identity transformation at position of arrays
+void setIdentity(float* outData, size_t inPaddedNum, size_t inPos){
+    for(int i = 0; i < COMPONENT_NUM; ++i) outData[i * inPaddedNum + inPos] = (i == QW)? 1.0f: 0.0f;
+}
+
+} //anonymous namespace
+
+PoseComposer::PoseComposer(): mPaddedNum(0){
+
+}
+
+void PoseComposer::setup(const Skeleton& inSkeleton){
+    const size_t boneNum = inSkeleton.mBones.size();
+
+    //depth of bones (wrong parents and cycles make roots)
+    std::vector<size_t> depths(boneNum, 0);
+    size_t maxDepth = 0;
+    for(size_t i = 0; i < boneNum; ++i){
+        size_t depth = 0;
+        int parent = inSkeleton.mBones[i].mParent;
+        while(parent >= 0 && static_cast<size_t>(parent) < boneNum && depth <= boneNum){
+            ++depth;
+            parent = inSkeleton.mBones[parent].mParent;
+        }
+        depths[i] = (depth > boneNum)? 0: depth;
+        maxDepth = std::max(maxDepth, depths[i]);
+    }
+
+    //bones sorted by depth (counting sort keeps order of skeleton inside of levels)
+    mLevels.assign(boneNum? maxDepth + 2: 0, 0);
+    for(size_t i = 0; i < boneNum; ++i) ++mLevels[depths[i] + 1];
+    for(size_t i = 1; i < mLevels.size(); ++i) mLevels[i] += mLevels[i - 1];
+    std::vector<size_t> positions(boneNum);
+    std::vector<size_t> next(mLevels);
+    mOrder.resize(boneNum);
+    for(size_t i = 0; i < boneNum; ++i){
+        positions[i] = next[depths[i]]++;
+        mOrder[positions[i]] = i;
+    }
+
+    //4 lanes may cross the end by 3 bones, identity slot follows them
+    mPaddedNum = (boneNum + 4 + 3) / 4 * 4;
+    const size_t identitySlot = boneNum + 3;
+    mParents.assign(mPaddedNum, identitySlot);
+    for(size_t i = 0; i < boneNum; ++i){
+        const int parent = inSkeleton.mBones[mOrder[i]].mParent;
+        if(depths[mOrder[i]] > 0) mParents[i] = positions[parent];
+    }
+
+    mLocal.assign(COMPONENT_NUM * mPaddedNum, 0.0f);
+    mComposed.assign(COMPONENT_NUM * mPaddedNum, 0.0f);
+    setIdentity(&mComposed[0], mPaddedNum, identitySlot);
+
+    //inverse bind pose: conjugated orientation and rotated back negated position
+    mInverseBind.assign(COMPONENT_NUM * mPaddedNum, 0.0f);
+    for(size_t i = 0; i < mPaddedNum; ++i) setIdentity(&mInverseBind[0], mPaddedNum, i);
+    for(size_t i = 0; i < boneNum; ++i){
+        Quat inverse = inSkeleton.mBones[mOrder[i]].mOrient;
+        inverse.normalize();
+        inverse.setVec(inverse.getVec() * -1.0f);
+        Vector3D pos = inSkeleton.mBones[mOrder[i]].mPos * -1.0f;
+        inverse.rotate(pos);
+        mInverseBind[QX * mPaddedNum + i] = inverse.getVec().x();
+        mInverseBind[QY * mPaddedNum + i] = inverse.getVec().y();
+        mInverseBind[QZ * mPaddedNum + i] = inverse.getVec().z();
+        mInverseBind[QW * mPaddedNum + i] = inverse.getScalar();
+        mInverseBind[PX * mPaddedNum + i] = pos.x();
+        mInverseBind[PY * mPaddedNum + i] = pos.y();
+        mInverseBind[PZ * mPaddedNum + i] = pos.z();
+    }
+}
+
+void PoseComposer::compose(const Pose& inLocal, Pose& outModel) const{
+    composeTo(inLocal, MODEL, &outModel, 0);
+}
+
+void PoseComposer::composeRelative(const Pose& inLocal, Pose& outRelative) const{
+    composeTo(inLocal, RELATIVE, &outRelative, 0);
+}
+
+void PoseComposer::composePalette(const Pose& inLocal, MeshSkinner::Palette& outPalette) const{
+    composeTo(inLocal, PALETTE, 0, &outPalette);
+}
+
+void PoseComposer::makeRelative(const Pose& inModel, Pose& outRelative) const{
+    const size_t boneNum = mOrder.size();
+    if(!boneNum){
+        outRelative.setIdentity(0);
+        return;
+    }
+    loadPose(inModel, mOrder, mPaddedNum, &mComposed[0]);
+    setIdentity(&mComposed[0], mPaddedNum, boneNum + 3);
+
+    outRelative.mPositions.resize(boneNum);
+    outRelative.mOrients.resize(boneNum);
+    float values[COMPONENT_NUM][4];
+    for(size_t i = 0; i < boneNum; i += 4){
+        const Transform4 relative = combine(loadTransform(&mComposed[0], mPaddedNum, i), loadTransform(&mInverseBind[0], mPaddedNum, i));
+        for(int k = 0; k < 4; ++k) store(relative.q[k], values[k]);
+        for(int k = 0; k < 3; ++k) store(relative.p[k], values[PX + k]);
+        for(size_t lane = 0; lane < 4 && i + lane < boneNum; ++lane){
+            Quat& orient = outRelative.mOrients[mOrder[i + lane]];
+            Vector3D& pos = outRelative.mPositions[mOrder[i + lane]];
+            Vector3D vec = orient.getVec();
+            vec.setX(values[QX][lane]);
+            vec.setY(values[QY][lane]);
+            vec.setZ(values[QZ][lane]);
+            orient.setVec(vec);
+            orient.setScalar(values[QW][lane]);
+            pos.setX(values[PX][lane]);
+            pos.setY(values[PY][lane]);
+            pos.setZ(values[PZ][lane]);
+        }
+    }
+}
+
+void PoseComposer::composeTo(const Pose& inLocal, PoseComposer::Output inOutput, Pose* outPose, MeshSkinner::Palette* outPalette) const{
+    const size_t boneNum = mOrder.size();
+    if(outPose){
+        outPose->mPositions.resize(boneNum);
+        outPose->mOrients.resize(boneNum);
+    }
+    if(outPalette) outPalette->resize(boneNum);
+    if(!boneNum) return;
+
+    //local transformations are combined with parents level by level,
+    //lanes after the end of level are recalculated with the next level
+    loadPose(inLocal, mOrder, mPaddedNum, &mLocal[0]);
+    float* composed = &mComposed[0];
+    for(size_t level = 0; level + 1 < mLevels.size(); ++level){
+        for(size_t i = mLevels[level]; i < mLevels[level + 1]; i += 4){
+            const Transform4 parent = gatherTransform(composed, mPaddedNum, &mParents[i]);
+            storeTransform(combine(parent, loadTransform(&mLocal[0], mPaddedNum, i)), composed, mPaddedNum, i);
+        }
+    }
+
+    float values[COMPONENT_NUM][4];
+    for(size_t i = 0; i < boneNum; i += 4){
+        Transform4 result = loadTransform(composed, mPaddedNum, i);
+        if(inOutput != MODEL) result = combine(result, loadTransform(&mInverseBind[0], mPaddedNum, i));
+        const size_t laneNum = std::min<size_t>(4, boneNum - i);
+
+        if(inOutput == PALETTE){
+            //columns of rotation matrix and translation
+            const Float4* q = result.q;
+            const Float4 one = splat(1.0f);
+            const Float4 two = splat(2.0f);
+            const Float4 xx = q[QX] * q[QX], yy = q[QY] * q[QY], zz = q[QZ] * q[QZ];
+            const Float4 xy = q[QX] * q[QY], xz = q[QX] * q[QZ], yz = q[QY] * q[QZ];
+            const Float4 wx = q[QW] * q[QX], wy = q[QW] * q[QY], wz = q[QW] * q[QZ];
+            Float4 columns[4][3];
+            columns[0][0] = one - two * (yy + zz);
+            columns[0][1] = two * (xy + wz);
+            columns[0][2] = two * (xz - wy);
+            columns[1][0] = two * (xy - wz);
+            columns[1][1] = one - two * (xx + zz);
+            columns[1][2] = two * (yz + wx);
+            columns[2][0] = two * (xz + wy);
+            columns[2][1] = two * (yz - wx);
+            columns[2][2] = one - two * (xx + yy);
+            for(int k = 0; k < 3; ++k) columns[3][k] = result.p[k];
+
+            float lanes[4][3][4];
+            for(int c = 0; c < 4; ++c){
+                for(int k = 0; k < 3; ++k) store(columns[c][k], lanes[c][k]);
+            }
+            for(size_t lane = 0; lane < laneNum; ++lane){
+                float* matrix = outPalette->getMatrix(mOrder[i + lane]);
+                for(int c = 0; c < 4; ++c){
+                    matrix[4 * c] = lanes[c][0][lane];
+                    matrix[4 * c + 1] = lanes[c][1][lane];
+                    matrix[4 * c + 2] = lanes[c][2][lane];
+                    matrix[4 * c + 3] = (c == 3)? 1.0f: 0.0f;
+                }
+            }
+            continue;
+        }
+
+        for(int k = 0; k < 4; ++k) store(result.q[k], values[k]);
+        for(int k = 0; k < 3; ++k) store(result.p[k], values[PX + k]);
+        for(size_t lane = 0; lane < laneNum; ++lane){
+            Quat& orient = outPose->mOrients[mOrder[i + lane]];
+            Vector3D& pos = outPose->mPositions[mOrder[i + lane]];
+            Vector3D vec = orient.getVec();
+            vec.setX(values[QX][lane]);
+            vec.setY(values[QY][lane]);
+            vec.setZ(values[QZ][lane]);
+            orient.setVec(vec);
+            orient.setScalar(values[QW][lane]);
+            pos.setX(values[PX][lane]);
+            pos.setY(values[PY][lane]);
+            pos.setZ(values[PZ][lane]);
+        }
+    }
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
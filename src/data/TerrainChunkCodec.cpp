@@ -0,0 +1,289 @@
+//TerrainChunkCodec.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/TerrainChunkCodec.hpp"
+#include "VarintCodec.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define TERRAIN_CHUNK_CODEC_USE_SSE2
+#endif
+
+using hydra::data::TerrainChunkCodec;
+using hydra::data::TerrainChunk;
+using namespace hydra::VarintCodec;
+
+namespace{
+
+typedef TerrainChunk::index_t index_t;
+
+//number of literals which share mask of high bytes
+const size_t GROUP_SIZE = 8;
+
+//zigzag of 16-bit difference of value and predictor
+inline boost::uint16_t zigzag(index_t inValue, index_t inPredictor){
+    return hydra::VarintCodec::zigzag(static_cast<boost::int16_t>(inValue - inPredictor));
+}
+
+//numbers of literals for 6 bits of triangle's code
+const unsigned char LITERAL_NUMS[64] = {
+    3, 2, 2, 2, 2, 1, 1, 1, 2, 1, 1, 1, 2, 1, 1, 1,
+    2, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0,
+    2, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0,
+    2, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0
+};
+
+inline unsigned int countBits(unsigned int inByte){
+    inByte = inByte - ((inByte >> 1) & 0x55);
+    inByte = (inByte & 0x33) + ((inByte >> 2) & 0x33);
+    return (inByte + (inByte >> 4)) & 0x0f;
+}
+
+//returns source of vertex (see class description) which is stored in code
+inline unsigned int getSource(unsigned int inCode, size_t inVertex){
+    return (inCode >> (inVertex * 2)) & 3;
+}
+
+//decodes differences of literals from byte planes
+void decodeDifferences(const unsigned char* inMasks, const unsigned char* inLows, const unsigned char* inHighs,
+                       size_t inHighNum, size_t inNum, index_t* outDifferences){
+    const size_t FULL_GROUP_NUM = inNum / GROUP_SIZE;
+#ifdef TERRAIN_CHUNK_CODEC_USE_SSE2
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i zero = _mm_setzero_si128();
+    const unsigned char* highEnd = inHighs + inHighNum;
+    for(size_t g = 0; g < FULL_GROUP_NUM; ++g, inLows += GROUP_SIZE, outDifferences += GROUP_SIZE){
+        const unsigned int mask = inMasks[g];
+        __m128i high;
+        if(highEnd - inHighs >= static_cast<std::ptrdiff_t>(GROUP_SIZE)){
+            //high bytes are gathered without branches (all the reads are inside the data)
+            unsigned char highs[GROUP_SIZE];
+            unsigned int offset = 0;
+            for(unsigned int i = 0; i < GROUP_SIZE; ++i){
+                const unsigned int bit = (mask >> i) & 1;
+                highs[i] = static_cast<unsigned char>(inHighs[offset] & -static_cast<int>(bit));
+                offset += bit;
+            }
+            inHighs += offset;
+            high = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(highs));
+        }
+        else{
+            unsigned char highs[GROUP_SIZE] = {0};
+            for(unsigned int i = 0; i < GROUP_SIZE; ++i){
+                if(mask & (1u << i)) highs[i] = *inHighs++;
+            }
+            high = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(highs));
+        }
+        //8 x 16-bit zigzag values, then (value >> 1) ^ -(value & 1)
+        const __m128i value = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(inLows)), high);
+        const __m128i sign = _mm_sub_epi16(zero, _mm_and_si128(value, one));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(outDifferences), _mm_xor_si128(_mm_srli_epi16(value, 1), sign));
+    }
+#else
+    for(size_t g = 0; g < FULL_GROUP_NUM; ++g, inLows += GROUP_SIZE, outDifferences += GROUP_SIZE){
+        const unsigned int mask = inMasks[g];
+        for(size_t i = 0; i < GROUP_SIZE; ++i){
+            const unsigned int high = (mask & (1u << i))? *inHighs++: 0;
+            outDifferences[i] = static_cast<index_t>(unzigzag(static_cast<boost::uint16_t>(inLows[i] | (high << 8))));
+        }
+    }
+#endif
+
+    //incomplete group
+    const unsigned int mask = (inNum % GROUP_SIZE != 0)? inMasks[FULL_GROUP_NUM]: 0;
+    for(size_t i = 0; i < inNum % GROUP_SIZE; ++i){
+        const unsigned int high = (mask & (1u << i))? *inHighs++: 0;
+        outDifferences[i] = static_cast<index_t>(unzigzag(static_cast<boost::uint16_t>(inLows[i] | (high << 8))));
+    }
+}
+
+//builds triangle (or its first inVertexNum vertices) from code and differences of literals
+//inoutPrevious contains previous literal and vertices of previous triangle
+inline void decodeTriangle(unsigned int inCode, size_t inVertexNum, const index_t* inDifferences, size_t& inoutLiteral,
+                           index_t* inoutPrevious, index_t* outTriangle){
+    const unsigned int predictor = inCode >> 6;
+    index_t triangle[3] = {0, 0, 0};
+    for(size_t i = 0; i < inVertexNum; ++i){
+        const unsigned int source = getSource(inCode, i);
+        if(source != 0){
+            triangle[i] = inoutPrevious[source];
+            continue;
+        }
+        inoutPrevious[0] = static_cast<index_t>(inoutPrevious[predictor] + inDifferences[inoutLiteral++]);
+        triangle[i] = inoutPrevious[0];
+    }
+    for(size_t i = 0; i < inVertexNum; ++i) outTriangle[i] = triangle[i];
+    inoutPrevious[1] = triangle[0];
+    inoutPrevious[2] = triangle[1];
+    inoutPrevious[3] = triangle[2];
+}
+
+} //unnamed namespace
+
+void TerrainChunkCodec::encode(const index_t* inIndices, size_t inNum, std::vector<unsigned char>& outData){
+    std::vector<unsigned char> codes((inNum + 2) / 3);
+    std::vector<boost::uint16_t> literals;
+    literals.reserve(codes.size());
+
+    //0 - previous literal, 1-3 - vertices of previous triangle
+    index_t previous[4] = {0, 0, 0, 0};
+    for(size_t t = 0; t < codes.size(); ++t){
+        const index_t* triangle = inIndices + t * 3;
+        const size_t VERTEX_NUM = std::min<size_t>(3, inNum - t * 3);
+
+        unsigned int code = 0;
+        for(size_t i = 0; i < VERTEX_NUM; ++i){
+            unsigned int source = 0;
+            for(unsigned int j = 1; j <= 3 && source == 0; ++j){
+                if(triangle[i] == previous[j]) source = j;
+            }
+            code |= source << (i * 2);
+        }
+
+        //choose predictor which gives the least number of high bytes (and then the least values)
+        unsigned int bestPredictor = 0;
+        unsigned int bestCost = ~0u;
+        for(unsigned int predictor = 0; predictor < 4; ++predictor){
+            index_t last = previous[0];
+            unsigned int cost = 0;
+            for(size_t i = 0; i < VERTEX_NUM; ++i){
+                if(getSource(code, i) != 0) continue;
+                const boost::uint16_t value = zigzag(triangle[i], (predictor == 0)? last: previous[predictor]);
+                cost += (value > 0xff)? 0x10000 + value: value;
+                last = triangle[i];
+            }
+            if(cost < bestCost){
+                bestCost = cost;
+                bestPredictor = predictor;
+            }
+        }
+
+        for(size_t i = 0; i < VERTEX_NUM; ++i){
+            if(getSource(code, i) != 0) continue;
+            literals.push_back(zigzag(triangle[i], previous[bestPredictor]));
+            previous[0] = triangle[i];
+        }
+        codes[t] = static_cast<unsigned char>(code | (bestPredictor << 6));
+        std::copy(triangle, triangle + VERTEX_NUM, previous + 1);
+    }
+
+    const size_t GROUP_NUM = (literals.size() + GROUP_SIZE - 1) / GROUP_SIZE;
+    outData.reserve(outData.size() + codes.size() + GROUP_NUM + literals.size() * 2 + 10);
+    writeVarint(static_cast<boost::uint32_t>(inNum), outData);
+    writeVarint(static_cast<boost::uint32_t>(literals.size()), outData);
+    outData.insert(outData.end(), codes.begin(), codes.end());
+
+    for(size_t g = 0; g < GROUP_NUM; ++g){
+        unsigned int mask = 0;
+        for(size_t i = g * GROUP_SIZE; i < std::min(literals.size(), (g + 1) * GROUP_SIZE); ++i){
+            if(literals[i] > 0xff) mask |= 1u << (i % GROUP_SIZE);
+        }
+        outData.push_back(static_cast<unsigned char>(mask));
+    }
+    for(size_t i = 0; i < literals.size(); ++i) outData.push_back(static_cast<unsigned char>(literals[i] & 0xff));
+    for(size_t i = 0; i < literals.size(); ++i){
+        if(literals[i] > 0xff) outData.push_back(static_cast<unsigned char>(literals[i] >> 8));
+    }
+}
+
+void TerrainChunkCodec::encode(const TerrainChunk& inChunk, std::vector<unsigned char>& outData){
+    encode(inChunk.indices.empty()? 0: &inChunk.indices[0], inChunk.indices.size(), outData);
+}
+
+size_t TerrainChunkCodec::getIndexNum(const unsigned char* inData, size_t inSize){
+    const unsigned char* data = inData;
+    const unsigned char* end = inData + inSize;
+    const size_t num = readVarint(data, end, "TerrainChunkCodec");
+    //each triangle takes at least one byte
+    if((num + 2) / 3 > static_cast<size_t>(end - data)) throw std::runtime_error("TerrainChunkCodec: unexpected end of encoded data");
+    return num;
+}
+
+size_t TerrainChunkCodec::decode(const unsigned char* inData, size_t inSize, index_t* outIndices){
+    const unsigned char* data = inData;
+    const unsigned char* end = inData + inSize;
+    const size_t NUM = readVarint(data, end, "TerrainChunkCodec");
+    const size_t LITERAL_NUM = readVarint(data, end, "TerrainChunkCodec");
+    if(LITERAL_NUM > NUM) throw std::runtime_error("TerrainChunkCodec: corrupted encoded data");
+
+    const size_t TRIANGLE_NUM = (NUM + 2) / 3;
+    const size_t GROUP_NUM = (LITERAL_NUM + GROUP_SIZE - 1) / GROUP_SIZE;
+    if(TRIANGLE_NUM + GROUP_NUM + LITERAL_NUM > static_cast<size_t>(end - data)){
+        throw std::runtime_error("TerrainChunkCodec: unexpected end of encoded data");
+    }
+    const unsigned char* codes = data;
+    const unsigned char* masks = codes + TRIANGLE_NUM;
+    const unsigned char* lows = masks + GROUP_NUM;
+    const unsigned char* highs = lows + LITERAL_NUM;
+    size_t highNum = 0;
+    for(size_t g = 0; g < GROUP_NUM; ++g) highNum += countBits(masks[g]);
+    if(highNum > static_cast<size_t>(end - highs)) throw std::runtime_error("TerrainChunkCodec: unexpected end of encoded data");
+
+    //differences are decoded to the tail of output: number of copied vertices never
+    //exceeds NUM - LITERAL_NUM, so difference is read before its place is overwritten
+    index_t* differences = outIndices + (NUM - LITERAL_NUM);
+    decodeDifferences(masks, lows, highs, highNum, LITERAL_NUM, differences);
+
+    //number of literals in codes must be equal to stored one, so all the reads below are inside output
+    size_t literalSlotNum = 0;
+    for(size_t t = 0; t < NUM / 3; ++t) literalSlotNum += LITERAL_NUMS[codes[t] & 0x3f];
+    for(size_t i = 0; i < NUM % 3; ++i) literalSlotNum += (getSource(codes[NUM / 3], i) == 0);
+    if(literalSlotNum != LITERAL_NUM) throw std::runtime_error("TerrainChunkCodec: corrupted encoded data");
+
+    //0 - previous literal, 1-3 - vertices of previous triangle
+    index_t previous[4] = {0, 0, 0, 0};
+    size_t literal = 0;
+    for(size_t t = 0; t < NUM / 3; ++t, outIndices += 3) decodeTriangle(codes[t], 3, differences, literal, previous, outIndices);
+    if(NUM % 3 != 0) decodeTriangle(codes[NUM / 3], NUM % 3, differences, literal, previous, outIndices);
+
+    return (highs + highNum) - inData;
+}
+
+size_t TerrainChunkCodec::decode(const unsigned char* inData, size_t inSize, TerrainChunk& outChunk){
+    outChunk.indices.resize(getIndexNum(inData, inSize));
+    if(outChunk.indices.empty()){
+        index_t dummy;
+        return decode(inData, inSize, &dummy);
+    }
+    return decode(inData, inSize, &outChunk.indices[0]);
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,169 @@
+//TerrainVertexCodec.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/TerrainVertexCodec.hpp"
+
+#include <cmath>
+#include <cassert>
+#include <limits>
+#include <algorithm>
+
+using hydra::data::TerrainVertexCodec;
+using hydra::data::TerrainFragment;
+using hydra::data::Vertex;
+using hydra::math::Vector3D;
+
+namespace{
+
+const float MAX_UNORM16 = 65535.0f;
+const float MAX_SNORM8 = 127.0f;
+const float INV_MAX_SNORM8 = 1.0f / MAX_SNORM8;
+
+inline boost::int8_t toSnorm8(float inValue){
+    inValue = std::min(std::max(inValue, -1.0f), 1.0f) * MAX_SNORM8;
+    return static_cast<boost::int8_t>(inValue >= 0.0f ? inValue + 0.5f : inValue - 0.5f);
+}
+
+//decodes octahedral normal (y is up), returns normalized vector
+//fold is done without branches (-1 and 1 are chosen by copysign)
+inline void decodeNormal(boost::int8_t inU, boost::int8_t inV, float& outX, float& outY, float& outZ){
+    float x = std::max(inU * INV_MAX_SNORM8, -1.0f);
+    float z = std::max(inV * INV_MAX_SNORM8, -1.0f);
+    const float y = 1.0f - fabsf(x) - fabsf(z);
+    const float fold = std::max(-y, 0.0f);
+    x += (x >= 0.0f) ? -fold : fold;
+    z += (z >= 0.0f) ? -fold : fold;
+    const float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+    outX = x * invLength;
+    outY = y * invLength;
+    outZ = z * invLength;
+}
+
+} //unnamed namespace
+
+void TerrainVertexCodec::getHeightBounds(const TerrainFragment& inFragment, float& outMinHeight, float& outHeightRange){
+    assert(inFragment.tree);
+    float minHeight = std::numeric_limits<float>::max();
+    float maxHeight = -std::numeric_limits<float>::max();
+    for(TerrainFragment::QuadTreeOfChunks::const_iterator iter = inFragment.tree->begin(); iter != inFragment.tree->end(); ++iter){
+        const float corner = iter->data.aabb.getCorner().y();
+        const float vec = iter->data.aabb.getVector().y();
+        minHeight = std::min(minHeight, std::min(corner, corner + vec));
+        maxHeight = std::max(maxHeight, std::max(corner, corner + vec));
+    }
+    if(minHeight > maxHeight){
+        minHeight = maxHeight = 0.0f;
+    }
+    outMinHeight = minHeight;
+    outHeightRange = maxHeight - minHeight;
+}
+
+void TerrainVertexCodec::pack(const TerrainFragment::CompressedVertex* inVertices, size_t inNum, float inMinHeight, float inHeightRange,
+                              TerrainFragment::PackedVertex* outVertices){
+    const float scale = (inHeightRange > 0.0f) ? MAX_UNORM16 / inHeightRange : 0.0f;
+    for(size_t i = 0; i < inNum; ++i){
+        const TerrainFragment::CompressedVertex& src = inVertices[i];
+        TerrainFragment::PackedVertex& dst = outVertices[i];
+        dst.x = src.x;
+        dst.z = src.z;
+        dst.height = static_cast<boost::uint16_t>(std::min(std::max((src.y - inMinHeight) * scale + 0.5f, 0.0f), MAX_UNORM16));
+
+        //y component of terrain normal is positive
+        const float normalY = sqrtf(std::max(1.0f - src.normalX * src.normalX - src.normalZ * src.normalZ, 0.0f));
+        const float sum = fabsf(src.normalX) + normalY + fabsf(src.normalZ);
+        if(sum > 0.0f){
+            dst.normalU = toSnorm8(src.normalX / sum);
+            dst.normalV = toSnorm8(src.normalZ / sum);
+        }
+        else{
+            dst.normalU = dst.normalV = 0;
+        }
+    }
+}
+
+void TerrainVertexCodec::unpack(const TerrainFragment::PackedVertex* inVertices, size_t inNum, float inMinHeight, float inHeightRange,
+                                TerrainFragment::CompressedVertex* outVertices){
+    const float scale = inHeightRange / MAX_UNORM16;
+    for(size_t i = 0; i < inNum; ++i){
+        const TerrainFragment::PackedVertex& src = inVertices[i];
+        TerrainFragment::CompressedVertex& dst = outVertices[i];
+        float normalY;
+        dst.x = src.x;
+        dst.z = src.z;
+        dst.y = inMinHeight + src.height * scale;
+        decodeNormal(src.normalU, src.normalV, dst.normalX, normalY, dst.normalZ);
+    }
+}
+
+void TerrainVertexCodec::unpack(const TerrainFragment::PackedVertex* inVertices, size_t inNum, float inMinHeight, float inHeightRange,
+                                float inTexCoordScale, Vertex* outVertices){
+    const float scale = inHeightRange / MAX_UNORM16;
+    for(size_t i = 0; i < inNum; ++i){
+        const TerrainFragment::PackedVertex& src = inVertices[i];
+        Vertex& dst = outVertices[i];
+        dst.mCoord.x = src.x;
+        dst.mCoord.y = inMinHeight + src.height * scale;
+        dst.mCoord.z = src.z;
+        dst.mTexCoord.x = src.z * inTexCoordScale;
+        dst.mTexCoord.y = src.x * inTexCoordScale;
+        dst.mTexCoord.z = 0.0f;
+
+        float x, y, z;
+        decodeNormal(src.normalU, src.normalV, x, y, z);
+        dst.mNormal = Vector3D(x, y, z);
+    }
+}
+
+void TerrainVertexCodec::expand(const TerrainFragment::CompressedVertex* inVertices, size_t inNum, float inTexCoordScale, Vertex* outVertices){
+    for(size_t i = 0; i < inNum; ++i){
+        const TerrainFragment::CompressedVertex& src = inVertices[i];
+        Vertex& dst = outVertices[i];
+        dst.mCoord.x = src.x;
+        dst.mCoord.y = src.y;
+        dst.mCoord.z = src.z;
+        dst.mTexCoord.x = src.z * inTexCoordScale;
+        dst.mTexCoord.y = src.x * inTexCoordScale;
+        dst.mTexCoord.z = 0.0f;
+
+        //recalculate y component of normal
+        //we know that y is positive
+        const float normalY = sqrtf(std::max(1.0f - src.normalX * src.normalX - src.normalZ * src.normalZ, 0.0f));
+        dst.mNormal = Vector3D(src.normalX, normalY, src.normalZ);
+    }
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
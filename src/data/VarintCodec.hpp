@@ -0,0 +1,101 @@
+//VarintCodec.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#ifndef VARINT_CODEC_HPP__
+#define VARINT_CODEC_HPP__
+
+/**
+ * Variable length integers and zigzag mapping of signed values shared by
+ * encoders of index data (IndexBuffer, TerrainChunkCodec).
+ */
+
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+
+namespace hydra{
+
+namespace VarintCodec{
+
+//writes unsigned value by 7 bits per byte (high bit means "more bytes follow")
+inline void writeVarint(boost::uint32_t inValue, std::vector<unsigned char>& outData){
+    while(inValue >= 0x80){
+        outData.push_back(static_cast<unsigned char>(inValue | 0x80));
+        inValue >>= 7;
+    }
+    outData.push_back(static_cast<unsigned char>(inValue));
+}
+
+//reads value written by writeVarint, inOwner prefixes messages of exceptions
+inline boost::uint32_t readVarint(const unsigned char*& inoutData, const unsigned char* inEnd, const char* inOwner){
+    boost::uint32_t result = 0;
+    for(unsigned int shift = 0; shift < 35; shift += 7){
+        if(inoutData == inEnd) throw std::runtime_error(std::string(inOwner) + ": unexpected end of encoded data");
+        const unsigned char byte = *inoutData++;
+        result |= static_cast<boost::uint32_t>(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return result;
+    }
+    throw std::runtime_error(std::string(inOwner) + ": corrupted encoded data");
+}
+
+//maps signed values to unsigned ones (0, -1, 1, -2, ... to 0, 1, 2, 3, ...)
+inline boost::uint32_t zigzag(boost::int32_t inValue){
+    return (static_cast<boost::uint32_t>(inValue) << 1) ^ static_cast<boost::uint32_t>(inValue >> 31);
+}
+
+inline boost::int32_t unzigzag(boost::uint32_t inValue){
+    return static_cast<boost::int32_t>(inValue >> 1) ^ -static_cast<boost::int32_t>(inValue & 1);
+}
+
+//16-bit versions of zigzag and unzigzag
+inline boost::uint16_t zigzag(boost::int16_t inValue){
+    return static_cast<boost::uint16_t>((static_cast<unsigned int>(inValue) << 1) ^ static_cast<unsigned int>(inValue >> 15));
+}
+
+inline boost::int16_t unzigzag(boost::uint16_t inValue){
+    return static_cast<boost::int16_t>((inValue >> 1) ^ -static_cast<int>(inValue & 1));
+}
+
+} //VarintCodec namespace
+
+} //hydra
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,415 @@
+//VertexFormat.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "data/VertexFormat.hpp"
+#include "data/Vertex.hpp"
+#include "math/Vector3D.hpp"
+#include "math/Point.hpp"
+#include "math/AABB.hpp"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+using hydra::data::VertexFormat;
+using hydra::data::Vertex;
+using hydra::math::Vector3D;
+using hydra::math::Point;
+using hydra::math::AABB;
+
+//some helpers to read/write unaligned values
+namespace{
+
+template <typename T>
+inline void writeValue(unsigned char* inPtr, T inValue){
+    memcpy(inPtr, &inValue, sizeof(T));
+}
+
+template <typename T>
+inline T readValue(const unsigned char* inPtr){
+    T value;
+    memcpy(&value, inPtr, sizeof(T));
+    return value;
+}
+
+inline float clampUnit(float inValue){
+    return std::max(-1.0f, std::min(1.0f, inValue));
+}
+
+inline boost::uint16_t toUnorm16(float inValue){
+    float clamped = std::max(0.0f, std::min(1.0f, inValue));
+    return static_cast<boost::uint16_t>(clamped * 65535.0f + 0.5f);
+}
+
+inline boost::int16_t toSnorm16(float inValue){
+    return static_cast<boost::int16_t>(floorf(clampUnit(inValue) * 32767.0f + 0.5f));
+}
+
+inline boost::int8_t toSnorm8(float inValue){
+    return static_cast<boost::int8_t>(floorf(clampUnit(inValue) * 127.0f + 0.5f));
+}
+
+inline float fromSnorm16(boost::int16_t inValue){
+    return std::max(-1.0f, static_cast<float>(inValue) / 32767.0f);
+}
+
+inline float fromSnorm8(boost::int8_t inValue){
+    return std::max(-1.0f, static_cast<float>(inValue) / 127.0f);
+}
+
+//returns 1/x or 0 for zero-sized dimensions
+inline float safeInverse(float inValue){
+    return (inValue > 0.0f)? (1.0f / inValue): 0.0f;
+}
+
+//returns attribute of vertex as array of 3 floats
+inline const float* getAttribute(const Vertex& inVertex, VertexFormat::Attribute inAttribute, float* outTemp){
+    switch(inAttribute){
+        case VertexFormat::POSITION:
+            outTemp[0] = inVertex.mCoord.x; outTemp[1] = inVertex.mCoord.y; outTemp[2] = inVertex.mCoord.z;
+            break;
+        case VertexFormat::TEX_COORD:
+            outTemp[0] = inVertex.mTexCoord.x; outTemp[1] = inVertex.mTexCoord.y; outTemp[2] = inVertex.mTexCoord.z;
+            break;
+        default:
+            inVertex.mNormal.get(outTemp);
+    }
+    return outTemp;
+}
+
+inline void setAttribute(Vertex& outVertex, VertexFormat::Attribute inAttribute, float inX, float inY, float inZ){
+    switch(inAttribute){
+        case VertexFormat::POSITION:
+            outVertex.mCoord = Point(inX, inY, inZ);
+            break;
+        case VertexFormat::TEX_COORD:
+            outVertex.mTexCoord = Point(inX, inY, inZ);
+            break;
+        default:
+            outVertex.mNormal = Vector3D(inX, inY, inZ);
+    }
+}
+
+} //unnamed namespace
+
+VertexFormat::VertexFormat(): mStride(0){
+
+}
+
+VertexFormat& VertexFormat::add(VertexFormat::Attribute inAttribute, VertexFormat::Type inType){
+    if(inType == NONE || inAttribute >= ATTRIBUTE_NUM || find(inAttribute)) return *this;
+
+    Element newElement;
+    newElement.attribute = inAttribute;
+    newElement.type = inType;
+    newElement.offset = mStride;
+    mElements.push_back(newElement);
+
+    //keep all offsets aligned to 4 bytes
+    mStride += getTypeSize(inType);
+    mStride = (mStride + 3) & ~3u;
+    return *this;
+}
+
+const VertexFormat::Element* VertexFormat::find(VertexFormat::Attribute inAttribute) const{
+    BOOST_FOREACH(const Element& nextElement, mElements){
+        if(nextElement.attribute == inAttribute) return &nextElement;
+    }
+    return 0;
+}
+
+unsigned int VertexFormat::getTypeSize(VertexFormat::Type inType){
+    switch(inType){
+        case FLOAT3: return 12;
+        case FLOAT2: return 8;
+        case HALF2: return 4;
+        case UNORM16_3: return 6;
+        case SNORM16_3: return 6;
+        case OCT16: return 4;
+        case OCT8: return 2;
+        default: return 0;
+    }
+}
+
+VertexFormat VertexFormat::createFull(){
+    VertexFormat format;
+    format.add(POSITION, FLOAT3).add(TEX_COORD, FLOAT3).add(NORMAL, FLOAT3);
+    return format;
+}
+
+VertexFormat VertexFormat::createCompact(){
+    VertexFormat format;
+    format.add(POSITION, UNORM16_3).add(TEX_COORD, HALF2).add(NORMAL, OCT16);
+    return format;
+}
+
+boost::uint16_t VertexFormat::floatToHalf(float inValue){
+    boost::uint32_t bits = readValue<boost::uint32_t>(reinterpret_cast<const unsigned char*>(&inValue));
+
+    boost::uint16_t sign = static_cast<boost::uint16_t>((bits >> 16) & 0x8000);
+    boost::int32_t exponent = static_cast<boost::int32_t>((bits >> 23) & 0xff) - 127 + 15;
+    boost::uint32_t mantissa = bits & 0x007fffff;
+
+    //NaN and infinity
+    if(((bits >> 23) & 0xff) == 0xff){
+        return static_cast<boost::uint16_t>(sign | 0x7c00 | (mantissa? 0x200: 0));
+    }
+    //overflow is saturated to infinity
+    if(exponent >= 0x1f) return static_cast<boost::uint16_t>(sign | 0x7c00);
+
+    //denormals or zero
+    if(exponent <= 0){
+        if(exponent < -10) return sign;
+        mantissa |= 0x00800000;
+        unsigned int shift = static_cast<unsigned int>(14 - exponent);
+        boost::uint32_t halfMantissa = mantissa >> shift;
+        //round to nearest
+        if((mantissa >> (shift - 1)) & 1) ++halfMantissa;
+        return static_cast<boost::uint16_t>(sign | halfMantissa);
+    }
+
+    boost::uint32_t result = (static_cast<boost::uint32_t>(exponent) << 10) | (mantissa >> 13);
+    //round to nearest (carry may correctly overflow to exponent)
+    if(mantissa & 0x00001000) ++result;
+    return static_cast<boost::uint16_t>(sign | std::min<boost::uint32_t>(result, 0x7c00));
+}
+
+float VertexFormat::halfToFloat(boost::uint16_t inValue){
+    boost::uint32_t sign = static_cast<boost::uint32_t>(inValue & 0x8000) << 16;
+    boost::uint32_t exponent = (inValue >> 10) & 0x1f;
+    boost::uint32_t mantissa = inValue & 0x03ff;
+
+    boost::uint32_t bits;
+    if(exponent == 0){
+        if(mantissa == 0){
+            bits = sign;
+        }
+        else{
+            //normalize denormal
+            exponent = 127 - 15 + 1;
+            while(!(mantissa & 0x0400)){
+                mantissa <<= 1;
+                --exponent;
+            }
+            mantissa &= 0x03ff;
+            bits = sign | (exponent << 23) | (mantissa << 13);
+        }
+    }
+    else if(exponent == 0x1f){
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else{
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    return readValue<float>(reinterpret_cast<const unsigned char*>(&bits));
+}
+
+void VertexFormat::encodeOctahedral(const Vector3D& inNormal, float& outU, float& outV){
+    float x = inNormal.x();
+    float y = inNormal.y();
+    float z = inNormal.z();
+
+    float sum = fabsf(x) + fabsf(y) + fabsf(z);
+    if(sum < 1e-20f){
+        outU = outV = 0.0f;
+        return;
+    }
+    x /= sum;
+    y /= sum;
+
+    if(z < 0.0f){
+        //fold lower hemisphere
+        float foldedX = (1.0f - fabsf(y)) * ((x >= 0.0f)? 1.0f: -1.0f);
+        float foldedY = (1.0f - fabsf(x)) * ((y >= 0.0f)? 1.0f: -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    outU = x;
+    outV = y;
+}
+
+Vector3D VertexFormat::decodeOctahedral(float inU, float inV){
+    float z = 1.0f - fabsf(inU) - fabsf(inV);
+    float x = inU;
+    float y = inV;
+    if(z < 0.0f){
+        //unfold lower hemisphere
+        x = (1.0f - fabsf(inV)) * ((inU >= 0.0f)? 1.0f: -1.0f);
+        y = (1.0f - fabsf(inU)) * ((inV >= 0.0f)? 1.0f: -1.0f);
+    }
+    float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+    return Vector3D(x * invLength, y * invLength, z * invLength);
+}
+
+void VertexFormat::encode(const Vertex* inVertices, size_t inNum, const AABB& inBounds, unsigned char* outData) const{
+    if(!inNum) return;
+    memset(outData, 0, inNum * mStride);
+
+    const Vector3D& corner = inBounds.getCorner();
+    const Vector3D& vec = inBounds.getVector();
+    const Vector3D center = inBounds.getCenter();
+    const float invX = safeInverse(vec.x());
+    const float invY = safeInverse(vec.y());
+    const float invZ = safeInverse(vec.z());
+
+    //we process attribute by attribute so encoding is chosen once per attribute
+    BOOST_FOREACH(const Element& nextElement, mElements){
+        unsigned char* dst = outData + nextElement.offset;
+        float temp[3];
+
+        for(size_t i = 0; i < inNum; ++i, dst += mStride){
+            const float* src = getAttribute(inVertices[i], nextElement.attribute, temp);
+
+            switch(nextElement.type){
+                case FLOAT3:
+                    memcpy(dst, src, 3 * sizeof(float));
+                    break;
+                case FLOAT2:
+                    memcpy(dst, src, 2 * sizeof(float));
+                    break;
+                case HALF2:
+                    writeValue(dst, floatToHalf(src[0]));
+                    writeValue(dst + 2, floatToHalf(src[1]));
+                    break;
+                case UNORM16_3:
+                    writeValue(dst, toUnorm16((src[0] - corner.x()) * invX));
+                    writeValue(dst + 2, toUnorm16((src[1] - corner.y()) * invY));
+                    writeValue(dst + 4, toUnorm16((src[2] - corner.z()) * invZ));
+                    break;
+                case SNORM16_3:
+                    writeValue(dst, toSnorm16((src[0] - center.x()) * 2.0f * invX));
+                    writeValue(dst + 2, toSnorm16((src[1] - center.y()) * 2.0f * invY));
+                    writeValue(dst + 4, toSnorm16((src[2] - center.z()) * 2.0f * invZ));
+                    break;
+                case OCT16:
+                case OCT8:{
+                    float u, v;
+                    encodeOctahedral(Vector3D(src[0], src[1], src[2]), u, v);
+                    if(nextElement.type == OCT16){
+                        writeValue(dst, toSnorm16(u));
+                        writeValue(dst + 2, toSnorm16(v));
+                    }
+                    else{
+                        writeValue(dst, toSnorm8(u));
+                        writeValue(dst + 1, toSnorm8(v));
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+void VertexFormat::decode(const unsigned char* inData, size_t inNum, const AABB& inBounds, Vertex* outVertices) const{
+    if(!inNum) return;
+
+    //attributes which are not present must be zero
+    for(size_t i = 0; i < inNum; ++i){
+        outVertices[i].mCoord = Point();
+        outVertices[i].mTexCoord = Point();
+        outVertices[i].mNormal = Vector3D();
+    }
+
+    const Vector3D& corner = inBounds.getCorner();
+    const Vector3D& vec = inBounds.getVector();
+    const Vector3D center = inBounds.getCenter();
+    const float scaleX = vec.x() / 65535.0f;
+    const float scaleY = vec.y() / 65535.0f;
+    const float scaleZ = vec.z() / 65535.0f;
+
+    BOOST_FOREACH(const Element& nextElement, mElements){
+        const unsigned char* src = inData + nextElement.offset;
+        const Attribute attribute = nextElement.attribute;
+
+        switch(nextElement.type){
+            case FLOAT3:
+                for(size_t i = 0; i < inNum; ++i, src += mStride){
+                    setAttribute(outVertices[i], attribute, readValue<float>(src), readValue<float>(src + 4), readValue<float>(src + 8));
+                }
+                break;
+            case FLOAT2:
+                for(size_t i = 0; i < inNum; ++i, src += mStride){
+                    setAttribute(outVertices[i], attribute, readValue<float>(src), readValue<float>(src + 4), 0.0f);
+                }
+                break;
+            case HALF2:
+                for(size_t i = 0; i < inNum; ++i, src += mStride){
+                    setAttribute(outVertices[i], attribute, halfToFloat(readValue<boost::uint16_t>(src)),
+                            halfToFloat(readValue<boost::uint16_t>(src + 2)), 0.0f);
+                }
+                break;
+            case UNORM16_3:
+                for(size_t i = 0; i < inNum; ++i, src += mStride){
+                    setAttribute(outVertices[i], attribute,
+                            corner.x() + readValue<boost::uint16_t>(src) * scaleX,
+                            corner.y() + readValue<boost::uint16_t>(src + 2) * scaleY,
+                            corner.z() + readValue<boost::uint16_t>(src + 4) * scaleZ);
+                }
+                break;
+            case SNORM16_3:
+                for(size_t i = 0; i < inNum; ++i, src += mStride){
+                    setAttribute(outVertices[i], attribute,
+                            center.x() + fromSnorm16(readValue<boost::int16_t>(src)) * vec.x() * 0.5f,
+                            center.y() + fromSnorm16(readValue<boost::int16_t>(src + 2)) * vec.y() * 0.5f,
+                            center.z() + fromSnorm16(readValue<boost::int16_t>(src + 4)) * vec.z() * 0.5f);
+                }
+                break;
+            case OCT16:
+                for(size_t i = 0; i < inNum; ++i, src += mStride){
+                    Vector3D normal = decodeOctahedral(fromSnorm16(readValue<boost::int16_t>(src)),
+                            fromSnorm16(readValue<boost::int16_t>(src + 2)));
+                    setAttribute(outVertices[i], attribute, normal.x(), normal.y(), normal.z());
+                }
+                break;
+            case OCT8:
+                for(size_t i = 0; i < inNum; ++i, src += mStride){
+                    Vector3D normal = decodeOctahedral(fromSnorm8(readValue<boost::int8_t>(src)),
+                            fromSnorm8(readValue<boost::int8_t>(src + 1)));
+                    setAttribute(outVertices[i], attribute, normal.x(), normal.y(), normal.z());
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
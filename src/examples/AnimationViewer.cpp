@@ -59,6 +59,9 @@
 #include "data/Animation.hpp"
 #include "data/Mesh.hpp"
 #include "data/Material.hpp"
+#include "data/MeshSkinner.hpp"
+#include "data/AnimationPlayer.hpp"
+#include "data/Pose.hpp"
 
 #include <boost/foreach.hpp>
 
@@ -121,6 +124,11 @@ struct VarrayIds{
 std::vector<VarrayIds> gVarrays;
 std::vector<MaterialPtr> gMaterials;
 
+//CPU skinning: skinner and buffer of skinned vertices for each mesh
+std::vector<MeshSkinner> gSkinners;
+std::vector<std::vector<Vertex> > gSkinnedVertices;
+MeshSkinner::Palette gPalette;
+
 GLuint gNormalList;
 
 float gZoom = 10;
@@ -134,7 +142,8 @@ SDL_Surface* gScreenSurface = 0;
 
 Timer gTimer;
 size_t gAnimNum = 0;
-size_t gFrameNum = 0;
+AnimationPlayer gPlayer;
+Pose gPose;
 
 static void clean(){
     if(gCamMatrix) delete[] gCamMatrix;
@@ -202,8 +211,8 @@ static VarrayIds createMeshBufferObject(const MeshPtr inMesh){
     glBufferDataARB(GL_ARRAY_BUFFER_ARB, static_cast<GLsizeiptr>(sizeof(Vertex) * inMesh->getVertexNum()),
                         (const void*)(&inMesh->mVertices[0]), GL_STREAM_DRAW_ARB);
     glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, newVarrayIds.IBO);
-    glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, static_cast<GLsizeiptr>(sizeof(unsigned int) * inMesh->getIndexNum()),
-                        (const void*)(&inMesh->mIndices[0]), GL_STATIC_DRAW_ARB);
+    glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, static_cast<GLsizeiptr>(inMesh->mIndices.getDataSize()),
+                        inMesh->mIndices.getData(), GL_STATIC_DRAW_ARB);
 
     glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
     glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
@@ -214,6 +223,10 @@ static VarrayIds createMeshBufferObject(const MeshPtr inMesh){
 static void createModelBufferObjects(const ModelPtr inModel){
     BOOST_FOREACH(const MeshPtr nextMesh, inModel->mMeshes){
         gVarrays.push_back(createMeshBufferObject(nextMesh));
+        gSkinners.push_back(MeshSkinner());
+        gSkinners.back().setup(*nextMesh);
+        //texture coordinates are not changed by skinning
+        gSkinnedVertices.push_back(nextMesh->mVertices);
     }
 }
 
@@ -357,6 +370,8 @@ static void setupOpenGL(){
         glDeleteTextures(1, &nextPair.second);
 
     gVarrays.clear();
+    gSkinners.clear();
+    gSkinnedVertices.clear();
     gMaterials.clear();
     gTextures.clear();
     gNormalList = 0;
@@ -379,77 +394,25 @@ static void resize(int new_width, int new_height){
     setupOpenGL();
 }
 
-inline float lerp(float inVal1, float inVal2, float inFactor){
-    return (inVal1*(1.0f - inFactor) + inVal2 * inFactor);
-}
-//linear interpolation
-Vector3D lerp(const Vector3D& inVec1, const Vector3D& inVec2, float inFactor){
-    Vector3D res;
-    res.setX(lerp(inVec1.x(), inVec2.x(), inFactor));
-    res.setY(lerp(inVec1.y(), inVec2.y(), inFactor));
-    res.setZ(lerp(inVec1.z(), inVec2.z(), inFactor));
-    return res;
-}
-
 //updates meshes
 void updateGeometry(){
-
-    float frameDuration = gModel->getAnimation(gAnimNum)->getFrameDuration();
-    assert(frameDuration > 0.01f);
-    float currentTime = gTimer.getSeconds();
-    //next frame switching
-    if(currentTime >= frameDuration){
-        gTimer.start();
-        currentTime = 0.0f;
-        if(++gFrameNum >= gModel->getAnimation(gAnimNum)->getFrameNum()) gFrameNum = 0;
-    }
-
-    float ratio = currentTime / frameDuration;
-    size_t nextFrameNum = gFrameNum + 1;
-    if(nextFrameNum >= gModel->getAnimation(gAnimNum)->getFrameNum()) nextFrameNum = 0;
-
-    //first interpolate skeletons
-    Skeleton currentSkel;
-    Skeleton& currentFrame = gModel->getAnimation(gAnimNum)->mFrames[gFrameNum];
-    Skeleton& nextFrame = gModel->getAnimation(gAnimNum)->mFrames[nextFrameNum];
-    currentSkel.mBones.resize(currentFrame.mBones.size());
-
-    for(size_t i = 0; i < currentFrame.mBones.size(); ++i){
-        //interpolate positions
-        currentSkel.mBones[i].mPos = lerp(currentFrame.mBones[i].mPos, nextFrame.mBones[i].mPos, ratio);
-        currentSkel.mBones[i].mOrient.setVec(lerp(currentFrame.mBones[i].mOrient.getVec(), nextFrame.mBones[i].mOrient.getVec(), ratio));
-        currentSkel.mBones[i].mOrient.setScalar(lerp(currentFrame.mBones[i].mOrient.getScalar(), nextFrame.mBones[i].mOrient.getScalar(), ratio));
-        currentSkel.mBones[i].mOrient.normalize();
-    }
+    //animation is sampled for time passed since previous update
+    float delta = gTimer.getSeconds();
+    gTimer.start();
+    gPlayer.update(delta);
+    gPlayer.evaluate(gPose);
 
     //calculate vertices now
     //this must be done on GPU, but now we do it on CPU
-    int varrayNum = 0;
-    BOOST_FOREACH(MeshPtr nextMesh, gModel->mMeshes){
-        std::vector<Vertex> newVerts = nextMesh->mVertices;
-
-        for(size_t i = 0; i < nextMesh->getVertexNum(); ++i){
-            Vector3D newPos;
-            newVerts[i].mNormal = Vector3D();
-            for(int j = 0; j < Mesh::MAX_BONES_PER_VERTEX; ++j){
-                Vector3D coord = nextMesh->mVertices[i].mCoord;
-                Vector3D normRot = nextMesh->mVertices[i].mNormal;
-                currentSkel.mBones[nextMesh->mBones[i][j]].mOrient.rotate(normRot);
-                newVerts[i].mNormal += normRot * nextMesh->mBoneWeights[i][j];
-                currentSkel.mBones[nextMesh->mBones[i][j]].mOrient.rotate(coord);
-                newPos += ((currentSkel.mBones[nextMesh->mBones[i][j]].mPos + coord) * nextMesh->mBoneWeights[i][j]);
-            }
-            newVerts[i].mCoord.x = newPos.x();
-            newVerts[i].mCoord.y = newPos.y();
-            newVerts[i].mCoord.z = newPos.z();
-        }
+    gPalette.build(gPose);
+    for(size_t i = 0; i < gSkinners.size(); ++i){
+        if(gSkinnedVertices[i].empty()) continue;
+        gSkinners[i].skin(gPalette, &gSkinnedVertices[i][0]);
 
         //reload each mesh to vertex buffer
-        glBindBufferARB(GL_ARRAY_BUFFER_ARB, gVarrays[varrayNum].VBO);
-        glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, static_cast<GLsizeiptr>(sizeof(Vertex) * nextMesh->getVertexNum()),
-                        (const void*)(&newVerts[0]));
-
-        ++varrayNum;
+        glBindBufferARB(GL_ARRAY_BUFFER_ARB, gVarrays[i].VBO);
+        glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, static_cast<GLsizeiptr>(sizeof(Vertex) * gSkinnedVertices[i].size()),
+                        (const void*)(&gSkinnedVertices[i][0]));
     }
 }
 
@@ -503,10 +466,11 @@ static void render(){
         glVertexPointer(3, GL_FLOAT, vertexStride, (void*)0);
 
         glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, gVarrays[i].IBO);
+        GLenum indexType = (gModel->mMeshes[i]->mIndices.getWidth() == IndexBuffer::WIDTH_16)? GL_UNSIGNED_SHORT: GL_UNSIGNED_INT;
         if(gModel->mMeshes[i]->mMode == Mesh::TRIANGLES) 
-            glDrawElements(GL_TRIANGLES, gModel->mMeshes[i]->getIndexNum(), GL_UNSIGNED_INT, (void*)(coordOffset));
+            glDrawElements(GL_TRIANGLES, gModel->mMeshes[i]->getIndexNum(), indexType, (void*)(coordOffset));
         else if(gModel->mMeshes[i]->mMode == Mesh::TRIANGLE_STRIP)
-            glDrawElements(GL_TRIANGLE_STRIP, gModel->mMeshes[i]->getIndexNum(), GL_UNSIGNED_INT, (void*)(coordOffset));
+            glDrawElements(GL_TRIANGLE_STRIP, gModel->mMeshes[i]->getIndexNum(), indexType, (void*)(coordOffset));
         else assert(!"unsupported primitive assemble mode!");
     }
         
@@ -732,6 +696,8 @@ int main (int argv, char** args){
            for(int i = 2; i < argv; ++i){
                 gModel->addAnimation(loadFromFile<Animation>(args[i]));
            }
+           gPlayer.setBoneNum(gModel->mBindSkel->mBones.size());
+           gPlayer.addLayer(gModel->getAnimation(gAnimNum));
         }
         else{
             printHelp();
@@ -752,6 +718,9 @@ int main (int argv, char** args){
     dropFactories();
     
     gModel->sortMeshesByOpacity();
+    size_t drawNum = gModel->mMeshes.size();
+    gModel->mergeMeshes();
+    std::cout << "meshes merged, draw calls: " << drawNum << " -> " << gModel->mMeshes.size() << std::endl;
     MeshOptimizer meshOpt;
     meshOpt.setCacheSize(32);
     BOOST_FOREACH(MeshPtr nextMesh, gModel->mMeshes){
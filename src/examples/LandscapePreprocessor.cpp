@@ -20,7 +20,9 @@
  * in docs section). Those data is enough to render landscape (original heightmap
  * is not needed).
  * This tool should be used offline as it may need big amounts of memory and
- * CPU time.
+ * CPU time. Raw and PGM heightmaps are read by fragments on demand, so only
+ * fragments which are being processed (limited by memory budget) are kept
+ * in memory.
  *
  * \author A.V.Medvedev
  * \date 14.10.2010
@@ -34,12 +36,16 @@
 #include "data/HeightMap.hpp"
 #include "data/Image.hpp"
 #include "loading/LoadingMain.hpp"
+#include "loading/TerrainPack.hpp"
+#include "loading/TerrainIndex.hpp"
+#include "common/Timer.hpp"
 
 //Boost headers
 #include <boost/thread.hpp>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 
 //3rd party headers
 #include <zip.h>
@@ -52,11 +58,24 @@
 #include <stdexcept>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
+#include <deque>
+#include <iomanip>
 
 //C headers
 #include <cassert>
 #include <cstring>
 #include <cstdlib>
+#include <cctype>
+
+//OS headers (peak memory usage)
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
 
 using namespace hydra::rendering;
 using namespace hydra::data;
@@ -247,6 +266,60 @@ private:
     FileSystemPtr mTempDir;
 };
 
+//memory implementation
+//Collects directories and files of a single fragment in memory,
+//so they may be written later by another thread (see flush()).
+class BufferedFileSystem : public FileSystem, boost::noncopyable{
+public:
+    BufferedFileSystem(){
+
+    }
+
+    virtual ~BufferedFileSystem(){
+
+    }
+
+    virtual void createDir(const std::string& inPath){
+        mDirs.push_back(inPath);
+    }
+
+    virtual OStreamPtr createOutputStream(const std::string& inPath){
+        StringStreamPtr stream(new std::ostringstream(std::ostringstream::out | std::ostringstream::binary));
+        mFiles.push_back(std::make_pair(inPath, stream));
+        return stream;
+    }
+
+    //returns number of bytes in all the files
+    size_t getSize() const{
+        size_t result = 0;
+        for(size_t i = 0; i < mFiles.size(); ++i){
+            result += static_cast<size_t>(mFiles[i].second->tellp());
+        }
+        return result;
+    }
+
+    //creates all the directories and files in specified file system
+    void flush(FileSystem& inFileSystem) const{
+        for(size_t i = 0; i < mDirs.size(); ++i){
+            inFileSystem.createDir(mDirs[i]);
+        }
+        for(size_t i = 0; i < mFiles.size(); ++i){
+            OStreamPtr stream = inFileSystem.createOutputStream(mFiles[i].first);
+            const std::string data = mFiles[i].second->str();
+            stream->write(data.data(), data.size());
+            if(!*stream) throw std::runtime_error("can't write file " + mFiles[i].first);
+        }
+    }
+
+private:
+    typedef hydra::common::SharedPtr<std::ostringstream>::Type StringStreamPtr;
+
+    std::vector<std::string> mDirs;
+    std::vector<std::pair<std::string, StringStreamPtr> > mFiles;
+};
+
+typedef hydra::common::SharedPtr<BufferedFileSystem>::Type BufferedFileSystemPtr;
+
 //========================================================================
 //=================END OF OUTPUT STUFF====================================
 //========================================================================
@@ -262,6 +335,19 @@ struct Args{
     unsigned int threadNum;
     unsigned int fragmentSize;
     std::string inputHeightmap;
+    //empty if input is not a raw file
+    std::string rawFormat;
+    unsigned int rawWidth;
+    unsigned int rawHeight;
+    bool bigEndian;
+    //memory (in bytes) for fragments being read and processed
+    size_t memoryBudget;
+    //save binary data of fragment to single pack file
+    bool packed;
+    //save XML metadata together with binary index (used with packed output only)
+    bool xmlMeta;
+    //where to save JSON summary of run (empty if not needed)
+    std::string summaryJSON;
     std::string outDir;
     std::string outZip;
 };
@@ -281,10 +367,18 @@ Args handleArguments(int inArgNum, char** inArgs){
         ("lod-error-factor,f", options::value<float>()->default_value(0.25f), "LOD error factor (used to compute each next level's of details error value)")
         ("lod-num,l", options::value<int>()->default_value(4), "number of levels per fragment")
         ("vertex-lod-factor,v", options::value<float>()->default_value(0.5f), "vertex LOD factor lies in interval (0.0, 1.0)")
-        ("threads,t", options::value<int>()->default_value(4), "number of threads used")
+        ("threads,t", options::value<int>()->default_value(4), "number of threads used (if there are fewer fragments, each fragment is triangulated by several threads)")
         ("fragment-size,s", options::value<int>()->default_value(257), "size of fragment's 1 level [size == 2^n + 1 and size <= 257]")
         ("input-heightmap,i", options::value<std::string>(), "input heightmap (image)")
-        ("max-height,m", options::value<float>()->default_value(100.0f), "Maximum height. Vertices' heights will be dequantized to interval [0.0, max-height].")
+        ("max-height,m", options::value<float>()->default_value(100.0f), "Maximum height. Integer heights will be dequantized to interval [0.0, max-height] (the lowest sample value, negative for signed ones, gives 0.0), float heights are used as is.")
+        ("raw-format,r", options::value<std::string>(), "input heightmap is a raw array of samples: u8, u16, s16 or f32")
+        ("raw-width", options::value<int>(), "width of raw heightmap (in samples)")
+        ("raw-height", options::value<int>(), "height of raw heightmap (equals to width if not specified)")
+        ("big-endian", "samples of raw heightmap are big-endian (little-endian by default)")
+        ("packed,p", "save binary data of every fragment to single pack file (X_Y/X_Y.tfpack) instead of file per chunk and per vertex level and metadata to binary index (main.index) instead of XML files (can't be used with 'z' option)")
+        ("xml-meta,x", "save XML metadata too when 'p' option is used (for debugging)")
+        ("summary-json,j", options::value<std::string>(), "file to save machine-readable summary (JSON) of run: progress, time of stages, output size, memory")
+        ("memory-budget,b", options::value<int>()->default_value(512), "memory (in MB) for fragments being read and processed. Raw and PGM heightmaps are read by fragments, so memory usage doesn't depend on their size.")
         ;//more options here...
 
     options::variables_map vm;
@@ -317,6 +411,36 @@ Args handleArguments(int inArgNum, char** inArgs){
     result.inputHeightmap = vm["input-heightmap"].as<std::string>();
     result.maxHeight = vm["max-height"].as<float>();
 
+    result.rawWidth = 0;
+    result.rawHeight = 0;
+    result.bigEndian = (vm.count("big-endian") != 0);
+    if(vm["memory-budget"].as<int>() <= 0){
+        std::cerr << "memory-budget has wrong value. It must lie in interval (0, +infinity)" << std::endl;
+        throw std::runtime_error("memory-budget has wrong value");
+    }
+    result.memoryBudget = static_cast<size_t>(vm["memory-budget"].as<int>()) * 1024 * 1024;
+    if(vm.count("summary-json")) result.summaryJSON = vm["summary-json"].as<std::string>();
+    result.packed = (vm.count("packed") != 0);
+    result.xmlMeta = (vm.count("xml-meta") != 0);
+    if(result.packed && vm.count("output-zip")){
+        //entries of zip archive can't be read by ranges
+        std::cerr << "Packed output can't be saved to zip archive." << std::endl;
+        throw std::runtime_error("packed and output-zip options are used together");
+    }
+    if(vm.count("raw-format")){
+        result.rawFormat = vm["raw-format"].as<std::string>();
+        if(!vm.count("raw-width") || vm["raw-width"].as<int>() <= 0){
+            std::cerr << "You must specify positive width of raw heightmap!" << std::endl;
+            throw std::runtime_error("no raw-width option specified");
+        }
+        result.rawWidth = vm["raw-width"].as<int>();
+        result.rawHeight = vm.count("raw-height") ? vm["raw-height"].as<int>() : result.rawWidth;
+        if(result.rawFormat != "u8" && result.rawFormat != "u16" && result.rawFormat != "s16" && result.rawFormat != "f32"){
+            std::cerr << "raw-format has wrong value. It must be one of u8, u16, s16, f32." << std::endl;
+            throw std::runtime_error("raw-format has wrong value");
+        }
+    }
+
     if(vm.count("output-zip")){
         result.outZip = vm["output-zip"].as<std::string>();
         result.outDir = "";
@@ -356,55 +480,353 @@ Args handleArguments(int inArgNum, char** inArgs){
     return result;
 }
 
-//splits original image into square fragments of specified size
-//creates HeightMap objects for every one and returns map of those objects
-std::map<TerrainFragmentId, HeightMapPtr> splitIntoFragments(const ImagePtr inImage, int inFragmentSize, float inMaxHeight){
-    std::map<TerrainFragmentId, HeightMapPtr> result;
-    if((inImage->getWidth() - 1)  % (inFragmentSize - 1) != 0 ||
-       (inImage->getHeight() - 1) % (inFragmentSize - 1) != 0 ){
-        throw std::runtime_error("Specified image can't be splitted into equal fragments of specified size without loss. Take another image or change fragment's size.");
+//========================================================================
+//=================INPUT STUFF============================================
+//========================================================================
+
+//single channel heights of the whole landscape
+//Heightmaps with more than 8 bits per sample are kept in their precision:
+//quantizing them to bytes produces terraces which cost triangles.
+struct HeightImage{
+    enum Type{
+        UNSIGNED_8 = 0,
+        UNSIGNED_16,
+        SIGNED_16,
+        FLOAT_32
+    };
+
+    HeightImage(): type(UNSIGNED_8), width(0), height(0){
+
     }
 
-    const unsigned int IMAGE_WIDTH = inImage->getWidth();
-    const unsigned int IMAGE_HEIGHT = inImage->getHeight();
-    const unsigned int VERT_NUMBER_OF_FRAGMENTS = (IMAGE_HEIGHT - 1) / (inFragmentSize - 1);
-    const unsigned int HORIZ_NUMBER_OF_FRAGMENTS = (IMAGE_WIDTH - 1)/ (inFragmentSize - 1);
-    std::cout << "splitted to " << VERT_NUMBER_OF_FRAGMENTS << 'x' << HORIZ_NUMBER_OF_FRAGMENTS << std::endl;
-    const unsigned char* IMAGE_DATA = inImage->getData();
+    Type type;
+    unsigned int width;
+    unsigned int height;
+    //width * height samples of type (in native byte order)
+    std::vector<unsigned char> data;
+};
 
-    const unsigned int STRIDE = (inImage->getMode() == Image::RGB) ? 3 : 4;
-    
-    for(unsigned int y = 0; y < VERT_NUMBER_OF_FRAGMENTS; ++y){ //Y
-        for(unsigned int x = 0; x < HORIZ_NUMBER_OF_FRAGMENTS; ++x){ //X
-            //for each fragment
-            unsigned char* fragment_data = new unsigned char[inFragmentSize * inFragmentSize];
-            //calculate start of the fragment in image data
-            const unsigned char* FRAGMENT_START_IN_IMAGE_DATA = 
-                IMAGE_DATA + STRIDE * y * IMAGE_WIDTH * (inFragmentSize - 1) + STRIDE * x * (inFragmentSize - 1);
-
-            //copy fragment's data to its heightmap
-
-            //for each fragment's line
-            for(int k = 0; k < inFragmentSize; ++k){
-                //for each byte
-                for(int l = 0; l < inFragmentSize; ++l){
-                    assert((FRAGMENT_START_IN_IMAGE_DATA + STRIDE * k * IMAGE_WIDTH + STRIDE * l) < (IMAGE_DATA + IMAGE_WIDTH * IMAGE_HEIGHT * STRIDE));
-                    fragment_data[k * inFragmentSize + l] = FRAGMENT_START_IN_IMAGE_DATA[STRIDE * IMAGE_WIDTH * k + STRIDE * l];
-                }
+unsigned int getSampleSize(HeightImage::Type inType){
+    switch(inType){
+        case HeightImage::UNSIGNED_8: return 1;
+        case HeightImage::UNSIGNED_16: return 2;
+        case HeightImage::SIGNED_16: return 2;
+        case HeightImage::FLOAT_32: return 4;
+        default:
+            assert(false);
+            return 0;
+    }
+}
+
+bool isBigEndianHost(){
+    const unsigned short test = 1;
+    return *reinterpret_cast<const unsigned char*>(&test) == 0;
+}
+
+//parses type of raw samples (u8, u16, s16, f32)
+HeightImage::Type parseRawFormat(const std::string& inFormat){
+    if(inFormat == "u8") return HeightImage::UNSIGNED_8;
+    if(inFormat == "u16") return HeightImage::UNSIGNED_16;
+    if(inFormat == "s16") return HeightImage::SIGNED_16;
+    if(inFormat == "f32") return HeightImage::FLOAT_32;
+    throw std::runtime_error("unknown raw format '" + inFormat + "' (expected u8, u16, s16 or f32)");
+}
+
+//converts samples read from file to native representation
+struct SampleConverter{
+    SampleConverter(): swapBytes(false), maxValue(0){
+
+    }
+
+    void operator()(HeightImage::Type inType, unsigned char* ioData, size_t inNum) const{
+        const unsigned int SAMPLE_SIZE = getSampleSize(inType);
+        if(swapBytes){
+            for(size_t i = 0; i < inNum; ++i){
+                std::reverse(ioData + i * SAMPLE_SIZE, ioData + (i + 1) * SAMPLE_SIZE);
+            }
+        }
+        if(maxValue != 0 && inType == HeightImage::UNSIGNED_16){
+            unsigned short* samples = reinterpret_cast<unsigned short*>(ioData);
+            for(size_t i = 0; i < inNum; ++i){
+                samples[i] = static_cast<unsigned short>(std::min(65535u, (samples[i] * 65535u + maxValue / 2) / maxValue));
             }
+        }
+    }
+
+    //samples are stored with other byte order
+    bool swapBytes;
+    //16-bit samples lie in [0, maxValue] and must be stretched to full range (0 if not needed)
+    unsigned int maxValue;
+};
+
+//source of landscape heights which gives them out by fragments
+class HeightSource{
+public:
+    virtual ~HeightSource(){
+
+    }
+
+    virtual HeightImage::Type getType() const = 0;
+    virtual unsigned int getWidth() const = 0;
+    virtual unsigned int getHeight() const = 0;
+
+    //copies inSize lines of inSize samples starting at specified sample to outData
+    virtual void read(unsigned int inFirstColumn, unsigned int inFirstLine, unsigned int inSize, unsigned char* outData) = 0;
+};
+
+typedef hydra::common::SharedPtr<HeightSource>::Type HeightSourcePtr;
+
+//whole heightmap in memory
+//used for images which are decoded by hydra loaders
+class MemoryHeightSource: public HeightSource, private boost::noncopyable{
+public:
+    MemoryHeightSource(){
 
-            HeightMapGen<unsigned char>* heightmap= new HeightMapGen<unsigned char>(inFragmentSize, fragment_data);
-            heightmap->setMinHeight(0.0f);
-            heightmap->setMaxHeight(inMaxHeight);
-            HeightMapPtr nextHeightMapFragment(heightmap);
-            TerrainFragmentId nextId(x, y);
-            result[nextId] = nextHeightMapFragment;
+    }
+
+    virtual HeightImage::Type getType() const{
+        return mImage.type;
+    }
+
+    virtual unsigned int getWidth() const{
+        return mImage.width;
+    }
+
+    virtual unsigned int getHeight() const{
+        return mImage.height;
+    }
+
+    virtual void read(unsigned int inFirstColumn, unsigned int inFirstLine, unsigned int inSize, unsigned char* outData){
+        const unsigned int SAMPLE_SIZE = getSampleSize(mImage.type);
+        const size_t LINE_SIZE = inSize * SAMPLE_SIZE;
+        for(unsigned int k = 0; k < inSize; ++k){
+            const size_t offset = (static_cast<size_t>(inFirstLine + k) * mImage.width + inFirstColumn) * SAMPLE_SIZE;
+            assert(offset + LINE_SIZE <= mImage.data.size());
+            memcpy(outData + k * LINE_SIZE, &mImage.data[offset], LINE_SIZE);
+        }
+    }
+
+    HeightImage mImage;
+};
+
+//reads lines of fragments from uncompressed file on demand,
+//so memory usage doesn't depend on size of heightmap
+//(raw arrays of samples and binary PGM images)
+class FileHeightSource: public HeightSource, private boost::noncopyable{
+public:
+    FileHeightSource(const std::string& inPath,
+                     HeightImage::Type inType,
+                     unsigned int inWidth,
+                     unsigned int inHeight,
+                     std::streamoff inDataOffset,
+                     const SampleConverter& inConverter): mFile(inPath.c_str(), std::ifstream::in | std::ifstream::binary),
+                                                          mPath(inPath),
+                                                          mType(inType),
+                                                          mWidth(inWidth),
+                                                          mHeight(inHeight),
+                                                          mDataOffset(inDataOffset),
+                                                          mConverter(inConverter){
+        if(!mFile) throw std::runtime_error("can't open file " + inPath);
+        mFile.seekg(0, std::ios::end);
+        const std::streamoff FILE_SIZE = mFile.tellg();
+        const std::streamoff DATA_SIZE = static_cast<std::streamoff>(inWidth) * inHeight * getSampleSize(inType);
+        if(FILE_SIZE < inDataOffset + DATA_SIZE){
+            std::ostringstream sstream;
+            sstream << "file " << inPath << " (" << FILE_SIZE << " bytes) is too small for "
+                << inWidth << 'x' << inHeight << " samples of " << getSampleSize(inType) << " bytes";
+            throw std::runtime_error(sstream.str());
+        }
+    }
+
+    virtual HeightImage::Type getType() const{
+        return mType;
+    }
+
+    virtual unsigned int getWidth() const{
+        return mWidth;
+    }
+
+    virtual unsigned int getHeight() const{
+        return mHeight;
+    }
+
+    virtual void read(unsigned int inFirstColumn, unsigned int inFirstLine, unsigned int inSize, unsigned char* outData){
+        const unsigned int SAMPLE_SIZE = getSampleSize(mType);
+        const size_t LINE_SIZE = inSize * SAMPLE_SIZE;
+        for(unsigned int k = 0; k < inSize; ++k){
+            const std::streamoff offset = mDataOffset + (static_cast<std::streamoff>(inFirstLine + k) * mWidth + inFirstColumn) * SAMPLE_SIZE;
+            mFile.seekg(offset);
+            if(!mFile.read(reinterpret_cast<char*>(outData + k * LINE_SIZE), LINE_SIZE)){
+                throw std::runtime_error("can't read heights from " + mPath);
+            }
+        }
+        mConverter(mType, outData, static_cast<size_t>(inSize) * inSize);
+    }
+
+private:
+    std::ifstream mFile;
+    std::string mPath;
+    HeightImage::Type mType;
+    unsigned int mWidth;
+    unsigned int mHeight;
+    std::streamoff mDataOffset;
+    SampleConverter mConverter;
+};
+
+//opens headerless array of samples (rows go one after another)
+HeightSourcePtr openRaw(const std::string& inPath, HeightImage::Type inType, unsigned int inWidth, unsigned int inHeight, bool inBigEndian){
+    SampleConverter converter;
+    converter.swapBytes = (inBigEndian != isBigEndianHost());
+    return HeightSourcePtr(new FileHeightSource(inPath, inType, inWidth, inHeight, 0, converter));
+}
+
+//reads next token of PNM header (skips whitespaces and comments)
+std::string readPNMToken(const std::vector<unsigned char>& inData, size_t& ioPos){
+    while(ioPos < inData.size()){
+        if(inData[ioPos] == '#'){
+            while(ioPos < inData.size() && inData[ioPos] != '\n') ++ioPos;
+        }
+        else if(isspace(inData[ioPos])) ++ioPos;
+        else break;
+    }
+    std::string result;
+    while(ioPos < inData.size() && !isspace(inData[ioPos]) && inData[ioPos] != '#'){
+        result += static_cast<char>(inData[ioPos++]);
+    }
+    return result;
+}
+
+//opens binary PGM (P5) image with 8-bit or 16-bit (big-endian) samples
+//16-bit samples with maximum value below 65535 are stretched to the full range
+HeightSourcePtr openPGM(const std::string& inPath){
+    //header is read from the beginning of file, data is read on demand
+    const size_t MAX_HEADER_SIZE = 65536;
+    std::ifstream file(inPath.c_str(), std::ifstream::in | std::ifstream::binary);
+    if(!file) throw std::runtime_error("can't open file " + inPath);
+    std::vector<unsigned char> header(MAX_HEADER_SIZE);
+    file.read(reinterpret_cast<char*>(&header[0]), MAX_HEADER_SIZE);
+    header.resize(static_cast<size_t>(file.gcount()));
+
+    size_t pos = 0;
+    if(readPNMToken(header, pos) != "P5") throw std::runtime_error(inPath + " is not a binary PGM (P5) image");
+
+    const int WIDTH = atoi(readPNMToken(header, pos).c_str());
+    const int HEIGHT = atoi(readPNMToken(header, pos).c_str());
+    const int MAX_VALUE = atoi(readPNMToken(header, pos).c_str());
+    ++pos; //single whitespace after header
+    if(WIDTH <= 0 || HEIGHT <= 0 || MAX_VALUE <= 0 || MAX_VALUE > 65535 || pos > header.size()){
+        throw std::runtime_error("wrong PGM header in " + inPath);
+    }
+
+    SampleConverter converter;
+    HeightImage::Type type = HeightImage::UNSIGNED_8;
+    if(MAX_VALUE >= 256){
+        type = HeightImage::UNSIGNED_16;
+        converter.swapBytes = !isBigEndianHost();
+        if(MAX_VALUE != 65535) converter.maxValue = MAX_VALUE;
+    }
+    return HeightSourcePtr(new FileHeightSource(inPath, type, WIDTH, HEIGHT, static_cast<std::streamoff>(pos), converter));
+}
+
+//takes heights from image loaded by hydra loaders
+//8-bit images are expected to be gray, so the first channel is used
+HeightSourcePtr fromImage(const Image& inImage){
+    MemoryHeightSource* source = new MemoryHeightSource();
+    HeightSourcePtr result(source);
+    HeightImage& image = source->mImage;
+    image.width = inImage.getWidth();
+    image.height = inImage.getHeight();
+    const unsigned int PIXEL_NUM = image.width * image.height;
+
+    switch(inImage.getMode()){
+        case Image::LUMINANCE16:
+            image.type = HeightImage::UNSIGNED_16;
+            image.data.assign(inImage.getData(), inImage.getData() + PIXEL_NUM * 2);
+            break;
+        case Image::LUMINANCE_FLOAT:
+            image.type = HeightImage::FLOAT_32;
+            image.data.assign(inImage.getData(), inImage.getData() + PIXEL_NUM * 4);
+            break;
+        case Image::RGB:
+        case Image::RGBA:
+        {
+            const unsigned int STRIDE = Image::getBytesPerPixel(inImage.getMode());
+            image.type = HeightImage::UNSIGNED_8;
+            image.data.resize(PIXEL_NUM);
+            for(unsigned int i = 0; i < PIXEL_NUM; ++i) image.data[i] = inImage.getData()[i * STRIDE];
+            break;
         }
+        default:
+            throw std::runtime_error("image has unsupported format");
     }
+    return result;
+}
+
+//reads square fragment of heights to new HeightMap
+//integer heights are dequantized to [0, inMaxHeight] (minimum of signed ones gives 0)
+template <typename T>
+HeightMapPtr createFragment(HeightSource& inSource, unsigned int inFirstColumn, unsigned int inFirstLine, int inFragmentSize, float inMaxHeight){
+    assert(sizeof(T) == getSampleSize(inSource.getType()));
+
+    T* fragment_data = new T[inFragmentSize * inFragmentSize];
+    HeightMapGen<T>* heightmap = new HeightMapGen<T>(inFragmentSize, fragment_data);
+    HeightMapPtr result(heightmap);
+    inSource.read(inFirstColumn, inFirstLine, inFragmentSize, reinterpret_cast<unsigned char*>(fragment_data));
 
+    heightmap->setMinHeight(0.0f);
+    heightmap->setMaxHeight(inMaxHeight);
     return result;
 }
 
+//checks that heightmap can be splitted into square fragments of specified size
+void checkFragmentSize(const HeightSource& inSource, int inFragmentSize){
+    if(inSource.getWidth() == 0 || inSource.getHeight() == 0 ||
+       (inSource.getWidth() - 1)  % (inFragmentSize - 1) != 0 ||
+       (inSource.getHeight() - 1) % (inFragmentSize - 1) != 0 ){
+        throw std::runtime_error("Specified image can't be splitted into equal fragments of specified size without loss. Take another image or change fragment's size.");
+    }
+}
+
+//reads heights of specified fragment (fragments overlap by one line/column)
+HeightMapPtr readFragment(HeightSource& inSource, TerrainFragmentId inId, int inFragmentSize, float inMaxHeight){
+    const unsigned int FIRST_COLUMN = inId.getX() * (inFragmentSize - 1);
+    const unsigned int FIRST_LINE = inId.getY() * (inFragmentSize - 1);
+    switch(inSource.getType()){
+        case HeightImage::UNSIGNED_8:
+            return createFragment<unsigned char>(inSource, FIRST_COLUMN, FIRST_LINE, inFragmentSize, inMaxHeight);
+        case HeightImage::UNSIGNED_16:
+            return createFragment<unsigned short>(inSource, FIRST_COLUMN, FIRST_LINE, inFragmentSize, inMaxHeight);
+        case HeightImage::SIGNED_16:
+            return createFragment<short>(inSource, FIRST_COLUMN, FIRST_LINE, inFragmentSize, inMaxHeight);
+        case HeightImage::FLOAT_32:
+            return createFragment<float>(inSource, FIRST_COLUMN, FIRST_LINE, inFragmentSize, inMaxHeight);
+        default:
+            assert(false);
+            return HeightMapPtr();
+    }
+}
+
+//returns peak resident memory of the process in bytes (0 if unknown)
+size_t getPeakMemoryUsage(){
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+//========================================================================
+//=================END OF INPUT STUFF=====================================
+//========================================================================
+
 typedef TerrainFragment::QuadTreeOfChunks QTree;
 
 const char* nodePosToString(QTree::NodePos nodePos){
@@ -425,7 +847,8 @@ const char* nodePosToString(QTree::NodePos nodePos){
     return "ERROR";
 }
 
-void recursivelySaveChunks(pugi::xml_node& parentXMLNode, const QTree& tree, unsigned int position, const std::string& path, const std::string& filenamePostfix, FileSystemPtr inFileSystem){
+//if inPacked is true chunks' data is not written (it is stored in fragment's pack)
+void recursivelySaveChunks(pugi::xml_node& parentXMLNode, const QTree& tree, unsigned int position, const std::string& path, const std::string& filenamePostfix, FileSystemPtr inFileSystem, bool inPacked){
     const QTree::Node& node = tree.getNode(position);
 
     pugi::xml_node quadNode = parentXMLNode.append_child();
@@ -441,6 +864,9 @@ void recursivelySaveChunks(pugi::xml_node& parentXMLNode, const QTree& tree, uns
     {
         pugi::xml_node data = quadNode.append_child();
         data.set_name("data");
+    }
+    if(!inPacked){
+        pugi::xml_node data = quadNode.child("data");
 
         std::ostringstream sstream;
         sstream << "ilods/level_" << static_cast<int>(node.data.level) << '_' << filenamePostfix << ".bin";
@@ -478,7 +904,7 @@ void recursivelySaveChunks(pugi::xml_node& parentXMLNode, const QTree& tree, uns
 
     for(int i = 0; i < 4; ++i){
         if(node.nodes[i] != 0){
-            recursivelySaveChunks(quadNode, tree, node.nodes[i], path, filenamePostfix + nodePosToString(static_cast<QTree::NodePos>(i)), inFileSystem);
+            recursivelySaveChunks(quadNode, tree, node.nodes[i], path, filenamePostfix + nodePosToString(static_cast<QTree::NodePos>(i)), inFileSystem, inPacked);
         }
     }
 }
@@ -490,12 +916,11 @@ std::string generateMetaFilename(TerrainFragmentId inId){
 }
 
 //saves all fragment's data
+//if inPacked is true binary data is saved to single pack file (see hydra::loading::TerrainPack)
+//instead of file per chunk and per vertex level
+//XML metadata is written only if inSaveXML is true
 //returns file's name
-std::string saveFragment(TerrainFragmentId inId, TerrainFragmentPtr inFragment, FileSystemPtr inFileSystem){
-    std::cout << "Fragment " << inId.getX() << 'x' << inId.getY() << '\n' <<
-                 "number of lods: " << inFragment->tree->getResolution() << '\n' <<
-                 "number of vertex lods: " << inFragment->vertexLODs.size() << std::endl << std::endl;
-
+std::string saveFragment(TerrainFragmentId inId, TerrainFragmentPtr inFragment, FileSystemPtr inFileSystem, bool inPacked, bool inSaveXML){
     //first we must generate DOM
     //we use pugixml
 
@@ -520,17 +945,29 @@ std::string saveFragment(TerrainFragmentId inId, TerrainFragmentPtr inFragment,
         position.set_name("position");
         position.append_attribute("x") = inId.getX();
         position.append_attribute("y") = inId.getY();
+
+        if(inPacked){
+            pugi::xml_node pack = descr.append_child();
+            pack.set_name("pack");
+            pack.append_attribute("filename") = (generateMetaFilename(inId) + ".tfpack").c_str();
+        }
     }
 
     std::string newPath = generateMetaFilename(inId);
     std::string filename = newPath + '/' + generateMetaFilename(inId) + ".tfmeta";
     
     inFileSystem->createDir(newPath);
-    inFileSystem->createDir(newPath + "/vlods");
-    inFileSystem->createDir(newPath + "/ilods");
+    if(inPacked){
+        OStreamPtr stream = inFileSystem->createOutputStream(newPath + '/' + generateMetaFilename(inId) + ".tfpack");
+        TerrainPack::write(*inFragment, *stream);
+    }
+    else{
+        inFileSystem->createDir(newPath + "/vlods");
+        inFileSystem->createDir(newPath + "/ilods");
+    }
 
     //recursively save quad tree of chunks
-    recursivelySaveChunks(root, *inFragment->tree, 0, newPath, "", inFileSystem);
+    recursivelySaveChunks(root, *inFragment->tree, 0, newPath, "", inFileSystem, inPacked);
 
     //save vertex_lods
     for(size_t i = 0; i < inFragment->vertexLODs.size(); ++i){
@@ -542,6 +979,8 @@ std::string saveFragment(TerrainFragmentId inId, TerrainFragmentPtr inFragment,
 
         pugi::xml_node dataNode = newVertexLod.append_child();
         dataNode.set_name("data");
+        if(inPacked) continue;
+
         std::ostringstream sstream;
         sstream << "vlods/v_level" << i << ".bin";
         
@@ -563,8 +1002,10 @@ std::string saveFragment(TerrainFragmentId inId, TerrainFragmentPtr inFragment,
     }
 
 
-    OStreamPtr ostream = inFileSystem->createOutputStream(filename);
-    doc.save(*ostream);
+    if(inSaveXML){
+        OStreamPtr ostream = inFileSystem->createOutputStream(filename);
+        doc.save(*ostream);
+    }
 
     return filename;
 }
@@ -607,97 +1048,441 @@ void saveMainMeta(int inWidth, int inHeight, unsigned int inFragmentWidth, const
 }
 
 
-//functor for threads which are handling terrain fragment data
-class ThreadStart{
+//========================================================================
+//=================PIPELINE STUFF=========================================
+//========================================================================
+
+//Fragments go through the stages:
+//read (main thread) -> preprocess and serialize to memory (worker threads) -> write (writer thread).
+//So workers never wait for disk and output of many fragments is written sequentially.
+
+//fragment which waits for processing
+struct FragmentTask{
+    TerrainFragmentId id;
+    HeightMapPtr heights;
+    //memory reserved for fragment
+    size_t bytes;
+};
+
+//fragment which has been processed and waits for writing
+struct WriteTask{
+    TerrainFragmentId id;
+    //name of fragment's meta file
+    std::string filename;
+    BufferedFileSystemPtr data;
+    //block of binary index (see hydra::loading::TerrainIndex), empty if output isn't packed
+    std::string indexBlock;
+    //memory reserved for fragment
+    size_t bytes;
+};
 
+//Memory needed for every fragment (its heights, estimation of memory used
+//during processing and serialized data) is reserved before the fragment is read
+//and released when it has been written. So number of fragments in memory is bounded.
+class MemoryBudget: private boost::noncopyable{
 public:
-    ThreadStart(std::map<TerrainFragmentId, 
-                HeightMapPtr>& inMap, 
-                TerrainPreprocessor::Properties inProps, 
-                FileSystemPtr inFileSystem): mMap(inMap), 
-                                             mPreprocessor(inProps), 
-                                             mFileSystem(inFileSystem){
-    
+    MemoryBudget(size_t inBudget): mBudget(inBudget), mReserved(0), mMaxReserved(0){
+
     }
 
-    ThreadStart(const ThreadStart& inStart): mMap(inStart.mMap), 
-                                mPreprocessor(inStart.mPreprocessor.getProperties()), 
-                                mFileSystem(inStart.mFileSystem){
+    //blocks till specified amount of memory fits into budget
+    //(single fragment is always allowed, even if it exceeds budget)
+    void reserve(size_t inBytes){
+        boost::unique_lock<boost::mutex> lock(mMutex);
+        while(mReserved != 0 && mReserved + inBytes > mBudget) mReleased.wait(lock);
+        mReserved += inBytes;
+        mMaxReserved = std::max(mMaxReserved, mReserved);
+    }
 
+    void release(size_t inBytes){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        assert(mReserved >= inBytes);
+        mReserved -= inBytes;
+        mReleased.notify_all();
     }
 
-    void operator()(){
-        try{
-            std::pair<TerrainFragmentId, HeightMapPtr> nextFragmentData;
-            nextFragmentData = getNextFragmentData();
-            
-            //while there is data to handle
-            while(nextFragmentData.second){
-                TerrainFragmentPtr fragment = mPreprocessor.process(*(nextFragmentData.second));
+    size_t getBudget() const{
+        return mBudget;
+    }
 
-                //now we must save data
-                std::string filename = saveFragment(nextFragmentData.first, fragment, mFileSystem);
-                addToFragmentList(nextFragmentData.first, filename);
+    //returns maximum amount of memory which has been reserved at once
+    size_t getMaxReserved(){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        return mMaxReserved;
+    }
 
-                nextFragmentData = getNextFragmentData();
-            }
+private:
+    size_t mBudget;
+    size_t mReserved;
+    size_t mMaxReserved;
+    boost::mutex mMutex;
+    boost::condition_variable mReleased;
+};
+
+//queue of tasks between stages
+template <typename Task>
+class TaskQueue: private boost::noncopyable{
+public:
+    TaskQueue(): mClosed(false){
+
+    }
+
+    void push(const Task& inTask){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        mTasks.push_back(inTask);
+        mPushed.notify_one();
+    }
+
+    //blocks till next task is available
+    //returns false if queue is closed and there is nothing to handle
+    bool pop(Task& outTask){
+        boost::unique_lock<boost::mutex> lock(mMutex);
+        while(mTasks.empty() && !mClosed) mPushed.wait(lock);
+        if(mTasks.empty()) return false;
+        outTask = mTasks.front();
+        mTasks.pop_front();
+        return true;
+    }
+
+    //no more tasks will be pushed
+    void close(){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        mClosed = true;
+        mPushed.notify_all();
+    }
+
+private:
+    std::deque<Task> mTasks;
+    bool mClosed;
+    boost::mutex mMutex;
+    boost::condition_variable mPushed;
+};
+
+//estimation of memory used by TerrainPreprocessor per sample of fragment
+//(quad tree of errors, flags, vertices, normals and output data)
+const size_t PROCESSING_BYTES_PER_SAMPLE = 256;
+
+//stages of pipeline which are timed
+enum Stage{
+    STAGE_READ = 0,
+    STAGE_VERTICES,
+    STAGE_OPTIMIZATION,
+    STAGE_CHUNKS,
+    STAGE_SERIALIZATION,
+    STAGE_WRITE,
+    //reading thread waits for memory budget
+    STAGE_BUDGET_WAIT,
+    //worker threads wait for fragments
+    STAGE_WORKER_WAIT,
+    STAGE_NUM
+};
+
+const char* getStageName(Stage inStage){
+    switch(inStage){
+        case STAGE_READ: return "read";
+        case STAGE_VERTICES: return "vertices";
+        case STAGE_OPTIMIZATION: return "optimization";
+        case STAGE_CHUNKS: return "chunks";
+        case STAGE_SERIALIZATION: return "serialization";
+        case STAGE_WRITE: return "write";
+        case STAGE_BUDGET_WAIT: return "budget_wait";
+        case STAGE_WORKER_WAIT: return "worker_wait";
+        default:
+            assert(false);
+            return "ERROR";
+    }
+}
+
+//escapes string for JSON
+std::string toJSONString(const std::string& inString){
+    std::ostringstream result;
+    result << '"';
+    for(size_t i = 0; i < inString.size(); ++i){
+        const unsigned char next = static_cast<unsigned char>(inString[i]);
+        if(next == '"' || next == '\\') result << '\\' << next;
+        else if(next < 0x20) result << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<unsigned int>(next) << std::dec << std::setfill(' ');
+        else result << next;
+    }
+    result << '"';
+    return result.str();
+}
+
+//thread-safe statistics of run: progress, time of stages and size of output
+class Statistics: private boost::noncopyable{
+public:
+    Statistics(unsigned int inTotalFragments): mTotal(inTotalFragments),
+                                               mWritten(0),
+                                               mFailed(0),
+                                               mTriangles(0),
+                                               mVertices(0),
+                                               mBytes(0),
+                                               mLastReport(0.0){
+        for(int i = 0; i < STAGE_NUM; ++i) mStageTime[i] = 0.0;
+        mTimer.start();
+    }
+
+    //adds time (in seconds) spent in stage
+    void addTime(Stage inStage, double inSeconds){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        mStageTime[inStage] += inSeconds;
+    }
+
+    //adds data of preprocessed fragment
+    void addProcessed(const TerrainPreprocessor::Timings& inTimings, const TerrainFragment& inFragment){
+        size_t triangles = 0;
+        for(TerrainFragment::QuadTreeOfChunks::const_iterator iter = inFragment.tree->begin(); iter != inFragment.tree->end(); ++iter){
+            triangles += iter->data.ptr->indices.size() / 3;
         }
-        catch(const std::runtime_error& e){
-            std::cerr << "WARNING: exception got in thread #" << boost::this_thread::get_id() <<
-                " : " << e.what() << std::endl;
+        size_t vertices = 0;
+        for(size_t i = 0; i < inFragment.vertexLODs.size(); ++i) vertices += inFragment.vertexLODs[i].size();
+
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        mStageTime[STAGE_VERTICES] += inTimings.vertices / 1e6;
+        mStageTime[STAGE_OPTIMIZATION] += inTimings.optimization / 1e6;
+        mStageTime[STAGE_CHUNKS] += inTimings.chunks / 1e6;
+        mTriangles += triangles;
+        mVertices += vertices;
+    }
+
+    //adds written fragment and prints progress (not more often than once a second)
+    void addWritten(size_t inBytes){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        ++mWritten;
+        mBytes += inBytes;
+        reportProgress();
+    }
+
+    void addFailed(){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        ++mFailed;
+        reportProgress();
+    }
+
+    unsigned int getFailed(){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        return mFailed;
+    }
+
+    //prints time of stages and results
+    void printSummary(std::ostream& inStream){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        const double ELAPSED = getElapsed();
+        inStream << "done: " << mWritten << " fragments written, " << mFailed << " failed, "
+            << std::fixed << std::setprecision(1) << ELAPSED << " s, "
+            << mTriangles << " triangles, " << mVertices << " vertices, " << mBytes / 1024 << " KB" << std::endl;
+        inStream << "time of stages (summed over threads):" << std::endl;
+        for(int i = 0; i < STAGE_NUM; ++i){
+            inStream << "  " << std::setw(14) << std::left << getStageName(static_cast<Stage>(i)) << std::right
+                << std::setw(9) << std::setprecision(3) << mStageTime[i] << " s" << std::endl;
         }
-        catch(const std::exception& e){
-            std::cerr << "WARNING: exception got in thread #" << boost::this_thread::get_id() <<
-                " : " << e.what() << std::endl;
+    }
 
-            //std::cerr << "WARNING: unknown exception has been thrown in thread #" << boost::this_thread::get_id() << std::endl;
+    //saves summary in JSON
+    void saveJSON(const std::string& inPath, const std::string& inLandscapeName, unsigned int inWidth, unsigned int inHeight,
+                  unsigned int inSampleBits, unsigned int inThreads, size_t inBudget, size_t inMaxReserved, size_t inPeakMemory){
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        std::ofstream file(inPath.c_str());
+        if(!file) throw std::runtime_error("can't create " + inPath);
+        const double ELAPSED = getElapsed();
+
+        file << "{\n"
+            << "  \"landscape\": " << toJSONString(inLandscapeName) << ",\n"
+            << "  \"width\": " << inWidth << ",\n"
+            << "  \"height\": " << inHeight << ",\n"
+            << "  \"sample_bits\": " << inSampleBits << ",\n"
+            << "  \"threads\": " << inThreads << ",\n"
+            << "  \"fragments\": " << mTotal << ",\n"
+            << "  \"fragments_written\": " << mWritten << ",\n"
+            << "  \"fragments_failed\": " << mFailed << ",\n"
+            << "  \"wall_seconds\": " << ELAPSED << ",\n"
+            << "  \"fragments_per_second\": " << (ELAPSED > 0.0 ? mWritten / ELAPSED : 0.0) << ",\n"
+            << "  \"triangles\": " << mTriangles << ",\n"
+            << "  \"vertices\": " << mVertices << ",\n"
+            << "  \"output_bytes\": " << mBytes << ",\n"
+            << "  \"stage_seconds\": {";
+        for(int i = 0; i < STAGE_NUM; ++i){
+            file << (i ? ", " : "") << '"' << getStageName(static_cast<Stage>(i)) << "\": " << mStageTime[i];
         }
+        file << "},\n"
+            << "  \"memory_budget_bytes\": " << inBudget << ",\n"
+            << "  \"max_reserved_bytes\": " << inMaxReserved << ",\n"
+            << "  \"peak_rss_bytes\": " << inPeakMemory << "\n"
+            << "}\n";
     }
 
-    //thread-safe function to get next fragment data from container and delete it
-    std::pair<TerrainFragmentId, HeightMapPtr> getNextFragmentData(){
-        boost::lock_guard<boost::mutex> lock(sMapMutex);
+private:
+    double getElapsed(){
+        return mTimer.getMicroseconds() / 1e6;
+    }
 
-        //take beginning
-        std::map<TerrainFragmentId, HeightMapPtr>::iterator begin = mMap.begin();
-        //if nothing to work with, return empty pair
-        if(begin == mMap.end()) return std::pair<TerrainFragmentId, HeightMapPtr>();
+    void reportProgress(){
+        const unsigned int DONE = mWritten + mFailed;
+        const double ELAPSED = getElapsed();
+        if(DONE != mTotal && ELAPSED - mLastReport < 1.0) return;
+        mLastReport = ELAPSED;
+
+        const double ETA = (DONE != 0) ? ELAPSED / DONE * (mTotal - DONE) : 0.0;
+        std::cout << "progress: " << DONE << '/' << mTotal << " fragments ("
+            << std::fixed << std::setprecision(1) << 100.0 * DONE / mTotal << "%), "
+            << ELAPSED << " s elapsed, ETA " << ETA << " s, "
+            << std::setprecision(2) << (ELAPSED > 0.0 ? DONE / ELAPSED : 0.0) << " fragments/s" << std::endl;
+    }
 
-        //copy pair
-        std::pair<TerrainFragmentId, HeightMapPtr> result = *begin;
-        //erase from map
-        mMap.erase(begin);
+    hydra::common::Timer mTimer;
+    unsigned int mTotal;
+    unsigned int mWritten;
+    unsigned int mFailed;
+    size_t mTriangles;
+    size_t mVertices;
+    size_t mBytes;
+    double mStageTime[STAGE_NUM];
+    double mLastReport;
+    boost::mutex mMutex;
+};
 
-        //return result (Truly yours, Cpt.)
-        return result;
+//returns seconds elapsed since timer's start
+inline double getSeconds(hydra::common::Timer& inTimer){
+    return inTimer.getMicroseconds() / 1e6;
+}
 
-        //unlock mutex
-    }
+
+//functor for threads which are handling terrain fragment data
+//fragments are preprocessed and serialized to memory
+class ThreadStart{
 
 public:
-    static std::vector<std::pair<TerrainFragmentId, std::string> > sFileList;
+    ThreadStart(TaskQueue<FragmentTask>& inQueue,
+                TaskQueue<WriteTask>& inWriteQueue,
+                MemoryBudget& inBudget,
+                Statistics& inStatistics,
+                TerrainPreprocessor::Properties inProps,
+                bool inPacked,
+                bool inSaveXML): mQueue(inQueue), 
+                                 mWriteQueue(inWriteQueue),
+                                 mBudget(inBudget),
+                                 mStatistics(inStatistics),
+                                 mPreprocessor(inProps),
+                                 mPacked(inPacked),
+                                 mSaveXML(inSaveXML){
+    
+    }
+
+    ThreadStart(const ThreadStart& inStart): mQueue(inStart.mQueue), 
+                                mWriteQueue(inStart.mWriteQueue),
+                                mBudget(inStart.mBudget),
+                                mStatistics(inStart.mStatistics),
+                                mPreprocessor(inStart.mPreprocessor.getProperties()),
+                                mPacked(inStart.mPacked),
+                                mSaveXML(inStart.mSaveXML){
+
+    }
+
+    void operator()(){
+        FragmentTask task;
+        hydra::common::Timer timer;
+            
+        //while there is data to handle
+        timer.start();
+        while(mQueue.pop(task)){
+            mStatistics.addTime(STAGE_WORKER_WAIT, getSeconds(timer));
+            try{
+                TerrainFragmentPtr fragment = mPreprocessor.process(*task.heights);
+                task.heights.reset();
+                mStatistics.addProcessed(mPreprocessor.getTimings(), *fragment);
+
+                //now we must save data (to memory, it will be written by writer)
+                timer.start();
+                WriteTask writeTask;
+                writeTask.id = task.id;
+                writeTask.data = BufferedFileSystemPtr(new BufferedFileSystem());
+                writeTask.filename = saveFragment(task.id, fragment, writeTask.data, mPacked, mSaveXML);
+                if(mPacked) writeTask.indexBlock = TerrainIndex::encodeFragment(*fragment);
+                writeTask.bytes = task.bytes;
+                mStatistics.addTime(STAGE_SERIALIZATION, getSeconds(timer));
+
+                mWriteQueue.push(writeTask);
+            }
+            catch(const std::exception& e){
+                std::cerr << "WARNING: exception got in thread #" << boost::this_thread::get_id() <<
+                    " : " << e.what() << std::endl;
+                task.heights.reset();
+                mBudget.release(task.bytes);
+                mStatistics.addFailed();
+            }
+            timer.start();
+        }
+    }
 
 private:
     ThreadStart& operator=(const ThreadStart& inStart); //NO IMPLEMENTATION
 
-    //adds new file to fragmentlist (thread-safe)
-    static void addToFragmentList(TerrainFragmentId inId, const std::string& inFilename){
-        boost::lock_guard<boost::mutex> lock(sFileListMutex);
+    TaskQueue<FragmentTask>& mQueue;
+    TaskQueue<WriteTask>& mWriteQueue;
+    MemoryBudget& mBudget;
+    Statistics& mStatistics;
+    TerrainPreprocessor mPreprocessor;
+    bool mPacked;
+    bool mSaveXML;
+};
+
+//functor for thread which writes serialized fragments to output file system
+class WriterStart{
+
+public:
+    WriterStart(TaskQueue<WriteTask>& inQueue,
+                MemoryBudget& inBudget,
+                Statistics& inStatistics,
+                FileSystemPtr inFileSystem,
+                TerrainIndex::Writer* inIndexWriter): mQueue(inQueue),
+                                                      mBudget(inBudget),
+                                                      mStatistics(inStatistics),
+                                                      mFileSystem(inFileSystem),
+                                                      mIndexWriter(inIndexWriter){
 
-        sFileList.push_back(std::make_pair(inId, inFilename));
     }
 
-    std::map<TerrainFragmentId, HeightMapPtr>& mMap;
-    TerrainPreprocessor mPreprocessor;
-    FileSystemPtr mFileSystem;
+    void operator()(){
+        WriteTask task;
+        hydra::common::Timer timer;
+        while(mQueue.pop(task)){
+            timer.start();
+            try{
+                task.data->flush(*mFileSystem);
+                if(mIndexWriter) mIndexWriter->addFragment(task.id, task.indexBlock);
+                sFileList.push_back(std::make_pair(task.id, task.filename));
+                mStatistics.addTime(STAGE_WRITE, getSeconds(timer));
+                mStatistics.addWritten(task.data->getSize());
+            }
+            catch(const std::exception& e){
+                std::cerr << "WARNING: exception got while writing fragment " << task.id.getX() << 'x' << task.id.getY() <<
+                    " : " << e.what() << std::endl;
+                mStatistics.addFailed();
+            }
+            task.data.reset();
+            mBudget.release(task.bytes);
+        }
+    }
+
+public:
+    //written fragments (used by the only writer thread, read after it has finished)
+    static std::vector<std::pair<TerrainFragmentId, std::string> > sFileList;
 
-    static boost::mutex sMapMutex;
-    static boost::mutex sFileListMutex;
+private:
+    WriterStart& operator=(const WriterStart& inStart); //NO IMPLEMENTATION
+
+    TaskQueue<WriteTask>& mQueue;
+    MemoryBudget& mBudget;
+    Statistics& mStatistics;
+    FileSystemPtr mFileSystem;
+    //0 if output isn't packed
+    TerrainIndex::Writer* mIndexWriter;
 };
 
-boost::mutex ThreadStart::sMapMutex;
-boost::mutex ThreadStart::sFileListMutex;
-std::vector<std::pair<TerrainFragmentId, std::string> > ThreadStart::sFileList;
+std::vector<std::pair<TerrainFragmentId, std::string> > WriterStart::sFileList;
+
+//========================================================================
+//=================END OF PIPELINE STUFF==================================
+//========================================================================
 
 
 int main(int ac, char** av){
@@ -714,9 +1499,7 @@ int main(int ac, char** av){
         return 1;
     }
 
-    ImagePtr image;
-    //init hydra factories
-    initFactories();
+    HeightSourcePtr source;
 
     //if name of heightmap contains '?' we are loading
     //from zip archive
@@ -730,41 +1513,58 @@ int main(int ac, char** av){
             std::string pathToZip = args.inputHeightmap.substr(0, questionSignPos);
             std::string pathInZip = args.inputHeightmap.substr(questionSignPos);
             landscapeName = pathInZip.substr(pathInZip.find_last_of("/\\") + 1);
-            image = loadFromZipFile<Image>(pathToZip, pathInZip);
+            if(!args.rawFormat.empty()) throw std::runtime_error("raw heightmaps can't be read from zip archives");
+
+            //init hydra factories (16-bit and float images keep their precision)
+            initFactories(true);
+            source = fromImage(*loadFromZipFile<Image>(pathToZip, pathInZip));
+            //drop hydra factories
+            dropFactories();
         }
         else{
             landscapeName = args.inputHeightmap.substr(args.inputHeightmap.find_last_of("/\\") + 1);
-            image = loadFromFile<Image>(args.inputHeightmap);
+            std::string extension = filesystem::extension(args.inputHeightmap);
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+            if(!args.rawFormat.empty()){
+                source = openRaw(args.inputHeightmap, parseRawFormat(args.rawFormat), args.rawWidth, args.rawHeight, args.bigEndian);
+            }
+            else if(extension == ".pgm"){
+                //read by ourselves to keep 16-bit samples and to stream them
+                source = openPGM(args.inputHeightmap);
+            }
+            else{
+                //init hydra factories (16-bit and float images keep their precision)
+                initFactories(true);
+                source = fromImage(*loadFromFile<Image>(args.inputHeightmap));
+                //drop hydra factories
+                dropFactories();
+            }
         }
     }
     catch(const std::runtime_error& e){
         std::cerr << "Error while reading heightmap file: " << e.what() << std::endl;
         return 1;
     }
-    //drop hydra factories
-    dropFactories();
-    assert(image);
 
-    const unsigned int IMAGE_WIDTH = image->getWidth();
-    const unsigned int IMAGE_HEIGHT = image->getHeight();
-    
-    //map which contains data to be processed
-    std::map<TerrainFragmentId, HeightMapPtr> fragmentData;
+    assert(source);
+    const unsigned int IMAGE_WIDTH = source->getWidth();
+    const unsigned int IMAGE_HEIGHT = source->getHeight();
+    const HeightImage::Type SAMPLE_TYPE = source->getType();
+    std::cout << "heightmap " << IMAGE_WIDTH << 'x' << IMAGE_HEIGHT << ", "
+        << getSampleSize(SAMPLE_TYPE) * 8 << (SAMPLE_TYPE == HeightImage::FLOAT_32 ? "-bit float" : "-bit integer") << " samples" << std::endl;
 
     try{
-        //we should fill map with data by splitting original heightmap
-        //into smaller ones (one for each fragment)
-        fragmentData = splitIntoFragments(image, args.fragmentSize, args.maxHeight);
+        checkFragmentSize(*source, args.fragmentSize);
     }
     catch(const std::runtime_error& e){
         std::cerr << "Error while splitting heightmap into fragments: " << e.what() << std::endl;
         return 1;
     }
 
-    assert(!fragmentData.empty());
-
-    //we don't need image data anymore, all the data is stored in fragments
-    image.reset();
+    const unsigned int VERT_NUMBER_OF_FRAGMENTS = (IMAGE_HEIGHT - 1) / (args.fragmentSize - 1);
+    const unsigned int HORIZ_NUMBER_OF_FRAGMENTS = (IMAGE_WIDTH - 1) / (args.fragmentSize - 1);
+    std::cout << "splitted to " << VERT_NUMBER_OF_FRAGMENTS << 'x' << HORIZ_NUMBER_OF_FRAGMENTS << std::endl;
 
     FileSystemPtr fileSystem;
     if(!args.outZip.empty()){
@@ -781,8 +1581,13 @@ int main(int ac, char** av){
     //now we should handle all the fragments and generate tree of LODs for each one.
     //Then we should save those trees to files and save some metadata to make
     //renderer's life easier.
-    //All those stuff is done in multiple threads.
+    //Fragments are read in this thread on demand (while they fit into memory budget),
+    //handled in multiple threads and written by separate thread.
     boost::thread_group threadGroup;
+    MemoryBudget budget(args.memoryBudget);
+    TaskQueue<FragmentTask> queue;
+    TaskQueue<WriteTask> writeQueue;
+    Statistics statistics(VERT_NUMBER_OF_FRAGMENTS * HORIZ_NUMBER_OF_FRAGMENTS);
 
     TerrainPreprocessor::Properties properties;
     properties.numOfLODs = args.lodNum;
@@ -790,20 +1595,102 @@ int main(int ac, char** av){
     properties.LODErrorFactor = args.lodErrorFactor; 
     properties.vertexLODFactor = args.vertexLODFactor;
     properties.generateSkirts = true;
+    //threads which would have no fragment to handle help to triangulate the others
+    const unsigned int FRAGMENT_NUM = VERT_NUMBER_OF_FRAGMENTS * HORIZ_NUMBER_OF_FRAGMENTS;
+    properties.optimizerThreadNum = (FRAGMENT_NUM > 0 && FRAGMENT_NUM < args.threadNum)? args.threadNum / FRAGMENT_NUM: 1;
     
-    ThreadStart threadStart(fragmentData, properties, fileSystem);
+    //packed output has binary metadata index, XML is saved only if requested
+    const bool SAVE_XML = !args.packed || args.xmlMeta;
+    OStreamPtr indexStream;
+    boost::scoped_ptr<TerrainIndex::Writer> indexWriter;
+    if(args.packed){
+        indexStream = fileSystem->createOutputStream("main.index");
+        indexWriter.reset(new TerrainIndex::Writer(*indexStream));
+    }
+
+    ThreadStart threadStart(queue, writeQueue, budget, statistics, properties, args.packed, SAVE_XML);
 
     for(unsigned int i = 0; i < args.threadNum; ++i){
         threadGroup.create_thread(threadStart);
     }
+    boost::thread writer(WriterStart(writeQueue, budget, statistics, fileSystem, indexWriter.get()));
+
+    const size_t FRAGMENT_SAMPLES = args.fragmentSize * args.fragmentSize;
+    const size_t FRAGMENT_BYTES = FRAGMENT_SAMPLES * (getSampleSize(SAMPLE_TYPE) + PROCESSING_BYTES_PER_SAMPLE);
+    bool readError = false;
+    hydra::common::Timer timer;
+    try{
+        for(unsigned int y = 0; y < VERT_NUMBER_OF_FRAGMENTS; ++y){ //Y
+            for(unsigned int x = 0; x < HORIZ_NUMBER_OF_FRAGMENTS; ++x){ //X
+                FragmentTask task;
+                task.id = TerrainFragmentId(x, y);
+                task.bytes = FRAGMENT_BYTES;
+                timer.start();
+                budget.reserve(task.bytes);
+                statistics.addTime(STAGE_BUDGET_WAIT, getSeconds(timer));
+
+                timer.start();
+                try{
+                    task.heights = readFragment(*source, task.id, args.fragmentSize, args.maxHeight);
+                }
+                catch(...){
+                    budget.release(task.bytes);
+                    throw;
+                }
+                statistics.addTime(STAGE_READ, getSeconds(timer));
+                queue.push(task);
+            }
+        }
+    }
+    catch(const std::exception& e){
+        //any error (bad_alloc too) must reach queue.close() below, otherwise workers never stop
+        std::cerr << "Error while reading heightmap fragments: " << e.what() << std::endl;
+        readError = true;
+    }
+    catch(...){
+        std::cerr << "Error while reading heightmap fragments: unknown exception" << std::endl;
+        readError = true;
+    }
+    queue.close();
     
     //wait till they finish
     threadGroup.join_all();
+    writeQueue.close();
+    writer.join();
+    source.reset();
+    if(readError) return 1;
 
     //we should create and save main metadata file
-    saveMainMeta(IMAGE_WIDTH, IMAGE_HEIGHT, args.fragmentSize, ThreadStart::sFileList, landscapeName, fileSystem);
+    if(indexWriter){
+        try{
+            indexWriter->finish(args.fragmentSize, IMAGE_WIDTH, IMAGE_HEIGHT);
+        }
+        catch(const std::runtime_error& e){
+            std::cerr << "Error while saving terrain index: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if(SAVE_XML){
+        saveMainMeta(IMAGE_WIDTH, IMAGE_HEIGHT, args.fragmentSize, WriterStart::sFileList, landscapeName, fileSystem);
+    }
+
+    statistics.printSummary(std::cout);
+    const size_t PEAK_MEMORY = getPeakMemoryUsage();
+    std::cout << "peak memory usage: " << PEAK_MEMORY / (1024 * 1024) << " MB (fragments took up to "
+        << budget.getMaxReserved() / (1024 * 1024) << " MB of " << budget.getBudget() / (1024 * 1024) << " MB budget)" << std::endl;
+
+    if(!args.summaryJSON.empty()){
+        try{
+            statistics.saveJSON(args.summaryJSON, landscapeName, IMAGE_WIDTH, IMAGE_HEIGHT, getSampleSize(SAMPLE_TYPE) * 8,
+                                args.threadNum, budget.getBudget(), budget.getMaxReserved(), PEAK_MEMORY);
+        }
+        catch(const std::runtime_error& e){
+            std::cerr << "Error while saving summary: " << e.what() << std::endl;
+            return 1;
+        }
+    }
 
-    return 0;
+    return (statistics.getFailed() == 0) ? 0 : 1;
 }
 
 /*
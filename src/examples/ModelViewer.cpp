@@ -193,8 +193,8 @@ static VarrayIds createMeshBufferObject(const MeshPtr inMesh){
     glBufferDataARB(GL_ARRAY_BUFFER_ARB, static_cast<GLsizeiptr>(sizeof(Vertex) * inMesh->getVertexNum()),
                         (const void*)(&inMesh->mVertices[0]), GL_STATIC_DRAW_ARB);
     glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, newVarrayIds.IBO);
-    glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, static_cast<GLsizeiptr>(sizeof(unsigned int) * inMesh->getIndexNum()),
-                        (const void*)(&inMesh->mIndices[0]), GL_STATIC_DRAW_ARB);
+    glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, static_cast<GLsizeiptr>(inMesh->mIndices.getDataSize()),
+                        inMesh->mIndices.getData(), GL_STATIC_DRAW_ARB);
 
     glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
     glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
@@ -418,10 +418,11 @@ static void render(){
         glVertexPointer(3, GL_FLOAT, vertexStride, (void*)0);
 
         glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, gVarrays[i].IBO);
+        GLenum indexType = (gModel->mMeshes[i]->mIndices.getWidth() == IndexBuffer::WIDTH_16)? GL_UNSIGNED_SHORT: GL_UNSIGNED_INT;
         if(gModel->mMeshes[i]->mMode == Mesh::TRIANGLES) 
-            glDrawElements(GL_TRIANGLES, gModel->mMeshes[i]->getIndexNum(), GL_UNSIGNED_INT, (void*)(coordOffset));
+            glDrawElements(GL_TRIANGLES, gModel->mMeshes[i]->getIndexNum(), indexType, (void*)(coordOffset));
         else if(gModel->mMeshes[i]->mMode == Mesh::TRIANGLE_STRIP)
-            glDrawElements(GL_TRIANGLE_STRIP, gModel->mMeshes[i]->getIndexNum(), GL_UNSIGNED_INT, (void*)(coordOffset));
+            glDrawElements(GL_TRIANGLE_STRIP, gModel->mMeshes[i]->getIndexNum(), indexType, (void*)(coordOffset));
         else assert(!"unsupported primitive assemble mode!");
     }
         
@@ -647,6 +648,9 @@ int main (int argv, char** args){
     dropFactories();
     
     gModel->sortMeshesByOpacity();
+    size_t drawNum = gModel->mMeshes.size();
+    gModel->mergeMeshes();
+    std::cout << "meshes merged, draw calls: " << drawNum << " -> " << gModel->mMeshes.size() << std::endl;
     MeshOptimizer meshOpt;
     meshOpt.setCacheSize(32);
     BOOST_FOREACH(MeshPtr nextMesh, gModel->mMeshes){
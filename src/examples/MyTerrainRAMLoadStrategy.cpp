@@ -13,6 +13,8 @@
  */
 
 #include "MyTerrainRAMLoadStrategy.hpp"
+#include "loading/TerrainPack.hpp"
+#include "loading/TerrainIndex.hpp"
 
 //boost headers
 #include <boost/asio/io_service.hpp>
@@ -47,6 +49,10 @@ using hydra::data::TerrainFragmentId;
 using hydra::data::TerrainChunk;
 using hydra::data::TerrainChunkPtr;
 using hydra::data::TerrainChunkId;
+using hydra::loading::TerrainPack;
+using hydra::loading::TerrainPackPtr;
+using hydra::loading::TerrainIndex;
+using hydra::loading::TerrainIndexPtr;
 
 typedef TerrainFragment::QuadTreeOfChunksPtr QTreePtr;
 typedef TerrainFragment::QuadTreeOfChunks QTree;
@@ -64,6 +70,12 @@ public:
     }
 
     virtual IStreamPtr createInputStream(const std::string& inPath) = 0;
+
+    //returns true if file exists
+    virtual bool exists(const std::string& inPath) = 0;
+
+    //opens fragment's pack (throws runtime_error)
+    virtual TerrainPackPtr openPack(const std::string& inPath) = 0;
 };
 
 typedef hydra::common::SharedPtr<FileSystem>::Type FileSystemPtr;
@@ -143,6 +155,18 @@ public:
         return result;
     }
 
+    virtual bool exists(const std::string& inPath){
+        assert(mArchive);
+        boost::lock_guard<boost::mutex> lock(mArchiveMutex);
+        return zip_name_locate(mArchive, inPath.c_str(), 0) >= 0;
+    }
+
+    virtual TerrainPackPtr openPack(const std::string& inPath){
+        //entries of archive can't be read by ranges
+        std::cerr << "Can't open pack from archive: " << inPath << std::endl;
+        throw std::runtime_error("Terrain packs are not supported in zip archives.");
+    }
+
 private:
     boost::mutex mArchiveMutex;
     zip* mArchive;
@@ -165,6 +189,14 @@ public:
         return fstream;
     }
 
+    virtual bool exists(const std::string& inPath){
+        return boost::filesystem::exists((mPath + "/" + inPath).c_str());
+    }
+
+    virtual TerrainPackPtr openPack(const std::string& inPath){
+        return TerrainPackPtr(new TerrainPack(mPath + "/" + inPath));
+    }
+
 private:
     std::string mPath;
 };
@@ -187,6 +219,8 @@ struct MetaData{
         std::string metaFile;
         std::vector<MetaData::VLOD> vlods;
         std::vector<MetaData::Chunk> chunks;
+        //binary data of fragment (empty if every chunk and vlod has its own file)
+        TerrainPackPtr pack;
     };
 
     typedef std::map<TerrainFragmentId, MetaData::Fragment> FragmentCont;
@@ -195,6 +229,8 @@ struct MetaData{
     unsigned int terrainWidth;
     unsigned int terrainHeight;
     FragmentCont fragments;
+    //binary metadata (empty if metadata is read from XML files)
+    TerrainIndexPtr index;
 };
 
 typedef hydra::common::SharedPtr<MetaData>::Type MetaDataPtr;
@@ -212,8 +248,13 @@ struct MyTerrainRAMLoadStrategy::Impl{
             fileSystem = FileSystemPtr(new ZipFileSystem(inPath));
         }
 
-        //now we should read main.meta file
-        metaData = readMainMeta(fileSystem->createInputStream("main.meta"));
+        //now we should read binary index (packed terrain) or main.meta file
+        if(fileSystem->exists("main.index")){
+            metaData = readIndex(fileSystem->createInputStream("main.index"));
+        }
+        else{
+            metaData = readMainMeta(fileSystem->createInputStream("main.meta"));
+        }
 
         terrain->setFragmentWidth(metaData->fragmentWidth);
 
@@ -225,6 +266,19 @@ struct MyTerrainRAMLoadStrategy::Impl{
         }
     }
 
+    MetaDataPtr readIndex(IStreamPtr inStream){
+        MetaDataPtr result = MetaDataPtr(new MetaData());
+        result->index = TerrainIndexPtr(new TerrainIndex(*inStream));
+        result->fragmentWidth = result->index->getFragmentWidth();
+        result->terrainWidth = result->index->getTerrainWidth();
+        result->terrainHeight = result->index->getTerrainHeight();
+
+        for(unsigned int i = 0; i < result->index->getFragmentNum(); ++i){
+            result->fragments[result->index->getFragmentId(i)] = MetaData::Fragment();
+        }
+        return result;
+    }
+
     MetaDataPtr readMainMeta(IStreamPtr inStream){
         if(!inStream->good()) throw std::runtime_error("Can't read main.meta file (bad stream)");
 
@@ -286,6 +340,11 @@ struct MyTerrainRAMLoadStrategy::Impl{
 static TerrainChunkPtr getChunk(TerrainChunkId inId, const MetaData::Fragment& meta, FileSystemPtr fileSystem){
     TerrainChunkPtr chunk(new TerrainChunk());
 
+    if(meta.pack){
+        meta.pack->readChunk(inId.getQuadTreePos(), *chunk);
+        return chunk;
+    }
+
     //get filename
     //.tfmeta directory + '/' + path
     std::string filename = meta.metaFile.substr(0, meta.metaFile.find_last_of("/\\"));
@@ -405,15 +464,20 @@ static void doLoadChunk(TerrainChunkId inId, MetaDataPtr meta, ChunkedTerrainPtr
                     else continue;
                 }
 
-                //get filename
-                std::string filename = fragmentMeta.metaFile.substr(0, fragmentMeta.metaFile.find_last_of("/\\"));
-                filename += ('/' + fragmentMeta.vlods[i].fileName);
+                if(fragmentMeta.pack){
+                    fragmentMeta.pack->readVertexLOD(i, fragment.vertexLODs[i]);
+                }
+                else{
+                    //get filename
+                    std::string filename = fragmentMeta.metaFile.substr(0, fragmentMeta.metaFile.find_last_of("/\\"));
+                    filename += ('/' + fragmentMeta.vlods[i].fileName);
 
-                //create stream
-                IStreamPtr stream = fileSystem->createInputStream(filename);
+                    //create stream
+                    IStreamPtr stream = fileSystem->createInputStream(filename);
 
-                //load data
-                loadVertexLOD(stream, fragment.vertexLODs[i], fragmentMeta.vlods[i].vertexNum);
+                    //load data
+                    loadVertexLOD(stream, fragment.vertexLODs[i], fragmentMeta.vlods[i].vertexNum);
+                }
                 
                 fragment.vertexLODsStatuses[i] = TerrainFragment::RAM;
             }
@@ -504,7 +568,41 @@ static void traverseFragmentMeta(QTreePtr tree, pugi::xml_node& xmlNode, std::ve
     }
 }
 
+//builds fragment's tree from binary index (no parsing, records are copied)
+static QTreePtr getFragmentTreeFromIndex(TerrainFragmentId inId, MetaDataPtr meta, FileSystemPtr fileSystem){
+    const TerrainIndex& index = *meta->index;
+    MetaData::Fragment& fragmentMeta = meta->fragments[inId];
+
+    const unsigned int CHUNK_NUM = index.getChunkNum(inId);
+    const TerrainIndex::ChunkRecord* chunks = index.getChunks(inId);
+    fragmentMeta.chunks.resize(CHUNK_NUM);
+    for(unsigned int i = 0; i < CHUNK_NUM; ++i){
+        fragmentMeta.chunks[i].indicesNum = chunks[i].indexNum;
+    }
+
+    const unsigned int VLOD_NUM = index.getVertexLODNum(inId);
+    const boost::uint32_t* vertexNums = index.getVertexNums(inId);
+    MetaData::VLOD emptyVLOD;
+    emptyVLOD.vertexNum = 0;
+    emptyVLOD.refCounter = 0;
+    fragmentMeta.vlods.resize(VLOD_NUM, emptyVLOD);
+    for(unsigned int i = 0; i < VLOD_NUM; ++i){
+        fragmentMeta.vlods[i].vertexNum = vertexNums[i];
+    }
+
+    //indexed terrain is always packed
+    TerrainPackPtr pack = fileSystem->openPack(TerrainIndex::getPackFilename(inId));
+    if(pack->getChunkNum() != CHUNK_NUM || pack->getVertexLODNum() != VLOD_NUM){
+        throw std::runtime_error("Terrain pack doesn't match terrain index.");
+    }
+    fragmentMeta.pack = pack;
+
+    return index.createTree(inId);
+}
+
 static QTreePtr getFragmentTree(TerrainFragmentId inId, MetaDataPtr meta, FileSystemPtr fileSystem){
+    if(meta->index) return getFragmentTreeFromIndex(inId, meta, fileSystem);
+
     //read metadata using pugixml and metadata from main.meta
     std::string metaFilePath = meta->fragments[inId].metaFile;
     //get fragment's directory
@@ -551,6 +649,16 @@ static QTreePtr getFragmentTree(TerrainFragmentId inId, MetaDataPtr meta, FileSy
     assert(descr.child("position").attribute("x").as_int() == inId.getX());
     assert(descr.child("position").attribute("y").as_int() == inId.getY());
 
+    //binary data may be packed to single file
+    pugi::xml_node packNode = descr.child("pack");
+    if(packNode){
+        TerrainPackPtr pack = fileSystem->openPack(fragmentDir + '/' + packNode.attribute("filename").value());
+        if(pack->getChunkNum() != numberOfChunks || pack->getVertexLODNum() != vlodNum){
+            throw std::runtime_error("Terrain pack doesn't match fragment's meta file.");
+        }
+        meta->fragments[inId].pack = pack;
+    }
+
     QTreePtr tree(new QTree(ilodNum));
 
     //read tree
@@ -774,6 +882,7 @@ void MyTerrainRAMLoadStrategy::unload(hydra::data::TerrainFragmentId inId){
     //unload metadata
     mImpl->metaData->fragments[inId].vlods.clear();
     mImpl->metaData->fragments[inId].chunks.clear();
+    mImpl->metaData->fragments[inId].pack.reset();
     
     //unload
     fragment.tree.reset();
@@ -19,6 +19,7 @@
 #include "data/TerrainChunkId.hpp"
 #include "data/TerrainFragmentId.hpp"
 #include "data/Vertex.hpp"
+#include "data/TerrainVertexCodec.hpp"
 #include "math/Vector3D.hpp"
 
 //boost headers
@@ -44,6 +45,7 @@ using hydra::data::TerrainChunk;
 using hydra::data::TerrainChunkPtr;
 using hydra::data::TerrainChunkId;
 using hydra::data::Vertex;
+using hydra::data::TerrainVertexCodec;
 using hydra::math::Vector3D;
 
 typedef TerrainFragment::QuadTreeOfChunksPtr QTreePtr;
@@ -113,18 +115,7 @@ static void loadVertexLevel(TerrainFragment& fragment, VertexLODInfo& vlodInfo,
             //decompress vertices
             size_t previousSize = vertices.size();
             vertices.resize(previousSize + fragment.vertexLODs[i].size());
-            for(unsigned int j = 0; j < fragment.vertexLODs[i].size(); ++j){
-                vertices[previousSize + j].mCoord.x = fragment.vertexLODs[i][j].x;
-                vertices[previousSize + j].mCoord.y = fragment.vertexLODs[i][j].y;
-                vertices[previousSize + j].mCoord.z = fragment.vertexLODs[i][j].z;
-
-                vertices[previousSize + j].mTexCoord.x = (float)fragment.vertexLODs[i][j].z / fragmentWidth;
-                vertices[previousSize + j].mTexCoord.y = (float)fragment.vertexLODs[i][j].x / fragmentWidth;
-                //recalculate y component of normal
-                //we know that y is positive
-                float normalY = sqrtf(1.0f - fragment.vertexLODs[i][j].normalX * fragment.vertexLODs[i][j].normalX - fragment.vertexLODs[i][j].normalZ * fragment.vertexLODs[i][j].normalZ);
-                vertices[previousSize + j].mNormal = Vector3D(fragment.vertexLODs[i][j].normalX, normalY, fragment.vertexLODs[i][j].normalZ);
-            }
+            TerrainVertexCodec::expand(&fragment.vertexLODs[i][0], fragment.vertexLODs[i].size(), 1.0f / fragmentWidth, &vertices[previousSize]);
         }
 
         if(!someDataIsNotPresent){
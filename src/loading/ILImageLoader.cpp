@@ -31,7 +31,7 @@ using hydra::loading::ILImageLoader;
 using hydra::loading::Manager;
 
 struct ILImageLoader::ILImpl{
-    ILImpl():mInitFlag(false){
+    ILImpl(bool inKeepLuminancePrecision):mInitFlag(false), mKeepLuminancePrecision(inKeepLuminancePrecision){
   
     }
 
@@ -70,12 +70,13 @@ struct ILImageLoader::ILImpl{
 
     //members
     bool mInitFlag;
+    bool mKeepLuminancePrecision;
     std::map<std::string, ILenum> mTypeMap;
 };
 
 
 
-ILImageLoader::ILImageLoader(): mImpl(new ILImageLoader::ILImpl()){
+ILImageLoader::ILImageLoader(bool inKeepLuminancePrecision): mImpl(new ILImageLoader::ILImpl(inKeepLuminancePrecision)){
 }
 
 ILImageLoader::~ILImageLoader(){
@@ -172,13 +173,31 @@ ImagePtr ILImageLoader::doLoad(std::istream& inSource, Manager& inManager, const
     
     //TODO: think about representating RGB
     ILenum ILmode = IL_RGBA;
+    ILenum ILpixelType = IL_UNSIGNED_BYTE;
     Image::Mode imgMode = Image::RGBA;
-    int ILimageDataSize = imageWidth * imageHeight * 4;
+
+    //single channel images with more than 8 bits per channel (height maps)
+    //keep their precision if it was requested (users of RGBA, e.g. textures, are not affected)
+    ILenum sourceFormat = static_cast<ILenum>(ilGetInteger(IL_IMAGE_FORMAT));
+    ILenum sourceType = static_cast<ILenum>(ilGetInteger(IL_IMAGE_TYPE));
+    if(mImpl->mKeepLuminancePrecision && sourceFormat == IL_LUMINANCE){
+        if(sourceType == IL_FLOAT || sourceType == IL_DOUBLE){
+            ILmode = IL_LUMINANCE;
+            ILpixelType = IL_FLOAT;
+            imgMode = Image::LUMINANCE_FLOAT;
+        }
+        else if(sourceType != IL_UNSIGNED_BYTE && sourceType != IL_BYTE){
+            ILmode = IL_LUMINANCE;
+            ILpixelType = IL_UNSIGNED_SHORT;
+            imgMode = Image::LUMINANCE16;
+        }
+    }
+    int ILimageDataSize = imageWidth * imageHeight * Image::getBytesPerPixel(imgMode);
 
     //allocate data for data::Image object
     unsigned char* data = new unsigned char[ILimageDataSize];
     
-    ilCopyPixels(0, 0, 0, imageWidth, imageHeight, 1, ILmode, IL_UNSIGNED_BYTE, data);
+    ilCopyPixels(0, 0, 0, imageWidth, imageHeight, 1, ILmode, ILpixelType, data);
 
     //we don't need ILImage any more
     ilDeleteImages(1, &ILImage);
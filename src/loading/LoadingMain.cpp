@@ -89,7 +89,7 @@ typedef Singleton<Factory<SoundTrackLoader> > SoundTrackLoaderFactory;
 } //hydra
 
 
-void hydra::loading::initFactories(){
+void hydra::loading::initFactories(bool inKeepImagePrecision){
 
     //registering loaders for image factory
     hydra::loading::ImageLoaderFactory::TPtr imageFact = hydra::loading::ImageLoaderFactory::instance();
@@ -97,7 +97,7 @@ void hydra::loading::initFactories(){
 #ifdef BUILD_LOADING_WITH_IL
     //registering DevIL image loaders
     //we use same pointer for all the different supported image formats
-    hydra::loading::ImageLoaderFactory::Type::BasePtr DevIL(new ILImageLoader());
+    hydra::loading::ImageLoaderFactory::Type::BasePtr DevIL(new ILImageLoader(inKeepImagePrecision));
     imageFact->reg("bmp", DevIL);
     imageFact->reg("png", DevIL);
     imageFact->reg("jpg", DevIL);
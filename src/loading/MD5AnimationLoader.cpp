@@ -17,6 +17,8 @@
 #include "data/Animation.hpp"
 #include "data/Skeleton.hpp"
 #include "data/Bone.hpp"
+#include "data/Pose.hpp"
+#include "data/PoseComposer.hpp"
 #include "loading/Manager.hpp"
 #include "math/Point.hpp"
 #include "math/Vector3D.hpp"
@@ -37,6 +39,8 @@ using hydra::data::SkeletonPtr;
 using hydra::loading::MD5AnimationLoader;
 using hydra::loading::Manager;
 using hydra::data::Bone;
+using hydra::data::Pose;
+using hydra::data::PoseComposer;
 
 using namespace hydra::MD5Common;
 
@@ -172,27 +176,34 @@ struct MD5AnimationLoader::MD5AnimImpl{
         //now we should build frames
         AnimationPtr anim(new Animation());
         anim->mFrames.resize(numFrames);
+
+        //joints are composed with their parents level by level
+        Skeleton hierarchy;
+        hierarchy.mBones = joints;
+        PoseComposer composer;
+        composer.setup(hierarchy);
+        Pose local, model;
+        local.fromSkeleton(hierarchy);
+
         //for each frame
         for(size_t i = 0; i < numFrames; ++i){
-            anim->mFrames[i].mBones.resize(numJoints);
-            
             //for each joint
             for(size_t j = 0; j < numJoints; ++j){
-                //copy bone
-                hydra::data::Bone currentBone = joints[j];
+                Vector3D& pos = local.mPositions[j];
+                pos = joints[j].mPos;
 
                 int startIndex = jointStartIndices[j];
                     
                 if (jointFlags[j] & 1){
-                    currentBone.mPos.setX(frameData[i][startIndex]);
+                    pos.setX(frameData[i][startIndex]);
                     ++startIndex;
                 }
                 if(jointFlags[j] & 2){
-                    currentBone.mPos.setY(frameData[i][startIndex]);
+                    pos.setY(frameData[i][startIndex]);
                     ++startIndex;
                 }
                 if(jointFlags[j] & 4){
-                    currentBone.mPos.setZ(frameData[i][startIndex]);
+                    pos.setZ(frameData[i][startIndex]);
                     ++startIndex;
                 }
 
@@ -210,24 +221,12 @@ struct MD5AnimationLoader::MD5AnimImpl{
                     ++startIndex;
                 }
 
-                currentBone.mOrient = buildUnitQuat(newQuat.x(), newQuat.y(), newQuat.z());
-
-                //assuming parent bone is alredy handled
-                int parentIndex = currentBone.mParent;
-
-                //if has parent
-                if(parentIndex >= 0){
-                    const hydra::data::Bone& parentBone = anim->mFrames[i].mBones[parentIndex];
-                    //rotate position
-                    parentBone.mOrient.rotate(currentBone.mPos);
-                    currentBone.mPos += parentBone.mPos;
-                    currentBone.mOrient = parentBone.mOrient * currentBone.mOrient;
-                    currentBone.mOrient.normalize();
-                }
-                
-                anim->mFrames[i].mBones[j] = currentBone;
-
+                local.mOrients[j] = buildUnitQuat(newQuat.x(), newQuat.y(), newQuat.z());
             }
+
+            composer.compose(local, model);
+            anim->mFrames[i].mBones = joints;
+            model.toSkeleton(anim->mFrames[i]);
         }
         anim->mFramerate = static_cast<float>(frameRate);
 
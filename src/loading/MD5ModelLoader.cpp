@@ -190,7 +190,7 @@ struct MD5ModelLoader::MD5Impl{
 
             //read triangles (indices)
             size_t numTriangles = getNamedValue(inSource, "numtris");
-            newMesh->mIndices.resize(3*numTriangles);
+            Mesh::IndexCont indices(3*numTriangles);
             
             //read each triangle
             for(size_t i = 0; i < numTriangles; ++i){
@@ -205,8 +205,9 @@ struct MD5ModelLoader::MD5Impl{
                     fatalError("wrong triangle's index found!");
                 findNextToken(inSource);
                 //read indices
-                inSource >> newMesh->mIndices[3*triIndex + 2] >> newMesh->mIndices[3*triIndex + 1] >> newMesh->mIndices[3*triIndex]; 
+                inSource >> indices[3*triIndex + 2] >> indices[3*triIndex + 1] >> indices[3*triIndex]; 
             }//end read triangles
+            newMesh->mIndices.assign(indices);
 
             size_t numWeights = getNamedValue(inSource, "numweights");
 
@@ -274,6 +275,8 @@ struct MD5ModelLoader::MD5Impl{
         for(size_t i = 0; i < model->mMeshes.size(); ++i)
             model->mMeshes[i]->generateNormals();
 
+        //bounds are precomputed here, so renderer doesn't calculate them per frame
+        model->updateBounds();
         return model;
     }
 
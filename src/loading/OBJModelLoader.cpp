@@ -603,6 +603,8 @@ struct OBJModelLoader::OBJImpl{
         //we can optimize meshes for video-card here, but we don't do that
         //user may do that by using  rendering::MeshOptimizer class
 
+        //bounds are precomputed here, so renderer doesn't calculate them per frame
+        model->updateBounds();
         return model;
     }
 };
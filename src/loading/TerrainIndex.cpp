@@ -0,0 +1,316 @@
+//TerrainIndex.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+#include "loading/TerrainIndex.hpp"
+#include "data/TerrainChunk.hpp"
+
+#include <map>
+#include <vector>
+#include <sstream>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+using hydra::loading::TerrainIndex;
+using hydra::data::TerrainFragment;
+using hydra::data::TerrainFragmentId;
+using hydra::data::TerrainChunkPtr;
+
+namespace{
+
+const char MAGIC[4] = {'H', 'T', 'F', 'I'};
+const boost::uint32_t VERSION = 1;
+
+//header of fragment's block
+struct BlockHeader{
+    boost::uint32_t indexLODNum;
+    boost::uint32_t vertexLODNum;
+};
+
+//trailer of index file
+struct Trailer{
+    char magic[4];
+    boost::uint32_t version;
+    boost::uint32_t fragmentWidth;
+    boost::uint32_t terrainWidth;
+    boost::uint32_t terrainHeight;
+    boost::uint32_t fragmentNum;
+    boost::uint64_t tableOffset;
+};
+
+} //unnamed namespace
+
+struct TerrainIndex::Writer::Impl{
+    Impl(std::ostream& inStream): stream(inStream), written(0){
+
+    }
+
+    std::ostream& stream;
+    boost::uint64_t written;
+    std::vector<TerrainIndex::FragmentRecord> table;
+};
+
+TerrainIndex::Writer::Writer(std::ostream& outStream): mImpl(new Impl(outStream)){
+
+}
+
+TerrainIndex::Writer::~Writer(){
+
+}
+
+void TerrainIndex::Writer::addFragment(TerrainFragmentId inId, const std::string& inBlock){
+    assert(mImpl);
+    FragmentRecord record;
+    record.x = inId.getX();
+    record.y = inId.getY();
+    record.offset = mImpl->written;
+    record.size = inBlock.size();
+
+    mImpl->stream.write(inBlock.data(), inBlock.size());
+    if(!mImpl->stream) throw std::runtime_error("Error while writing terrain index");
+    mImpl->written += inBlock.size();
+    mImpl->table.push_back(record);
+}
+
+void TerrainIndex::Writer::finish(unsigned int inFragmentWidth, unsigned int inTerrainWidth, unsigned int inTerrainHeight){
+    assert(mImpl);
+
+    //table has 64-bit fields
+    const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    const size_t PADDING_SIZE = static_cast<size_t>((8 - mImpl->written % 8) % 8);
+    mImpl->stream.write(padding, PADDING_SIZE);
+    mImpl->written += PADDING_SIZE;
+
+    Trailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    memcpy(trailer.magic, MAGIC, sizeof(MAGIC));
+    trailer.version = VERSION;
+    trailer.fragmentWidth = inFragmentWidth;
+    trailer.terrainWidth = inTerrainWidth;
+    trailer.terrainHeight = inTerrainHeight;
+    trailer.fragmentNum = static_cast<boost::uint32_t>(mImpl->table.size());
+    trailer.tableOffset = mImpl->written;
+
+    if(!mImpl->table.empty()){
+        mImpl->stream.write(reinterpret_cast<const char*>(&mImpl->table[0]), mImpl->table.size() * sizeof(FragmentRecord));
+    }
+    mImpl->stream.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    mImpl->stream.flush();
+    if(!mImpl->stream) throw std::runtime_error("Error while writing terrain index");
+}
+
+std::string TerrainIndex::encodeFragment(const TerrainFragment& inFragment){
+    assert(inFragment.tree);
+    const TerrainFragment::QuadTreeOfChunks& tree = *inFragment.tree;
+
+    BlockHeader header;
+    header.indexLODNum = tree.getResolution();
+    header.vertexLODNum = static_cast<boost::uint32_t>(inFragment.vertexLODs.size());
+    const unsigned int CHUNK_NUM = TerrainFragment::QuadTreeOfChunks::getNodeNum(header.indexLODNum);
+
+    std::string result(sizeof(BlockHeader) + CHUNK_NUM * sizeof(ChunkRecord) + header.vertexLODNum * sizeof(boost::uint32_t), '\0');
+    char* data = &result[0];
+    memcpy(data, &header, sizeof(header));
+
+    ChunkRecord* chunks = reinterpret_cast<ChunkRecord*>(data + sizeof(BlockHeader));
+    for(unsigned int i = 0; i < CHUNK_NUM; ++i){
+        const TerrainFragment::ChunkData& chunkData = tree.getNode(i).data;
+        ChunkRecord& record = chunks[i];
+        record.maxError = chunkData.maxError;
+        record.vertices = chunkData.vertices;
+        record.level = chunkData.level;
+        record.reserved = 0;
+        record.indexNum = chunkData.ptr ? static_cast<boost::uint32_t>(chunkData.ptr->indices.size()) : 0;
+        record.corner[0] = chunkData.aabb.getCorner().x();
+        record.corner[1] = chunkData.aabb.getCorner().y();
+        record.corner[2] = chunkData.aabb.getCorner().z();
+        record.vector[0] = chunkData.aabb.getVector().x();
+        record.vector[1] = chunkData.aabb.getVector().y();
+        record.vector[2] = chunkData.aabb.getVector().z();
+    }
+
+    boost::uint32_t* vertexNums = reinterpret_cast<boost::uint32_t*>(chunks + CHUNK_NUM);
+    for(unsigned int i = 0; i < header.vertexLODNum; ++i){
+        vertexNums[i] = static_cast<boost::uint32_t>(inFragment.vertexLODs[i].size());
+    }
+    return result;
+}
+
+std::string TerrainIndex::getPackFilename(TerrainFragmentId inId){
+    std::ostringstream result;
+    result << inId.getX() << '_' << inId.getY() << '/' << inId.getX() << '_' << inId.getY() << ".tfpack";
+    return result.str();
+}
+
+struct TerrainIndex::Impl{
+    //returns header of fragment's block (throws std::runtime_error)
+    const BlockHeader& getBlock(TerrainFragmentId inId) const{
+        std::map<TerrainFragmentId, const BlockHeader*>::const_iterator iter = blocks.find(inId);
+        if(iter == blocks.end()) throw std::runtime_error("There is no such fragment in terrain index");
+        return *iter->second;
+    }
+
+    //whole file (vector of 64-bit values, so records are aligned)
+    std::vector<boost::uint64_t> data;
+    const Trailer* trailer;
+    const TerrainIndex::FragmentRecord* table;
+    std::map<TerrainFragmentId, const BlockHeader*> blocks;
+};
+
+TerrainIndex::TerrainIndex(std::istream& inStream): mImpl(new Impl()){
+    //file is read directly to aligned buffer (size is found by seeking to the end)
+    const std::streampos begin = inStream.tellg();
+    inStream.seekg(0, std::ios::end);
+    const std::streamoff streamSize = inStream.tellg() - begin;
+    inStream.seekg(begin);
+    //table and trailer are aligned to 8 bytes, so is the size of file
+    if(!inStream || begin < 0 || streamSize < static_cast<std::streamoff>(sizeof(Trailer)) || streamSize % 8 != 0){
+        throw std::runtime_error("Wrong format of terrain index");
+    }
+    const size_t fileSize = static_cast<size_t>(streamSize);
+    mImpl->data.resize((fileSize + 7) / 8);
+    const char* data = reinterpret_cast<const char*>(&mImpl->data[0]);
+    inStream.read(reinterpret_cast<char*>(&mImpl->data[0]), streamSize);
+    if(inStream.gcount() != streamSize) throw std::runtime_error("Error while reading terrain index");
+
+    mImpl->trailer = reinterpret_cast<const Trailer*>(data + fileSize - sizeof(Trailer));
+    const Trailer& trailer = *mImpl->trailer;
+    //sizes are compared by subtractions, so wrong values can't overflow
+    const boost::uint64_t tableEnd = fileSize - sizeof(Trailer);
+    if(memcmp(trailer.magic, MAGIC, sizeof(MAGIC)) != 0 || trailer.version != VERSION || trailer.tableOffset % 8 != 0 ||
+       trailer.tableOffset > tableEnd || tableEnd - trailer.tableOffset != trailer.fragmentNum * static_cast<boost::uint64_t>(sizeof(FragmentRecord))){
+        throw std::runtime_error("Wrong format of terrain index");
+    }
+
+    const unsigned int MAX_INDEX_LOD_NUM = TerrainFragment::QuadTreeOfChunks::getMaxResolution();
+    mImpl->table = reinterpret_cast<const FragmentRecord*>(data + trailer.tableOffset);
+    for(unsigned int i = 0; i < trailer.fragmentNum; ++i){
+        const FragmentRecord& record = mImpl->table[i];
+        if(record.offset % 4 != 0 || record.offset > trailer.tableOffset || record.size > trailer.tableOffset - record.offset ||
+           record.size < sizeof(BlockHeader)){
+            throw std::runtime_error("Wrong format of terrain index");
+        }
+        const BlockHeader* block = reinterpret_cast<const BlockHeader*>(data + record.offset);
+        if(block->indexLODNum < 1 || block->indexLODNum > MAX_INDEX_LOD_NUM ||
+           record.size != sizeof(BlockHeader) + TerrainFragment::QuadTreeOfChunks::getNodeNum(block->indexLODNum) * sizeof(ChunkRecord) +
+                          static_cast<boost::uint64_t>(block->vertexLODNum) * sizeof(boost::uint32_t)){
+            throw std::runtime_error("Wrong format of terrain index");
+        }
+        mImpl->blocks[TerrainFragmentId(record.x, record.y)] = block;
+    }
+}
+
+TerrainIndex::~TerrainIndex(){
+
+}
+
+unsigned int TerrainIndex::getFragmentWidth() const{
+    assert(mImpl);
+    return mImpl->trailer->fragmentWidth;
+}
+
+unsigned int TerrainIndex::getTerrainWidth() const{
+    assert(mImpl);
+    return mImpl->trailer->terrainWidth;
+}
+
+unsigned int TerrainIndex::getTerrainHeight() const{
+    assert(mImpl);
+    return mImpl->trailer->terrainHeight;
+}
+
+unsigned int TerrainIndex::getFragmentNum() const{
+    assert(mImpl);
+    return mImpl->trailer->fragmentNum;
+}
+
+TerrainFragmentId TerrainIndex::getFragmentId(unsigned int inNum) const{
+    assert(mImpl);
+    assert(inNum < getFragmentNum());
+    return TerrainFragmentId(mImpl->table[inNum].x, mImpl->table[inNum].y);
+}
+
+bool TerrainIndex::hasFragment(TerrainFragmentId inId) const{
+    assert(mImpl);
+    return mImpl->blocks.find(inId) != mImpl->blocks.end();
+}
+
+unsigned int TerrainIndex::getIndexLODNum(TerrainFragmentId inId) const{
+    assert(mImpl);
+    return mImpl->getBlock(inId).indexLODNum;
+}
+
+unsigned int TerrainIndex::getChunkNum(TerrainFragmentId inId) const{
+    assert(mImpl);
+    return TerrainFragment::QuadTreeOfChunks::getNodeNum(mImpl->getBlock(inId).indexLODNum);
+}
+
+const TerrainIndex::ChunkRecord* TerrainIndex::getChunks(TerrainFragmentId inId) const{
+    assert(mImpl);
+    return reinterpret_cast<const ChunkRecord*>(&mImpl->getBlock(inId) + 1);
+}
+
+unsigned int TerrainIndex::getVertexLODNum(TerrainFragmentId inId) const{
+    assert(mImpl);
+    return mImpl->getBlock(inId).vertexLODNum;
+}
+
+const boost::uint32_t* TerrainIndex::getVertexNums(TerrainFragmentId inId) const{
+    assert(mImpl);
+    return reinterpret_cast<const boost::uint32_t*>(getChunks(inId) + getChunkNum(inId));
+}
+
+TerrainFragment::QuadTreeOfChunksPtr TerrainIndex::createTree(TerrainFragmentId inId) const{
+    assert(mImpl);
+    const unsigned int RESOLUTION = getIndexLODNum(inId);
+    const unsigned int CHUNK_NUM = TerrainFragment::QuadTreeOfChunks::getNodeNum(RESOLUTION);
+    const ChunkRecord* chunks = getChunks(inId);
+
+    TerrainFragment::QuadTreeOfChunksPtr tree(new TerrainFragment::QuadTreeOfChunks(RESOLUTION));
+    for(unsigned int i = 0; i < CHUNK_NUM; ++i){
+        TerrainFragment::ChunkData& chunkData = tree->getNode(i).data;
+        chunkData.status = TerrainFragment::UNLOADED;
+        chunkData.maxError = chunks[i].maxError;
+        chunkData.vertices = chunks[i].vertices;
+        chunkData.level = chunks[i].level;
+        chunkData.aabb = hydra::math::AABB(hydra::math::Vector3D(chunks[i].corner[0], chunks[i].corner[1], chunks[i].corner[2]),
+                                           hydra::math::Vector3D(chunks[i].vector[0], chunks[i].vector[1], chunks[i].vector[2]));
+    }
+    return tree;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
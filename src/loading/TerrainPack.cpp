@@ -0,0 +1,319 @@
+//TerrainPack.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#include "loading/TerrainPack.hpp"
+#include "data/TerrainChunkCodec.hpp"
+
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using hydra::loading::TerrainPack;
+using hydra::data::TerrainFragment;
+using hydra::data::TerrainChunk;
+using hydra::data::TerrainChunkPtr;
+using hydra::data::TerrainChunkCodec;
+
+namespace{
+
+const char MAGIC[4] = {'H', 'T', 'F', 'P'};
+const boost::uint32_t VERSION = 1;
+
+//indices of chunks are encoded with TerrainChunkCodec
+const boost::uint32_t COMPRESSED_INDICES = 1;
+
+//header of pack file
+struct Header{
+    char magic[4];
+    boost::uint32_t version;
+    boost::uint32_t chunkNum;
+    boost::uint32_t vertexLODNum;
+    boost::uint32_t alignment;
+    boost::uint32_t flags;
+    boost::uint32_t reserved[2];
+};
+
+//entry of offset table
+struct Entry{
+    boost::uint64_t offset;
+    boost::uint32_t num;
+    //size of payload in bytes
+    boost::uint32_t size;
+};
+
+inline boost::uint64_t align(boost::uint64_t inOffset){
+    return (inOffset + TerrainPack::ALIGNMENT - 1) / TerrainPack::ALIGNMENT * TerrainPack::ALIGNMENT;
+}
+
+} //unnamed namespace
+
+struct TerrainPack::Impl{
+    Impl(const std::string& inPath): path(inPath), flags(0){
+#ifdef _WIN32
+        file = CreateFileA(inPath.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+        if(file == INVALID_HANDLE_VALUE) throw std::runtime_error("Can't open terrain pack " + inPath);
+#else
+        file = open(inPath.c_str(), O_RDONLY);
+        if(file < 0) throw std::runtime_error("Can't open terrain pack " + inPath);
+#endif
+    }
+
+    ~Impl(){
+#ifdef _WIN32
+        CloseHandle(file);
+#else
+        close(file);
+#endif
+    }
+
+    //reads inSize bytes at specified offset (doesn't change position of file, so it's thread-safe)
+    void read(boost::uint64_t inOffset, size_t inSize, char* outData) const{
+        while(inSize > 0){
+#ifdef _WIN32
+            OVERLAPPED overlapped;
+            memset(&overlapped, 0, sizeof(overlapped));
+            overlapped.Offset = static_cast<DWORD>(inOffset);
+            overlapped.OffsetHigh = static_cast<DWORD>(inOffset >> 32);
+            DWORD done = 0;
+            if(!ReadFile(file, outData, static_cast<DWORD>(inSize), &done, &overlapped) || done == 0){
+                throw std::runtime_error("Can't read terrain pack " + path);
+            }
+#else
+            ssize_t done = pread(file, outData, inSize, static_cast<off_t>(inOffset));
+            if(done < 0 && errno == EINTR) continue;
+            if(done <= 0) throw std::runtime_error("Can't read terrain pack " + path);
+#endif
+            inOffset += done;
+            outData += done;
+            inSize -= done;
+        }
+    }
+
+    std::string path;
+#ifdef _WIN32
+    HANDLE file;
+#else
+    int file;
+#endif
+    boost::uint32_t flags;
+    std::vector<Entry> chunks;
+    std::vector<Entry> vertexLODs;
+};
+
+void TerrainPack::write(const TerrainFragment& inFragment, std::ostream& outStream, bool inCompressIndices){
+    assert(inFragment.tree);
+    const unsigned int CHUNK_NUM = TerrainFragment::QuadTreeOfChunks::getNodeNum(inFragment.tree->getResolution());
+    const unsigned int VERTEX_LOD_NUM = static_cast<unsigned int>(inFragment.vertexLODs.size());
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.chunkNum = CHUNK_NUM;
+    header.vertexLODNum = VERTEX_LOD_NUM;
+    header.alignment = ALIGNMENT;
+    header.flags = inCompressIndices? COMPRESSED_INDICES: 0;
+
+    //chunks are encoded before offsets are known
+    std::vector<std::vector<unsigned char> > encodedChunks(inCompressIndices? CHUNK_NUM: 0);
+    for(size_t i = 0; i < encodedChunks.size(); ++i){
+        const TerrainChunkPtr& chunk = inFragment.tree->getNode(static_cast<unsigned int>(i)).data.ptr;
+        if(chunk && !chunk->indices.empty()) TerrainChunkCodec::encode(*chunk, encodedChunks[i]);
+    }
+
+    //build offset table
+    std::vector<Entry> table(CHUNK_NUM + VERTEX_LOD_NUM);
+    memset(&table[0], 0, table.size() * sizeof(Entry));
+    boost::uint64_t offset = align(sizeof(Header) + table.size() * sizeof(Entry));
+    for(unsigned int i = 0; i < CHUNK_NUM; ++i){
+        const TerrainChunkPtr& chunk = inFragment.tree->getNode(i).data.ptr;
+        if(!chunk || chunk->indices.empty()) continue;
+        table[i].offset = offset;
+        table[i].num = static_cast<boost::uint32_t>(chunk->indices.size());
+        table[i].size = static_cast<boost::uint32_t>(inCompressIndices? encodedChunks[i].size(): chunk->indices.size() * sizeof(TerrainChunk::index_t));
+        offset = align(offset + table[i].size);
+    }
+    for(unsigned int i = 0; i < VERTEX_LOD_NUM; ++i){
+        if(inFragment.vertexLODs[i].empty()) continue;
+        table[CHUNK_NUM + i].offset = offset;
+        table[CHUNK_NUM + i].num = static_cast<boost::uint32_t>(inFragment.vertexLODs[i].size());
+        table[CHUNK_NUM + i].size = static_cast<boost::uint32_t>(inFragment.vertexLODs[i].size() * VERTEX_SIZE);
+        offset = align(offset + table[CHUNK_NUM + i].size);
+    }
+
+    outStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outStream.write(reinterpret_cast<const char*>(&table[0]), table.size() * sizeof(Entry));
+    boost::uint64_t written = sizeof(Header) + table.size() * sizeof(Entry);
+
+    //payloads are padded with zeros
+    const std::vector<char> padding(ALIGNMENT, 0);
+    std::vector<char> vertexData;
+    for(size_t i = 0; i < table.size(); ++i){
+        if(table[i].num == 0) continue;
+        outStream.write(&padding[0], static_cast<std::streamsize>(table[i].offset - written));
+        written = table[i].offset;
+
+        if(i < CHUNK_NUM && inCompressIndices){
+            outStream.write(reinterpret_cast<const char*>(&encodedChunks[i][0]), encodedChunks[i].size());
+            written += encodedChunks[i].size();
+        }
+        else if(i < CHUNK_NUM){
+            const TerrainChunk::IndexCont& indices = inFragment.tree->getNode(static_cast<unsigned int>(i)).data.ptr->indices;
+            outStream.write(reinterpret_cast<const char*>(&indices[0]), indices.size() * sizeof(TerrainChunk::index_t));
+            written += indices.size() * sizeof(TerrainChunk::index_t);
+        }
+        else{
+            const TerrainFragment::VertexCont& vertices = inFragment.vertexLODs[i - CHUNK_NUM];
+            vertexData.resize(vertices.size() * VERTEX_SIZE);
+            encodeVertices(&vertices[0], vertices.size(), &vertexData[0]);
+            outStream.write(&vertexData[0], vertexData.size());
+            written += vertexData.size();
+        }
+    }
+
+    if(!outStream) throw std::runtime_error("Error while writing terrain pack");
+}
+
+void TerrainPack::encodeVertices(const TerrainFragment::CompressedVertex* inVertices, size_t inNum, char* outData){
+    for(size_t i = 0; i < inNum; ++i, outData += VERTEX_SIZE){
+        memcpy(outData, &inVertices[i].x, 2);
+        memcpy(outData + 2, &inVertices[i].z, 2);
+        memcpy(outData + 4, &inVertices[i].y, 4);
+        memcpy(outData + 8, &inVertices[i].normalX, 4);
+        memcpy(outData + 12, &inVertices[i].normalZ, 4);
+    }
+}
+
+void TerrainPack::decodeVertices(const char* inData, size_t inNum, TerrainFragment::CompressedVertex* outVertices){
+    for(size_t i = 0; i < inNum; ++i, inData += VERTEX_SIZE){
+        memcpy(&outVertices[i].x, inData, 2);
+        memcpy(&outVertices[i].z, inData + 2, 2);
+        memcpy(&outVertices[i].y, inData + 4, 4);
+        memcpy(&outVertices[i].normalX, inData + 8, 4);
+        memcpy(&outVertices[i].normalZ, inData + 12, 4);
+    }
+}
+
+TerrainPack::TerrainPack(const std::string& inPath): mImpl(new Impl(inPath)){
+    Header header;
+    mImpl->read(0, sizeof(header), reinterpret_cast<char*>(&header));
+    if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.alignment != ALIGNMENT){
+        throw std::runtime_error("Wrong format of terrain pack " + inPath);
+    }
+    mImpl->flags = header.flags;
+
+    mImpl->chunks.resize(header.chunkNum);
+    mImpl->vertexLODs.resize(header.vertexLODNum);
+    if(header.chunkNum != 0){
+        mImpl->read(sizeof(Header), header.chunkNum * sizeof(Entry), reinterpret_cast<char*>(&mImpl->chunks[0]));
+    }
+    if(header.vertexLODNum != 0){
+        mImpl->read(sizeof(Header) + header.chunkNum * sizeof(Entry), header.vertexLODNum * sizeof(Entry), reinterpret_cast<char*>(&mImpl->vertexLODs[0]));
+    }
+}
+
+TerrainPack::~TerrainPack(){
+
+}
+
+unsigned int TerrainPack::getChunkNum() const{
+    assert(mImpl);
+    return static_cast<unsigned int>(mImpl->chunks.size());
+}
+
+unsigned int TerrainPack::getVertexLODNum() const{
+    assert(mImpl);
+    return static_cast<unsigned int>(mImpl->vertexLODs.size());
+}
+
+bool TerrainPack::hasCompressedIndices() const{
+    assert(mImpl);
+    return (mImpl->flags & COMPRESSED_INDICES) != 0;
+}
+
+unsigned int TerrainPack::getIndexNum(unsigned int inPosition) const{
+    assert(mImpl);
+    return mImpl->chunks.at(inPosition).num;
+}
+
+unsigned int TerrainPack::getVertexNum(unsigned int inLevel) const{
+    assert(mImpl);
+    return mImpl->vertexLODs.at(inLevel).num;
+}
+
+void TerrainPack::readChunk(unsigned int inPosition, TerrainChunk& outChunk) const{
+    assert(mImpl);
+    if(inPosition >= mImpl->chunks.size()) throw std::runtime_error("Wrong chunk position in terrain pack " + mImpl->path);
+    const Entry& entry = mImpl->chunks[inPosition];
+    if(entry.num != 0 && hasCompressedIndices()){
+        std::vector<unsigned char> data(entry.size);
+        mImpl->read(entry.offset, data.size(), reinterpret_cast<char*>(&data[0]));
+        TerrainChunkCodec::decode(&data[0], data.size(), outChunk);
+        if(outChunk.indices.size() != entry.num) throw std::runtime_error("Wrong number of indices in terrain pack " + mImpl->path);
+        return;
+    }
+    outChunk.indices.resize(entry.num);
+    if(entry.num != 0){
+        mImpl->read(entry.offset, entry.num * sizeof(TerrainChunk::index_t), reinterpret_cast<char*>(&outChunk.indices[0]));
+    }
+}
+
+void TerrainPack::readVertexLOD(unsigned int inLevel, TerrainFragment::VertexCont& outVertices) const{
+    assert(mImpl);
+    if(inLevel >= mImpl->vertexLODs.size()) throw std::runtime_error("Wrong vertex level in terrain pack " + mImpl->path);
+    const Entry& entry = mImpl->vertexLODs[inLevel];
+    outVertices.resize(entry.num);
+    if(entry.num != 0){
+        std::vector<char> data(entry.num * VERTEX_SIZE);
+        mImpl->read(entry.offset, data.size(), &data[0]);
+        decodeVertices(&data[0], entry.num, &outVertices[0]);
+    }
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
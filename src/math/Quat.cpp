@@ -116,7 +116,7 @@ float Quat::getSquareMagnitude() const{
 }
 
 void Quat::getRotationMatrix(float* inoutMatrix) const{
-	inoutMatrix[0] = 1 - 2*(mVec.x()*mVec.y() + mVec.z()*mVec.z());
+	inoutMatrix[0] = 1 - 2*(mVec.y()*mVec.y() + mVec.z()*mVec.z());
 	inoutMatrix[1] = 2*(mVec.x()*mVec.y() - mScalar*mVec.z());
 	inoutMatrix[2] = 2*(mVec.x()*mVec.z() + mVec.y()*mScalar);
 	inoutMatrix[3] = 2*(mVec.x()*mVec.y() + mScalar*mVec.z());
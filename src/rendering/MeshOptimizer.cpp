@@ -18,10 +18,17 @@
 #include "tri_stripper.h"
 
 #include <boost/foreach.hpp>
+#include <vector>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <limits>
 
 using hydra::data::Mesh;
 using hydra::data::MeshPtr;
+using hydra::data::IndexBuffer;
+using hydra::math::Vector3D;
+using hydra::math::Point;
 using hydra::rendering::MeshOptimizer;
 
 using triangle_stripper::tri_stripper;
@@ -29,9 +36,374 @@ using triangle_stripper::primitive_vector;
 using triangle_stripper::primitive_group;
 
 struct MeshOptimizer::MeshOptImpl{
+    MeshOptImpl(): mCacheSize(10), mMode(MeshOptimizer::STRIPIFY){
+
+    }
+
+    unsigned int mCacheSize;
+    MeshOptimizer::Mode mMode;
+};
+
+//resolution of render target used to choose between triangle orders
+const unsigned int OVERDRAW_RESOLUTION = 128;
+
+//memory is read by lines of this size (in bytes)
+const size_t FETCH_LINE_SIZE = 64;
+//number of lines in simulated memory cache
+const unsigned int FETCH_CACHE_LINES = 64;
+
+//Forsyth's linear-speed vertex cache optimization
+//(see "Linear-Speed Vertex Cache Optimisation" by Tom Forsyth)
+namespace{
+
+const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRI_SCORE = 0.75f;
+const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+//precomputed vertex scores
+class ForsythScores{
+public:
+    ForsythScores(unsigned int inCacheSize): mCacheScores(inCacheSize), mValenceScores(64){
+        for(unsigned int i = 0; i < inCacheSize; ++i){
+            if(i < 3){
+                //vertices of the last triangle get fixed score
+                //so the next triangle is not chosen to be its neighbour strictly
+                mCacheScores[i] = FORSYTH_LAST_TRI_SCORE;
+            }
+            else{
+                float scaler = 1.0f / (inCacheSize - 3);
+                mCacheScores[i] = powf(1.0f - (i - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+            }
+        }
+        for(size_t i = 1; i < mValenceScores.size(); ++i){
+            mValenceScores[i] = valenceScore(static_cast<unsigned int>(i));
+        }
+    }
+
+    //score of vertex with specified position in cache (-1 if not in cache) and number of remaining triangles
+    inline float get(int inCachePos, unsigned int inRemaining) const{
+        if(inRemaining == 0) return -1.0f;
+
+        float score = (inCachePos >= 0)? mCacheScores[inCachePos]: 0.0f;
+        score += (inRemaining < mValenceScores.size())? mValenceScores[inRemaining]: valenceScore(inRemaining);
+        return score;
+    }
+
+private:
+    //bonus for vertices with few remaining triangles
+    static inline float valenceScore(unsigned int inRemaining){
+        return FORSYTH_VALENCE_BOOST_SCALE * powf(static_cast<float>(inRemaining), -FORSYTH_VALENCE_BOOST_POWER);
+    }
+
+    std::vector<float> mCacheScores;
+    std::vector<float> mValenceScores;
+};
+
+//reorders triangles of triangle list
+void optimizeVertexCache(Mesh::IndexCont& inoutIndices, size_t inVertexNum, unsigned int inCacheSize){
+    const size_t triNum = inoutIndices.size() / 3;
+    if(triNum < 2) return;
+
+    //modeled LRU cache must hold at least one triangle
+    const unsigned int cacheSize = std::max(inCacheSize, 4u);
+    const ForsythScores scores(cacheSize);
+
+    //vertex to triangle adjacency; only first 'remaining' triangles of a vertex are active
+    std::vector<unsigned int> offsets(inVertexNum + 1, 0);
+    for(size_t i = 0; i < inoutIndices.size(); ++i) ++offsets[inoutIndices[i] + 1];
+    for(size_t i = 0; i < inVertexNum; ++i) offsets[i + 1] += offsets[i];
+
+    std::vector<unsigned int> remaining(inVertexNum, 0);
+    std::vector<unsigned int> adjacency(inoutIndices.size());
+    for(size_t i = 0; i < inoutIndices.size(); ++i){
+        const Mesh::index_t v = inoutIndices[i];
+        adjacency[offsets[v] + remaining[v]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<int> cachePos(inVertexNum, -1);
+    std::vector<float> vertexScores(inVertexNum);
+    for(size_t v = 0; v < inVertexNum; ++v) vertexScores[v] = scores.get(-1, remaining[v]);
+
+    std::vector<float> triScores(triNum);
+    std::vector<bool> triAdded(triNum, false);
+    size_t bestTri = 0;
+    for(size_t t = 0; t < triNum; ++t){
+        triScores[t] = vertexScores[inoutIndices[3 * t]] + vertexScores[inoutIndices[3 * t + 1]] + vertexScores[inoutIndices[3 * t + 2]];
+        if(triScores[t] > triScores[bestTri]) bestTri = t;
+    }
+
+    Mesh::IndexCont result;
+    result.reserve(inoutIndices.size());
+
+    std::vector<Mesh::index_t> cache;
+    std::vector<Mesh::index_t> newCache;
+    cache.reserve(cacheSize + 3);
+    newCache.reserve(cacheSize + 3);
+
+    //next triangle to check if there are no candidates in cache
+    size_t cursor = 0;
+    const size_t NO_TRIANGLE = static_cast<size_t>(-1);
+
+    for(size_t n = 0; n < triNum; ++n){
+        if(bestTri == NO_TRIANGLE){
+            while(triAdded[cursor]) ++cursor;
+            bestTri = cursor;
+        }
+
+        const Mesh::index_t* tri = &inoutIndices[3 * bestTri];
+        result.insert(result.end(), tri, tri + 3);
+        triAdded[bestTri] = true;
+
+        //deactivate triangle for its vertices
+        for(size_t k = 0; k < 3; ++k){
+            const Mesh::index_t v = tri[k];
+            unsigned int* begin = &adjacency[offsets[v]];
+            for(unsigned int i = 0; i < remaining[v]; ++i){
+                if(begin[i] == bestTri){
+                    std::swap(begin[i], begin[remaining[v] - 1]);
+                    --remaining[v];
+                    break;
+                }
+            }
+        }
+
+        //move triangle's vertices to the front of LRU cache
+        newCache.clear();
+        for(size_t k = 0; k < 3; ++k){
+            if(std::find(newCache.begin(), newCache.end(), tri[k]) == newCache.end()) newCache.push_back(tri[k]);
+        }
+        for(size_t i = 0; i < cache.size(); ++i){
+            if(std::find(newCache.begin(), newCache.end(), cache[i]) == newCache.end()) newCache.push_back(cache[i]);
+        }
+
+        //update scores of vertices in cache and of vertices which were pushed out
+        for(size_t i = 0; i < newCache.size(); ++i){
+            const Mesh::index_t v = newCache[i];
+            cachePos[v] = (i < cacheSize)? static_cast<int>(i): -1;
+            const float newScore = scores.get(cachePos[v], remaining[v]);
+            const float delta = newScore - vertexScores[v];
+            vertexScores[v] = newScore;
+
+            const unsigned int* begin = &adjacency[offsets[v]];
+            for(unsigned int j = 0; j < remaining[v]; ++j) triScores[begin[j]] += delta;
+        }
+
+        //find best triangle among ones using cached vertices
+        bestTri = NO_TRIANGLE;
+        float bestScore = -1.0f;
+        for(size_t i = 0; i < newCache.size() && i < cacheSize; ++i){
+            const Mesh::index_t v = newCache[i];
+            const unsigned int* begin = &adjacency[offsets[v]];
+            for(unsigned int j = 0; j < remaining[v]; ++j){
+                if(triScores[begin[j]] > bestScore){
+                    bestScore = triScores[begin[j]];
+                    bestTri = begin[j];
+                }
+            }
+        }
+
+        if(newCache.size() > cacheSize) newCache.resize(cacheSize);
+        cache.swap(newCache);
+    }
+
+    inoutIndices.swap(result);
+}
+
+//returns non-degenerate triangles of triangle list or triangle strip as triples of indices
+//(triangles of strip are turned to have the same face-order)
+void collectTriangles(const Mesh& inMesh, Mesh::IndexCont& outTriangles){
+    const IndexBuffer& indices = inMesh.mIndices;
+    outTriangles.clear();
+
+    if(inMesh.mMode == Mesh::TRIANGLE_LIST){
+        outTriangles.reserve(indices.size());
+        for(size_t i = 0; i + 2 < indices.size(); i += 3){
+            if(indices[i] == indices[i + 1] || indices[i] == indices[i + 2] || indices[i + 1] == indices[i + 2]) continue;
+            outTriangles.push_back(indices[i]);
+            outTriangles.push_back(indices[i + 1]);
+            outTriangles.push_back(indices[i + 2]);
+        }
+    }
+    else if(inMesh.mMode == Mesh::TRIANGLE_STRIP){
+        outTriangles.reserve(indices.size() * 3);
+        for(size_t i = 0; i + 2 < indices.size(); ++i){
+            if(indices[i] == indices[i + 1] || indices[i] == indices[i + 2] || indices[i + 1] == indices[i + 2]) continue;
+            outTriangles.push_back(indices[i]);
+            outTriangles.push_back(indices[i + 1 + i % 2]);
+            outTriangles.push_back(indices[i + 2 - i % 2]);
+        }
+    }
+}
+
+//depth-tested rasterizer which counts shaded pixels
+class OverdrawRasterizer{
+public:
+    OverdrawRasterizer(unsigned int inResolution):
+        mResolution(inResolution), mDepth(inResolution * inResolution), mCovered(inResolution * inResolution){
+
+    }
+
+    void clear(){
+        std::fill(mDepth.begin(), mDepth.end(), std::numeric_limits<float>::max());
+        std::fill(mCovered.begin(), mCovered.end(), false);
+    }
+
+    //vertices are given in pixels (x, y) and depth (z, greater is farther)
+    //only counter-clockwise triangles are drawn
+    void draw(const float* inA, const float* inB, const float* inC, size_t& outShaded){
+        const float area = (inB[0] - inA[0]) * (inC[1] - inA[1]) - (inB[1] - inA[1]) * (inC[0] - inA[0]);
+        if(area <= 0.0f) return;
+
+        const float maxCoord = static_cast<float>(mResolution - 1);
+        const int minX = static_cast<int>(std::max(0.0f, floorf(std::min(inA[0], std::min(inB[0], inC[0])))));
+        const int minY = static_cast<int>(std::max(0.0f, floorf(std::min(inA[1], std::min(inB[1], inC[1])))));
+        const int maxX = static_cast<int>(std::min(maxCoord, ceilf(std::max(inA[0], std::max(inB[0], inC[0])))));
+        const int maxY = static_cast<int>(std::min(maxCoord, ceilf(std::max(inA[1], std::max(inB[1], inC[1])))));
+
+        const float invArea = 1.0f / area;
+        for(int y = minY; y <= maxY; ++y){
+            const float py = y + 0.5f;
+            for(int x = minX; x <= maxX; ++x){
+                const float px = x + 0.5f;
+                //barycentric weights of vertices (edge functions of opposite edges)
+                const float wA = (inC[0] - inB[0]) * (py - inB[1]) - (inC[1] - inB[1]) * (px - inB[0]);
+                const float wB = (inA[0] - inC[0]) * (py - inC[1]) - (inA[1] - inC[1]) * (px - inC[0]);
+                const float wC = (inB[0] - inA[0]) * (py - inA[1]) - (inB[1] - inA[1]) * (px - inA[0]);
+                if(wA < 0.0f || wB < 0.0f || wC < 0.0f) continue;
+
+                const float depth = (wA * inA[2] + wB * inB[2] + wC * inC[2]) * invArea;
+                const size_t pixel = y * mResolution + x;
+                if(depth < mDepth[pixel]){
+                    mDepth[pixel] = depth;
+                    mCovered[pixel] = true;
+                    ++outShaded;
+                }
+            }
+        }
+    }
+
+    size_t getCovered() const{
+        return static_cast<size_t>(std::count(mCovered.begin(), mCovered.end(), true));
+    }
+
+private:
+    unsigned int mResolution;
+    std::vector<float> mDepth;
+    std::vector<bool> mCovered;
+};
+
+//renders triangles from fixed viewpoints
+MeshOptimizer::OverdrawStatistics estimateOverdraw(const Mesh::VertexCont& inVertices, const Mesh::IndexCont& inTriangles, unsigned int inResolution){
+    MeshOptimizer::OverdrawStatistics stats;
+    stats.pixelsCovered = 0;
+    stats.pixelsShaded = 0;
+    stats.overdraw = 0.0f;
+    if(inTriangles.empty() || inResolution == 0) return stats;
+
+    //all views use the same scale so results of different views are comparable
+    Vector3D minCorner(inVertices[inTriangles[0]].mCoord);
+    Vector3D maxCorner(minCorner);
+    BOOST_FOREACH(Mesh::index_t nextIndex, inTriangles){
+        const Point& p = inVertices[nextIndex].mCoord;
+        minCorner = Vector3D(std::min(minCorner.x(), p.x), std::min(minCorner.y(), p.y), std::min(minCorner.z(), p.z));
+        maxCorner = Vector3D(std::max(maxCorner.x(), p.x), std::max(maxCorner.y(), p.y), std::max(maxCorner.z(), p.z));
+    }
+    const Vector3D center = (minCorner + maxCorner) * 0.5f;
+    const float radius = (maxCorner - minCorner).getMagnitude() * 0.5f;
+    if(radius <= 0.0f) return stats;
+    const float scale = 0.5f * inResolution / radius;
+    const float offset = 0.5f * inResolution;
+
+    //view directions: 6 axis-aligned and 8 diagonal
+    std::vector<Vector3D> directions;
+    for(int axis = 0; axis < 3; ++axis){
+        for(int sign = -1; sign <= 1; sign += 2){
+            directions.push_back(Vector3D(axis == 0? sign: 0.0f, axis == 1? sign: 0.0f, axis == 2? sign: 0.0f));
+        }
+    }
+    for(int i = 0; i < 8; ++i){
+        directions.push_back(Vector3D((i & 1)? 1.0f: -1.0f, (i & 2)? 1.0f: -1.0f, (i & 4)? 1.0f: -1.0f).getUnit());
+    }
+
+    OverdrawRasterizer rasterizer(inResolution);
+    std::vector<float> projected(inVertices.size() * 3);
+
+    BOOST_FOREACH(const Vector3D& direction, directions){
+        //camera looks along direction; right x up = -direction (counter-clockwise faces are front faces)
+        const Vector3D upHint = (fabsf(direction.y()) > 0.9f)? Vector3D(0.0f, 0.0f, 1.0f): Vector3D(0.0f, 1.0f, 0.0f);
+        const Vector3D right = direction.cross(upHint).getUnit();
+        const Vector3D up = right.cross(direction);
+
+        for(size_t i = 0; i < inVertices.size(); ++i){
+            const Vector3D pos = Vector3D(inVertices[i].mCoord) - center;
+            projected[3 * i] = (pos * right) * scale + offset;
+            projected[3 * i + 1] = (pos * up) * scale + offset;
+            projected[3 * i + 2] = pos * direction;
+        }
+
+        rasterizer.clear();
+        for(size_t i = 0; i + 2 < inTriangles.size(); i += 3){
+            rasterizer.draw(&projected[3 * inTriangles[i]], &projected[3 * inTriangles[i + 1]], &projected[3 * inTriangles[i + 2]], stats.pixelsShaded);
+        }
+        stats.pixelsCovered += rasterizer.getCovered();
+    }
+
+    if(stats.pixelsCovered) stats.overdraw = static_cast<float>(stats.pixelsShaded) / stats.pixelsCovered;
+    return stats;
+}
+
+//triangle cluster to be sorted for overdraw
+struct Cluster{
+    size_t begin;
+    size_t end;
+    float sortKey;
+};
+
+//front clusters go first
+struct ClusterCompare{
+    bool operator()(const Cluster& lhv, const Cluster& rhv) const{
+        return lhv.sortKey > rhv.sortKey;
+    }
+};
+
+//FIFO vertex cache which may be flushed in constant time
+class FifoCache{
+public:
+    FifoCache(size_t inVertexNum, unsigned int inCacheSize):
+        mInsertTime(inVertexNum, 0), mTime(1), mFlushTime(1), mCacheSize(inCacheSize){
+
+    }
+
+    //returns true if vertex was not in cache
+    inline bool access(Mesh::index_t inIndex){
+        size_t& inserted = mInsertTime[inIndex];
+        if(inserted >= mFlushTime && mTime - inserted < mCacheSize) return false;
+        inserted = mTime++;
+        return true;
+    }
+
+    //returns number of triangle's vertices which were not in cache
+    inline unsigned int access(const Mesh::index_t* inTriangle){
+        unsigned int misses = access(inTriangle[0])? 1: 0;
+        if(access(inTriangle[1])) ++misses;
+        if(access(inTriangle[2])) ++misses;
+        return misses;
+    }
+
+    inline void flush(){
+        mFlushTime = mTime;
+    }
+
+private:
+    std::vector<size_t> mInsertTime;
+    size_t mTime;
+    size_t mFlushTime;
     unsigned int mCacheSize;
 };
 
+} //unnamed namespace
+
 MeshOptimizer::MeshOptimizer(): mImpl(new MeshOptimizer::MeshOptImpl()){
 
 }
@@ -54,13 +426,75 @@ void MeshOptimizer::setCacheSize(unsigned int inSize){
     mImpl->mCacheSize = inSize;
 }
 
+unsigned int MeshOptimizer::getCacheSize() const{
+    return mImpl->mCacheSize;
+}
+
+void MeshOptimizer::setMode(MeshOptimizer::Mode inMode){
+    mImpl->mMode = inMode;
+}
+
+MeshOptimizer::Mode MeshOptimizer::getMode() const{
+    return mImpl->mMode;
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::analyzeVertexCache(const Mesh& inMesh, unsigned int inCacheSize){
+    CacheStatistics stats;
+    stats.indices = inMesh.getIndexNum();
+    stats.triangles = 0;
+    stats.vertices = 0;
+    stats.transformedVertices = 0;
+    stats.acmr = 0.0f;
+    stats.atvr = 0.0f;
+
+    const IndexBuffer& indices = inMesh.mIndices;
+
+    //count non-degenerate triangles
+    if(inMesh.mMode == Mesh::TRIANGLE_LIST){
+        for(size_t i = 0; i + 2 < indices.size(); i += 3){
+            if(indices[i] != indices[i + 1] && indices[i] != indices[i + 2] && indices[i + 1] != indices[i + 2]) ++stats.triangles;
+        }
+    }
+    else if(inMesh.mMode == Mesh::TRIANGLE_STRIP){
+        for(size_t i = 0; i + 2 < indices.size(); ++i){
+            if(indices[i] != indices[i + 1] && indices[i] != indices[i + 2] && indices[i + 1] != indices[i + 2]) ++stats.triangles;
+        }
+    }
+    else return stats;
+
+    //FIFO cache: vertex is in cache if it was inserted less than cache size misses ago
+    const size_t NOT_CACHED = static_cast<size_t>(-1);
+    std::vector<size_t> insertTime(inMesh.getVertexNum(), NOT_CACHED);
+    BOOST_FOREACH(Mesh::index_t nextIndex, indices){
+        assert(nextIndex < insertTime.size());
+        if(insertTime[nextIndex] == NOT_CACHED) ++stats.vertices;
+        if(insertTime[nextIndex] == NOT_CACHED || stats.transformedVertices - insertTime[nextIndex] >= inCacheSize){
+            insertTime[nextIndex] = stats.transformedVertices;
+            ++stats.transformedVertices;
+        }
+    }
+
+    if(stats.triangles) stats.acmr = static_cast<float>(stats.transformedVertices) / stats.triangles;
+    if(stats.vertices) stats.atvr = static_cast<float>(stats.transformedVertices) / stats.vertices;
+    return stats;
+}
+
 
 void MeshOptimizer::optimizeMesh(MeshPtr inMesh) const{
     //do nothing if given data is crappy
     if(!inMesh || inMesh->mMode != Mesh::TRIANGLES || inMesh->getIndexNum() < 3 || inMesh->getIndexNum()%3 != 0) return;
 
+    Mesh::IndexCont source;
+    inMesh->mIndices.copyTo(source);
+
+    if(mImpl->mMode == VERTEX_CACHE){
+        optimizeVertexCache(source, inMesh->getVertexNum(), mImpl->mCacheSize);
+        inMesh->mIndices.assign(source);
+        return;
+    }
+
     //create stripper
-    tri_stripper stripper(inMesh->mIndices);
+    tri_stripper stripper(source);
     
     stripper.SetCacheSize(mImpl->mCacheSize);
     //stripper.SetPushCacheHits(true);
@@ -73,8 +507,7 @@ void MeshOptimizer::optimizeMesh(MeshPtr inMesh) const{
     //we got several submeshes here in primitive_vector;
     //some of them must be triangle strips but some og them may be triangle lists;
 
-    inMesh->mIndices.clear();
-    Mesh::IndexCont& indices = inMesh->mIndices;
+    Mesh::IndexCont indices;
 
     //value to store size of last linked strip
     size_t lastStripSize = 0;
@@ -143,11 +576,130 @@ void MeshOptimizer::optimizeMesh(MeshPtr inMesh) const{
     //now we should add triangles lists
 
 
+    inMesh->mIndices.assign(indices);
     inMesh->mMode = Mesh::TRIANGLE_STRIP;
 
     delete optimized;
 }
 
+void MeshOptimizer::optimizeOverdraw(MeshPtr inMesh, float inThreshold) const{
+    if(!inMesh || inMesh->mMode != Mesh::TRIANGLES || inMesh->getIndexNum() < 6 || inMesh->getIndexNum()%3 != 0) return;
+
+    Mesh::IndexCont indices;
+    inMesh->mIndices.copyTo(indices);
+    const Mesh::VertexCont& vertices = inMesh->mVertices;
+    const size_t triNum = indices.size() / 3;
+
+    //hard boundaries: triangles which miss cache for all of their vertices
+    //(cache is already flushed there so reordering costs nothing)
+    FifoCache cache(vertices.size(), mImpl->mCacheSize);
+    std::vector<size_t> hardBoundaries(1, 0);
+    for(size_t t = 0; t < triNum; ++t){
+        if(cache.access(&indices[3 * t]) == 3 && t > 0) hardBoundaries.push_back(t);
+    }
+    hardBoundaries.push_back(triNum);
+
+    //soft boundaries: split hard clusters while ACMR stays below threshold
+    std::vector<Cluster> clusters;
+    for(size_t h = 0; h + 1 < hardBoundaries.size(); ++h){
+        const size_t begin = hardBoundaries[h];
+        const size_t end = hardBoundaries[h + 1];
+
+        cache.flush();
+        unsigned int clusterMisses = 0;
+        for(size_t t = begin; t < end; ++t) clusterMisses += cache.access(&indices[3 * t]);
+        const float maxACMR = inThreshold * clusterMisses / (end - begin);
+
+        cache.flush();
+        size_t start = begin;
+        unsigned int misses = 0;
+        for(size_t t = begin; t < end; ++t){
+            misses += cache.access(&indices[3 * t]);
+            if(t + 1 < end && misses <= maxACMR * (t + 1 - start)){
+                Cluster cluster = {start, t + 1, 0.0f};
+                clusters.push_back(cluster);
+                start = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+        Cluster cluster = {start, end, 0.0f};
+        clusters.push_back(cluster);
+    }
+    if(clusters.size() < 2) return;
+
+    //area-weighted centroids and normals of clusters
+    std::vector<Vector3D> centroids(clusters.size());
+    std::vector<Vector3D> normals(clusters.size());
+    Vector3D meshCentroid;
+    float meshArea = 0.0f;
+    for(size_t i = 0; i < clusters.size(); ++i){
+        float clusterArea = 0.0f;
+        for(size_t t = clusters[i].begin; t < clusters[i].end; ++t){
+            const Vector3D a(vertices[indices[3 * t]].mCoord);
+            const Vector3D b(vertices[indices[3 * t + 1]].mCoord);
+            const Vector3D c(vertices[indices[3 * t + 2]].mCoord);
+            const Vector3D normal = (b - a).cross(c - a);
+            const float area = normal.getMagnitude();
+            centroids[i] += (a + b + c) * (area / 3.0f);
+            normals[i] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += centroids[i];
+        meshArea += clusterArea;
+        if(clusterArea > 0.0f) centroids[i] /= clusterArea;
+    }
+    if(meshArea <= 0.0f) return;
+    meshCentroid /= meshArea;
+
+    //clusters which are far from center in direction of their normal occlude others
+    for(size_t i = 0; i < clusters.size(); ++i){
+        if(normals[i].getSquareMagnitude() > 0.0f){
+            clusters[i].sortKey = (centroids[i] - meshCentroid) * normals[i].getUnit();
+        }
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), ClusterCompare());
+
+    Mesh::IndexCont reordered;
+    reordered.reserve(indices.size());
+    BOOST_FOREACH(const Cluster& nextCluster, clusters){
+        reordered.insert(reordered.end(), indices.begin() + 3 * nextCluster.begin, indices.begin() + 3 * nextCluster.end);
+    }
+
+    //keep new order only if it is really better
+    const float before = estimateOverdraw(vertices, indices, OVERDRAW_RESOLUTION).overdraw;
+    const float after = estimateOverdraw(vertices, reordered, OVERDRAW_RESOLUTION).overdraw;
+    if(after < before) inMesh->mIndices.assign(reordered);
+}
+
+MeshOptimizer::OverdrawStatistics MeshOptimizer::analyzeOverdraw(const Mesh& inMesh, unsigned int inResolution){
+    Mesh::IndexCont triangles;
+    collectTriangles(inMesh, triangles);
+    return estimateOverdraw(inMesh.mVertices, triangles, inResolution);
+}
+
+MeshOptimizer::FetchStatistics MeshOptimizer::analyzeVertexFetch(const Mesh& inMesh, unsigned int inVertexSize){
+    FetchStatistics stats;
+    stats.bytesFetched = 0;
+    stats.overfetch = 0.0f;
+
+    const size_t dataSize = inMesh.getVertexNum() * inVertexSize;
+    if(dataSize == 0) return stats;
+
+    FifoCache cache((dataSize + FETCH_LINE_SIZE - 1) / FETCH_LINE_SIZE, FETCH_CACHE_LINES);
+    BOOST_FOREACH(Mesh::index_t nextIndex, inMesh.mIndices){
+        assert(nextIndex < inMesh.getVertexNum());
+        const size_t firstLine = nextIndex * inVertexSize / FETCH_LINE_SIZE;
+        const size_t lastLine = (nextIndex * inVertexSize + inVertexSize - 1) / FETCH_LINE_SIZE;
+        for(size_t line = firstLine; line <= lastLine; ++line){
+            if(cache.access(static_cast<Mesh::index_t>(line))) stats.bytesFetched += FETCH_LINE_SIZE;
+        }
+    }
+
+    stats.overfetch = static_cast<float>(stats.bytesFetched) / dataSize;
+    return stats;
+}
+
 
 /*
  *   Copyright 2010-2011 Alexander Medvedev
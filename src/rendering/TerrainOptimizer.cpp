@@ -16,9 +16,11 @@
 #include "common/QuadTree.hpp"
 #include "math/Point.hpp"
 #include "data/Vertex.hpp"
+#include "common/ParallelFor.hpp"
 
 #include <stdexcept>
 #include <algorithm>
+#include <limits>
 
 #include <cassert>
 #include <cmath>
@@ -69,11 +71,87 @@ enum VertexPos{
     CENTER_VERTEX = 8
 };
 
-typedef QuadTree<NodeData> RQuadTree; //restricted quad tree
+//restricted quad tree (32-bit indices allow fragments up to 2^16 + 1)
+typedef QuadTree<NodeData, unsigned int> RQuadTree;
+
+typedef RQuadTree::NodeId NodeId;
+
+//flag of vertex (or quad for CENTER_VERTEX) to enable after parallel pass of generateLOD
+struct DeferredFlag{
+    NodeId node;
+    VertexPos vertex;
+};
+
+//subtree handled by separate task
+struct Subtree{
+    NodeId node;
+    unsigned int bottomLeftCorner;
+    unsigned int size;
+};
+
+//state of enable flags calculation
+struct EnableContext{
+    //nodes which may be changed: [begin, end)
+    NodeId begin;
+    NodeId end;
+
+    //children of nodes of this depth are not visited (0 - all are visited)
+    unsigned int stopDepth;
+
+    //changes of nodes outside of range are saved here
+    std::vector<DeferredFlag>* deferred;
+
+    inline bool owns(NodeId inNode) const{
+        return inNode >= begin && inNode < end;
+    }
+};
+
+//subtree which triangulation is built by separate task
+struct DeferredTriangulation{
+    RQuadTree::Node* node;
+    RQuadTree::NodePos startCorner;
+    unsigned int southWestCornerCoord;
+    unsigned int size;
+    bool onePass;
+    //position in list of indices of parent task
+    size_t offset;
+    std::vector<unsigned int> indices;
+};
+
+//list of indices of triangulation;
+//subtrees of specified size may be deferred to be triangulated in parallel
+struct TriangleList{
+    TriangleList(std::vector<unsigned int>& inIndices, unsigned int inSplitSize = 0, std::vector<DeferredTriangulation>* inDeferred = 0):
+        indices(inIndices), splitSize(inSplitSize), deferred(inDeferred){
+
+    }
+
+    inline void push_back(unsigned int inIndex){
+        indices.push_back(inIndex);
+    }
+
+    //returns true if subtree is saved to be triangulated later
+    inline bool defer(RQuadTree::Node& inNode, RQuadTree::NodePos inStartCorner, unsigned int inSouthWestCornerCoord, unsigned int inSize, bool inOnePass){
+        if(!deferred || inSize != splitSize) return false;
+        DeferredTriangulation next;
+        next.node = &inNode;
+        next.startCorner = inStartCorner;
+        next.southWestCornerCoord = inSouthWestCornerCoord;
+        next.size = inSize;
+        next.onePass = inOnePass;
+        next.offset = indices.size();
+        deferred->push_back(next);
+        return true;
+    }
+
+    std::vector<unsigned int>& indices;
+    unsigned int splitSize;
+    std::vector<DeferredTriangulation>* deferred;
+};
 
 struct TerrainOptimizer::Impl{
 
-    Impl(unsigned int inSize): tree(new RQuadTree(inSize)){
+    Impl(unsigned int inSize, unsigned int inThreadNum): tree(new RQuadTree(inSize)), threadNum(inThreadNum), lodError(std::numeric_limits<float>::max()){
 
     }
 
@@ -205,32 +283,152 @@ struct TerrainOptimizer::Impl{
 
     }
 
+    //returns number of nodes in subtree with root of specified depth
+    inline NodeId getSubtreeNodeNum(unsigned int inDepth) const{
+        assert(inDepth < tree->getResolution());
+        NodeId result = 0;
+        for(unsigned int i = inDepth; i < tree->getResolution(); ++i) result = result * 4 + 1;
+        return result;
+    }
+
+    //returns depth of subtrees handled by separate tasks for quad of specified size
+    //(0 if quad is handled by a single thread)
+    inline unsigned int getSplitDepth(unsigned int inSize) const{
+        const unsigned int threads = (threadNum > 0)? threadNum: hydra::common::getHardwareThreadNum();
+        if(threads <= 1 || inSize < 5) return 0;
+
+        //several subtrees per thread to balance uneven ones
+        unsigned int depth = 1;
+        while((1u << (2 * depth)) < 8 * threads && ((inSize - 1) >> (depth + 1)) >= 2) ++depth;
+        return depth;
+    }
+
+    //collects subtrees of split depth in order of quad positions,
+    //returns their depth (0 if tree is not splitted)
+    unsigned int collectSubtrees(std::vector<Subtree>& outSubtrees) const{
+        const unsigned int depth = getSplitDepth(getTotalSize());
+        if(depth > 0) recursiveCollectSubtrees(0, 0, getTotalSize(), depth, outSubtrees);
+        return depth;
+    }
+
+    void recursiveCollectSubtrees(NodeId inNodeId, unsigned int inBottomLeftCorner, unsigned int inSize, unsigned int inDepth, std::vector<Subtree>& outSubtrees) const{
+        if(inDepth == 0){
+            Subtree next = {inNodeId, inBottomLeftCorner, inSize};
+            outSubtrees.push_back(next);
+            return;
+        }
+        const RQuadTree::Node& node = tree->getNode(inNodeId);
+        for(int i = 0; i < 4; ++i){
+            assert(node.nodes[i] != 0);
+            recursiveCollectSubtrees(node.nodes[i], 
+                    calcPointPos(inBottomLeftCorner, inSize, getBottomLeftCorner(static_cast<RQuadTree::NodePos>(i)), getTotalSize()), 
+                    (inSize - 1) / 2 + 1, inDepth - 1, outSubtrees);
+        }
+    }
+
     ///================================END OF UTILITIES=================================
 
+    ///===================================TASKS=========================================
+
+    //calculates errors of subtrees
+    struct MaxErrorsTask{
+        Impl* impl;
+        const float* heights;
+        const std::vector<Subtree>* subtrees;
+
+        void operator()(size_t inBegin, size_t inEnd) const{
+            for(size_t i = inBegin; i < inEnd; ++i){
+                const Subtree& next = (*subtrees)[i];
+                impl->recursiveCalculateMaxErrors(impl->tree->getNode(next.node), heights, next.bottomLeftCorner, next.size);
+            }
+        }
+    };
+
+    //drops enable flags of range of nodes
+    struct ClearFlagsTask{
+        Impl* impl;
+
+        void operator()(size_t inBegin, size_t inEnd) const{
+            RQuadTree::iterator begin = impl->tree->begin();
+            for(size_t i = inBegin; i < inEnd; ++i) begin[i].data.flags = NodeData::NONE;
+        }
+    };
+
+    //calculates enable flags of subtrees, changes of other nodes are deferred
+    struct EnableFlagsTask{
+        Impl* impl;
+        float maxError;
+        unsigned int depth;
+        const std::vector<Subtree>* subtrees;
+        std::vector<std::vector<DeferredFlag> >* deferred;
+
+        void operator()(size_t inBegin, size_t inEnd) const{
+            const NodeId nodeNum = impl->getSubtreeNodeNum(depth);
+            for(size_t i = inBegin; i < inEnd; ++i){
+                const NodeId root = (*subtrees)[i].node;
+                EnableContext context = {root, root + nodeNum, 0, &(*deferred)[i]};
+                impl->recursiveCalculateEnableFlags(root, maxError, depth, context);
+            }
+        }
+    };
+
+    //triangulates deferred subtrees
+    struct TriangulationTask{
+        const Impl* impl;
+        std::vector<DeferredTriangulation>* deferred;
+
+        void operator()(size_t inBegin, size_t inEnd) const{
+            for(size_t i = inBegin; i < inEnd; ++i){
+                DeferredTriangulation& next = (*deferred)[i];
+                TriangleList list(next.indices);
+                if(next.onePass) impl->recursiveTriangulateInOnePass(list, *next.node, next.startCorner, next.southWestCornerCoord, next.size);
+                else impl->recursiveTriangulateInTwoPasses(list, *next.node, next.startCorner, next.southWestCornerCoord, next.size);
+            }
+        }
+    };
+
+    ///================================END OF TASKS=====================================
+
     //calculates maximum errors for hole tree (vertex errors and quad errors)
     //drops 'enable flags'
     void calculateMaxErrors(const HeightMap& inHeightmap){
         assert(tree);
 
         clearEnableFlags();
-        recursiveCalculateMaxErrors(tree->getRoot(), inHeightmap, 0, inHeightmap.getSize());
+        lodError = std::numeric_limits<float>::max();
+
+        //heights are read at once, so there are no virtual calls per height
+        std::vector<float> heights(inHeightmap.getSize() * inHeightmap.getSize());
+        inHeightmap.getHeights(0, heights.size(), &heights[0]);
+
+        //subtrees are independent, so they are calculated in parallel,
+        //then the top of the tree uses their errors
+        std::vector<Subtree> subtrees;
+        if(collectSubtrees(subtrees) == 0){
+            recursiveCalculateMaxErrors(tree->getRoot(), &heights[0], 0, inHeightmap.getSize());
+            return;
+        }
+        MaxErrorsTask task = {this, &heights[0], &subtrees};
+        hydra::common::parallelFor(0, subtrees.size(), task, threadNum, 1);
+        recursiveCalculateMaxErrors(tree->getRoot(), &heights[0], 0, inHeightmap.getSize(), subtrees[0].size);
     }
 
     //recursive function to calculate errors based on original heightmap and save them into our restricted quad tree
-    void recursiveCalculateMaxErrors(RQuadTree::Node& node, const HeightMap& heightmap, unsigned int bottomLeftCorner, unsigned int size){
+    //quads of inCalculatedSize are not visited (their errors must be calculated already)
+    void recursiveCalculateMaxErrors(RQuadTree::Node& node, const float* heightmap, unsigned int bottomLeftCorner, unsigned int size, unsigned int inCalculatedSize = 0){
 
         //calculate vertex errors
         {
             //save corner heights
-            float upperLeftHeight = heightmap[calcPointPos(bottomLeftCorner, size, NORTH_WEST_VERTEX, heightmap.getSize())];
-            float bottomLeftHeight = heightmap[calcPointPos(bottomLeftCorner, size, SOUTH_WEST_VERTEX, heightmap.getSize())];
-            float upperRightHeight = heightmap[calcPointPos(bottomLeftCorner, size, NORTH_EAST_VERTEX, heightmap.getSize())];
-            float bottomRightHeight = heightmap[calcPointPos(bottomLeftCorner, size, SOUTH_EAST_VERTEX, heightmap.getSize())];
+            float upperLeftHeight = heightmap[calcPointPos(bottomLeftCorner, size, NORTH_WEST_VERTEX, getTotalSize())];
+            float bottomLeftHeight = heightmap[calcPointPos(bottomLeftCorner, size, SOUTH_WEST_VERTEX, getTotalSize())];
+            float upperRightHeight = heightmap[calcPointPos(bottomLeftCorner, size, NORTH_EAST_VERTEX, getTotalSize())];
+            float bottomRightHeight = heightmap[calcPointPos(bottomLeftCorner, size, SOUTH_EAST_VERTEX, getTotalSize())];
 
-            node.data.vertex_errors[static_cast<VertexPos>(NORTH_VERTEX - 4)] = errorBetweenLineAndPoint(heightmap[calcPointPos(bottomLeftCorner, size, NORTH_VERTEX, heightmap.getSize())], upperLeftHeight, upperRightHeight);
-            node.data.vertex_errors[static_cast<VertexPos>(EAST_VERTEX - 4)] = errorBetweenLineAndPoint(heightmap[calcPointPos(bottomLeftCorner, size, EAST_VERTEX, heightmap.getSize())], upperRightHeight, bottomRightHeight);
-            node.data.vertex_errors[static_cast<VertexPos>(SOUTH_VERTEX - 4)] = errorBetweenLineAndPoint(heightmap[calcPointPos(bottomLeftCorner, size, SOUTH_VERTEX, heightmap.getSize())], bottomRightHeight, bottomLeftHeight);
-            node.data.vertex_errors[static_cast<VertexPos>(WEST_VERTEX - 4)] = errorBetweenLineAndPoint(heightmap[calcPointPos(bottomLeftCorner, size, WEST_VERTEX, heightmap.getSize())], bottomLeftHeight, upperLeftHeight);
+            node.data.vertex_errors[static_cast<VertexPos>(NORTH_VERTEX - 4)] = errorBetweenLineAndPoint(heightmap[calcPointPos(bottomLeftCorner, size, NORTH_VERTEX, getTotalSize())], upperLeftHeight, upperRightHeight);
+            node.data.vertex_errors[static_cast<VertexPos>(EAST_VERTEX - 4)] = errorBetweenLineAndPoint(heightmap[calcPointPos(bottomLeftCorner, size, EAST_VERTEX, getTotalSize())], upperRightHeight, bottomRightHeight);
+            node.data.vertex_errors[static_cast<VertexPos>(SOUTH_VERTEX - 4)] = errorBetweenLineAndPoint(heightmap[calcPointPos(bottomLeftCorner, size, SOUTH_VERTEX, getTotalSize())], bottomRightHeight, bottomLeftHeight);
+            node.data.vertex_errors[static_cast<VertexPos>(WEST_VERTEX - 4)] = errorBetweenLineAndPoint(heightmap[calcPointPos(bottomLeftCorner, size, WEST_VERTEX, getTotalSize())], bottomLeftHeight, upperLeftHeight);
 
         }
 
@@ -241,16 +439,19 @@ struct TerrainOptimizer::Impl{
                 unsigned int newBottomLeftCorner = 
                     calcPointPos(bottomLeftCorner, size, 
                             getBottomLeftCorner(static_cast<RQuadTree::NodePos>(i)), 
-                            heightmap.getSize());
-                recursiveCalculateMaxErrors(tree->getNode(node.nodes[i]), 
-                                    heightmap, 
-                                    newBottomLeftCorner, 
-                                    (size - 1)/2 + 1 );
+                            getTotalSize());
+                if((size - 1)/2 + 1 != inCalculatedSize){
+                    recursiveCalculateMaxErrors(tree->getNode(node.nodes[i]), 
+                                        heightmap, 
+                                        newBottomLeftCorner, 
+                                        (size - 1)/2 + 1,
+                                        inCalculatedSize);
+                }
                 //error is a maximum error between all inner optional elements of quad and error of central point
                 
-                float centerHeight = heightmap[calcPointPos(newBottomLeftCorner, (size - 1)/2 + 1, CENTER_VERTEX, heightmap.getSize())];
+                float centerHeight = heightmap[calcPointPos(newBottomLeftCorner, (size - 1)/2 + 1, CENTER_VERTEX, getTotalSize())];
                 float lineHeight1 = heightmap[newBottomLeftCorner]; //same corner
-                float lineHeight2 = heightmap[calcPointPos(newBottomLeftCorner, (size - 1)/2 + 1, NORTH_EAST_VERTEX, heightmap.getSize())];
+                float lineHeight2 = heightmap[calcPointPos(newBottomLeftCorner, (size - 1)/2 + 1, NORTH_EAST_VERTEX, getTotalSize())];
                 float centerError = errorBetweenLineAndPoint(centerHeight, lineHeight1, lineHeight2);
                 node.data.quad_errors[i] = std::max(maxErrorOfQuad(tree->getNode(node.nodes[i]).data), centerError);
             }
@@ -263,27 +464,57 @@ struct TerrainOptimizer::Impl{
     void clearEnableFlags(){
         assert(tree);
 
-        recursiveClearEnableFlags(tree->getRoot());
-    }
-
-    void recursiveClearEnableFlags(RQuadTree::Node& inNode){
-        inNode.data.flags = NodeData::NONE;
-
-        for(int i = 0; i < 4; ++i){
-            if(inNode.nodes[i] != 0) recursiveClearEnableFlags(tree->getNode(inNode.nodes[i]));
-        }
+        ClearFlagsTask task = {this};
+        hydra::common::parallelFor(0, tree->end() - tree->begin(), task, threadNum, 65536);
     }
 
     void calculateEnableFlags(float inMaxError){
         assert(tree);
 
-        recursiveCalculateEnableFlags(0, inMaxError);
+        const NodeId nodeNum = static_cast<NodeId>(tree->end() - tree->begin());
+        EnableContext whole = {0, nodeNum, 0, 0};
+        std::vector<Subtree> subtrees;
+        const unsigned int depth = collectSubtrees(subtrees);
+        if(depth == 0){
+            recursiveCalculateEnableFlags(0, inMaxError, 0, whole);
+            return;
+        }
+
+        //flags only become enabled, so the result doesn't depend on order:
+        //top of the tree is handled first, then subtrees in parallel,
+        //then changes of nodes outside of subtrees are applied
+        EnableContext top = whole;
+        top.stopDepth = depth;
+        recursiveCalculateEnableFlags(0, inMaxError, 0, top);
+
+        std::vector<std::vector<DeferredFlag> > deferred(subtrees.size());
+        EnableFlagsTask task = {this, inMaxError, depth, &subtrees, &deferred};
+        hydra::common::parallelFor(0, subtrees.size(), task, threadNum, 1);
+
+        for(size_t i = 0; i < deferred.size(); ++i){
+            for(size_t j = 0; j < deferred[i].size(); ++j){
+                const DeferredFlag& next = deferred[i][j];
+                if(next.vertex == CENTER_VERTEX){
+                    enableQuad(next.node, whole);
+                }
+                else if(!(tree->getNode(next.node).data.flags & fromVertexToMask(next.vertex))){
+                    tree->getNode(next.node).data.flags |= fromVertexToMask(next.vertex);
+                    notifyNeighbours(next.node, next.vertex, whole);
+                }
+            }
+        }
     }
 
     //recursively enables chain from root to current quad
-    void enableQuad(unsigned short inNodeId){
-        unsigned short nodeId = inNodeId;
+    //parents outside of context are enabled later
+    void enableQuad(NodeId inNodeId, const EnableContext& inContext){
+        NodeId nodeId = inNodeId;
         while(nodeId != 0){
+            if(!inContext.owns(tree->getNode(nodeId).parent)){
+                DeferredFlag next = {nodeId, CENTER_VERTEX};
+                inContext.deferred->push_back(next);
+                return;
+            }
             RQuadTree::Node& parent = tree->getNode(tree->getNode(nodeId).parent);
         
             //find out what position current node takes
@@ -304,13 +535,13 @@ struct TerrainOptimizer::Impl{
                                                         nextCCW(static_cast<RQuadTree::NodePos>(pos)));
                 if(!(parent.data.flags & fromVertexToMask(vertex))){
                     parent.data.flags |= fromVertexToMask(vertex);
-                    notifyNeighbours(tree->getNode(nodeId).parent, vertex);
+                    notifyNeighbours(tree->getNode(nodeId).parent, vertex, inContext);
                 }
                 vertex = getVertexBetweenQuads(static_cast<RQuadTree::NodePos>(pos), 
                                                         nextCW(static_cast<RQuadTree::NodePos>(pos)));
                 if(!(parent.data.flags & fromVertexToMask(vertex))){
                     parent.data.flags |= fromVertexToMask(vertex);
-                    notifyNeighbours(tree->getNode(nodeId).parent, vertex);
+                    notifyNeighbours(tree->getNode(nodeId).parent, vertex, inContext);
                 }
                 nodeId = tree->getNode(nodeId).parent;
             }
@@ -324,28 +555,35 @@ struct TerrainOptimizer::Impl{
     //recursively notifies all the neighbours of enabled vertex
     //all the dependencies will be resolved (current vertex must be enabled before)
     //handle NORTH, WEST, EAST, SOUTH and CENTER vertices
-    void notifyNeighbours(unsigned short inNodeId, VertexPos inEnabledVertex){
+    //(neighbours outside of context are notified later)
+    void notifyNeighbours(NodeId inNodeId, VertexPos inEnabledVertex, const EnableContext& inContext){
         //first we enable current node (if it was not enabled yet)
         if(inNodeId != 0){
-            enableQuad(inNodeId);
+            enableQuad(inNodeId, inContext);
         
             //for non-center vertex we should enable neighbour quad and his vertex
             if(inEnabledVertex != CENTER_VERTEX){
                 //check neighbour quad
-                if(tree->getNode(inNodeId).neighbours[inEnabledVertex - 4] != 0){
+                const NodeId neighbourId = tree->getNode(inNodeId).neighbours[inEnabledVertex - 4];
+                if(neighbourId != 0 && !inContext.owns(neighbourId)){
+                    DeferredFlag next = {neighbourId, getOpposite(inEnabledVertex)};
+                    inContext.deferred->push_back(next);
+                }
+                else if(neighbourId != 0){
                     RQuadTree::Node& neighbour = tree->getNode(tree->getNode(inNodeId).neighbours[inEnabledVertex - 4]);
                     //if not enabled, enable it
                     if(!(neighbour.data.flags & fromVertexToMask(getOpposite(inEnabledVertex)))){
                         neighbour.data.flags |= fromVertexToMask(getOpposite(inEnabledVertex));
                         //notify
-                        notifyNeighbours(tree->getNode(inNodeId).neighbours[inEnabledVertex - 4], getOpposite(inEnabledVertex));
+                        notifyNeighbours(neighbourId, getOpposite(inEnabledVertex), inContext);
                     }
                 }
             }
         }
     }
 
-    void recursiveCalculateEnableFlags(unsigned short inNodeId, float inMaxError){
+    //children of nodes of context's stop depth are not visited
+    void recursiveCalculateEnableFlags(NodeId inNodeId, float inMaxError, unsigned int inDepth, const EnableContext& inContext){
            
         RQuadTree::Node& inNode = tree->getNode(inNodeId); 
         //calc vertices
@@ -354,7 +592,7 @@ struct TerrainOptimizer::Impl{
             if(inNode.data.vertex_errors[i] > inMaxError){
                 inNode.data.flags |= fromVertexToMask(static_cast<VertexPos>(i + 4));
                 
-                notifyNeighbours(inNodeId, static_cast<VertexPos>(i + 4));
+                notifyNeighbours(inNodeId, static_cast<VertexPos>(i + 4), inContext);
             }
         }
 
@@ -362,25 +600,28 @@ struct TerrainOptimizer::Impl{
         for(int i = 0; i < 4; ++i){
             if(inNode.nodes[i] == 0) continue;
             if(inNode.data.flags & fromQuadToMask(static_cast<RQuadTree::NodePos>(i))){
-                recursiveCalculateEnableFlags(inNode.nodes[i], inMaxError);
+                //quad error is the maximum error of the whole subquad,
+                //so there is nothing to enable inside if it is small
+                if(inNode.data.quad_errors[i] > inMaxError && inDepth + 1 != inContext.stopDepth) recursiveCalculateEnableFlags(inNode.nodes[i], inMaxError, inDepth + 1, inContext);
                 continue;
             }
 
             if(inNode.data.quad_errors[i] > inMaxError){
                 //inNode.data.flags |= fromQuadToMask(static_cast<RQuadTree::NodePos>(i));
-                enableQuad(inNode.nodes[i]);
+                enableQuad(inNode.nodes[i], inContext);
 
 
-                notifyNeighbours(inNode.nodes[i], CENTER_VERTEX);
+                notifyNeighbours(inNode.nodes[i], CENTER_VERTEX, inContext);
                 
                 //recursive call for enabled quad
-                recursiveCalculateEnableFlags(inNode.nodes[i], inMaxError);
+                if(inDepth + 1 != inContext.stopDepth) recursiveCalculateEnableFlags(inNode.nodes[i], inMaxError, inDepth + 1, inContext);
             }
         }
     }
 
     //recursive function to triangulate specified node in one pass 
-    void recursiveTriangulateInOnePass(std::vector<unsigned int>& inoutList, RQuadTree::Node& inNode, RQuadTree::NodePos inStartCorner, unsigned int inSouthWestCornerCoord, unsigned int inCurrentSize) const{
+    void recursiveTriangulateInOnePass(TriangleList& inoutList, RQuadTree::Node& inNode, RQuadTree::NodePos inStartCorner, unsigned int inSouthWestCornerCoord, unsigned int inCurrentSize) const{
+        if(inoutList.defer(inNode, inStartCorner, inSouthWestCornerCoord, inCurrentSize, true)) return;
        
         RQuadTree::NodePos nextQuadPos = inStartCorner;
         RQuadTree::NodePos nextQuadStart = inStartCorner;
@@ -515,7 +756,8 @@ struct TerrainOptimizer::Impl{
     //recursive function to triangulate specified node in two passes
     //(should be called twice for every node as it triangulates only half of quad)
     //see [1] for more info
-    void recursiveTriangulateInTwoPasses(std::vector<unsigned int>& inoutList, RQuadTree::Node& inNode, RQuadTree::NodePos inStartCorner, unsigned int inSouthWestCornerCoord, unsigned int inCurrentSize) const{
+    void recursiveTriangulateInTwoPasses(TriangleList& inoutList, RQuadTree::Node& inNode, RQuadTree::NodePos inStartCorner, unsigned int inSouthWestCornerCoord, unsigned int inCurrentSize) const{
+        if(inoutList.defer(inNode, inStartCorner, inSouthWestCornerCoord, inCurrentSize, false)) return;
         
         RQuadTree::NodePos nextQuadPos = inStartCorner;
         RQuadTree::NodePos nextQuadStart = inStartCorner;
@@ -594,17 +836,52 @@ struct TerrainOptimizer::Impl{
     std::vector<unsigned int> triangulate() const{
         assert(tree);
 
-        std::vector<unsigned int> list;
-        recursiveTriangulateInOnePass(list, tree->getRoot(), RQuadTree::SOUTH_WEST_QUAD, 0, getTotalSize());
+        return triangulate(tree->getRoot(), 0, getTotalSize());
+    }
 
-        return list;
+    ///builds triangle list for specified quad
+    std::vector<unsigned int> triangulate(RQuadTree::Node& inNode, unsigned int inSouthWestCornerCoord, unsigned int inSize) const{
+        std::vector<unsigned int> result;
+        const unsigned int depth = getSplitDepth(inSize);
+        if(depth == 0){
+            TriangleList list(result);
+            recursiveTriangulateInOnePass(list, inNode, RQuadTree::SOUTH_WEST_QUAD, inSouthWestCornerCoord, inSize);
+            return result;
+        }
+
+        //enabled subtrees of split depth are triangulated in parallel,
+        //then their indices are inserted to the places they would take
+        std::vector<unsigned int> top;
+        std::vector<DeferredTriangulation> deferred;
+        TriangleList list(top, ((inSize - 1) >> depth) + 1, &deferred);
+        recursiveTriangulateInOnePass(list, inNode, RQuadTree::SOUTH_WEST_QUAD, inSouthWestCornerCoord, inSize);
+        TriangulationTask task = {this, &deferred};
+        hydra::common::parallelFor(0, deferred.size(), task, threadNum, 1);
+
+        size_t totalSize = top.size();
+        for(size_t i = 0; i < deferred.size(); ++i) totalSize += deferred[i].indices.size();
+        result.reserve(totalSize);
+        size_t copied = 0;
+        for(size_t i = 0; i < deferred.size(); ++i){
+            result.insert(result.end(), top.begin() + copied, top.begin() + deferred[i].offset);
+            result.insert(result.end(), deferred[i].indices.begin(), deferred[i].indices.end());
+            copied = deferred[i].offset;
+        }
+        result.insert(result.end(), top.begin() + copied, top.end());
+        return result;
     }
 
  
     hydra::common::SharedPtr<RQuadTree>::Type tree;
+
+    ///number of threads (0 - number of hardware threads)
+    unsigned int threadNum;
+
+    ///max error of LOD which enable flags are stored in tree (max float if there are no flags)
+    float lodError;
 };
 
-TerrainOptimizer::TerrainOptimizer(const HeightMap& inHeights): mImpl(new TerrainOptimizer::Impl(log2(inHeights.getSize() - 1))){
+TerrainOptimizer::TerrainOptimizer(const HeightMap& inHeights, unsigned int inThreadNum): mImpl(new TerrainOptimizer::Impl(log2(inHeights.getSize() - 1), inThreadNum)){
     //empty tree is built here
     //we should fill tree (full) with error data using height map
     mImpl->calculateMaxErrors(inHeights);
@@ -615,6 +892,16 @@ TerrainOptimizer::~TerrainOptimizer(){
 
 }
 
+void TerrainOptimizer::setThreadNum(unsigned int inThreadNum){
+    assert(mImpl);
+    mImpl->threadNum = inThreadNum;
+}
+
+unsigned int TerrainOptimizer::getThreadNum() const{
+    assert(mImpl);
+    return mImpl->threadNum;
+}
+
 void TerrainOptimizer::rebuild(const HeightMap& inHeights){
     assert(mImpl);
     assert(mImpl->tree);
@@ -632,7 +919,13 @@ void TerrainOptimizer::generateLOD(float inMaxError){
     
     //first we build tree which contains all the included quads and vertices
     //we use same tree
+    //enabled elements of less detailed LOD are enabled in more detailed one too,
+    //so flags are dropped only if error grows
+    if(inMaxError > mImpl->lodError){
+        mImpl->clearEnableFlags();
+    }
     mImpl->calculateEnableFlags(inMaxError);
+    mImpl->lodError = inMaxError;
 }
 
 std::vector<unsigned int> TerrainOptimizer::getTriangulation() const{
@@ -654,7 +947,7 @@ std::vector<unsigned int> TerrainOptimizer::getTriangulation(const std::vector<i
     unsigned int currentSize = totalSize;
     unsigned int bottomLeftCornerCoord = 0;
     std::vector<unsigned int> list;
-    unsigned short nodeIndex = 0;
+    NodeId nodeIndex = 0;
 
     //we triangulate only the chunk we need
     for(size_t i = 0; i < inPositionStack.size(); ++i){
@@ -670,9 +963,7 @@ std::vector<unsigned int> TerrainOptimizer::getTriangulation(const std::vector<i
         currentSize = (currentSize - 1) / 2 + 1;
     }
 
-    mImpl->recursiveTriangulateInOnePass(list, mImpl->tree->getNode(nodeIndex), RQuadTree::SOUTH_WEST_QUAD, bottomLeftCornerCoord, currentSize);
-
-    return list;
+    return mImpl->triangulate(mImpl->tree->getNode(nodeIndex), bottomLeftCornerCoord, currentSize);
 }
 
 std::vector<hydra::data::Vertex> TerrainOptimizer::generateVertices(const HeightMap& inHeights, float inVertexStride){
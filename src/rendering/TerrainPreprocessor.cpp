@@ -16,9 +16,11 @@
 #include "rendering/TerrainOptimizer.hpp"
 #include "common/QuadTree.hpp"
 #include "common/LoadStatus.hpp"
+#include "common/Timer.hpp"
 #include "data/TerrainChunk.hpp"
 #include "data/TerrainFragment.hpp"
 #include "data/HeightMap.hpp"
+#include "data/HeightMapNormals.hpp"
 #include "math/AABB.hpp"
 #include "data/Vertex.hpp"
 #include "data/Mesh.hpp"
@@ -37,10 +39,12 @@ using hydra::rendering::TerrainOptimizerPtr;
 using hydra::data::TerrainFragment;
 using hydra::data::TerrainFragmentPtr;
 using hydra::common::QuadTree;
+using hydra::common::Timer;
 using hydra::data::TerrainChunk;
 using hydra::data::TerrainChunkPtr;
 using hydra::common::Conditional;
 using hydra::data::HeightMap;
+using hydra::data::HeightMapNormals;
 using hydra::data::Vertex;
 using hydra::data::Mesh;
 using hydra::math::AABB;
@@ -223,24 +227,28 @@ struct SkirtTriangulationBuilder: public QTree::NodeFunctor{
     unsigned int fragmentSize;
 };
 
-//functor for marking vertices as enabled in special set
-struct VertexMarker: public QTree::NodeFunctor{
-    VertexMarker(): number(0){
+//functor to collect vertices which are used for the first time in specified level
+//(their values in transformation map are not less than inUnusedValue)
+struct NewVertexCollector: public QTree::NodeFunctor{
+    NewVertexCollector(std::vector<unsigned int>& inTransformationMap, unsigned int inUnusedValue): 
+        mTransformationMap(inTransformationMap), mUnusedValue(inUnusedValue){
 
     }
 
     virtual void operator()(QTree&, QTree::Node& node){
         LongIndexCont& indices = node.data.longIndices;
         for(unsigned int index = 0; index < indices.size(); ++index){
-            if(!bitmap[indices[index]]){
-                ++number;
-                bitmap[indices[index]] = true;
+            if(mTransformationMap[indices[index]] == mUnusedValue){
+                //mark as collected
+                mTransformationMap[indices[index]] = mUnusedValue + 1;
+                vertices.push_back(indices[index]);
             }
         }
     }
 
-    unsigned int number;
-    std::vector<bool> bitmap;
+    std::vector<unsigned int>& mTransformationMap;
+    unsigned int mUnusedValue;
+    std::vector<unsigned int> vertices;
 };
 
 //functor to transform indices using map
@@ -291,7 +299,7 @@ struct AABBCalculator: public TerrainFragment::QuadTreeOfChunks::NodeFunctor{
         //build mesh object
         mesh.mIndices.resize(node.data.ptr->indices.size());
         for(size_t i = 0; i < mesh.mIndices.size(); ++i)
-            mesh.mIndices[i] = node.data.ptr->indices[i];
+            mesh.mIndices.set(i, node.data.ptr->indices[i]);
         
         node.data.aabb = mesh.calcAABB();
     }
@@ -302,11 +310,14 @@ struct AABBCalculator: public TerrainFragment::QuadTreeOfChunks::NodeFunctor{
 
 struct TerrainPreprocessor::Impl{
     Impl(TerrainPreprocessor::Properties inProps): properties(inProps){
-        
+        timings.vertices = 0;
+        timings.optimization = 0;
+        timings.chunks = 0;
     }
 
     TerrainPreprocessor::Properties properties;
     TerrainOptimizerPtr optimizer;
+    TerrainPreprocessor::Timings timings;
 };
 
 TerrainPreprocessor::TerrainPreprocessor(TerrainPreprocessor::Properties inProperties): mImpl(new TerrainPreprocessor::Impl(inProperties)){
@@ -318,107 +329,55 @@ TerrainPreprocessor::~TerrainPreprocessor(){
 }
 
 
-Vector3D calcNormalForTriangle(Vector3D vert1, Vector3D vert2, Vector3D vert3){
-    Vector3D vec1(vert2.x() - vert1.x(), vert2.y() - vert1.y(), vert2.z() - vert1.z());
-    Vector3D vec2(vert3.x() - vert1.x(), vert3.y() - vert1.y(), vert3.z() - vert1.z());
-
-    //find cross product
-    return vec1.cross(vec2);
-}
-
 //helper function to generate compressed vertices from heightmap (row-major with lower left origin)
 static TerrainFragment::VertexCont generateVertices(const HeightMap& inHeightMap, bool inGenSkirts){
+    const unsigned int size = inHeightMap.getSize();
     TerrainFragment::VertexCont vertices;
     if(!inGenSkirts){
-        vertices.resize(inHeightMap.getSize() * inHeightMap.getSize());
+        vertices.resize(size * size);
     }
     else{
-        vertices.resize(2 * inHeightMap.getSize() * inHeightMap.getSize());
+        vertices.resize(2 * size * size);
     }
 
-    for(unsigned int i = 0; i < inHeightMap.getSize(); ++i){ //line
-        for(unsigned int j = 0; j < inHeightMap.getSize(); ++j){
+    //heights are read line by line into buffers (3 lines are needed for normals)
+    std::vector<float> heights(3 * size);
+    std::vector<float> normals(3 * size);
+    float* lines[3] = {&heights[0], &heights[size], &heights[2 * size]};
+    inHeightMap.getHeights(0, size, lines[1]);
+    if(size > 1) inHeightMap.getHeights(size, size, lines[2]);
+
+    for(unsigned int i = 0; i < size; ++i){ //line
+        //normal is a sum of normals of neighbouring triangles
+        HeightMapNormals::calcLine((i != 0)? lines[0]: 0, lines[1], (i != size - 1)? lines[2]: 0, size,
+                                   &normals[0], &normals[size], &normals[2 * size]);
+
+        for(unsigned int j = 0; j < size; ++j){
             TerrainFragment::CompressedVertex newVertex;
             newVertex.x = static_cast<unsigned short>(i);
-            newVertex.y = (inHeightMap[i * inHeightMap.getSize() + j]);
+            newVertex.y = lines[1][j];
             newVertex.z = static_cast<unsigned short>(j);
-
-            //normal?? no
-            //we will generate normals later using Mesh utility functions
-            //well, actually, yes!
-            //TODO
-
-            //dirty
-            //traverse all neighbouring triangles and calculate normal
-            Vector3D normal(0.0f, 0.0f, 0.0f);
-			//we are assuming that i and j may not be very big
-            Vector3D thisVertex(static_cast<float>(i), newVertex.y, static_cast<float>(j));
-        
-            //first get normal contribution on the left (for index i - 1)
-            if(i != 0){
-
-                Vector3D leftVertex(static_cast<float>(i - 1), inHeightMap[(i - 1) * inHeightMap.getSize() + j], static_cast<float>(j));
-
-                //on the bottom (second index j - 1)
-                if(j != 0){
-                    Vector3D bottomVertex(static_cast<float>(i), inHeightMap[(i) * inHeightMap.getSize() + j - 1], static_cast<float>(j - 1));
-                    Vector3D bottomLeftVertex(static_cast<float>(i - 1), inHeightMap[(i - 1) * inHeightMap.getSize() + j - 1], static_cast<float>(j - 1));
-                    
-                    //2 trangles
-                    normal += calcNormalForTriangle(bottomLeftVertex, bottomVertex, thisVertex);
-                    normal += calcNormalForTriangle(bottomLeftVertex, thisVertex, leftVertex);
-                }
-
-                //on the top
-                if(j != (inHeightMap.getSize() - 1)){
-                    Vector3D topVertex(static_cast<float>(i), inHeightMap[(i) * inHeightMap.getSize() + j + 1], static_cast<float>(j + 1));
-                    
-                    //1 trangle
-                    normal += calcNormalForTriangle(leftVertex, thisVertex, topVertex);
-                }
-            }
-
-            //get normal component  on the right
-            if(i != (inHeightMap.getSize() - 1)){
-                Vector3D rightVertex(static_cast<float>(i + 1), inHeightMap[(i + 1) * inHeightMap.getSize() + j], static_cast<float>(j));
-
-                //on the bottom (second index j + 1)
-                if(j != 0){
-                    Vector3D bottomVertex(static_cast<float>(i), inHeightMap[(i) * inHeightMap.getSize() + j - 1], static_cast<float>(j - 1));
-                    
-                    //1 trangle
-                    normal += calcNormalForTriangle(bottomVertex, rightVertex, thisVertex);
-                }
-
-                //on the top
-                if(j != (inHeightMap.getSize() - 1)){
-                    Vector3D topVertex(static_cast<float>(i), inHeightMap[(i) * inHeightMap.getSize() + j + 1], static_cast<float>(j + 1));
-                    Vector3D topRightVertex(static_cast<float>(i + 1), inHeightMap[(i + 1) * inHeightMap.getSize() + j + 1], static_cast<float>(j + 1));
-
-                    //2 trangles
-                    normal += calcNormalForTriangle(rightVertex, topRightVertex, thisVertex);
-                    normal += calcNormalForTriangle(topVertex, thisVertex, topRightVertex);
-                }
-            }
-
-            normal.normalize();
-
-            newVertex.normalX = normal.x();
-            newVertex.normalZ = normal.z();
+            newVertex.normalX = normals[j];
+            newVertex.normalZ = normals[2 * size + j];
 
             //insert new vertex into vertex container
-            vertices[i * inHeightMap.getSize() + j] = newVertex;
+            vertices[i * size + j] = newVertex;
             
             //for skirts we generate vertices twice
             if(inGenSkirts){
                 newVertex.y -= 5.0f; //TODO
 
-                vertices[(inHeightMap.getSize() * inHeightMap.getSize()) + (i * inHeightMap.getSize() + j)] = newVertex;
+                vertices[(size * size) + (i * size + j)] = newVertex;
             }
         }
-    }
-
 
+        //shift lines
+        float* oldest = lines[0];
+        lines[0] = lines[1];
+        lines[1] = lines[2];
+        lines[2] = oldest;
+        if(i + 2 < size) inHeightMap.getHeights((i + 2) * size, size, lines[2]);
+    }
 
     return vertices;
 }
@@ -451,20 +410,29 @@ static void copyQuadTreeLevels(const QTree& source, QTree& dest, unsigned int nu
 TerrainFragmentPtr TerrainPreprocessor::process(const HeightMap& inHeightMap){
     assert(mImpl);   
 
+    Timings& timings = mImpl->timings;
+    Timer timer;
+    Timer totalTimer;
+    totalTimer.start();
+    timer.start();
+
     //first time create
     if(!mImpl->optimizer){
-        mImpl->optimizer = TerrainOptimizerPtr(new TerrainOptimizer(inHeightMap));
+        mImpl->optimizer = TerrainOptimizerPtr(new TerrainOptimizer(inHeightMap, mImpl->properties.optimizerThreadNum));
     }
     else{
         mImpl->optimizer->rebuild(inHeightMap);
     }
+    timings.optimization = timer.getMicroseconds();
 
     //now we should build levels of details
     TerrainFragmentPtr result(new TerrainFragment());
 
     QTreePtr tree = QTreePtr(new QTree(mImpl->properties.numOfLODs));
 
+    timer.start();
     TerrainFragment::VertexCont allVertices = generateVertices(inHeightMap, mImpl->properties.generateSkirts);
+    timings.vertices = timer.getMicroseconds();
 
     TriangulationBuilder triangBuilder;
     triangBuilder.optimizer = mImpl->optimizer;
@@ -481,7 +449,9 @@ TerrainFragmentPtr TerrainPreprocessor::process(const HeightMap& inHeightMap){
     for(size_t i = 0; i < mImpl->properties.numOfLODs; ++i){
         triangBuilder.levelIsNotPresent = false;
 
+        timer.start();
         triangBuilder.optimizer->generateLOD(error);
+        timings.optimization += timer.getMicroseconds();
         applyToLevel(*tree, currentLOD, triangBuilder);
 
         //we should add skirts (if we need them)
@@ -528,67 +498,32 @@ TerrainFragmentPtr TerrainPreprocessor::process(const HeightMap& inHeightMap){
     //of vertex array but after the last used vertex of previous LOD.
 
     //map of transformation
+    //vertices which are not used yet have value of allVertices.size()
     std::vector<unsigned int> mapOfTransformation;
-    mapOfTransformation.resize(allVertices.size(), allVertices.size() + 1);
+    mapOfTransformation.resize(allVertices.size(), allVertices.size());
 
     //functor to apply transformations
     IndexTransformer transform(mapOfTransformation);
 
-    //functor to mark vertices wich are used in specified level
-    //and build bitmap
-    VertexMarker vertMarker;
-    vertMarker.bitmap.resize(allVertices.size(), false);
-    vertMarker.number = 0;
-
     std::vector<unsigned int> numbersOfUsedVertices;
     numbersOfUsedVertices.reserve(numOfLODs);
 
-    //build transformation map for first level
-
-    //first build bitmap of usage
-    applyToLevel(*tree, 0, vertMarker);
-    numbersOfUsedVertices.push_back(vertMarker.number);
-    //build map
-    for(size_t i = 0, usedVerticesIndex = 0, otherVerticesIndex = vertMarker.number; i < mapOfTransformation.size(); ++i){
-        assert(usedVerticesIndex <= numbersOfUsedVertices.back());
-        assert(otherVerticesIndex <= allVertices.size());
-
-        if(vertMarker.bitmap[i]) mapOfTransformation[i] = usedVerticesIndex++;
-        else mapOfTransformation[i] = otherVerticesIndex++;
-    }
-
     //build transformation map and other needed data
-    for(size_t lodLevel = 1; lodLevel < numOfLODs; ++lodLevel){
-        
-        for(size_t i = 0; i < vertMarker.bitmap.size(); ++i)
-            vertMarker.bitmap[i] = false;
-        vertMarker.number = 0;
-        //build bitmap of usage for transformed indices
-        applyToLevel(*tree, lodLevel, vertMarker);
+    //only indices of level are traversed, so the cost of level doesn't depend on size of fragment
+    for(size_t lodLevel = 0; lodLevel < numOfLODs; ++lodLevel){
+        //collect vertices which are not used by previous levels
+        NewVertexCollector collector(mapOfTransformation, allVertices.size());
+        applyToLevel(*tree, lodLevel, collector);
 
-        if(vertMarker.number == 0) continue;
-        
-        unsigned int previousVerticesNum = numbersOfUsedVertices.back();
-        unsigned int newVerticesNum = 0;
-        for(size_t i = 0; i < vertMarker.bitmap.size(); ++i){
-            if(vertMarker.bitmap[i] && mapOfTransformation[i] >= previousVerticesNum){
-                ++newVerticesNum;
-            }
-        }
-        if(newVerticesNum == 0) continue;
-        numbersOfUsedVertices.push_back(newVerticesNum + previousVerticesNum);
+        if(collector.vertices.empty() && lodLevel != 0) continue;
 
-        //build a map of transformation using bitmap
-        for(size_t i = 0, usedVerticesIndex = previousVerticesNum, otherVerticesIndex = numbersOfUsedVertices.back(); i < mapOfTransformation.size(); ++i){
-            assert(usedVerticesIndex <= numbersOfUsedVertices.back());
-            assert(otherVerticesIndex <= mapOfTransformation.size());
-            
-            //we don't touch any old data
-            if(mapOfTransformation[i] >= previousVerticesNum){
-                if(vertMarker.bitmap[i]) mapOfTransformation[i] = usedVerticesIndex++;
-                else mapOfTransformation[i] = otherVerticesIndex++;
-            }
+        //new vertices are placed after the previous ones in order of their original positions
+        std::sort(collector.vertices.begin(), collector.vertices.end());
+        unsigned int previousVerticesNum = numbersOfUsedVertices.empty()? 0: numbersOfUsedVertices.back();
+        for(size_t i = 0; i < collector.vertices.size(); ++i){
+            mapOfTransformation[collector.vertices[i]] = previousVerticesNum + i;
         }
+        numbersOfUsedVertices.push_back(previousVerticesNum + collector.vertices.size());
     }
 
     //now we should transform all the indices
@@ -688,6 +623,9 @@ TerrainFragmentPtr TerrainPreprocessor::process(const HeightMap& inHeightMap){
 
     for(unsigned int i = 0; i < numOfLODs; ++i)
         applyToLevel(*result->tree, i, aabbCalc);
+
+    //the rest of time was spent on chunks
+    timings.chunks = totalTimer.getMicroseconds() - timings.vertices - timings.optimization;
     
     return result; 
 }
@@ -698,6 +636,12 @@ TerrainPreprocessor::Properties TerrainPreprocessor::getProperties() const{
     return mImpl->properties;
 }
 
+const TerrainPreprocessor::Timings& TerrainPreprocessor::getTimings() const{
+    assert(mImpl);
+
+    return mImpl->timings;
+}
+
 /*
  *   Copyright 2010-2011 Alexander Medvedev
  *
@@ -0,0 +1,258 @@
+//AnimationBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Measures poses per second of AnimationPlayer for synthetic animations
+//and checks basic properties of sampling and blending.
+//Usage: AnimationBenchmark [number of bones]
+
+#include "data/AnimationPlayer.hpp"
+#include "data/Animation.hpp"
+#include "data/Pose.hpp"
+#include "data/Skeleton.hpp"
+#include "math/Quat.hpp"
+#include "math/Vector3D.hpp"
+#include "common/Timer.hpp"
+#include "common/ParallelFor.hpp"
+
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+using namespace hydra::data;
+using hydra::math::Quat;
+using hydra::math::Vector3D;
+using hydra::common::Timer;
+
+//returns random float in [-1, 1]
+static float getRandom(){
+    return static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f;
+}
+
+//builds animation where each bone swings around random axis
+static AnimationPtr createAnimation(size_t inBoneNum, size_t inFrameNum, const std::string& inName){
+    AnimationPtr result(new Animation());
+    result->mName = inName;
+    result->mFramerate = 30.0f;
+    result->mFrames.resize(inFrameNum);
+
+    std::vector<Vector3D> axes(inBoneNum);
+    std::vector<float> amplitudes(inBoneNum);
+    for(size_t i = 0; i < inBoneNum; ++i){
+        axes[i] = Vector3D(getRandom(), getRandom(), getRandom() + 2.0f).getUnit();
+        amplitudes[i] = getRandom() * 1.5f;
+    }
+    for(size_t f = 0; f < inFrameNum; ++f){
+        const float phase = 2.0f * 3.14159265f * f / inFrameNum;
+        result->mFrames[f].mBones.resize(inBoneNum);
+        for(size_t i = 0; i < inBoneNum; ++i){
+            Bone& bone = result->mFrames[f].mBones[i];
+            bone.mOrient = Quat(amplitudes[i] * sinf(phase + i), axes[i]);
+            bone.mPos = Vector3D(sinf(phase), cosf(phase), 0.0f) * 0.1f;
+        }
+    }
+    return result;
+}
+
+//interpolation of AnimationViewer (component-wise lerp of quaternions)
+static void sampleViewer(const Animation& inAnimation, float inTime, Skeleton& outSkeleton){
+    float frame = fmodf(inTime * inAnimation.mFramerate, static_cast<float>(inAnimation.getFrameNum()));
+    const size_t first = static_cast<size_t>(frame);
+    const size_t second = (first + 1 < inAnimation.getFrameNum())? first + 1: 0;
+    const float ratio = frame - first;
+    const Skeleton& currentFrame = inAnimation.mFrames[first];
+    const Skeleton& nextFrame = inAnimation.mFrames[second];
+    outSkeleton.mBones.resize(currentFrame.mBones.size());
+    for(size_t i = 0; i < currentFrame.mBones.size(); ++i){
+        outSkeleton.mBones[i].mPos = currentFrame.mBones[i].mPos + (nextFrame.mBones[i].mPos - currentFrame.mBones[i].mPos) * ratio;
+        outSkeleton.mBones[i].mOrient.setVec(currentFrame.mBones[i].mOrient.getVec() * (1.0f - ratio) + nextFrame.mBones[i].mOrient.getVec() * ratio);
+        outSkeleton.mBones[i].mOrient.setScalar(currentFrame.mBones[i].mOrient.getScalar() * (1.0f - ratio) + nextFrame.mBones[i].mOrient.getScalar() * ratio);
+        outSkeleton.mBones[i].mOrient.normalize();
+    }
+}
+
+//returns maximal difference of poses (positions and orientations, sign of quaternions is ignored)
+static float getDifference(const Pose& inPose1, const Pose& inPose2){
+    float result = 0.0f;
+    for(size_t i = 0; i < std::min(inPose1.getBoneNum(), inPose2.getBoneNum()); ++i){
+        const Quat& q1 = inPose1.mOrients[i];
+        const Quat& q2 = inPose2.mOrients[i];
+        const float dot = fabsf(q1.getVec() * q2.getVec() + q1.getScalar() * q2.getScalar());
+        result = std::max(result, 1.0f - std::min(dot, 1.0f));
+        result = std::max(result, (inPose1.mPositions[i] - inPose2.mPositions[i]).getMagnitude());
+    }
+    return result;
+}
+
+//prints number of poses per second
+static void report(const char* inName, size_t inPoseNum, hydra::common::Timer& inTimer){
+    const double seconds = inTimer.getMicroseconds() / 1e6;
+    std::cout << std::setw(36) << inName << ": " << std::setw(10) << std::setprecision(4)
+        << (seconds > 0.0? inPoseNum / seconds / 1e3: 0.0) << " K poses/s" << std::endl;
+}
+
+int main(int argc, char** argv){
+    const size_t boneNum = (argc > 1)? std::max(1, atoi(argv[1])): 64;
+    const size_t frameNum = 60;
+    const size_t iterations = 20000;
+    srand(1);
+
+    std::vector<AnimationPtr> anims;
+    anims.push_back(createAnimation(boneNum, frameNum, "walk"));
+    anims.push_back(createAnimation(boneNum, frameNum, "run"));
+    anims.push_back(createAnimation(boneNum, frameNum, "idle"));
+    anims.push_back(createAnimation(boneNum, frameNum, "strafe"));
+    anims.push_back(createAnimation(boneNum, frameNum / 2, "wave"));
+    std::cout << "=== " << boneNum << " bones, " << frameNum << " frames" << std::endl;
+
+    int result = 0;
+    Timer timer;
+    Pose pose;
+    Skeleton skeleton;
+    float sink = 0.0f;
+
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        sampleViewer(*anims[0], i * 0.0123f, skeleton);
+        sink += skeleton.mBones[0].mPos.x();
+    }
+    report("viewer lerp (Skeleton)", iterations, timer);
+
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        AnimationPlayer::sample(*anims[0], i * 0.0123f, true, AnimationPlayer::NLERP, pose);
+        sink += pose.mPositions[0].x();
+    }
+    report("sample, nlerp", iterations, timer);
+
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        AnimationPlayer::sample(*anims[0], i * 0.0123f, true, AnimationPlayer::SLERP, pose);
+        sink += pose.mPositions[0].x();
+    }
+    report("sample, slerp", iterations, timer);
+
+    //cross-fade of two animations
+    AnimationPlayer fading(boneNum);
+    fading.addLayer(anims[0]);
+    fading.crossFade(anims[1], 1e6f);
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        fading.update(0.0123f);
+        fading.evaluate(pose);
+        sink += pose.mPositions[0].x();
+    }
+    report("player, cross-fade of 2 clips", iterations, timer);
+
+    //4 clips blended, additive upper body
+    std::vector<float> upperBody(boneNum, 0.0f);
+    std::fill(upperBody.begin() + boneNum / 2, upperBody.end(), 1.0f);
+    AnimationPlayer layered(boneNum);
+    for(size_t i = 0; i < 4; ++i) layered.addLayer(anims[i], 0.25f + 0.1f * i);
+    layered.getLayer(layered.addAdditiveLayer(anims[4], 0.7f)).mBoneMask = upperBody;
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        layered.update(0.0123f);
+        layered.evaluate(pose);
+        sink += pose.mPositions[0].x();
+    }
+    report("player, 4 clips + additive layer", iterations, timer);
+
+    //crowd of players
+    const size_t playerNum = 1000;
+    const size_t frames = 20;
+    std::vector<AnimationPlayer> players(playerNum, AnimationPlayer(boneNum));
+    std::vector<AnimationPlayer*> playerPtrs;
+    for(size_t i = 0; i < playerNum; ++i){
+        players[i].addLayer(anims[i % 4]);
+        players[i].crossFade(anims[(i + 1) % 4], 0.5f);
+        players[i].getLayer(0).mTime = i * 0.01f;
+        playerPtrs.push_back(&players[i]);
+    }
+    std::vector<Pose> poses(playerNum);
+    timer.start();
+    for(size_t f = 0; f < frames; ++f) AnimationPlayer::updateAndEvaluate(&playerPtrs[0], playerNum, 0.0123f, &poses[0], 1);
+    report("batch of 1000 players, 1 thread", playerNum * frames, timer);
+
+    const unsigned int threadNum = hydra::common::getHardwareThreadNum();
+    timer.start();
+    for(size_t f = 0; f < frames; ++f) AnimationPlayer::updateAndEvaluate(&playerPtrs[0], playerNum, 0.0123f, &poses[0]);
+    std::cout << std::setw(36) << "batch of 1000 players, threads" << ": " << threadNum << std::endl;
+    report("batch of 1000 players, all threads", playerNum * frames, timer);
+
+    //checks
+    Pose framePose, sampled, other;
+    framePose.fromSkeleton(anims[0]->mFrames[7]);
+    AnimationPlayer::sample(*anims[0], 7.0f / anims[0]->mFramerate, true, AnimationPlayer::SLERP, sampled);
+    const float frameError = getDifference(framePose, sampled);
+
+    float nlerpError = 0.0f;
+    for(size_t i = 0; i < 100; ++i){
+        AnimationPlayer::sample(*anims[0], i * 0.0123f, true, AnimationPlayer::NLERP, sampled);
+        AnimationPlayer::sample(*anims[0], i * 0.0123f, true, AnimationPlayer::SLERP, other);
+        nlerpError = std::max(nlerpError, getDifference(sampled, other));
+    }
+
+    AnimationPlayer::sample(*anims[1], 0.3f, true, AnimationPlayer::NLERP, other);
+    const Pose* blended[2] = {&framePose, &other};
+    const float weights[2] = {1.0f, 0.0f};
+    AnimationPlayer::blend(blended, weights, 2, sampled);
+    const float blendError = getDifference(framePose, sampled);
+
+    sampled = other;
+    AnimationPlayer::addAdditive(framePose, framePose, 1.0f, 0, sampled);
+    const float additiveError = getDifference(other, sampled);
+
+    AnimationPlayer switching(boneNum);
+    switching.addLayer(anims[2]);
+    switching.crossFade(anims[3], 0.25f);
+    for(size_t i = 0; i < 30; ++i) switching.update(0.01f);
+    switching.evaluate(sampled);
+    AnimationPlayer::sample(*anims[3], 0.3f, true, AnimationPlayer::NLERP, other);
+    const float fadeError = getDifference(other, sampled);
+
+    std::cout << "errors: frame " << frameError << ", nlerp vs slerp " << nlerpError << ", blend " << blendError
+        << ", additive " << additiveError << ", cross-fade " << fadeError << " (" << switching.getLayerNum() << " layers left)" << std::endl;
+    if(frameError > 1e-5f || blendError > 1e-5f || additiveError > 1e-4f || fadeError > 1e-4f || switching.getLayerNum() != 1) result = 1;
+
+    return (sink == 12345.0f)? 2: result;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,165 @@
+//BenchmarkUtils.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef BENCHMARK_UTILS_HPP__
+#define BENCHMARK_UTILS_HPP__
+
+//Small helpers shared by benchmark applications.
+//Benchmarks load models specified in command line. If nothing is specified
+//they use generated meshes, so they can be run without any data.
+
+#include "loading/LoadingMain.hpp"
+#include "data/Model.hpp"
+#include "data/Mesh.hpp"
+#include "data/Vertex.hpp"
+#include "common/Timer.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+namespace benchmark{
+
+///model with the name to print in reports
+struct NamedModel{
+    std::string name;
+    hydra::data::ModelPtr model;
+};
+
+///\brief Builds UV-sphere triangle list.
+///
+///Seam vertices are duplicated (as loaders do for texture seams).
+inline hydra::data::MeshPtr createSphereMesh(unsigned int inRings, unsigned int inSegments, float inRadius = 1.0f){
+    using hydra::data::Mesh;
+    using hydra::data::Vertex;
+
+    hydra::data::MeshPtr mesh(new Mesh());
+    mesh->mMode = Mesh::TRIANGLES;
+    mesh->mVertices.reserve((inRings + 1) * (inSegments + 1));
+    mesh->mIndices.reserve(inRings * inSegments * 6);
+
+    const float pi = 3.14159265358979f;
+    for(unsigned int i = 0; i <= inRings; ++i){
+        float theta = pi * i / inRings;
+        for(unsigned int j = 0; j <= inSegments; ++j){
+            float phi = 2.0f * pi * j / inSegments;
+            Vertex vert;
+            vert.mNormal = hydra::math::Vector3D(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+            vert.mCoord = hydra::math::Point(vert.mNormal.x() * inRadius, vert.mNormal.y() * inRadius, vert.mNormal.z() * inRadius);
+            vert.mTexCoord = hydra::math::Point(static_cast<float>(j) / inSegments, static_cast<float>(i) / inRings, 0.0f);
+            mesh->mVertices.push_back(vert);
+        }
+    }
+
+    for(unsigned int i = 0; i < inRings; ++i){
+        for(unsigned int j = 0; j < inSegments; ++j){
+            Mesh::index_t first = i * (inSegments + 1) + j;
+            Mesh::index_t second = first + inSegments + 1;
+            mesh->mIndices.push_back(first);
+            mesh->mIndices.push_back(first + 1);
+            mesh->mIndices.push_back(second);
+
+            mesh->mIndices.push_back(second);
+            mesh->mIndices.push_back(first + 1);
+            mesh->mIndices.push_back(second + 1);
+        }
+    }
+    return mesh;
+}
+
+///\brief Loads models specified in command line.
+///
+///If there are no arguments, sphere model with specified number of rings is generated.
+inline std::vector<NamedModel> loadModels(int argc, char** argv, unsigned int inDefaultRings = 256){
+    std::vector<NamedModel> models;
+
+    hydra::loading::initFactories();
+    for(int i = 1; i < argc; ++i){
+        NamedModel next;
+        next.name = argv[i];
+        try{
+            next.model = hydra::loading::loadFromFile<hydra::data::Model>(argv[i]);
+        }
+        catch(const std::runtime_error& err){
+            std::cerr << "can't load " << argv[i] << ": " << err.what() << std::endl;
+            continue;
+        }
+        models.push_back(next);
+    }
+    hydra::loading::dropFactories();
+
+    if(models.empty()){
+        NamedModel sphere;
+        sphere.name = "generated sphere";
+        sphere.model = hydra::data::ModelPtr(new hydra::data::Model(sphere.name));
+        sphere.model->mMeshes.push_back(createSphereMesh(inDefaultRings, inDefaultRings * 2));
+        models.push_back(sphere);
+    }
+    return models;
+}
+
+///returns total number of vertices in model
+inline size_t getVertexNum(const hydra::data::Model& inModel){
+    size_t result = 0;
+    for(size_t i = 0; i < inModel.mMeshes.size(); ++i) result += inModel.mMeshes[i]->getVertexNum();
+    return result;
+}
+
+///returns total number of indices in model
+inline size_t getIndexNum(const hydra::data::Model& inModel){
+    size_t result = 0;
+    for(size_t i = 0; i < inModel.mMeshes.size(); ++i) result += inModel.mMeshes[i]->getIndexNum();
+    return result;
+}
+
+///returns time (in seconds) spent in inRepeats calls of functor, divided by inRepeats
+template <typename F>
+inline double measure(F inFunctor, unsigned int inRepeats = 1){
+    hydra::common::Timer timer;
+    timer.start();
+    for(unsigned int i = 0; i < inRepeats; ++i) inFunctor();
+    return static_cast<double>(timer.getMicroseconds()) / 1000000.0 / inRepeats;
+}
+
+} //benchmark namespace
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
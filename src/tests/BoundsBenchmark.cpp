@@ -0,0 +1,208 @@
+//BoundsBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Compares time of bounds recalculation with access to cached bounds.
+//For skinned models checks that bounds calculated from per-bone boxes
+//contain all the vertices skinned with random poses.
+//Usage: BoundsBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/Mesh.hpp"
+#include "data/Model.hpp"
+#include "data/Skeleton.hpp"
+#include "math/AABB.hpp"
+#include "math/BoundingSphere.hpp"
+#include "math/Quat.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+
+using namespace hydra::data;
+using hydra::math::AABB;
+using hydra::math::BoundingSphere;
+using hydra::math::Quat;
+using hydra::math::Vector3D;
+
+//returns random float in [-1, 1]
+static float getRandom(){
+    return static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f;
+}
+
+//builds pose with random rotations and small offsets of bones (relative to bind pose)
+static void buildRandomPose(size_t inBoneNum, float inOffset, Skeleton& outPose){
+    outPose.mBones.resize(inBoneNum);
+    for(size_t i = 0; i < inBoneNum; ++i){
+        Vector3D axis(getRandom(), getRandom(), getRandom());
+        if(axis.getSquareMagnitude() < 1e-6f) axis = Vector3D(0.0f, 1.0f, 0.0f);
+        outPose.mBones[i].mOrient = Quat(getRandom() * 3.14159265f, axis.getUnit());
+        outPose.mBones[i].mPos = Vector3D(getRandom(), getRandom(), getRandom()) * inOffset;
+    }
+}
+
+//skins single vertex as AnimationViewer does
+static Vector3D skinVertex(const Mesh& inMesh, size_t inVertex, const Skeleton& inPose){
+    Vector3D result;
+    for(int j = 0; j < Mesh::MAX_BONES_PER_VERTEX; ++j){
+        const float weight = inMesh.mBoneWeights[inVertex][j];
+        if(!(weight > 0.0f)) continue;
+        const Bone& bone = inPose.mBones[inMesh.mBones[inVertex][j]];
+        Vector3D coord(inMesh.mVertices[inVertex].mCoord);
+        bone.mOrient.rotate(coord);
+        result += (bone.mPos + coord) * weight;
+    }
+    return result;
+}
+
+//bounds of model skinned with pose (brute force)
+static AABB calcSkinnedAABB(const Model& inModel, const Skeleton& inPose){
+    Vector3D minCorner(1e30f, 1e30f, 1e30f), maxCorner(-1e30f, -1e30f, -1e30f);
+    BOOST_FOREACH(const MeshPtr& nextMesh, inModel.mMeshes){
+        for(size_t i = 0; i < nextMesh->getVertexNum(); ++i){
+            const Vector3D coord = skinVertex(*nextMesh, i, inPose);
+            minCorner = Vector3D(std::min(minCorner.x(), coord.x()), std::min(minCorner.y(), coord.y()), std::min(minCorner.z(), coord.z()));
+            maxCorner = Vector3D(std::max(maxCorner.x(), coord.x()), std::max(maxCorner.y(), coord.y()), std::max(maxCorner.z(), coord.z()));
+        }
+    }
+    return AABB(minCorner, maxCorner - minCorner);
+}
+
+static float gSink = 0.0f;
+
+static void recalcMeshAABBs(const Model& inModel){
+    BOOST_FOREACH(const MeshPtr& nextMesh, inModel.mMeshes) gSink += nextMesh->calcAABB().getVector().x();
+}
+
+static void getMeshAABBs(const Model& inModel){
+    BOOST_FOREACH(const MeshPtr& nextMesh, inModel.mMeshes){
+        gSink += nextMesh->getAABB().getVector().x() + nextMesh->getBoundingSphere().getRadius();
+    }
+}
+
+static void getModelBounds(const Model& inModel){
+    gSink += inModel.getAABB().getVector().x() + inModel.getBoundingSphere().getRadius();
+}
+
+static void calcPose(const Model& inModel, const Skeleton& inPose){
+    gSink += inModel.calcPoseAABB(inPose).getVector().x();
+}
+
+static void calcSkinned(const Model& inModel, const Skeleton& inPose){
+    gSink += calcSkinnedAABB(inModel, inPose).getVector().x();
+}
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv);
+    int result = 0;
+
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        const Model& model = *nextModel.model;
+        std::cout << "=== " << nextModel.name << ": " << model.mMeshes.size() << " meshes, "
+            << benchmark::getIndexNum(model) / 3 << " triangles" << std::endl;
+
+        //generated models are not processed by loaders
+        model.updateBounds();
+
+        const double recalcTime = benchmark::measure(boost::bind(recalcMeshAABBs, boost::cref(model)), 20);
+        const double cachedTime = benchmark::measure(boost::bind(getMeshAABBs, boost::cref(model)), 100000);
+        const double modelTime = benchmark::measure(boost::bind(getModelBounds, boost::cref(model)), 100000);
+        const double updateTime = benchmark::measure(boost::bind(&Model::updateBounds, &model), 20);
+
+        std::cout << std::setprecision(4)
+            << "  calcAABB for all meshes:  " << std::setw(10) << recalcTime * 1e6 << " us" << std::endl
+            << "  cached mesh bounds:       " << std::setw(10) << cachedTime * 1e6 << " us" << std::endl
+            << "  cached model bounds:      " << std::setw(10) << modelTime * 1e6 << " us" << std::endl
+            << "  updateBounds (bake):      " << std::setw(10) << updateTime * 1e6 << " us" << std::endl;
+
+        //model's sphere must contain all the vertices
+        size_t outside = 0;
+        const BoundingSphere& sphere = model.getBoundingSphere();
+        const float tolerance = sphere.getRadius() * 1e-4f;
+        BOOST_FOREACH(const MeshPtr& nextMesh, model.mMeshes){
+            for(size_t i = 0; i < nextMesh->getIndexNum(); ++i){
+                const Vector3D coord(nextMesh->mVertices[nextMesh->mIndices[i]].mCoord);
+                if((coord - sphere.getCenter()).getMagnitude() > sphere.getRadius() + tolerance) ++outside;
+            }
+        }
+        std::cout << "  vertices outside sphere:  " << outside << std::endl;
+        if(outside) result = 1;
+
+        if(!model.mBindSkel) continue;
+
+        //random poses, offsets are proportional to the size of model
+        const size_t boneNum = model.mBindSkel->mBones.size();
+        const float offset = model.getAABB().getVector().getMagnitude() * 0.1f;
+        const unsigned int poseNum = 20;
+        double poseTime = 0.0;
+        double skinTime = 0.0;
+        double volumeRatio = 0.0;
+        size_t failed = 0;
+        srand(1);
+        for(unsigned int p = 0; p < poseNum; ++p){
+            Skeleton pose;
+            buildRandomPose(boneNum, offset, pose);
+            poseTime += benchmark::measure(boost::bind(calcPose, boost::cref(model), boost::cref(pose)), 100);
+            skinTime += benchmark::measure(boost::bind(calcSkinned, boost::cref(model), boost::cref(pose)), 5);
+
+            const AABB poseBox = model.calcPoseAABB(pose);
+            const AABB exactBox = calcSkinnedAABB(model, pose);
+            const Vector3D eps = poseBox.getVector() * 1e-4f;
+            const Vector3D poseMin = poseBox.getCorner() - eps;
+            const Vector3D poseMax = poseBox.getCorner() + poseBox.getVector() + eps;
+            const Vector3D exactMin = exactBox.getCorner();
+            const Vector3D exactMax = exactBox.getCorner() + exactBox.getVector();
+            if(exactMin.x() < poseMin.x() || exactMin.y() < poseMin.y() || exactMin.z() < poseMin.z() ||
+               exactMax.x() > poseMax.x() || exactMax.y() > poseMax.y() || exactMax.z() > poseMax.z()) ++failed;
+
+            const Vector3D poseSize = poseBox.getVector();
+            const Vector3D exactSize = exactBox.getVector();
+            volumeRatio += (poseSize.x() * poseSize.y() * poseSize.z()) / (exactSize.x() * exactSize.y() * exactSize.z());
+        }
+        std::cout << "  " << boneNum << " bones, " << poseNum << " random poses" << std::endl
+            << "  pose bounds (per-bone):   " << std::setw(10) << poseTime / poseNum * 1e6 << " us" << std::endl
+            << "  skinned vertices bounds:  " << std::setw(10) << skinTime / poseNum * 1e6 << " us" << std::endl
+            << "  volume overestimation:    " << std::setw(10) << volumeRatio / poseNum << "x" << std::endl
+            << "  poses not contained:      " << failed << std::endl;
+        if(failed) result = 1;
+    }
+    return (gSink == 12345.0f)? 2: result;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
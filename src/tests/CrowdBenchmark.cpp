@@ -0,0 +1,537 @@
+//CrowdBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Simulates crowd of animated characters without rendering: each instance
+//has its own AnimationPlayer and clip time, every frame poses are sampled,
+//composed, converted to palettes and meshes are skinned. Reports time of
+//each stage and scaling with number of threads.
+//Animations are converted to local space, so composition of hierarchy is
+//done every frame (as it would be with blending of local poses).
+//Stages run on a pool of persistent threads which is signalled once per
+//stage, so thread creation is not timed.
+//Without model generated character (sphere with chain of bones) with
+//generated clips is used. Loaded model needs at least one loaded clip.
+//Usage: CrowdBenchmark [-n instances] [-f frames] [-t max threads] [model.md5mesh [animations.md5anim...]]
+
+#include "BenchmarkUtils.hpp"
+#include "data/AnimationPlayer.hpp"
+#include "data/PoseComposer.hpp"
+#include "data/MeshSkinner.hpp"
+#include "data/Animation.hpp"
+#include "data/Model.hpp"
+#include "data/Mesh.hpp"
+#include "data/Pose.hpp"
+#include "data/Skeleton.hpp"
+#include "data/Bone.hpp"
+#include "math/Quat.hpp"
+#include "math/Vector3D.hpp"
+#include "common/ParallelFor.hpp"
+#include "common/Timer.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+
+using namespace hydra::data;
+using hydra::math::Quat;
+using hydra::math::Vector3D;
+using hydra::common::Timer;
+
+//number of bones of generated character
+const int SYNTHETIC_BONE_NUM = 32;
+
+//returns random float in [0, 1]
+static float getRandom(){
+    return static_cast<float>(rand()) / RAND_MAX;
+}
+
+//sphere stretched along Y with chain of bones inside
+static ModelPtr createSyntheticModel(){
+    ModelPtr model(new Model("generated character"));
+    MeshPtr mesh = benchmark::createSphereMesh(64, 128);
+    const size_t vertexNum = mesh->getVertexNum();
+    mesh->mBones.resize(vertexNum);
+    mesh->mBoneWeights.resize(vertexNum);
+    for(size_t i = 0; i < vertexNum; ++i){
+        mesh->mVertices[i].mCoord.y *= 4.0f;
+        mesh->mBones[i].assign(0);
+        mesh->mBoneWeights[i].assign(0.0f);
+
+        //linear falloff from bones placed at even distances
+        const float position = (mesh->mVertices[i].mCoord.y + 4.0f) / 8.0f * (SYNTHETIC_BONE_NUM - 1);
+        const int first = std::max(0, std::min(SYNTHETIC_BONE_NUM - 4, static_cast<int>(position) - 1));
+        float sum = 0.0f;
+        for(int j = 0; j < 4; ++j){
+            const float weight = std::max(0.0f, 2.0f - fabsf(position - (first + j)));
+            mesh->mBones[i][j] = first + j;
+            mesh->mBoneWeights[i][j] = weight;
+            sum += weight;
+        }
+        for(int j = 0; j < 4; ++j) mesh->mBoneWeights[i][j] /= sum;
+    }
+    model->mMeshes.push_back(mesh);
+
+    model->mBindSkel = SkeletonPtr(new Skeleton());
+    model->mBindSkel->mBones.resize(SYNTHETIC_BONE_NUM);
+    for(int i = 0; i < SYNTHETIC_BONE_NUM; ++i){
+        Bone& bone = model->mBindSkel->mBones[i];
+        bone.mParent = i - 1;
+        bone.mPos = Vector3D(0.0f, -4.0f + 8.0f * i / (SYNTHETIC_BONE_NUM - 1), 0.0f);
+        bone.mOrient = Quat(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    return model;
+}
+
+//local space animation of chain of createSyntheticModel(): each bone swings a bit
+static AnimationPtr createSyntheticAnimation(const Skeleton& inBind, const std::string& inName){
+    AnimationPtr result(new Animation());
+    result->mName = inName;
+    result->mFramerate = 30.0f;
+    result->mFrames.resize(40);
+    const Vector3D axis = Vector3D(getRandom(), 0.2f, getRandom()).getUnit();
+    for(size_t f = 0; f < result->mFrames.size(); ++f){
+        const float phase = 2.0f * 3.14159265f * f / result->mFrames.size();
+        result->mFrames[f].mBones = inBind.mBones;
+        for(size_t i = 0; i < inBind.mBones.size(); ++i){
+            Bone& bone = result->mFrames[f].mBones[i];
+            bone.mOrient = Quat(0.15f * sinf(phase + 0.3f * i), axis);
+            if(i > 0) bone.mPos = inBind.mBones[i].mPos - inBind.mBones[i - 1].mPos;
+        }
+    }
+    return result;
+}
+
+//converts frames from model space to space of parents
+static void makeLocal(Animation& inoutAnimation){
+    BOOST_FOREACH(Skeleton& nextFrame, inoutAnimation.mFrames){
+        const Skeleton model = nextFrame;
+        for(size_t i = 0; i < model.mBones.size(); ++i){
+            const int parent = model.mBones[i].mParent;
+            if(parent < 0 || static_cast<size_t>(parent) >= model.mBones.size()) continue;
+            const Quat inverse = model.mBones[parent].mOrient.getInverse();
+            Vector3D pos = model.mBones[i].mPos - model.mBones[parent].mPos;
+            inverse.rotate(pos);
+            nextFrame.mBones[i].mPos = pos;
+            nextFrame.mBones[i].mOrient = inverse * model.mBones[i].mOrient;
+            nextFrame.mBones[i].mOrient.normalize();
+        }
+    }
+}
+
+//\brief Pool of persistent threads for data-parallel stages.
+//
+//run() splits range like hydra::common::parallelFor, wakes the workers and
+//handles the last subrange in calling thread. Workers sleep between runs.
+class WorkerPool{
+public:
+    explicit WorkerPool(unsigned int inThreadNum): mThreadNum(std::max(1u, inThreadNum)), mFunctor(NULL), mCall(NULL),
+        mBegin(0), mEnd(0), mGeneration(0), mPending(0), mStop(false){
+        for(unsigned int i = 0; i + 1 < mThreadNum; ++i){
+            Worker worker = {this, i};
+            mThreads.create_thread(worker);
+        }
+    }
+
+    ~WorkerPool(){
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            mStop = true;
+        }
+        mStart.notify_all();
+        mThreads.join_all();
+    }
+
+    //calls inFunctor(rangeBegin, rangeEnd) for subranges of [inBegin, inEnd) and waits for all of them
+    template <typename F>
+    void run(size_t inBegin, size_t inEnd, const F& inFunctor){
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            mFunctor = &inFunctor;
+            mCall = &call<F>;
+            mBegin = inBegin;
+            mEnd = inEnd;
+            mPending = mThreadNum - 1;
+            mError = boost::exception_ptr();
+            ++mGeneration;
+        }
+        mStart.notify_all();
+
+        boost::exception_ptr error;
+        try{
+            handle(mThreadNum - 1, inBegin, inEnd, &inFunctor, &call<F>);
+        }
+        catch(...){
+            error = boost::current_exception();
+        }
+
+        boost::mutex::scoped_lock lock(mMutex);
+        while(mPending > 0) mDone.wait(lock);
+        if(!error) error = mError;
+        if(error) boost::rethrow_exception(error);
+    }
+
+private:
+    typedef void (*CallFunc)(const void*, size_t, size_t);
+
+    //calls functor of type F
+    template <typename F>
+    static void call(const void* inFunctor, size_t inBegin, size_t inEnd){
+        (*static_cast<const F*>(inFunctor))(inBegin, inEnd);
+    }
+
+    //handles subrange with index inIndex
+    void handle(unsigned int inIndex, size_t inBegin, size_t inEnd, const void* inFunctor, CallFunc inCall) const{
+        const size_t count = inEnd - inBegin;
+        const size_t begin = inBegin + count * inIndex / mThreadNum;
+        const size_t end = inBegin + count * (inIndex + 1) / mThreadNum;
+        if(begin < end) inCall(inFunctor, begin, end);
+    }
+
+    //body of worker thread
+    struct Worker{
+        WorkerPool* pool;
+        unsigned int index;
+
+        void operator()() const{
+            size_t generation = 0;
+            for(;;){
+                const void* functor;
+                CallFunc callFunc;
+                size_t begin, end;
+                {
+                    boost::mutex::scoped_lock lock(pool->mMutex);
+                    while(!pool->mStop && pool->mGeneration == generation) pool->mStart.wait(lock);
+                    if(pool->mStop) return;
+                    generation = pool->mGeneration;
+                    functor = pool->mFunctor;
+                    callFunc = pool->mCall;
+                    begin = pool->mBegin;
+                    end = pool->mEnd;
+                }
+
+                boost::exception_ptr error;
+                try{
+                    pool->handle(index, begin, end, functor, callFunc);
+                }
+                catch(...){
+                    error = boost::current_exception();
+                }
+
+                boost::mutex::scoped_lock lock(pool->mMutex);
+                if(error && !pool->mError) pool->mError = error;
+                if(--pool->mPending == 0) pool->mDone.notify_one();
+            }
+        }
+    };
+
+    const unsigned int mThreadNum;
+    boost::thread_group mThreads;
+    boost::mutex mMutex;
+    //signalled when new range is ready or pool stops
+    boost::condition_variable mStart;
+    //signalled when the last worker finishes its subrange
+    boost::condition_variable mDone;
+
+    //current task (guarded by mMutex)
+    const void* mFunctor;
+    CallFunc mCall;
+    size_t mBegin;
+    size_t mEnd;
+    size_t mGeneration;
+    unsigned int mPending;
+    bool mStop;
+    //the first exception of workers
+    boost::exception_ptr mError;
+};
+
+//state of single character
+struct Instance{
+    //skinning matrices
+    MeshSkinner::Palette palette;
+    //skinned positions of meshes
+    std::vector<std::vector<float> > positions;
+    //skinned normals of meshes
+    std::vector<std::vector<float> > normals;
+};
+
+//data shared by stages
+struct Crowd{
+    AnimationPlayer* const* players;
+    float delta;
+    const PoseComposer* composer;
+    const std::vector<MeshSkinner>* skinners;
+    std::vector<Pose>* locals;
+    std::vector<Pose>* relatives;
+    std::vector<Instance>* instances;
+};
+
+//updates players and samples local poses
+struct SampleStage{
+    const Crowd* crowd;
+    void operator()(size_t inBegin, size_t inEnd) const{
+        for(size_t i = inBegin; i < inEnd; ++i){
+            crowd->players[i]->update(crowd->delta);
+            crowd->players[i]->evaluate((*crowd->locals)[i]);
+        }
+    }
+};
+
+//composes local poses to poses relative to bind pose
+struct ComposeStage{
+    const Crowd* crowd;
+    void operator()(size_t inBegin, size_t inEnd) const{
+        //composer has internal buffers, each thread needs a copy
+        PoseComposer composer(*crowd->composer);
+        for(size_t i = inBegin; i < inEnd; ++i) composer.composeRelative((*crowd->locals)[i], (*crowd->relatives)[i]);
+    }
+};
+
+//builds palettes from relative poses
+struct PaletteStage{
+    const Crowd* crowd;
+    void operator()(size_t inBegin, size_t inEnd) const{
+        for(size_t i = inBegin; i < inEnd; ++i) (*crowd->instances)[i].palette.build((*crowd->relatives)[i]);
+    }
+};
+
+//composes local poses directly to palettes
+struct ComposePaletteStage{
+    const Crowd* crowd;
+    void operator()(size_t inBegin, size_t inEnd) const{
+        PoseComposer composer(*crowd->composer);
+        for(size_t i = inBegin; i < inEnd; ++i) composer.composePalette((*crowd->locals)[i], (*crowd->instances)[i].palette);
+    }
+};
+
+//skins all the meshes of instances
+struct SkinStage{
+    const Crowd* crowd;
+    void operator()(size_t inBegin, size_t inEnd) const{
+        for(size_t i = inBegin; i < inEnd; ++i){
+            Instance& instance = (*crowd->instances)[i];
+            for(size_t j = 0; j < crowd->skinners->size(); ++j){
+                if(instance.positions[j].empty()) continue;
+                (*crowd->skinners)[j].skin(instance.palette, &instance.positions[j][0], &instance.normals[j][0], 3 * sizeof(float));
+            }
+        }
+    }
+};
+
+//time of stages for one number of threads
+struct StageTimes{
+    double sample;
+    double compose;
+    double palette;
+    double skin;
+    double fused;
+};
+
+int main(int argc, char** argv){
+    size_t instanceNum = 256;
+    size_t frameNum = 30;
+    unsigned int maxThreadNum = hydra::common::getHardwareThreadNum();
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; ++i){
+        if(!strcmp(argv[i], "-n") && i + 1 < argc) instanceNum = std::max(1, atoi(argv[++i]));
+        else if(!strcmp(argv[i], "-f") && i + 1 < argc) frameNum = std::max(1, atoi(argv[++i]));
+        else if(!strcmp(argv[i], "-t") && i + 1 < argc) maxThreadNum = std::max(1, atoi(argv[++i]));
+        else files.push_back(argv[i]);
+    }
+    srand(1);
+
+    //model and local space animations
+    ModelPtr model;
+    std::vector<AnimationPtr> anims;
+    hydra::loading::initFactories();
+    try{
+        if(!files.empty()) model = hydra::loading::loadFromFile<Model>(files[0]);
+        for(size_t i = 1; i < files.size(); ++i){
+            AnimationPtr anim = hydra::loading::loadFromFile<Animation>(files[i]);
+            if(!anim->getFrameNum()) continue;
+            if(anim->mName.empty()) anim->mName = files[i];
+            makeLocal(*anim);
+            anims.push_back(anim);
+        }
+    }
+    catch(const std::runtime_error& err){
+        std::cerr << "can't load: " << err.what() << std::endl;
+        hydra::loading::dropFactories();
+        return 1;
+    }
+    hydra::loading::dropFactories();
+    if(!model){
+        model = createSyntheticModel();
+        for(size_t i = 0; i < 4; ++i) anims.push_back(createSyntheticAnimation(*model->mBindSkel, "synthetic"));
+    }
+    if(anims.empty()){
+        std::cerr << "model needs at least one animation" << std::endl;
+        return 1;
+    }
+    if(!model->mBindSkel || model->mBindSkel->mBones.empty()){
+        std::cerr << "model has no skeleton" << std::endl;
+        return 1;
+    }
+    const Skeleton& bind = *model->mBindSkel;
+    const size_t boneNum = bind.mBones.size();
+    for(size_t i = 0; i < anims.size(); ++i){
+        if(anims[i]->mFrames[0].mBones.size() != boneNum){
+            std::cerr << "animation " << anims[i]->mName << " doesn't match skeleton" << std::endl;
+            return 1;
+        }
+    }
+
+    MeshSkinner::Properties props;
+    props.threadNum = 1;
+    std::vector<MeshSkinner> skinners(model->mMeshes.size(), MeshSkinner(props));
+    for(size_t i = 0; i < model->mMeshes.size(); ++i) skinners[i].setup(*model->mMeshes[i]);
+    PoseComposer composer;
+    composer.setup(bind);
+    const size_t vertexNum = benchmark::getVertexNum(*model);
+
+    std::cout << "=== " << (files.empty()? model->mName: files[0]) << ": " << vertexNum << " vertices, " << boneNum << " bones, "
+        << composer.getDepth() << " levels, " << anims.size() << " animations" << std::endl;
+    std::cout << "=== " << instanceNum << " instances, " << frameNum << " frames, "
+        << instanceNum * vertexNum / 1000 << "K vertices per frame" << std::endl;
+
+    //instances have random clips, start times and speeds
+    std::vector<size_t> clips(instanceNum);
+    std::vector<float> startTimes(instanceNum), speeds(instanceNum);
+    for(size_t i = 0; i < instanceNum; ++i){
+        clips[i] = rand() % anims.size();
+        startTimes[i] = getRandom() * anims[clips[i]]->getFrameNum() / anims[clips[i]]->mFramerate;
+        speeds[i] = 0.8f + 0.4f * getRandom();
+    }
+
+    std::vector<Instance> instances(instanceNum);
+    BOOST_FOREACH(Instance& nextInstance, instances){
+        nextInstance.positions.resize(skinners.size());
+        nextInstance.normals.resize(skinners.size());
+        for(size_t j = 0; j < skinners.size(); ++j){
+            nextInstance.positions[j].resize(skinners[j].getVertexNum() * 3);
+            nextInstance.normals[j].resize(skinners[j].getVertexNum() * 3);
+        }
+    }
+    std::vector<Pose> locals(instanceNum), relatives(instanceNum);
+    Crowd crowd = {NULL, 1.0f / 30.0f, &composer, &skinners, &locals, &relatives, &instances};
+    const SampleStage sampleStage = {&crowd};
+    const ComposeStage composeStage = {&crowd};
+    const PaletteStage paletteStage = {&crowd};
+    const ComposePaletteStage fusedStage = {&crowd};
+    const SkinStage skinStage = {&crowd};
+
+    std::vector<unsigned int> threadNums;
+    for(unsigned int threads = 1; threads < maxThreadNum; threads *= 2) threadNums.push_back(threads);
+    threadNums.push_back(maxThreadNum);
+
+    std::cout << std::setw(8) << "threads" << std::setw(10) << "sample" << std::setw(10) << "compose" << std::setw(10) << "palette"
+        << std::setw(10) << "skin" << std::setw(10) << "total" << std::setw(10) << "fused" << std::setw(12) << "inst/s"
+        << std::setw(10) << "speedup" << "   (ms per frame; fused is compose + palette in one pass)" << std::endl;
+
+    int result = 0;
+    double singleTotal = 0.0;
+    std::vector<double> checksums, expected;
+    BOOST_FOREACH(unsigned int threads, threadNums){
+        //players start from the same state for each number of threads
+        std::vector<AnimationPlayer> players(instanceNum, AnimationPlayer(boneNum));
+        std::vector<AnimationPlayer*> playerPtrs(instanceNum);
+        for(size_t i = 0; i < instanceNum; ++i){
+            players[i].addLayer(anims[clips[i]]);
+            players[i].getLayer(0).mTime = startTimes[i];
+            players[i].getLayer(0).mSpeed = speeds[i];
+            playerPtrs[i] = &players[i];
+        }
+        crowd.players = &playerPtrs[0];
+        WorkerPool pool(threads);
+
+        StageTimes times = {0.0, 0.0, 0.0, 0.0, 0.0};
+        Timer timer;
+        for(size_t f = 0; f < frameNum; ++f){
+            timer.start();
+            pool.run(0, instanceNum, sampleStage);
+            times.sample += timer.getMicroseconds();
+
+            timer.start();
+            pool.run(0, instanceNum, composeStage);
+            times.compose += timer.getMicroseconds();
+
+            timer.start();
+            pool.run(0, instanceNum, paletteStage);
+            times.palette += timer.getMicroseconds();
+
+            timer.start();
+            pool.run(0, instanceNum, fusedStage);
+            times.fused += timer.getMicroseconds();
+
+            timer.start();
+            pool.run(0, instanceNum, skinStage);
+            times.skin += timer.getMicroseconds();
+        }
+
+        const double scale = 1.0 / 1000.0 / frameNum;
+        const double total = (times.sample + times.compose + times.palette + times.skin) * scale;
+        if(threads == 1) singleTotal = total;
+        std::cout << std::fixed << std::setprecision(3) << std::setw(8) << threads
+            << std::setw(10) << times.sample * scale << std::setw(10) << times.compose * scale
+            << std::setw(10) << times.palette * scale << std::setw(10) << times.skin * scale
+            << std::setw(10) << total << std::setw(10) << times.fused * scale
+            << std::setw(12) << std::setprecision(0) << (total > 0.0? instanceNum / total * 1000.0: 0.0)
+            << std::setw(10) << std::setprecision(2) << (total > 0.0? singleTotal / total: 0.0) << std::endl;
+
+        //results must not depend on number of threads
+        checksums.assign(instanceNum, 0.0);
+        for(size_t i = 0; i < instanceNum; ++i){
+            for(size_t j = 0; j < skinners.size(); ++j){
+                for(size_t k = 0; k < instances[i].positions[j].size(); ++k) checksums[i] += instances[i].positions[j][k];
+            }
+        }
+        if(expected.empty()) expected = checksums;
+        else if(checksums != expected){
+            std::cout << "FAILED: results with " << threads << " threads differ from results with 1 thread" << std::endl;
+            result = 1;
+        }
+    }
+    return result;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
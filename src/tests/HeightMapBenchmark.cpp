@@ -0,0 +1,213 @@
+//HeightMapBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Compares reading of heights one by one (virtual HeightMap::get) with
+//bulk reading (HeightMap::getHeights) and per-triangle calculation of
+//normals with HeightMapNormals. Checks that results are identical and
+//that 16-bit heights with fractional range are decoded correctly.
+//Height maps are generated (float and 16-bit ones).
+//Usage: HeightMapBenchmark [size, default 4097]
+
+#include "TerrainBenchmarkUtils.hpp"
+#include "data/HeightMap.hpp"
+#include "data/HeightMapNormals.hpp"
+#include "math/Vector3D.hpp"
+#include "common/Timer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+#include <cstring>
+
+using hydra::data::HeightMap;
+using hydra::data::HeightMapGen;
+using hydra::data::HeightMapNormals;
+using hydra::math::Vector3D;
+using hydra::common::Timer;
+
+//normal of triangle (not normalized)
+static Vector3D calcTriangleNormal(const Vector3D& inVert1, const Vector3D& inVert2, const Vector3D& inVert3){
+    Vector3D vec1(inVert2.x() - inVert1.x(), inVert2.y() - inVert1.y(), inVert2.z() - inVert1.z());
+    Vector3D vec2(inVert3.x() - inVert1.x(), inVert3.y() - inVert1.y(), inVert3.z() - inVert1.z());
+    return vec1.cross(vec2);
+}
+
+//reference: normals are calculated per vertex with heights read one by one
+static void calcNormalsPerVertex(const HeightMap& inHeights, std::vector<Vector3D>& outNormals){
+    const unsigned int size = inHeights.getSize();
+    outNormals.resize(size * size);
+    for(unsigned int i = 0; i < size; ++i){
+        for(unsigned int j = 0; j < size; ++j){
+            Vector3D normal(0.0f, 0.0f, 0.0f);
+            Vector3D center(static_cast<float>(i), inHeights[i * size + j], static_cast<float>(j));
+            if(i != 0){
+                Vector3D left(static_cast<float>(i - 1), inHeights[(i - 1) * size + j], static_cast<float>(j));
+                if(j != 0){
+                    Vector3D bottom(static_cast<float>(i), inHeights[i * size + j - 1], static_cast<float>(j - 1));
+                    Vector3D bottomLeft(static_cast<float>(i - 1), inHeights[(i - 1) * size + j - 1], static_cast<float>(j - 1));
+                    normal += calcTriangleNormal(bottomLeft, bottom, center);
+                    normal += calcTriangleNormal(bottomLeft, center, left);
+                }
+                if(j != size - 1){
+                    Vector3D top(static_cast<float>(i), inHeights[i * size + j + 1], static_cast<float>(j + 1));
+                    normal += calcTriangleNormal(left, center, top);
+                }
+            }
+            if(i != size - 1){
+                Vector3D right(static_cast<float>(i + 1), inHeights[(i + 1) * size + j], static_cast<float>(j));
+                if(j != 0){
+                    Vector3D bottom(static_cast<float>(i), inHeights[i * size + j - 1], static_cast<float>(j - 1));
+                    normal += calcTriangleNormal(bottom, right, center);
+                }
+                if(j != size - 1){
+                    Vector3D top(static_cast<float>(i), inHeights[i * size + j + 1], static_cast<float>(j + 1));
+                    Vector3D topRight(static_cast<float>(i + 1), inHeights[(i + 1) * size + j + 1], static_cast<float>(j + 1));
+                    normal += calcTriangleNormal(right, topRight, center);
+                    normal += calcTriangleNormal(top, center, topRight);
+                }
+            }
+            normal.normalize();
+            outNormals[i * size + j] = normal;
+        }
+    }
+}
+
+//compares bits of floats
+static bool isSame(float inFirst, float inSecond){
+    return memcmp(&inFirst, &inSecond, sizeof(float)) == 0;
+}
+
+//checks decoding of integer heights with fractional range by get() and getHeights():
+//the lowest value of T must give min height and the highest one max height
+template <typename T>
+static bool checkFractionalRange(const char* inName){
+    const float minHeight = 0.25f;
+    const float maxHeight = 100.9f;
+    const double lowest = std::numeric_limits<T>::min();
+    const double highest = std::numeric_limits<T>::max();
+    T* data = new T[4];
+    data[0] = std::numeric_limits<T>::min();
+    data[1] = std::numeric_limits<T>::max();
+    data[2] = static_cast<T>(std::numeric_limits<T>::min() / 2 + std::numeric_limits<T>::max() / 2);
+    data[3] = static_cast<T>(std::numeric_limits<T>::min() + 1);
+    HeightMapGen<T> heights(2, data);
+    heights.setMinHeight(minHeight);
+    heights.setMaxHeight(maxHeight);
+
+    float bulk[4];
+    heights.getHeights(0, 4, bulk);
+    bool same = true;
+    for(unsigned int i = 0; i < 4; ++i){
+        const double expected = minHeight + (heights.getRaw(i) - lowest) / (highest - lowest) * (maxHeight - minHeight);
+        same = same && fabs(heights.get(i) - expected) < 1e-4 && isSame(heights.get(i), bulk[i]);
+    }
+    if(!same) std::cout << "FAILED: " << inName << " heights with fractional range are decoded wrong" << std::endl;
+    return same;
+}
+
+//measures reading and normals of height map, returns false if results differ
+static bool run(const char* inName, const HeightMap& inHeights){
+    const unsigned int size = inHeights.getSize();
+    const double samples = static_cast<double>(size) * size;
+    std::cout << "=== " << inName << " " << size << "x" << size << std::endl;
+
+    Timer timer;
+    std::vector<float> single(size * size), bulk(size * size);
+    timer.start();
+    for(unsigned int i = 0; i < single.size(); ++i) single[i] = inHeights[i];
+    const double singleTime = timer.getMicroseconds() / 1e6;
+
+    timer.start();
+    inHeights.getHeights(0, bulk.size(), &bulk[0]);
+    const double bulkTime = timer.getMicroseconds() / 1e6;
+
+    bool same = true;
+    for(size_t i = 0; i < single.size(); ++i) same = same && isSame(single[i], bulk[i]);
+
+    std::vector<Vector3D> reference, normals;
+    timer.start();
+    calcNormalsPerVertex(inHeights, reference);
+    const double referenceTime = timer.getMicroseconds() / 1e6;
+
+    timer.start();
+    HeightMapNormals::calc(inHeights, normals);
+    const double normalsTime = timer.getMicroseconds() / 1e6;
+
+    for(size_t i = 0; i < normals.size(); ++i){
+        same = same && isSame(reference[i].x(), normals[i].x()) && isSame(reference[i].y(), normals[i].y()) && isSame(reference[i].z(), normals[i].z());
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "  get() per height     " << std::setw(8) << singleTime * 1000.0 << " ms  " << std::setw(7) << (singleTime > 0.0? samples / singleTime / 1e6: 0.0) << " M/s" << std::endl
+        << "  getHeights()         " << std::setw(8) << bulkTime * 1000.0 << " ms  " << std::setw(7) << (bulkTime > 0.0? samples / bulkTime / 1e6: 0.0) << " M/s" << std::endl
+        << "  normals per vertex   " << std::setw(8) << referenceTime * 1000.0 << " ms  " << std::setw(7) << (referenceTime > 0.0? samples / referenceTime / 1e6: 0.0) << " M/s" << std::endl
+        << "  HeightMapNormals     " << std::setw(8) << normalsTime * 1000.0 << " ms  " << std::setw(7) << (normalsTime > 0.0? samples / normalsTime / 1e6: 0.0) << " M/s"
+        << "  (x" << std::setprecision(2) << (normalsTime > 0.0? referenceTime / normalsTime: 0.0) << ")" << std::endl;
+    if(!same) std::cout << "FAILED: results differ" << std::endl;
+    return same;
+}
+
+int main(int argc, char** argv){
+    const unsigned int size = (argc > 1)? atoi(argv[1]): 4097;
+    if(size < 2){
+        std::cerr << "size is too small" << std::endl;
+        return 1;
+    }
+
+    bool same = checkFractionalRange<unsigned short>("unsigned short");
+    same = checkFractionalRange<short>("short") && same;
+    {
+        HeightMapGen<float>* heights = benchmark::createHeightMap(size);
+        same = run("float", *heights) && same;
+
+        //same heights encoded with 16 bits
+        unsigned short* data = new unsigned short[size * size];
+        for(unsigned int i = 0; i < size * size; ++i) data[i] = static_cast<unsigned short>(heights->getRaw(i) / 100.0f * 65535.0f);
+        delete heights;
+
+        HeightMapGen<unsigned short> encoded(size, data);
+        encoded.setMinHeight(0.0f);
+        encoded.setMaxHeight(100.0f);
+        same = run("unsigned short", encoded) && same;
+    }
+    return same? 0: 1;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
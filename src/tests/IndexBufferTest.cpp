@@ -0,0 +1,222 @@
+//IndexBufferTest.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Checks that mesh processing gives the same results with 16-bit and 32-bit
+//index buffers and that compressed index encoding is lossless.
+//Returns non-zero if some check fails.
+
+#include "BenchmarkUtils.hpp"
+#include "data/IndexBuffer.hpp"
+#include "data/Mesh.hpp"
+#include "rendering/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+using namespace hydra::data;
+using hydra::rendering::MeshOptimizer;
+using hydra::math::AABB;
+using hydra::math::Vector3D;
+
+namespace{
+
+unsigned int gFailures = 0;
+
+void check(bool inCondition, const char* inWhat){
+    if(!inCondition){
+        std::cout << "FAILED: " << inWhat << std::endl;
+        ++gFailures;
+    }
+}
+
+///triangle stored as sorted vertex indices
+struct Triangle{
+    Mesh::index_t v[3];
+
+    bool operator<(const Triangle& rhv) const{
+        return std::lexicographical_compare(v, v + 3, rhv.v, rhv.v + 3);
+    }
+
+    bool operator==(const Triangle& rhv) const{
+        return std::equal(v, v + 3, rhv.v);
+    }
+};
+
+Triangle makeTriangle(Mesh::index_t inA, Mesh::index_t inB, Mesh::index_t inC){
+    Triangle result;
+    result.v[0] = inA;
+    result.v[1] = inB;
+    result.v[2] = inC;
+    std::sort(result.v, result.v + 3);
+    return result;
+}
+
+///returns sorted list of non-degenerate triangles of mesh
+std::vector<Triangle> getTriangles(const Mesh& inMesh){
+    std::vector<Triangle> result;
+    const IndexBuffer& indices = inMesh.mIndices;
+    if(inMesh.mMode == Mesh::TRIANGLES){
+        for(size_t i = 0; i + 2 < indices.size(); i += 3){
+            result.push_back(makeTriangle(indices[i], indices[i + 1], indices[i + 2]));
+        }
+    }
+    else{
+        for(size_t i = 0; i + 2 < indices.size(); ++i){
+            Mesh::index_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            if(a == b || b == c || a == c) continue;
+            result.push_back(makeTriangle(a, b, c));
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+///converts mesh to triangle soup (every corner gets its own vertex)
+MeshPtr createSoup(const Mesh& inMesh){
+    MeshPtr result(new Mesh());
+    result->mMode = Mesh::TRIANGLES;
+    for(size_t i = 0; i < inMesh.getIndexNum(); ++i){
+        result->mVertices.push_back(inMesh.mVertices[inMesh.mIndices[i]]);
+        result->mIndices.push_back(static_cast<Mesh::index_t>(i));
+    }
+    return result;
+}
+
+bool isNear(const Vector3D& inFirst, const Vector3D& inSecond){
+    return (inFirst - inSecond).getMagnitude() < 1e-5f;
+}
+
+void testAABB(const Mesh& inMesh){
+    Vector3D minCorner(inMesh.mVertices[0].mCoord), maxCorner(minCorner);
+    for(size_t i = 0; i < inMesh.getVertexNum(); ++i){
+        const Vector3D next(inMesh.mVertices[i].mCoord);
+        minCorner = Vector3D(std::min(minCorner.x(), next.x()), std::min(minCorner.y(), next.y()), std::min(minCorner.z(), next.z()));
+        maxCorner = Vector3D(std::max(maxCorner.x(), next.x()), std::max(maxCorner.y(), next.y()), std::max(maxCorner.z(), next.z()));
+    }
+    AABB aabb = inMesh.calcAABB();
+    check(isNear(aabb.getCorner(), minCorner), "calcAABB corner");
+    check(isNear(aabb.getVector(), maxCorner - minCorner), "calcAABB vector");
+}
+
+void testWeld(const Mesh& inMesh){
+    MeshPtr soup = createSoup(inMesh);
+    soup->deleteRedundantVertices();
+
+    check(soup->getVertexNum() == inMesh.getVertexNum(), "deleteRedundantVertices vertex number");
+    check(soup->getIndexNum() == inMesh.getIndexNum(), "deleteRedundantVertices index number");
+    check((soup->mIndices.getWidth() == IndexBuffer::WIDTH_16) == (soup->getVertexNum() <= IndexBuffer::MAX_INDEX_16 + 1),
+        "deleteRedundantVertices narrows index buffer");
+
+    //welded mesh must reference the same vertices in the same order
+    bool same = true;
+    for(size_t i = 0; same && i < inMesh.getIndexNum(); ++i){
+        const Vertex& src = inMesh.mVertices[inMesh.mIndices[i]];
+        const Vertex& dst = soup->mVertices[soup->mIndices[i]];
+        same = isNear(Vector3D(src.mCoord), Vector3D(dst.mCoord)) && isNear(Vector3D(src.mTexCoord), Vector3D(dst.mTexCoord));
+    }
+    check(same, "deleteRedundantVertices keeps triangles");
+    std::cout << "  weld: " << soup->getVertexNum() << " vertices, "
+        << (soup->mIndices.getWidth() == IndexBuffer::WIDTH_16? 16: 32) << "-bit indices" << std::endl;
+}
+
+void testOptimizer(const Mesh& inMesh, MeshOptimizer::Mode inMode){
+    MeshPtr copy(new Mesh(inMesh));
+    MeshOptimizer optimizer;
+    optimizer.setMode(inMode);
+    optimizer.optimizeMesh(copy);
+
+    const char* name = (inMode == MeshOptimizer::STRIPIFY)? "stripify": "vertex cache";
+    check(getTriangles(*copy) == getTriangles(inMesh), name);
+    check(copy->mIndices.getWidth() == inMesh.mIndices.getWidth(), "optimizer keeps index width");
+    std::cout << "  " << name << ": " << copy->getIndexNum() << " indices" << std::endl;
+}
+
+void testCodec(const IndexBuffer& inIndices){
+    std::vector<unsigned char> encoded;
+    inIndices.encode(encoded);
+
+    IndexBuffer decoded;
+    size_t read = decoded.decode(encoded.empty()? 0: &encoded[0], encoded.size());
+    check(read == encoded.size(), "decode reads whole data");
+    check(decoded == inIndices, "encode/decode round trip");
+    check(decoded.getWidth() == inIndices.getWidth(), "decode restores width");
+
+    bool thrown = false;
+    try{
+        decoded.decode(&encoded[0], encoded.size() / 2);
+    }
+    catch(const std::runtime_error&){
+        thrown = true;
+    }
+    check(thrown, "truncated data is rejected");
+
+    std::cout << "  codec: " << inIndices.getDataSize() << " -> " << encoded.size() << " bytes ("
+        << static_cast<float>(inIndices.getDataSize()) / encoded.size() << ":1)" << std::endl;
+}
+
+} //unnamed namespace
+
+int main(){
+    //first sphere fits into 16-bit indices, second one needs 32-bit
+    MeshPtr meshes[2];
+    meshes[0] = benchmark::createSphereMesh(100, 200);
+    meshes[1] = benchmark::createSphereMesh(200, 400);
+
+    check(meshes[0]->mIndices.getWidth() == IndexBuffer::WIDTH_16, "small mesh uses 16-bit indices");
+    check(meshes[1]->mIndices.getWidth() == IndexBuffer::WIDTH_32, "large mesh uses 32-bit indices");
+
+    for(size_t i = 0; i < 2; ++i){
+        std::cout << meshes[i]->getVertexNum() << " vertices, "
+            << (meshes[i]->mIndices.getWidth() == IndexBuffer::WIDTH_16? 16: 32) << "-bit indices" << std::endl;
+        testAABB(*meshes[i]);
+        testWeld(*meshes[i]);
+        testOptimizer(*meshes[i], MeshOptimizer::VERTEX_CACHE);
+        testOptimizer(*meshes[i], MeshOptimizer::STRIPIFY);
+        testCodec(meshes[i]->mIndices);
+    }
+
+    if(gFailures){
+        std::cout << gFailures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all checks passed" << std::endl;
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
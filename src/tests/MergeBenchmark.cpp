@@ -0,0 +1,131 @@
+//MergeBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Reports reduction of number of draw calls made by merging meshes with
+//equal materials: for each model itself and for a static scene of many
+//pre-transformed instances of it.
+//Usage: MergeBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/Mesh.hpp"
+#include "data/MeshMerger.hpp"
+#include "data/Material.hpp"
+#include "math/Matrix.hpp"
+
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <vector>
+
+using namespace hydra::data;
+using hydra::math::Matrix;
+
+//builds model of many small meshes which use few materials
+static ModelPtr createPropsModel(){
+    ModelPtr model(new Model("generated props"));
+    std::vector<MaterialPtr> materials;
+    for(int i = 0; i < 4; ++i){
+        materials.push_back(MaterialPtr(new Material("material" + std::string(1, static_cast<char>('0' + i)))));
+    }
+    for(int i = 0; i < 64; ++i){
+        MeshPtr mesh = benchmark::createSphereMesh(8, 16, 0.1f);
+        BOOST_FOREACH(Vertex& nextVertex, mesh->mVertices) nextVertex.mCoord.x += static_cast<float>(i);
+        //half of meshes get their own copies of materials
+        const MaterialPtr& material = materials[i % materials.size()];
+        mesh->mMaterial = (i % 2)? MaterialPtr(new Material(*material)): material;
+        model->mMeshes.push_back(mesh);
+    }
+    return model;
+}
+
+static void mergeModel(const Model& inModel){
+    Model model(inModel);
+    hydra::common::Timer timer;
+    timer.start();
+    model.sortMeshesByOpacity();
+    model.mergeMeshes();
+    const double time = timer.getMicroseconds() / 1e6;
+
+    const bool same = (benchmark::getVertexNum(model) == benchmark::getVertexNum(inModel));
+    std::cout << "  model:  draw calls " << inModel.mMeshes.size() << " -> " << model.mMeshes.size()
+        << ", merged in " << time * 1000.0 << " ms"
+        << (same? "": ", VERTEX NUMBER CHANGED") << std::endl;
+}
+
+static void mergeInstances(ModelPtr inModel, unsigned int inGridSize){
+    MeshMerger merger;
+    for(unsigned int i = 0; i < inGridSize; ++i){
+        for(unsigned int j = 0; j < inGridSize; ++j){
+            Matrix transform;
+            float data[16];
+            transform.get(data);
+            //every other instance is mirrored
+            data[0] = ((i + j) % 2)? -1.0f: 1.0f;
+            data[3] = 10.0f * i;
+            data[11] = 10.0f * j;
+            merger.addInstance(inModel, Matrix(data));
+        }
+    }
+
+    hydra::common::Timer timer;
+    timer.start();
+    ModelPtr scene = merger.buildStaticModel("scene");
+    const double time = timer.getMicroseconds() / 1e6;
+
+    const size_t instances = merger.getInstanceNum();
+    const size_t triangles = benchmark::getIndexNum(*inModel) / 3 * instances;
+    std::cout << "  " << instances << " instances: draw calls " << inModel->mMeshes.size() * instances
+        << " -> " << scene->mMeshes.size() << ", merged in " << time * 1000.0 << " ms ("
+        << (time > 0.0? triangles / time / 1e6: 0.0) << " Mtri/s)" << std::endl;
+}
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv, 32);
+    benchmark::NamedModel props;
+    props.model = createPropsModel();
+    props.name = props.model->mName;
+    models.push_back(props);
+
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        std::cout << "=== " << nextModel.name << ": " << nextModel.model->mMeshes.size() << " meshes, "
+            << benchmark::getIndexNum(*nextModel.model) << " indices" << std::endl;
+        mergeModel(*nextModel.model);
+        mergeInstances(nextModel.model, 10);
+    }
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
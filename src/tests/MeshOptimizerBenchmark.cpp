@@ -0,0 +1,124 @@
+//MeshOptimizerBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Compares STRIPIFY and VERTEX_CACHE modes of MeshOptimizer:
+//number of indices, ACMR/ATVR for simulated FIFO caches and optimization time.
+//Usage: MeshOptimizerBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/Mesh.hpp"
+#include "rendering/MeshOptimizer.hpp"
+
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace hydra::data;
+using hydra::rendering::MeshOptimizer;
+
+//sums statistics of all meshes
+MeshOptimizer::CacheStatistics analyze(const std::vector<MeshPtr>& inMeshes, unsigned int inCacheSize){
+    MeshOptimizer::CacheStatistics total = MeshOptimizer::CacheStatistics();
+    BOOST_FOREACH(const MeshPtr& nextMesh, inMeshes){
+        MeshOptimizer::CacheStatistics stats = MeshOptimizer::analyzeVertexCache(*nextMesh, inCacheSize);
+        total.indices += stats.indices;
+        total.triangles += stats.triangles;
+        total.vertices += stats.vertices;
+        total.transformedVertices += stats.transformedVertices;
+    }
+    if(total.triangles) total.acmr = static_cast<float>(total.transformedVertices) / total.triangles;
+    if(total.vertices) total.atvr = static_cast<float>(total.transformedVertices) / total.vertices;
+    return total;
+}
+
+void report(const std::string& inName, const std::vector<MeshPtr>& inMeshes, double inTime){
+    const unsigned int cacheSizes[] = {8, 16, 32};
+    std::cout << std::setw(22) << inName << "  time " << std::setw(8) << inTime * 1000.0 << " ms"
+        << "  indices " << std::setw(8) << analyze(inMeshes, 16).indices;
+    for(size_t i = 0; i < sizeof(cacheSizes) / sizeof(cacheSizes[0]); ++i){
+        MeshOptimizer::CacheStatistics stats = analyze(inMeshes, cacheSizes[i]);
+        std::cout << "  | fifo " << std::setw(2) << cacheSizes[i] << ": acmr " << std::setw(6) << stats.acmr
+            << " atvr " << std::setw(6) << stats.atvr;
+    }
+    std::cout << std::endl;
+}
+
+std::vector<MeshPtr> copyMeshes(const Model& inModel){
+    std::vector<MeshPtr> result;
+    BOOST_FOREACH(const MeshPtr& nextMesh, inModel.mMeshes){
+        result.push_back(MeshPtr(new Mesh(*nextMesh)));
+    }
+    return result;
+}
+
+double optimize(std::vector<MeshPtr>& inoutMeshes, MeshOptimizer::Mode inMode, unsigned int inCacheSize){
+    MeshOptimizer optimizer;
+    optimizer.setMode(inMode);
+    optimizer.setCacheSize(inCacheSize);
+
+    hydra::common::Timer timer;
+    timer.start();
+    BOOST_FOREACH(MeshPtr& nextMesh, inoutMeshes) optimizer.optimizeMesh(nextMesh);
+    return timer.getMicroseconds() / 1e6;
+}
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv, 128);
+
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        std::cout << "=== " << nextModel.name << std::endl;
+
+        std::vector<MeshPtr> original = copyMeshes(*nextModel.model);
+        report("original list", original, 0.0);
+
+        std::vector<MeshPtr> strips = copyMeshes(*nextModel.model);
+        double time = optimize(strips, MeshOptimizer::STRIPIFY, 16);
+        report("strip (cache 16)", strips, time);
+
+        const unsigned int listCacheSizes[] = {16, 32};
+        for(size_t i = 0; i < sizeof(listCacheSizes) / sizeof(listCacheSizes[0]); ++i){
+            std::vector<MeshPtr> lists = copyMeshes(*nextModel.model);
+            time = optimize(lists, MeshOptimizer::VERTEX_CACHE, listCacheSizes[i]);
+            report(std::string("forsyth list (cache ") + (i? "32)": "16)"), lists, time);
+        }
+    }
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,176 @@
+//NormalsBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Compares NormalGenerator with the previous serial implementation
+//of Mesh::generateNormals on specified models.
+//Usage: NormalsBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/Mesh.hpp"
+#include "data/Vertex.hpp"
+#include "data/NormalGenerator.hpp"
+#include "common/ParallelFor.hpp"
+
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+using namespace hydra::data;
+using hydra::math::Vector3D;
+
+//previous implementation of Mesh::generateNormals
+void serialGenerateNormals(Mesh& inoutMesh){
+    std::vector<Vertex>& vertices = inoutMesh.mVertices;
+    const IndexBuffer& indices = inoutMesh.mIndices;
+
+    for(size_t i = 0; i < vertices.size(); ++i)
+        vertices[i].mNormal = Vector3D(0.0f, 0.0f, 0.0f);
+
+    size_t numTriangles;
+    if(inoutMesh.mMode == Mesh::TRIANGLE_LIST) numTriangles = indices.size() / 3;
+    else if(inoutMesh.mMode == Mesh::TRIANGLE_STRIP) numTriangles = indices.size() - 2;
+    else return;
+
+    for(size_t i = 0; i < numTriangles; ++i){
+        Vertex* vert1;
+        Vertex* vert2;
+        Vertex* vert3;
+
+        if(inoutMesh.mMode == Mesh::TRIANGLE_LIST){
+            vert1 = &vertices[indices[3*i]];
+            vert2 = &vertices[indices[3*i + 1]];
+            vert3 = &vertices[indices[3*i + 2]];
+        }
+        else{
+            vert1 = &vertices[indices[i + 0]];
+            vert2 = &vertices[indices[i + 1]];
+            vert3 = &vertices[indices[i + 2]];
+            if(i % 2 != 0) std::swap(vert1, vert3);
+        }
+
+        Vector3D vec1(vert2->mCoord.x - vert1->mCoord.x, vert2->mCoord.y - vert1->mCoord.y, vert2->mCoord.z - vert1->mCoord.z);
+        Vector3D vec2(vert3->mCoord.x - vert1->mCoord.x, vert3->mCoord.y - vert1->mCoord.y, vert3->mCoord.z - vert1->mCoord.z);
+        Vector3D contribution = vec1.cross(vec2);
+
+        vert1->mNormal += contribution;
+        vert2->mNormal += contribution;
+        vert3->mNormal += contribution;
+    }
+
+    for(size_t i = 0; i < vertices.size(); ++i)
+        vertices[i].mNormal.normalize();
+}
+
+float maxDifference(const Mesh& inMesh1, const Mesh& inMesh2){
+    float result = 0.0f;
+    for(size_t i = 0; i < std::min(inMesh1.getVertexNum(), inMesh2.getVertexNum()); ++i){
+        result = std::max(result, (inMesh1.mVertices[i].mNormal - inMesh2.mVertices[i].mNormal).getMagnitude());
+    }
+    return result;
+}
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv, 1024);
+    const unsigned int repeats = 5;
+
+    NormalGenerator::Properties serialProps;
+    serialProps.threadNum = 1;
+    NormalGenerator::Properties parallelProps;
+    parallelProps.threadNum = 4;
+    NormalGenerator::Properties angleProps;
+    angleProps.weighting = NormalGenerator::ANGLE_WEIGHTED;
+    NormalGenerator::Properties splitProps;
+    splitProps.smoothingAngle = 3.14159265f / 3.0f;
+
+    NormalGenerator serial(serialProps);
+    NormalGenerator parallel(parallelProps);
+    NormalGenerator angle(angleProps);
+    NormalGenerator split(splitProps);
+
+    std::cout << "hardware threads: " << hydra::common::getHardwareThreadNum() << std::endl;
+
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        std::cout << "=== " << nextModel.name << ": " << benchmark::getVertexNum(*nextModel.model) << " vertices, "
+            << benchmark::getIndexNum(*nextModel.model) << " indices" << std::endl;
+
+        double oldTime = 0.0, serialTime = 0.0, parallelTime = 0.0, angleTime = 0.0, splitTime = 0.0;
+        float maxDiff = 0.0f;
+        size_t vertexNum = 0, splitVertexNum = 0;
+
+        BOOST_FOREACH(const MeshPtr& nextMesh, nextModel.model->mMeshes){
+            Mesh reference(*nextMesh);
+            Mesh generated(*nextMesh);
+            vertexNum += nextMesh->getVertexNum();
+
+            hydra::common::Timer timer;
+            timer.start();
+            for(unsigned int i = 0; i < repeats; ++i) serialGenerateNormals(reference);
+            oldTime += timer.getMicroseconds() / 1e6 / repeats;
+
+            timer.start();
+            for(unsigned int i = 0; i < repeats; ++i) serial.generate(generated);
+            serialTime += timer.getMicroseconds() / 1e6 / repeats;
+
+            timer.start();
+            for(unsigned int i = 0; i < repeats; ++i) parallel.generate(generated);
+            parallelTime += timer.getMicroseconds() / 1e6 / repeats;
+            maxDiff = std::max(maxDiff, maxDifference(reference, generated));
+
+            timer.start();
+            for(unsigned int i = 0; i < repeats; ++i) angle.generate(generated);
+            angleTime += timer.getMicroseconds() / 1e6 / repeats;
+
+            Mesh splitMesh(*nextMesh);
+            timer.start();
+            split.generate(splitMesh);
+            splitTime += timer.getMicroseconds() / 1e6;
+            splitVertexNum += splitMesh.getVertexNum();
+        }
+
+        std::cout << "previous serial routine:     " << oldTime * 1000.0 << " ms" << std::endl;
+        std::cout << "generator, 1 thread:         " << serialTime * 1000.0 << " ms (x" << oldTime / serialTime << ")" << std::endl;
+        std::cout << "generator, 4 threads:        " << parallelTime * 1000.0 << " ms (x" << oldTime / parallelTime << ")" << std::endl;
+        std::cout << "max difference from previous: " << maxDiff << std::endl;
+        std::cout << "angle weighted:              " << angleTime * 1000.0 << " ms" << std::endl;
+        std::cout << "area weighted, split at 60 deg: " << splitTime * 1000.0 << " ms, "
+            << vertexNum << " -> " << splitVertexNum << " vertices" << std::endl;
+    }
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,123 @@
+//OverdrawBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Runs mesh optimization passes one after another (vertex cache, overdraw,
+//vertex fetch) and reports ACMR, estimated overdraw and vertex overfetch after each pass.
+//Usage: OverdrawBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/Mesh.hpp"
+#include "data/Vertex.hpp"
+#include "rendering/MeshOptimizer.hpp"
+
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace hydra::data;
+using hydra::rendering::MeshOptimizer;
+
+const unsigned int CACHE_SIZE = 16;
+const unsigned int COMPACT_VERTEX_SIZE = 16;
+
+void report(const std::string& inName, const std::vector<MeshPtr>& inMeshes, double inTime){
+    size_t triangles = 0;
+    size_t transformed = 0;
+    size_t covered = 0;
+    size_t shaded = 0;
+    size_t fullFetched = 0;
+    size_t compactFetched = 0;
+    size_t vertices = 0;
+
+    BOOST_FOREACH(const MeshPtr& nextMesh, inMeshes){
+        MeshOptimizer::CacheStatistics cache = MeshOptimizer::analyzeVertexCache(*nextMesh, CACHE_SIZE);
+        triangles += cache.triangles;
+        transformed += cache.transformedVertices;
+
+        MeshOptimizer::OverdrawStatistics overdraw = MeshOptimizer::analyzeOverdraw(*nextMesh);
+        covered += overdraw.pixelsCovered;
+        shaded += overdraw.pixelsShaded;
+
+        fullFetched += MeshOptimizer::analyzeVertexFetch(*nextMesh, sizeof(Vertex)).bytesFetched;
+        compactFetched += MeshOptimizer::analyzeVertexFetch(*nextMesh, COMPACT_VERTEX_SIZE).bytesFetched;
+        vertices += nextMesh->getVertexNum();
+    }
+
+    std::cout << std::setw(16) << inName << "  time " << std::setw(8) << inTime * 1000.0 << " ms"
+        << "  acmr " << std::setw(8) << (triangles? static_cast<float>(transformed) / triangles: 0.0f)
+        << "  overdraw " << std::setw(8) << (covered? static_cast<float>(shaded) / covered: 0.0f)
+        << "  overfetch " << std::setw(8) << (vertices? static_cast<float>(fullFetched) / (vertices * sizeof(Vertex)): 0.0f)
+        << " (" << sizeof(Vertex) << " b), " << std::setw(8)
+        << (vertices? static_cast<float>(compactFetched) / (vertices * COMPACT_VERTEX_SIZE): 0.0f)
+        << " (" << COMPACT_VERTEX_SIZE << " b)" << std::endl;
+}
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv, 128);
+
+    MeshOptimizer optimizer;
+    optimizer.setMode(MeshOptimizer::VERTEX_CACHE);
+    optimizer.setCacheSize(CACHE_SIZE);
+
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        std::cout << "=== " << nextModel.name << ": " << benchmark::getIndexNum(*nextModel.model) / 3 << " triangles" << std::endl;
+
+        std::vector<MeshPtr> meshes;
+        BOOST_FOREACH(const MeshPtr& nextMesh, nextModel.model->mMeshes){
+            meshes.push_back(MeshPtr(new Mesh(*nextMesh)));
+        }
+        report("original", meshes, 0.0);
+
+        hydra::common::Timer timer;
+        timer.start();
+        BOOST_FOREACH(MeshPtr& nextMesh, meshes) optimizer.optimizeMesh(nextMesh);
+        report("vertex cache", meshes, timer.getMicroseconds() / 1e6);
+
+        timer.start();
+        BOOST_FOREACH(MeshPtr& nextMesh, meshes) optimizer.optimizeOverdraw(nextMesh);
+        report("overdraw", meshes, timer.getMicroseconds() / 1e6);
+
+        timer.start();
+        BOOST_FOREACH(MeshPtr& nextMesh, meshes) nextMesh->optimizeVertexFetch();
+        report("vertex fetch", meshes, timer.getMicroseconds() / 1e6);
+    }
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
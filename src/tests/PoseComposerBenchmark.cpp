@@ -0,0 +1,264 @@
+//PoseComposerBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Measures poses per second of PoseComposer for synthetic hierarchies
+//and compares results with scalar composition used before it.
+//Usage: PoseComposerBenchmark [number of bones]
+
+#include "data/PoseComposer.hpp"
+#include "data/MeshSkinner.hpp"
+#include "data/Pose.hpp"
+#include "data/Skeleton.hpp"
+#include "data/Bone.hpp"
+#include "math/Quat.hpp"
+#include "math/Vector3D.hpp"
+#include "common/Timer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+using namespace hydra::data;
+using hydra::math::Quat;
+using hydra::math::Vector3D;
+using hydra::common::Timer;
+
+//returns random float in [-1, 1]
+static float getRandom(){
+    return static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f;
+}
+
+//builds hierarchy where parent precedes its children (as in MD5 files)
+static void createHierarchy(size_t inBoneNum, Skeleton& outSkeleton){
+    outSkeleton.mBones.resize(inBoneNum);
+    for(size_t i = 0; i < inBoneNum; ++i){
+        Bone& bone = outSkeleton.mBones[i];
+        //short chains with some branching
+        bone.mParent = (i == 0)? -1: static_cast<int>(i - 1 - rand() % std::min<size_t>(i, 3));
+        bone.mPos = Vector3D(getRandom(), getRandom(), getRandom());
+        bone.mOrient = Quat(getRandom() * 3.0f, Vector3D(getRandom(), getRandom(), getRandom() + 2.0f).getUnit());
+    }
+}
+
+//builds random local pose
+static void createLocalPose(size_t inBoneNum, Pose& outPose){
+    outPose.setIdentity(inBoneNum);
+    for(size_t i = 0; i < inBoneNum; ++i){
+        outPose.mPositions[i] = Vector3D(getRandom(), getRandom(), getRandom());
+        outPose.mOrients[i] = Quat(getRandom() * 3.0f, Vector3D(getRandom(), getRandom() + 2.0f, getRandom()).getUnit());
+    }
+}
+
+//composition of MD5AnimationLoader before PoseComposer
+static void composeScalar(const Skeleton& inHierarchy, const Pose& inLocal, Pose& outModel){
+    outModel.mPositions.resize(inLocal.getBoneNum());
+    outModel.mOrients.resize(inLocal.getBoneNum());
+    for(size_t i = 0; i < inLocal.getBoneNum(); ++i){
+        Vector3D pos = inLocal.mPositions[i];
+        Quat orient = inLocal.mOrients[i];
+        const int parent = inHierarchy.mBones[i].mParent;
+        if(parent >= 0){
+            outModel.mOrients[parent].rotate(pos);
+            pos += outModel.mPositions[parent];
+            orient = outModel.mOrients[parent] * orient;
+            orient.normalize();
+        }
+        outModel.mPositions[i] = pos;
+        outModel.mOrients[i] = orient;
+    }
+}
+
+//conversion of Model::addAnimation before PoseComposer
+static void makeRelativeScalar(const Skeleton& inBind, const Pose& inModel, Pose& outRelative){
+    outRelative = inModel;
+    for(size_t i = 0; i < inModel.getBoneNum(); ++i){
+        outRelative.mOrients[i] = inModel.mOrients[i] * inBind.mBones[i].mOrient.getInverse();
+        outRelative.mOrients[i].normalize();
+        Vector3D temp = inBind.mBones[i].mPos;
+        outRelative.mOrients[i].rotate(temp);
+        outRelative.mPositions[i] = inModel.mPositions[i] - temp;
+    }
+}
+
+//returns maximal difference of poses (positions and orientations, sign of quaternions is ignored)
+static float getDifference(const Pose& inPose1, const Pose& inPose2){
+    float result = 0.0f;
+    for(size_t i = 0; i < std::min(inPose1.getBoneNum(), inPose2.getBoneNum()); ++i){
+        const Quat& q1 = inPose1.mOrients[i];
+        const Quat& q2 = inPose2.mOrients[i];
+        const float dot = fabsf(q1.getVec() * q2.getVec() + q1.getScalar() * q2.getScalar());
+        result = std::max(result, 1.0f - std::min(dot, 1.0f));
+        result = std::max(result, (inPose1.mPositions[i] - inPose2.mPositions[i]).getMagnitude());
+    }
+    return result;
+}
+
+//returns maximal difference of matrices
+static float getDifference(const MeshSkinner::Palette& inPalette1, const MeshSkinner::Palette& inPalette2){
+    float result = 0.0f;
+    for(size_t i = 0; i < std::min(inPalette1.getBoneNum(), inPalette2.getBoneNum()); ++i){
+        for(size_t j = 0; j < MeshSkinner::Palette::MATRIX_SIZE; ++j){
+            result = std::max(result, fabsf(inPalette1.getMatrix(i)[j] - inPalette2.getMatrix(i)[j]));
+        }
+    }
+    return result;
+}
+
+//prints number of poses per second
+static void report(const char* inName, size_t inPoseNum, hydra::common::Timer& inTimer){
+    const double seconds = inTimer.getMicroseconds() / 1e6;
+    std::cout << std::setw(36) << inName << ": " << std::setw(10) << std::setprecision(4)
+        << (seconds > 0.0? inPoseNum / seconds / 1e3: 0.0) << " K poses/s" << std::endl;
+}
+
+//measures composition for hierarchy, returns false if results differ from scalar ones
+static bool run(size_t inBoneNum){
+    const size_t poseNum = 16;
+    const size_t iterations = 2000000 / inBoneNum;
+
+    Skeleton hierarchy, bind;
+    createHierarchy(inBoneNum, hierarchy);
+    std::vector<Pose> locals(poseNum);
+    for(size_t i = 0; i < poseNum; ++i) createLocalPose(inBoneNum, locals[i]);
+
+    //bind pose is in model space
+    Pose bindPose;
+    bindPose.fromSkeleton(hierarchy);
+    Pose bindModel;
+    composeScalar(hierarchy, bindPose, bindModel);
+    bind = hierarchy;
+    bindModel.toSkeleton(bind);
+
+    PoseComposer composer;
+    composer.setup(bind);
+    std::cout << "=== " << inBoneNum << " bones, " << composer.getDepth() << " levels" << std::endl;
+
+    Timer timer;
+    Pose model, relative;
+    MeshSkinner::Palette palette;
+    float sink = 0.0f;
+
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        composeScalar(hierarchy, locals[i % poseNum], model);
+        sink += model.mPositions[inBoneNum - 1].x();
+    }
+    report("scalar, model", iterations, timer);
+
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        composeScalar(hierarchy, locals[i % poseNum], model);
+        makeRelativeScalar(bind, model, relative);
+        palette.build(relative);
+        sink += palette.getMatrix(inBoneNum - 1)[12];
+    }
+    report("scalar, model + relative + palette", iterations, timer);
+
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        composer.compose(locals[i % poseNum], model);
+        sink += model.mPositions[inBoneNum - 1].x();
+    }
+    report("composer, model", iterations, timer);
+
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        composer.composeRelative(locals[i % poseNum], relative);
+        sink += relative.mPositions[inBoneNum - 1].x();
+    }
+    report("composer, relative", iterations, timer);
+
+    timer.start();
+    for(size_t i = 0; i < iterations; ++i){
+        composer.composePalette(locals[i % poseNum], palette);
+        sink += palette.getMatrix(inBoneNum - 1)[12];
+    }
+    report("composer, palette", iterations, timer);
+
+    //checks
+    float modelError = 0.0f, relativeError = 0.0f, paletteError = 0.0f, makeRelativeError = 0.0f;
+    Pose expectedModel, expectedRelative;
+    MeshSkinner::Palette expectedPalette;
+    for(size_t i = 0; i < poseNum; ++i){
+        composeScalar(hierarchy, locals[i], expectedModel);
+        makeRelativeScalar(bind, expectedModel, expectedRelative);
+        expectedPalette.build(expectedRelative);
+
+        composer.compose(locals[i], model);
+        modelError = std::max(modelError, getDifference(expectedModel, model));
+        composer.composeRelative(locals[i], relative);
+        relativeError = std::max(relativeError, getDifference(expectedRelative, relative));
+        composer.composePalette(locals[i], palette);
+        paletteError = std::max(paletteError, getDifference(expectedPalette, palette));
+        composer.makeRelative(expectedModel, relative);
+        makeRelativeError = std::max(makeRelativeError, getDifference(expectedRelative, relative));
+    }
+    std::cout << "errors: model " << modelError << ", relative " << relativeError << ", palette " << paletteError
+        << ", makeRelative " << makeRelativeError << " (" << sink * 0.0f << ")" << std::endl;
+
+    //long chains accumulate rounding errors of both implementations
+    const float tolerance = 1e-3f;
+    return modelError < tolerance && relativeError < tolerance && paletteError < tolerance && makeRelativeError < tolerance;
+}
+
+int main(int argc, char** argv){
+    srand(1);
+    std::vector<size_t> boneNums;
+    if(argc > 1){
+        boneNums.push_back(std::max(1, atoi(argv[1])));
+    }
+    else{
+        boneNums.push_back(32);
+        boneNums.push_back(64);
+        boneNums.push_back(128);
+        boneNums.push_back(256);
+    }
+
+    int result = 0;
+    for(size_t i = 0; i < boneNums.size(); ++i){
+        if(!run(boneNums[i])){
+            std::cout << "FAILED: results differ from scalar composition" << std::endl;
+            result = 1;
+        }
+    }
+    return result;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
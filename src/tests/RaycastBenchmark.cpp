@@ -0,0 +1,252 @@
+//RaycastBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Builds MeshBVH for meshes of models and reports build time and speed
+//(rays per second) of single rays, ray packets, segment tests and box queries.
+//Packet results and a part of single ray results are checked against
+//brute force intersection.
+//Usage: RaycastBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/Mesh.hpp"
+#include "data/MeshBVH.hpp"
+#include "math/AABB.hpp"
+#include "math/Vector3D.hpp"
+
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+using namespace hydra::data;
+using hydra::math::Vector3D;
+using hydra::math::AABB;
+
+typedef std::vector<MeshBVH> BVHCont;
+
+//random value in [-1, 1]
+static float getRandom(){
+    return 2.0f * std::rand() / RAND_MAX - 1.0f;
+}
+
+//closest hit over all the meshes (single rays)
+static float traceSingle(const BVHCont& inTrees, const Vector3D& inOrigin, const Vector3D& inDirection){
+    float closest = 1e30f;
+    BOOST_FOREACH(const MeshBVH& nextTree, inTrees){
+        MeshBVH::Hit hit;
+        if(nextTree.intersectRay(inOrigin, inDirection, hit, closest)) closest = hit.distance;
+    }
+    return closest;
+}
+
+//brute force closest hit (two-sided Moller-Trumbore in double precision)
+static float traceBruteForce(const Model& inModel, const Vector3D& inOrigin, const Vector3D& inDirection){
+    double closest = 1e30;
+    BOOST_FOREACH(const MeshPtr& nextMesh, inModel.mMeshes){
+        const size_t step = (nextMesh->mMode == Mesh::TRIANGLES)? 3: 1;
+        for(size_t i = 0; i + 2 < nextMesh->getIndexNum(); i += step){
+            const Vector3D a(nextMesh->mVertices[nextMesh->mIndices[i]].mCoord);
+            const Vector3D b(nextMesh->mVertices[nextMesh->mIndices[i + 1]].mCoord);
+            const Vector3D c(nextMesh->mVertices[nextMesh->mIndices[i + 2]].mCoord);
+            const Vector3D e1 = b - a, e2 = c - a;
+            const Vector3D p = inDirection.cross(e2);
+            const double det = e1 * p;
+            if(fabs(det) < 1e-20) continue;
+            const Vector3D s = inOrigin - a;
+            const double u = (s * p) / det;
+            const Vector3D q = s.cross(e1);
+            const double v = (inDirection * q) / det;
+            const double t = (e2 * q) / det;
+            if(u >= 0.0 && v >= 0.0 && u + v <= 1.0 && t > 0.0 && t < closest) closest = t;
+        }
+    }
+    return static_cast<float>(closest);
+}
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv, 256);
+    const unsigned int imageSize = 256;
+    const size_t randomRayNum = 65536;
+    const size_t checkedRayNum = 256;
+    const size_t queryNum = 16384;
+
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        const Model& model = *nextModel.model;
+        std::cout << "=== " << nextModel.name << ": " << model.mMeshes.size() << " meshes, "
+            << benchmark::getIndexNum(model) / 3 << " triangles" << std::endl;
+
+        //build with one thread and with all the threads
+        BVHCont trees;
+        for(int pass = 0; pass < 2; ++pass){
+            MeshBVH::Properties props;
+            props.threadNum = (pass == 0)? 1: 0;
+            trees.assign(model.mMeshes.size(), MeshBVH(props));
+            hydra::common::Timer timer;
+            timer.start();
+            for(size_t i = 0; i < trees.size(); ++i) trees[i].build(*model.mMeshes[i]);
+            const double time = timer.getMicroseconds() / 1e6;
+            size_t nodes = 0;
+            unsigned int depth = 0;
+            BOOST_FOREACH(const MeshBVH& nextTree, trees){
+                nodes += nextTree.getNodes().size();
+                depth = std::max(depth, nextTree.getDepth());
+            }
+            std::cout << "  build (" << (pass == 0? "1 thread": "all threads") << "): " << time * 1000.0 << " ms, "
+                << nodes << " nodes, depth " << depth << std::endl;
+        }
+
+        //bounds of model
+        Vector3D minCorner(1e30f, 1e30f, 1e30f), maxCorner(-1e30f, -1e30f, -1e30f);
+        BOOST_FOREACH(const MeshPtr& nextMesh, model.mMeshes){
+            AABB aabb = nextMesh->calcAABB();
+            Vector3D corner = aabb.getCorner(), opposite = aabb.getCorner() + aabb.getVector();
+            minCorner = Vector3D(std::min(minCorner.x(), corner.x()), std::min(minCorner.y(), corner.y()), std::min(minCorner.z(), corner.z()));
+            maxCorner = Vector3D(std::max(maxCorner.x(), opposite.x()), std::max(maxCorner.y(), opposite.y()), std::max(maxCorner.z(), opposite.z()));
+        }
+        const Vector3D center = (minCorner + maxCorner) * 0.5f;
+        const float radius = (maxCorner - minCorner).getMagnitude() * 0.5f;
+
+        //coherent rays: pinhole camera looking at the model, 2x2 pixel blocks form packets
+        std::vector<Vector3D> origins, directions;
+        const Vector3D eye = center + Vector3D(0.3f, 0.4f, 2.0f) * radius;
+        for(unsigned int y = 0; y < imageSize; y += 2){
+            for(unsigned int x = 0; x < imageSize; x += 2){
+                for(unsigned int k = 0; k < 4; ++k){
+                    float px = (x + k % 2 + 0.5f) / imageSize * 2.0f - 1.0f;
+                    float py = (y + k / 2 + 0.5f) / imageSize * 2.0f - 1.0f;
+                    Vector3D target = center + Vector3D(px, py, 0.0f) * radius;
+                    origins.push_back(eye);
+                    directions.push_back(target - eye);
+                }
+            }
+        }
+        const size_t coherentNum = origins.size();
+        //incoherent rays: from random points around the model to random points inside it
+        for(size_t i = 0; i < randomRayNum; ++i){
+            Vector3D from(getRandom(), getRandom(), getRandom());
+            if(from.getSquareMagnitude() > 0.0f) from.normalize();
+            from = center + from * (2.0f * radius);
+            Vector3D to = center + Vector3D(getRandom(), getRandom(), getRandom()) * (0.5f * radius);
+            origins.push_back(from);
+            directions.push_back(to - from);
+        }
+
+        for(int set = 0; set < 2; ++set){
+            const size_t begin = (set == 0)? 0: coherentNum;
+            const size_t num = (set == 0)? coherentNum: randomRayNum;
+            std::vector<float> single(num);
+            std::vector<MeshBVH::Hit> packet(num);
+            std::vector<float> closest(num, 1e30f);
+
+            hydra::common::Timer timer;
+            timer.start();
+            size_t hits = 0;
+            for(size_t i = 0; i < num; ++i){
+                single[i] = traceSingle(trees, origins[begin + i], directions[begin + i]);
+                if(single[i] < 1e30f) ++hits;
+            }
+            const double singleTime = timer.getMicroseconds() / 1e6;
+
+            timer.start();
+            BOOST_FOREACH(const MeshBVH& nextTree, trees){
+                nextTree.intersectRays(&origins[begin], &directions[begin], num, &packet[0]);
+                for(size_t i = 0; i < num; ++i) closest[i] = std::min(closest[i], packet[i].distance);
+            }
+            const double packetTime = timer.getMicroseconds() / 1e6;
+
+            size_t mismatches = 0;
+            for(size_t i = 0; i < num; ++i){
+                if(fabsf(closest[i] - single[i]) > 1e-4f * (1.0f + single[i])) ++mismatches;
+            }
+            size_t bruteMismatches = 0;
+            for(size_t i = 0; i < checkedRayNum; ++i){
+                const size_t ray = i * num / checkedRayNum;
+                float expected = traceBruteForce(model, origins[begin + ray], directions[begin + ray]);
+                if(fabsf(expected - single[ray]) > 1e-3f * (1.0f + expected)) ++bruteMismatches;
+            }
+
+            std::cout << "  " << (set == 0? "coherent  ": "incoherent") << " rays: " << num << ", hit " << hits
+                << " | single " << (singleTime > 0.0? num / singleTime / 1e6: 0.0) << " Mrays/s"
+                << " | packets " << (packetTime > 0.0? num / packetTime / 1e6: 0.0) << " Mrays/s"
+                << " | mismatches: packets " << mismatches << ", brute force " << bruteMismatches
+                << " of " << checkedRayNum << std::endl;
+        }
+
+        //segment tests (line of sight between random points)
+        {
+            hydra::common::Timer timer;
+            timer.start();
+            size_t blocked = 0;
+            for(size_t i = 0; i < queryNum; ++i){
+                Vector3D from = center + Vector3D(getRandom(), getRandom(), getRandom()) * radius;
+                Vector3D to = center + Vector3D(getRandom(), getRandom(), getRandom()) * radius;
+                BOOST_FOREACH(const MeshBVH& nextTree, trees){
+                    if(nextTree.testSegment(from, to)){
+                        ++blocked;
+                        break;
+                    }
+                }
+            }
+            const double time = timer.getMicroseconds() / 1e6;
+            std::cout << "  segments: " << queryNum << ", blocked " << blocked << " | "
+                << (time > 0.0? queryNum / time / 1e6: 0.0) << " Msegments/s" << std::endl;
+        }
+
+        //box queries (boxes of 1/10 of model size)
+        {
+            hydra::common::Timer timer;
+            timer.start();
+            size_t found = 0;
+            MeshBVH::TriangleIdCont triangles;
+            for(size_t i = 0; i < queryNum; ++i){
+                Vector3D corner = center + Vector3D(getRandom(), getRandom(), getRandom()) * (0.5f * radius);
+                AABB box(corner, Vector3D(0.1f, 0.1f, 0.1f) * radius);
+                BOOST_FOREACH(const MeshBVH& nextTree, trees){
+                    triangles.clear();
+                    found += nextTree.queryAABB(box, triangles);
+                }
+            }
+            const double time = timer.getMicroseconds() / 1e6;
+            std::cout << "  boxes: " << queryNum << ", " << found << " triangles found | "
+                << (time > 0.0? queryNum / time / 1e6: 0.0) << " Mqueries/s" << std::endl;
+        }
+    }
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,128 @@
+//SimplifyBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Generates levels of detail for models with MeshSimplifier and reports
+//simplification speed, number of triangles and error of each level and
+//number of triangles drawn at several distances (screen-space error selection).
+//Usage: SimplifyBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/Mesh.hpp"
+#include "data/MeshSimplifier.hpp"
+#include "math/AABB.hpp"
+
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace hydra::data;
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv, 128);
+
+    std::vector<float> ratios;
+    ratios.push_back(0.5f);
+    ratios.push_back(0.25f);
+    ratios.push_back(0.125f);
+    ratios.push_back(0.0625f);
+
+    //1080 pixels high viewport, 60 degrees vertical field of view
+    const float projectionScale = 1080.0f / (2.0f * tanf(3.14159265f / 6.0f));
+    const float maxPixelError = 1.0f;
+
+    MeshSimplifier simplifier;
+
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        const size_t triangles = benchmark::getIndexNum(*nextModel.model) / 3;
+        std::cout << "=== " << nextModel.name << ": " << nextModel.model->mMeshes.size() << " meshes, "
+            << triangles << " triangles" << std::endl;
+
+        float radius = 0.0f;
+        BOOST_FOREACH(const MeshPtr& nextMesh, nextModel.model->mMeshes){
+            radius = std::max(radius, nextMesh->calcAABB().getVector().getMagnitude() * 0.5f);
+        }
+
+        hydra::common::Timer timer;
+        timer.start();
+        BOOST_FOREACH(MeshPtr& nextMesh, nextModel.model->mMeshes) simplifier.generateLODs(*nextMesh, ratios);
+        const double time = timer.getMicroseconds() / 1e6;
+        std::cout << "  generated in " << time * 1000.0 << " ms (" << (time > 0.0? triangles / time / 1e6: 0.0)
+            << " Mtri/s of source)" << std::endl;
+
+        //sum over meshes; meshes with fewer levels use their coarsest one
+        bool invalid = false;
+        for(size_t level = 0; level <= ratios.size(); ++level){
+            size_t levelTriangles = 0;
+            float maxError = 0.0f;
+            BOOST_FOREACH(const MeshPtr& nextMesh, nextModel.model->mMeshes){
+                const size_t used = std::min(level, nextMesh->mLODs.size());
+                const IndexBuffer& indices = nextMesh->getLODIndices(used);
+                levelTriangles += indices.size() / 3;
+                if(used > 0) maxError = std::max(maxError, nextMesh->mLODs[used - 1].mError);
+                BOOST_FOREACH(Mesh::index_t nextIndex, indices){
+                    if(nextIndex >= nextMesh->getVertexNum()) invalid = true;
+                }
+            }
+            std::cout << "  level " << level << (level? " (target " : " (source")
+                << std::setw(7) << (level? ratios[level - 1]: 1.0f) << ")  triangles " << std::setw(8) << levelTriangles
+                << "  saved " << std::setw(6) << 100.0f * (1.0f - static_cast<float>(levelTriangles) / triangles) << " %"
+                << "  error " << std::setw(10) << maxError << " (" << std::setw(8) << (radius > 0.0f? 100.0f * maxError / radius: 0.0f)
+                << " % of radius)" << std::endl;
+        }
+        if(invalid){
+            std::cout << "  ERROR: levels of detail reference missing vertices" << std::endl;
+            return 1;
+        }
+
+        //distances are given in radii of model
+        const float distances[] = {2.0f, 8.0f, 32.0f, 128.0f, 512.0f};
+        for(size_t i = 0; i < sizeof(distances) / sizeof(distances[0]); ++i){
+            size_t drawn = 0;
+            BOOST_FOREACH(const MeshPtr& nextMesh, nextModel.model->mMeshes){
+                drawn += nextMesh->getLODIndices(nextMesh->selectLOD(distances[i] * radius, projectionScale, maxPixelError)).size() / 3;
+            }
+            std::cout << "  distance " << std::setw(4) << distances[i] << " radii: " << std::setw(8) << drawn
+                << " triangles drawn (1080p, 60 deg, " << maxPixelError << " px)" << std::endl;
+        }
+    }
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,250 @@
+//SkinningBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Compares CPU skinning of MeshSkinner with the skinning code of AnimationViewer
+//(all bone slots of vertex, Quat::rotate for each of them).
+//Models without bones get synthetic weights (up to 4 of 64 bones along Y axis).
+//Usage: SkinningBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/MeshSkinner.hpp"
+#include "data/BoneInfluences.hpp"
+#include "data/Mesh.hpp"
+#include "data/Model.hpp"
+#include "data/Skeleton.hpp"
+#include "data/Vertex.hpp"
+#include "math/Quat.hpp"
+#include "math/AABB.hpp"
+#include "common/ParallelFor.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+using namespace hydra::data;
+using hydra::math::Quat;
+using hydra::math::Vector3D;
+using hydra::math::AABB;
+
+//number of bones of synthetic skeleton
+const int SYNTHETIC_BONE_NUM = 64;
+
+//returns random float in [-1, 1]
+static float getRandom(){
+    return static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f;
+}
+
+//builds pose with random rotations and offsets of bones
+static void buildRandomPose(size_t inBoneNum, float inOffset, Skeleton& outPose){
+    outPose.mBones.resize(inBoneNum);
+    for(size_t i = 0; i < inBoneNum; ++i){
+        Vector3D axis(getRandom(), getRandom(), getRandom());
+        if(axis.getSquareMagnitude() < 1e-6f) axis = Vector3D(0.0f, 1.0f, 0.0f);
+        outPose.mBones[i].mOrient = Quat(getRandom() * 0.5f, axis.getUnit());
+        outPose.mBones[i].mPos = Vector3D(getRandom(), getRandom(), getRandom()) * inOffset;
+    }
+}
+
+//copy of mesh with weights of bones placed along Y axis
+static MeshPtr createSyntheticSkin(const Mesh& inMesh, const AABB& inBounds){
+    MeshPtr result(new Mesh(inMesh));
+    const size_t vertexNum = result->getVertexNum();
+    result->mBones.resize(vertexNum);
+    result->mBoneWeights.resize(vertexNum);
+    const float height = std::max(inBounds.getVector().y(), 1e-6f);
+    for(size_t i = 0; i < vertexNum; ++i){
+        result->mBones[i].assign(0);
+        result->mBoneWeights[i].assign(0.0f);
+
+        //linear falloff from bones placed at even distances
+        const float position = (result->mVertices[i].mCoord.y - inBounds.getCorner().y()) / height * (SYNTHETIC_BONE_NUM - 1);
+        const int first = std::max(0, std::min(SYNTHETIC_BONE_NUM - 4, static_cast<int>(position) - 1));
+        float sum = 0.0f;
+        for(int j = 0; j < 4; ++j){
+            const float weight = std::max(0.0f, 2.0f - fabsf(position - (first + j)));
+            result->mBones[i][j] = first + j;
+            result->mBoneWeights[i][j] = weight;
+            sum += weight;
+        }
+        for(int j = 0; j < 4; ++j) result->mBoneWeights[i][j] /= sum;
+    }
+    return result;
+}
+
+//port of AnimationViewer::updateGeometry
+static void skinReference(const Mesh& inMesh, const Skeleton& inPose, std::vector<Vertex>& outVertices){
+    for(size_t i = 0; i < inMesh.getVertexNum(); ++i){
+        Vector3D newPos;
+        outVertices[i].mNormal = Vector3D();
+        for(int j = 0; j < Mesh::MAX_BONES_PER_VERTEX; ++j){
+            Vector3D coord = inMesh.mVertices[i].mCoord;
+            Vector3D normRot = inMesh.mVertices[i].mNormal;
+            inPose.mBones[inMesh.mBones[i][j]].mOrient.rotate(normRot);
+            outVertices[i].mNormal += normRot * inMesh.mBoneWeights[i][j];
+            inPose.mBones[inMesh.mBones[i][j]].mOrient.rotate(coord);
+            newPos += ((inPose.mBones[inMesh.mBones[i][j]].mPos + coord) * inMesh.mBoneWeights[i][j]);
+        }
+        outVertices[i].mCoord.x = newPos.x();
+        outVertices[i].mCoord.y = newPos.y();
+        outVertices[i].mCoord.z = newPos.z();
+    }
+}
+
+//builds palette and skins mesh (palette is built every frame)
+static void skinWithSkinner(const MeshSkinner& inSkinner, const Skeleton& inPose, MeshSkinner::Palette& outPalette, std::vector<Vertex>& outVertices){
+    outPalette.build(inPose);
+    inSkinner.skin(outPalette, &outVertices[0]);
+}
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv, 512);
+    const unsigned int threadNum = hydra::common::getHardwareThreadNum();
+    int result = 0;
+
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        const Model& model = *nextModel.model;
+        const size_t vertexNum = benchmark::getVertexNum(model);
+        const bool synthetic = !model.mBindSkel;
+        const size_t boneNum = synthetic? SYNTHETIC_BONE_NUM: model.mBindSkel->mBones.size();
+        std::cout << "=== " << nextModel.name << ": " << vertexNum << " vertices, " << boneNum
+            << (synthetic? " synthetic bones": " bones") << std::endl;
+        if(!vertexNum) continue;
+
+        std::vector<MeshPtr> meshes;
+        BOOST_FOREACH(const MeshPtr& nextMesh, model.mMeshes){
+            meshes.push_back(synthetic? createSyntheticSkin(*nextMesh, model.getAABB()): nextMesh);
+        }
+
+        MeshSkinner::Properties singleProps;
+        singleProps.threadNum = 1;
+        std::vector<MeshSkinner> singleSkinners(meshes.size(), MeshSkinner(singleProps));
+        std::vector<MeshSkinner> skinners(meshes.size());
+        size_t truncated = 0;
+        float dropped = 0.0f;
+        for(size_t m = 0; m < meshes.size(); ++m){
+            singleSkinners[m].setup(*meshes[m]);
+            skinners[m].setup(*meshes[m]);
+            truncated += skinners[m].getTruncatedVertexNum();
+            dropped = std::max(dropped, skinners[m].getMaxDroppedWeight());
+        }
+        std::cout << "  vertices with more than " << MeshSkinner::MAX_INFLUENCES << " bones: " << truncated
+            << ", max dropped weight: " << dropped << std::endl;
+
+        const unsigned int poseNum = 10;
+        const unsigned int repeats = 5;
+        const float offset = model.getAABB().getVector().getMagnitude() * 0.05f;
+        double referenceTime = 0.0;
+        double singleTime = 0.0;
+        double parallelTime = 0.0;
+        float maxPosError = 0.0f;
+        float maxNormalError = 0.0f;
+        MeshSkinner::Palette palette;
+        srand(1);
+        for(unsigned int p = 0; p < poseNum; ++p){
+            Skeleton pose;
+            buildRandomPose(boneNum, offset, pose);
+            for(size_t m = 0; m < meshes.size(); ++m){
+                std::vector<Vertex> reference(meshes[m]->mVertices);
+                std::vector<Vertex> skinned(meshes[m]->mVertices);
+                if(reference.empty()) continue;
+                referenceTime += benchmark::measure(boost::bind(skinReference, boost::cref(*meshes[m]), boost::cref(pose), boost::ref(reference)), repeats);
+                singleTime += benchmark::measure(boost::bind(skinWithSkinner, boost::cref(singleSkinners[m]), boost::cref(pose), boost::ref(palette), boost::ref(skinned)), repeats);
+                parallelTime += benchmark::measure(boost::bind(skinWithSkinner, boost::cref(skinners[m]), boost::cref(pose), boost::ref(palette), boost::ref(skinned)), repeats);
+
+                for(size_t i = 0; i < reference.size(); ++i){
+                    maxPosError = std::max(maxPosError, (Vector3D(reference[i].mCoord) - Vector3D(skinned[i].mCoord)).getMagnitude());
+                    maxNormalError = std::max(maxNormalError, (reference[i].mNormal - skinned[i].mNormal).getMagnitude());
+                }
+            }
+        }
+
+        const double vertices = static_cast<double>(vertexNum) * poseNum;
+        std::cout << std::setprecision(4)
+            << "  viewer code:            " << std::setw(8) << vertices / referenceTime / 1e6 << " Mvert/s" << std::endl
+            << "  MeshSkinner, 1 thread:  " << std::setw(8) << vertices / singleTime / 1e6 << " Mvert/s ("
+            << referenceTime / singleTime << "x)" << std::endl
+            << "  MeshSkinner, " << threadNum << ((threadNum > 1)? " threads: ": " thread:  ") << std::setw(8) << vertices / parallelTime / 1e6 << " Mvert/s ("
+            << referenceTime / parallelTime << "x)" << std::endl
+            << "  max difference: position " << maxPosError << " (model size " << model.getAABB().getVector().getMagnitude()
+            << "), normal " << maxNormalError << std::endl;
+
+        //without truncation results must be the same up to rounding
+        if(!truncated && maxPosError > model.getAABB().getVector().getMagnitude() * 1e-4f) result = 1;
+
+        //compact influences against float ones (both are truncated to 4 bones)
+        const BoneInfluences::WeightType types[2] = {BoneInfluences::UNORM8, BoneInfluences::UNORM16};
+        const char* typeNames[2] = {"unorm8", "unorm16"};
+        for(int t = 0; t < 2; ++t){
+            size_t bytes = 0;
+            double droppedMass = 0.0;
+            float quantizationError = 0.0f;
+            float maxCompactError = 0.0f;
+            Skeleton pose;
+            buildRandomPose(boneNum, offset, pose);
+            palette.build(pose);
+            for(size_t m = 0; m < meshes.size(); ++m){
+                if(meshes[m]->mVertices.empty()) continue;
+                BoneInfluences influences;
+                influences.build(*meshes[m], types[t]);
+                bytes += influences.getDataSize();
+                droppedMass += influences.getReport().totalDroppedWeight;
+                quantizationError = std::max(quantizationError, influences.getReport().maxQuantizationError);
+
+                MeshSkinner compact;
+                compact.setup(*meshes[m], influences);
+                std::vector<Vertex> expected(meshes[m]->mVertices);
+                std::vector<Vertex> skinned(meshes[m]->mVertices);
+                skinners[m].skin(palette, &expected[0]);
+                compact.skin(palette, &skinned[0]);
+                for(size_t i = 0; i < expected.size(); ++i){
+                    maxCompactError = std::max(maxCompactError, (Vector3D(expected[i].mCoord) - Vector3D(skinned[i].mCoord)).getMagnitude());
+                }
+            }
+            const size_t sourceBytes = vertexNum * (sizeof(Mesh::BoneIndices) + sizeof(Mesh::BoneWeights));
+            std::cout << "  " << std::setw(7) << typeNames[t] << " influences: " << bytes << " bytes (" << sourceBytes << " in mesh), "
+                << "dropped mass " << droppedMass << " (" << droppedMass / vertexNum * 100.0 << "% per vertex), "
+                << "max weight error " << quantizationError << ", max position difference " << maxCompactError << std::endl;
+        }
+    }
+    return result;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,91 @@
+//TerrainBenchmarkUtils.hpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+
+#ifndef TERRAIN_BENCHMARK_UTILS_HPP__
+#define TERRAIN_BENCHMARK_UTILS_HPP__
+
+//Helpers shared by terrain benchmarks.
+//Height maps are generated, so benchmarks can be run without any data.
+
+#include "data/HeightMap.hpp"
+
+namespace benchmark{
+
+///returns pseudo-random value in [0, 1] for lattice point
+inline float getLatticeValue(unsigned int inX, unsigned int inY, unsigned int inSeed){
+    unsigned int hash = inX * 73856093u ^ inY * 19349663u ^ inSeed * 83492791u;
+    hash = (hash ^ (hash >> 13)) * 1274126177u;
+    return static_cast<float>(hash & 0xffff) / 0xffff;
+}
+
+///smoothly interpolated lattice noise
+inline float getNoise(float inX, float inY, unsigned int inSeed){
+    const unsigned int x = static_cast<unsigned int>(inX);
+    const unsigned int y = static_cast<unsigned int>(inY);
+    float fx = inX - x, fy = inY - y;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fy = fy * fy * (3.0f - 2.0f * fy);
+    const float bottom = getLatticeValue(x, y, inSeed) * (1.0f - fx) + getLatticeValue(x + 1, y, inSeed) * fx;
+    const float top = getLatticeValue(x, y + 1, inSeed) * (1.0f - fx) + getLatticeValue(x + 1, y + 1, inSeed) * fx;
+    return bottom * (1.0f - fy) + top * fy;
+}
+
+///\brief Builds height map with hills and small details (heights are in [0, 100]).
+///
+///Different seeds give different maps.
+inline hydra::data::HeightMapGen<float>* createHeightMap(unsigned int inSize, unsigned int inSeed = 0){
+    float* data = new float[inSize * inSize];
+    for(unsigned int i = 0; i < inSize; ++i){
+        for(unsigned int j = 0; j < inSize; ++j){
+            float height = 0.0f, amplitude = 50.0f, frequency = 4.0f / inSize;
+            for(unsigned int octave = 0; octave < 8; ++octave){
+                height += amplitude * getNoise(j * frequency, i * frequency, inSeed * 8 + octave);
+                amplitude *= 0.5f;
+                frequency *= 2.0f;
+            }
+            data[i * inSize + j] = height;
+        }
+    }
+    return new hydra::data::HeightMapGen<float>(inSize, data);
+}
+
+} //benchmark namespace
+
+#endif
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,182 @@
+//TerrainChunkCodecBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Compares storage of terrain chunk's indices: raw 16-bit indices, delta + zigzag +
+//varint encoding of hydra::data::IndexBuffer and hydra::data::TerrainChunkCodec.
+//Reports compression ratio and speed of encoding and decoding (decoding speed is
+//given in GB/s of decoded 16-bit indices). Fragments are generated.
+//Usage: TerrainChunkCodecBenchmark [size (2^n + 1), default 257] [fragments, default 4]
+
+#include "TerrainBenchmarkUtils.hpp"
+#include "rendering/TerrainPreprocessor.hpp"
+#include "data/TerrainChunkCodec.hpp"
+#include "data/TerrainFragment.hpp"
+#include "data/TerrainChunk.hpp"
+#include "data/IndexBuffer.hpp"
+#include "common/Timer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+using hydra::rendering::TerrainPreprocessor;
+using hydra::data::TerrainFragment;
+using hydra::data::TerrainFragmentPtr;
+using hydra::data::TerrainChunk;
+using hydra::data::TerrainChunkCodec;
+using hydra::data::IndexBuffer;
+using hydra::data::HeightMapGen;
+using hydra::common::Timer;
+
+//encoded chunks
+typedef std::vector<std::vector<unsigned char> > EncodedCont;
+
+//returns throughput in units per second
+inline double getSpeed(double inAmount, unsigned int inRepeats, Timer& inTimer){
+    const double seconds = inTimer.getMicroseconds() / 1e6;
+    return (seconds > 0.0) ? inAmount * inRepeats / seconds: 0.0;
+}
+
+inline size_t getSize(const EncodedCont& inEncoded){
+    size_t result = 0;
+    for(size_t i = 0; i < inEncoded.size(); ++i) result += inEncoded[i].size();
+    return result;
+}
+
+void printResult(const char* inName, size_t inRawBytes, size_t inBytes, double inEncodeSpeed, double inDecodeSpeed, bool inEqual){
+    std::cout << std::setw(16) << inName
+        << "  bytes " << std::setw(9) << inBytes
+        << std::fixed << std::setprecision(2) << "  ratio " << std::setw(5) << static_cast<double>(inRawBytes) / inBytes
+        << "  (" << std::setw(5) << std::setprecision(1) << 100.0 * inBytes / inRawBytes << "%)"
+        << "  encode " << std::setw(7) << inEncodeSpeed / (1024.0 * 1024.0) << " MB/s"
+        << "  decode " << std::setw(5) << std::setprecision(2) << inDecodeSpeed / (1024.0 * 1024.0 * 1024.0) << " GB/s"
+        << "  " << (inEqual? "data is equal": "DATA DIFFERS") << std::endl;
+}
+
+int main(int argc, char** argv){
+    const unsigned int size = (argc > 1)? atoi(argv[1]): 257;
+    const unsigned int fragmentNum = (argc > 2)? atoi(argv[2]): 4;
+    const unsigned int repeats = 20;
+    if(size < 5 || ((size - 1) & (size - 2)) != 0){
+        std::cerr << "size must be 2^n + 1" << std::endl;
+        return 1;
+    }
+
+    TerrainPreprocessor::Properties properties;
+    properties.numOfLODs = 4;
+    properties.maxError = 1.0f;
+    properties.LODErrorFactor = 0.5f;
+    properties.vertexLODFactor = 0.5f;
+    properties.generateSkirts = true;
+    TerrainPreprocessor preprocessor(properties);
+
+    //indices of all the chunks of all the fragments
+    std::vector<TerrainChunk::IndexCont> chunks;
+    size_t indexNum = 0;
+    for(unsigned int f = 0; f < fragmentNum; ++f){
+        HeightMapGen<float>* heights = benchmark::createHeightMap(size, f);
+        TerrainFragmentPtr fragment = preprocessor.process(*heights);
+        delete heights;
+
+        for(TerrainFragment::QuadTreeOfChunks::const_iterator iter = fragment->tree->begin(); iter != fragment->tree->end(); ++iter){
+            if(iter->data.ptr->indices.empty()) continue;
+            chunks.push_back(iter->data.ptr->indices);
+            indexNum += chunks.back().size();
+        }
+    }
+    const size_t RAW_BYTES = indexNum * sizeof(TerrainChunk::index_t);
+    std::cout << "=== " << fragmentNum << " fragments " << size << "x" << size << ", " << chunks.size() << " chunks, "
+        << indexNum << " indices, " << RAW_BYTES / 1024 << " KB" << std::endl;
+
+    Timer timer;
+
+    //delta + zigzag + varint
+    {
+        std::vector<IndexBuffer> buffers(chunks.size());
+        for(size_t i = 0; i < chunks.size(); ++i){
+            buffers[i].assign(IndexBuffer::IndexCont(chunks[i].begin(), chunks[i].end()));
+        }
+        EncodedCont encoded(chunks.size());
+        timer.start();
+        for(unsigned int r = 0; r < repeats; ++r){
+            for(size_t i = 0; i < chunks.size(); ++i){
+                encoded[i].clear();
+                buffers[i].encode(encoded[i]);
+            }
+        }
+        const double encodeSpeed = getSpeed(static_cast<double>(RAW_BYTES), repeats, timer);
+
+        std::vector<IndexBuffer> decoded(chunks.size());
+        timer.start();
+        for(unsigned int r = 0; r < repeats; ++r){
+            for(size_t i = 0; i < chunks.size(); ++i) decoded[i].decode(&encoded[i][0], encoded[i].size());
+        }
+        const double decodeSpeed = getSpeed(static_cast<double>(RAW_BYTES), repeats, timer);
+
+        bool equal = true;
+        for(size_t i = 0; i < chunks.size(); ++i) equal = equal && (decoded[i] == buffers[i]);
+        printResult("varint deltas", RAW_BYTES, getSize(encoded), encodeSpeed, decodeSpeed, equal);
+    }
+
+    //TerrainChunkCodec
+    {
+        EncodedCont encoded(chunks.size());
+        timer.start();
+        for(unsigned int r = 0; r < repeats; ++r){
+            for(size_t i = 0; i < chunks.size(); ++i){
+                encoded[i].clear();
+                TerrainChunkCodec::encode(&chunks[i][0], chunks[i].size(), encoded[i]);
+            }
+        }
+        const double encodeSpeed = getSpeed(static_cast<double>(RAW_BYTES), repeats, timer);
+
+        //output is allocated once, like in loader which decodes to chunk's container
+        std::vector<TerrainChunk::IndexCont> decoded(chunks.size());
+        for(size_t i = 0; i < chunks.size(); ++i) decoded[i].resize(chunks[i].size());
+        timer.start();
+        for(unsigned int r = 0; r < repeats; ++r){
+            for(size_t i = 0; i < chunks.size(); ++i) TerrainChunkCodec::decode(&encoded[i][0], encoded[i].size(), &decoded[i][0]);
+        }
+        const double decodeSpeed = getSpeed(static_cast<double>(RAW_BYTES), repeats, timer);
+
+        printResult("chunk codec", RAW_BYTES, getSize(encoded), encodeSpeed, decodeSpeed, decoded == chunks);
+    }
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,155 @@
+//TerrainChunkCodecTest.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Checks that hydra::data::TerrainChunkCodec is lossless for any sequence of
+//indices (incomplete triangles, random and extreme values) and rejects
+//truncated and corrupted data.
+//Returns non-zero if some check fails.
+
+#include "data/TerrainChunkCodec.hpp"
+#include "data/TerrainChunk.hpp"
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <cstdlib>
+
+using hydra::data::TerrainChunk;
+using hydra::data::TerrainChunkCodec;
+
+namespace{
+
+unsigned int gFailures = 0;
+
+void check(bool inCondition, const char* inWhat){
+    if(!inCondition){
+        std::cout << "FAILED: " << inWhat << std::endl;
+        ++gFailures;
+    }
+}
+
+///returns true if decoding of specified data throws std::runtime_error
+bool isRejected(const std::vector<unsigned char>& inData, size_t inSize){
+    TerrainChunk chunk;
+    try{
+        TerrainChunkCodec::decode(inData.empty()? 0: &inData[0], inSize, chunk);
+    }
+    catch(const std::runtime_error&){
+        return true;
+    }
+    return false;
+}
+
+void testRoundTrip(const TerrainChunk::IndexCont& inIndices, const char* inName){
+    TerrainChunk chunk;
+    chunk.indices = inIndices;
+
+    //encoded data is appended
+    std::vector<unsigned char> encoded(1, 0xab);
+    TerrainChunkCodec::encode(chunk, encoded);
+    check(encoded[0] == 0xab, "encode appends data");
+
+    TerrainChunk decoded;
+    const size_t read = TerrainChunkCodec::decode(&encoded[1], encoded.size() - 1, decoded);
+    check(read == encoded.size() - 1, "decode reads whole data");
+    check(decoded.indices == inIndices, inName);
+    check(TerrainChunkCodec::getIndexNum(&encoded[1], encoded.size() - 1) == inIndices.size(), "getIndexNum");
+
+    if(encoded.size() > 2){
+        check(isRejected(encoded, encoded.size() - 1), "truncated data is rejected");
+    }
+    std::cout << "  " << inName << ": " << inIndices.size() * sizeof(TerrainChunk::index_t) << " -> " << encoded.size() - 1 << " bytes" << std::endl;
+}
+
+} //unnamed namespace
+
+int main(){
+    TerrainChunk::IndexCont indices;
+    testRoundTrip(indices, "empty");
+    for(unsigned int i = 0; i < 5; ++i){
+        indices.push_back(static_cast<TerrainChunk::index_t>(i * 1000));
+        testRoundTrip(indices, "incomplete triangles");
+    }
+
+    //strip-like triangles on grid (each triangle shares an edge with the previous one)
+    indices.clear();
+    const unsigned int WIDTH = 65;
+    for(unsigned int row = 0; row + 1 < WIDTH; ++row){
+        for(unsigned int column = 0; column + 1 < WIDTH; ++column){
+            const TerrainChunk::index_t corner = static_cast<TerrainChunk::index_t>(row * WIDTH + column);
+            indices.push_back(corner);
+            indices.push_back(static_cast<TerrainChunk::index_t>(corner + WIDTH));
+            indices.push_back(static_cast<TerrainChunk::index_t>(corner + 1));
+            indices.push_back(static_cast<TerrainChunk::index_t>(corner + 1));
+            indices.push_back(static_cast<TerrainChunk::index_t>(corner + WIDTH));
+            indices.push_back(static_cast<TerrainChunk::index_t>(corner + WIDTH + 1));
+        }
+    }
+    testRoundTrip(indices, "grid");
+
+    //random and extreme values (differences wrap around)
+    srand(1);
+    for(unsigned int tail = 0; tail < 3; ++tail){
+        indices.clear();
+        for(unsigned int i = 0; i < 3000 + tail; ++i){
+            switch(rand() % 4){
+                case 0: indices.push_back(0); break;
+                case 1: indices.push_back(65535); break;
+                default: indices.push_back(static_cast<TerrainChunk::index_t>(rand() & 0xffff)); break;
+            }
+        }
+        testRoundTrip(indices, "random");
+    }
+
+    //number of literals which doesn't match codes
+    std::vector<unsigned char> corrupted;
+    indices.assign(6, 7);
+    TerrainChunkCodec::encode(&indices[0], indices.size(), corrupted);
+    corrupted[1] = 2;
+    check(isRejected(corrupted, corrupted.size()), "corrupted number of literals is rejected");
+    corrupted[1] = 7;
+    check(isRejected(corrupted, corrupted.size()), "too many literals are rejected");
+
+    if(gFailures){
+        std::cout << gFailures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all checks passed" << std::endl;
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
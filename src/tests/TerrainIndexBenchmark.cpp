@@ -0,0 +1,222 @@
+//TerrainIndexBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Measures latency of building fragment's quad tree of chunks from XML metadata
+//(as terrain loaders did: read .tfmeta, parse it and walk DOM) and from binary
+//index (hydra::loading::TerrainIndex) and checks that trees are equal.
+//Directory must be produced by LandscapePreprocessor with 'p' and 'x' options,
+//so it has both main.index and XML metadata.
+//Usage: TerrainIndexBenchmark <terrain directory> [repeats, default 5]
+
+#include "loading/TerrainIndex.hpp"
+#include "data/TerrainFragment.hpp"
+#include "common/Timer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#include "pugixml.hpp"
+
+using hydra::loading::TerrainIndex;
+using hydra::data::TerrainFragment;
+using hydra::data::TerrainFragmentId;
+using hydra::common::Timer;
+
+typedef TerrainFragment::QuadTreeOfChunksPtr QTreePtr;
+
+//what loader needs besides the tree
+struct FragmentMeta{
+    std::vector<unsigned int> indexNums;
+    std::vector<unsigned int> vertexNums;
+};
+
+//reads whole file
+std::string readFile(const std::string& inPath){
+    std::ifstream file(inPath.c_str(), std::ios::binary);
+    if(!file) throw std::runtime_error("can't open " + inPath);
+    std::ostringstream result;
+    result << file.rdbuf();
+    return result.str();
+}
+
+//same as loader's traversal of fragment's metadata
+void traverseFragmentMeta(QTreePtr tree, const pugi::xml_node& xmlNode, FragmentMeta& meta){
+    TerrainFragment::ChunkData chunkData;
+    chunkData.vertices = xmlNode.attribute("vertex_level").as_uint();
+    chunkData.maxError = xmlNode.attribute("max_error").as_float();
+    chunkData.level = xmlNode.attribute("index_level").as_uint();
+    const unsigned int position = xmlNode.attribute("position").as_uint();
+    meta.indexNums.at(position) = xmlNode.attribute("indices_num").as_uint();
+
+    pugi::xml_node aabbNode = xmlNode.child("aabb");
+    hydra::math::Vector3D corner(aabbNode.child("corner").attribute("x").as_float(), 
+                                 aabbNode.child("corner").attribute("y").as_float(),
+                                 aabbNode.child("corner").attribute("z").as_float());
+    hydra::math::Vector3D vector(aabbNode.child("vector").attribute("x").as_float(), 
+                                 aabbNode.child("vector").attribute("y").as_float(),
+                                 aabbNode.child("vector").attribute("z").as_float());
+    chunkData.aabb = hydra::math::AABB(corner, vector);
+    chunkData.status = TerrainFragment::UNLOADED;
+    tree->getNode(position).data = chunkData;
+
+    for(pugi::xml_node_iterator iter = xmlNode.begin(); iter != xmlNode.end(); ++iter){
+        if(std::string(iter->name()) == "quad") traverseFragmentMeta(tree, *iter, meta);
+    }
+}
+
+//loads fragment's metadata from XML file
+QTreePtr loadFromXML(const std::string& inPath, FragmentMeta& outMeta){
+    const std::string text = readFile(inPath);
+    pugi::xml_document document;
+    if(!document.load_buffer(text.data(), text.size())) throw std::runtime_error("can't parse " + inPath);
+
+    pugi::xml_node root = document.child("terrain_fragment");
+    pugi::xml_node descr = root.child("description");
+    const unsigned int ilodNum = descr.child("index_lods").attribute("number").as_uint();
+    const unsigned int vlodNum = descr.child("vertex_lods").attribute("number").as_uint();
+
+    QTreePtr tree(new TerrainFragment::QuadTreeOfChunks(ilodNum));
+    outMeta.indexNums.resize(tree->end() - tree->begin());
+    outMeta.vertexNums.resize(vlodNum);
+    traverseFragmentMeta(tree, root.child("quad"), outMeta);
+
+    for(pugi::xml_node node = root.child("vertex_lod"); node; node = node.next_sibling("vertex_lod")){
+        outMeta.vertexNums.at(node.attribute("level").as_uint()) = node.attribute("vertex_number").as_uint();
+    }
+    return tree;
+}
+
+//loads fragment's metadata from index
+QTreePtr loadFromIndex(const TerrainIndex& inIndex, TerrainFragmentId inId, FragmentMeta& outMeta){
+    const unsigned int CHUNK_NUM = inIndex.getChunkNum(inId);
+    const TerrainIndex::ChunkRecord* chunks = inIndex.getChunks(inId);
+    outMeta.indexNums.resize(CHUNK_NUM);
+    for(unsigned int i = 0; i < CHUNK_NUM; ++i) outMeta.indexNums[i] = chunks[i].indexNum;
+
+    const boost::uint32_t* vertexNums = inIndex.getVertexNums(inId);
+    outMeta.vertexNums.assign(vertexNums, vertexNums + inIndex.getVertexLODNum(inId));
+    return inIndex.createTree(inId);
+}
+
+//XML keeps 6 significant digits of floats
+inline bool isClose(float inFirst, float inSecond){
+    return fabs(inFirst - inSecond) <= 1e-5f * std::max(1.0f, fabs(inFirst));
+}
+
+bool isEqual(const QTreePtr& inXMLTree, const FragmentMeta& inXMLMeta, const QTreePtr& inIndexTree, const FragmentMeta& inIndexMeta){
+    if(inXMLMeta.indexNums != inIndexMeta.indexNums || inXMLMeta.vertexNums != inIndexMeta.vertexNums) return false;
+    if(inXMLTree->getResolution() != inIndexTree->getResolution()) return false;
+    for(unsigned int i = 0; i < inXMLMeta.indexNums.size(); ++i){
+        const TerrainFragment::ChunkData& first = inXMLTree->getNode(i).data;
+        const TerrainFragment::ChunkData& second = inIndexTree->getNode(i).data;
+        if(first.vertices != second.vertices || first.level != second.level || !isClose(first.maxError, second.maxError)) return false;
+        const hydra::math::Vector3D& corner1 = first.aabb.getCorner();
+        const hydra::math::Vector3D& corner2 = second.aabb.getCorner();
+        const hydra::math::Vector3D& vector1 = first.aabb.getVector();
+        const hydra::math::Vector3D& vector2 = second.aabb.getVector();
+        if(!isClose(corner1.x(), corner2.x()) || !isClose(corner1.y(), corner2.y()) || !isClose(corner1.z(), corner2.z()) ||
+           !isClose(vector1.x(), vector2.x()) || !isClose(vector1.y(), vector2.y()) || !isClose(vector1.z(), vector2.z())) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    if(argc < 2){
+        std::cerr << "Usage: TerrainIndexBenchmark <terrain directory> [repeats, default 5]" << std::endl;
+        return 1;
+    }
+    const std::string dir = argv[1];
+    const unsigned int repeats = (argc > 2)? atoi(argv[2]): 5;
+
+    try{
+        Timer timer;
+        timer.start();
+        std::ifstream indexFile((dir + "/main.index").c_str(), std::ios::binary);
+        if(!indexFile) throw std::runtime_error("can't open " + dir + "/main.index");
+        TerrainIndex index(indexFile);
+        const double openTime = timer.getMicroseconds() / 1e6;
+
+        const unsigned int FRAGMENT_NUM = index.getFragmentNum();
+        std::cout << "=== " << FRAGMENT_NUM << " fragments, index read in " << std::fixed << std::setprecision(3)
+            << openTime * 1000.0 << " ms" << std::endl;
+
+        double xmlTime = 0.0;
+        double indexTime = 0.0;
+        bool equal = true;
+        for(unsigned int r = 0; r < repeats; ++r){
+            for(unsigned int i = 0; i < FRAGMENT_NUM; ++i){
+                const TerrainFragmentId id = index.getFragmentId(i);
+                std::ostringstream name;
+                name << dir << '/' << id.getX() << '_' << id.getY() << '/' << id.getX() << '_' << id.getY() << ".tfmeta";
+
+                FragmentMeta xmlMeta;
+                FragmentMeta indexMeta;
+
+                timer.start();
+                QTreePtr xmlTree = loadFromXML(name.str(), xmlMeta);
+                xmlTime += timer.getMicroseconds() / 1e6;
+
+                timer.start();
+                QTreePtr indexTree = loadFromIndex(index, id, indexMeta);
+                indexTime += timer.getMicroseconds() / 1e6;
+
+                equal = equal && isEqual(xmlTree, xmlMeta, indexTree, indexMeta);
+            }
+        }
+
+        const unsigned int LOADS = FRAGMENT_NUM * repeats;
+        std::cout << "  xml    " << std::setw(9) << xmlTime * 1e6 / LOADS << " us/fragment" << std::endl;
+        std::cout << "  index  " << std::setw(9) << indexTime * 1e6 / LOADS << " us/fragment  ("
+            << std::setprecision(1) << xmlTime / indexTime << "x faster)" << std::endl;
+        std::cout << (equal? "trees are equal": "TREES DIFFER") << std::endl;
+        return equal? 0: 1;
+    }
+    catch(const std::runtime_error& e){
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
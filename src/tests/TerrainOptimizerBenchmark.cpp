@@ -0,0 +1,145 @@
+//TerrainOptimizerBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Measures scaling of TerrainOptimizer with number of threads on a single
+//big fragment and checks that results don't depend on number of threads.
+//Height map is generated (sum of octaves of value noise).
+//Usage: TerrainOptimizerBenchmark [size (2^n + 1), default 4097] [max threads]
+
+#include "TerrainBenchmarkUtils.hpp"
+#include "rendering/TerrainOptimizer.hpp"
+#include "data/HeightMap.hpp"
+#include "common/ParallelFor.hpp"
+#include "common/Timer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+using hydra::rendering::TerrainOptimizer;
+using hydra::data::HeightMapGen;
+using hydra::common::Timer;
+
+//prints time and speedup
+static void report(const char* inName, double inSeconds, double inSingleSeconds){
+    std::cout << std::setw(24) << inName << ": " << std::setw(9) << std::fixed << std::setprecision(1) << inSeconds * 1000.0 << " ms"
+        << "  (x" << std::setprecision(2) << (inSeconds > 0.0? inSingleSeconds / inSeconds: 0.0) << ")" << std::endl;
+}
+
+int main(int argc, char** argv){
+    const unsigned int size = (argc > 1)? atoi(argv[1]): 4097;
+    const unsigned int maxThreadNum = (argc > 2)? std::max(1, atoi(argv[2])): hydra::common::getHardwareThreadNum();
+    if(size < 5 || ((size - 1) & (size - 2)) != 0){
+        std::cerr << "size must be 2^n + 1" << std::endl;
+        return 1;
+    }
+
+    Timer timer;
+    timer.start();
+    HeightMapGen<float>* heights = benchmark::createHeightMap(size);
+    std::cout << "=== " << size << "x" << size << " height map generated in " << timer.getMicroseconds() / 1000 << " ms" << std::endl;
+
+    timer.start();
+    TerrainOptimizer optimizer(*heights);
+    std::cout << "=== optimizer built in " << timer.getMicroseconds() / 1000 << " ms" << std::endl;
+
+    const float errors[] = {4.0f, 1.0f, 0.25f};
+    const size_t errorNum = sizeof(errors) / sizeof(errors[0]);
+    std::vector<int> chunk(2, 0);
+    chunk[1] = 3;
+
+    std::vector<unsigned int> threadNums;
+    for(unsigned int threads = 1; threads < maxThreadNum; threads *= 2) threadNums.push_back(threads);
+    threadNums.push_back(maxThreadNum);
+
+    int result = 0;
+    std::vector<std::vector<unsigned int> > expected(errorNum);
+    std::vector<unsigned int> expectedChunk;
+    double singleErrors = 0.0, singleFlags = 0.0, singleTriangulation = 0.0;
+    for(size_t t = 0; t < threadNums.size(); ++t){
+        const unsigned int threads = threadNums[t];
+        optimizer.setThreadNum(threads);
+        std::cout << "--- " << threads << " thread(s)" << std::endl;
+
+        timer.start();
+        optimizer.rebuild(*heights);
+        const double errorTime = timer.getMicroseconds() / 1e6;
+
+        double flagTime = 0.0, triangulationTime = 0.0;
+        size_t triangleNum = 0;
+        bool same = true;
+        for(size_t e = 0; e < errorNum; ++e){
+            timer.start();
+            optimizer.generateLOD(errors[e]);
+            flagTime += timer.getMicroseconds() / 1e6;
+
+            timer.start();
+            std::vector<unsigned int> indices = optimizer.getTriangulation();
+            triangulationTime += timer.getMicroseconds() / 1e6;
+            triangleNum += indices.size() / 3;
+
+            if(t == 0) expected[e].swap(indices);
+            else same = same && (indices == expected[e]);
+        }
+        //chunk of the last LOD
+        std::vector<unsigned int> chunkIndices = optimizer.getTriangulation(chunk);
+        if(t == 0) expectedChunk.swap(chunkIndices);
+        else same = same && (chunkIndices == expectedChunk);
+
+        if(t == 0){
+            singleErrors = errorTime;
+            singleFlags = flagTime;
+            singleTriangulation = triangulationTime;
+        }
+        report("errors (rebuild)", errorTime, singleErrors);
+        report("enable flags (3 LODs)", flagTime, singleFlags);
+        report("triangulation (3 LODs)", triangulationTime, singleTriangulation);
+        report("total", errorTime + flagTime + triangulationTime, singleErrors + singleFlags + singleTriangulation);
+        std::cout << std::setw(24) << "triangles" << ": " << triangleNum << " (" << expectedChunk.size() / 3 << " in chunk)" << std::endl;
+        if(!same){
+            std::cout << "FAILED: results differ from results of 1 thread" << std::endl;
+            result = 1;
+        }
+    }
+
+    delete heights;
+    return result;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
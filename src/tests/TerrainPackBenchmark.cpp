@@ -0,0 +1,291 @@
+//TerrainPackBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Compares reading of preprocessed terrain fragments stored with file per chunk
+//and per vertex LOD (as LandscapePreprocessor saves them by default) and stored
+//in single pack per fragment (hydra::loading::TerrainPack) with raw and with
+//compressed indices of chunks.
+//Fragments are generated, written to specified directory and read back several
+//times, read data is compared with original one. Files are removed at the end.
+//Note: files are read from the system cache, so costs of opening files and of
+//system calls are measured, not the speed of disk.
+//Usage: TerrainPackBenchmark [directory, default .] [fragments, default 16] [size (2^n + 1), default 257]
+
+#include "TerrainBenchmarkUtils.hpp"
+#include "loading/TerrainPack.hpp"
+#include "rendering/TerrainPreprocessor.hpp"
+#include "data/TerrainFragment.hpp"
+#include "data/TerrainChunk.hpp"
+#include "common/Timer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using hydra::loading::TerrainPack;
+using hydra::rendering::TerrainPreprocessor;
+using hydra::data::TerrainFragment;
+using hydra::data::TerrainFragmentPtr;
+using hydra::data::TerrainChunk;
+using hydra::data::HeightMapGen;
+using hydra::common::Timer;
+
+//data read from files
+struct ReadData{
+    std::vector<TerrainChunk::IndexCont> chunks;
+    std::vector<TerrainFragment::VertexCont> vertexLODs;
+};
+
+//returns number of chunks (nodes of quad tree) of fragment
+inline unsigned int getChunkNum(const TerrainFragment& inFragment){
+    return static_cast<unsigned int>(inFragment.tree->end() - inFragment.tree->begin());
+}
+
+std::string getChunkFilename(const std::string& inDir, unsigned int inFragment, unsigned int inPosition){
+    std::ostringstream result;
+    result << inDir << "/chunk_" << inFragment << '_' << inPosition << ".bin";
+    return result.str();
+}
+
+std::string getVertexLODFilename(const std::string& inDir, unsigned int inFragment, unsigned int inLevel){
+    std::ostringstream result;
+    result << inDir << "/vlod_" << inFragment << '_' << inLevel << ".bin";
+    return result.str();
+}
+
+std::string getPackFilename(const std::string& inDir, unsigned int inFragment, bool inCompressed){
+    std::ostringstream result;
+    result << inDir << "/fragment_" << inFragment << (inCompressed? "": "_raw") << ".tfpack";
+    return result.str();
+}
+
+//writes fragment with file per chunk and per vertex LOD, returns number of files
+size_t writeFiles(const TerrainFragment& inFragment, const std::string& inDir, unsigned int inFragmentNum){
+    size_t files = 0;
+    unsigned int position = 0;
+    for(TerrainFragment::QuadTreeOfChunks::const_iterator iter = inFragment.tree->begin(); iter != inFragment.tree->end(); ++iter, ++position){
+        const TerrainChunk::IndexCont& indices = iter->data.ptr->indices;
+        if(indices.empty()) continue;
+        std::ofstream file(getChunkFilename(inDir, inFragmentNum, position).c_str(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&indices[0]), indices.size() * sizeof(TerrainChunk::index_t));
+        ++files;
+    }
+    std::vector<char> data;
+    for(unsigned int i = 0; i < inFragment.vertexLODs.size(); ++i){
+        const TerrainFragment::VertexCont& vertices = inFragment.vertexLODs[i];
+        data.resize(vertices.size() * TerrainPack::VERTEX_SIZE);
+        if(!vertices.empty()) TerrainPack::encodeVertices(&vertices[0], vertices.size(), &data[0]);
+        std::ofstream file(getVertexLODFilename(inDir, inFragmentNum, i).c_str(), std::ios::binary);
+        file.write(&data[0], data.size());
+        ++files;
+    }
+    return files;
+}
+
+//reads fragment written by writeFiles (sizes are known from meta data in real loader)
+void readFiles(const TerrainFragment& inMeta, const std::string& inDir, unsigned int inFragmentNum, ReadData& outData){
+    outData.chunks.resize(getChunkNum(inMeta));
+    outData.vertexLODs.resize(inMeta.vertexLODs.size());
+
+    unsigned int position = 0;
+    for(TerrainFragment::QuadTreeOfChunks::const_iterator iter = inMeta.tree->begin(); iter != inMeta.tree->end(); ++iter, ++position){
+        TerrainChunk::IndexCont& indices = outData.chunks[position];
+        indices.resize(iter->data.ptr->indices.size());
+        if(indices.empty()) continue;
+        std::ifstream file(getChunkFilename(inDir, inFragmentNum, position).c_str(), std::ios::binary);
+        file.read(reinterpret_cast<char*>(&indices[0]), indices.size() * sizeof(TerrainChunk::index_t));
+    }
+    std::vector<char> data;
+    for(unsigned int i = 0; i < inMeta.vertexLODs.size(); ++i){
+        TerrainFragment::VertexCont& vertices = outData.vertexLODs[i];
+        vertices.resize(inMeta.vertexLODs[i].size());
+        data.resize(vertices.size() * TerrainPack::VERTEX_SIZE);
+        std::ifstream file(getVertexLODFilename(inDir, inFragmentNum, i).c_str(), std::ios::binary);
+        file.read(&data[0], data.size());
+        if(!vertices.empty()) TerrainPack::decodeVertices(&data[0], vertices.size(), &vertices[0]);
+    }
+}
+
+//reads fragment's pack
+void readPack(const std::string& inDir, unsigned int inFragmentNum, bool inCompressed, ReadData& outData){
+    TerrainPack pack(getPackFilename(inDir, inFragmentNum, inCompressed));
+    outData.chunks.resize(pack.getChunkNum());
+    outData.vertexLODs.resize(pack.getVertexLODNum());
+
+    TerrainChunk chunk;
+    for(unsigned int i = 0; i < pack.getChunkNum(); ++i){
+        pack.readChunk(i, chunk);
+        outData.chunks[i].swap(chunk.indices);
+    }
+    for(unsigned int i = 0; i < pack.getVertexLODNum(); ++i) pack.readVertexLOD(i, outData.vertexLODs[i]);
+}
+
+//compares read data with original fragment
+bool isEqual(const TerrainFragment& inFragment, const ReadData& inData){
+    unsigned int position = 0;
+    for(TerrainFragment::QuadTreeOfChunks::const_iterator iter = inFragment.tree->begin(); iter != inFragment.tree->end(); ++iter, ++position){
+        if(iter->data.ptr->indices != inData.chunks.at(position)) return false;
+    }
+    if(inFragment.vertexLODs.size() != inData.vertexLODs.size()) return false;
+    for(size_t i = 0; i < inFragment.vertexLODs.size(); ++i){
+        const TerrainFragment::VertexCont& original = inFragment.vertexLODs[i];
+        const TerrainFragment::VertexCont& read = inData.vertexLODs[i];
+        if(original.size() != read.size()) return false;
+        for(size_t j = 0; j < original.size(); ++j){
+            if(original[j].x != read[j].x || original[j].z != read[j].z || original[j].y != read[j].y ||
+               original[j].normalX != read[j].normalX || original[j].normalZ != read[j].normalZ) return false;
+        }
+    }
+    return true;
+}
+
+void printResult(const char* inName, size_t inFiles, size_t inBytes, size_t inChunks, double inSeconds, bool inEqual){
+    std::cout << std::setw(10) << inName
+        << "  files " << std::setw(7) << inFiles
+        << "  time " << std::setw(8) << std::fixed << std::setprecision(1) << inSeconds * 1000.0 << " ms"
+        << "  " << std::setw(8) << inBytes / inSeconds / (1024.0 * 1024.0) << " MB/s"
+        << "  " << std::setw(9) << std::setprecision(0) << inChunks / inSeconds << " chunks/s"
+        << "  " << (inEqual? "data is equal": "DATA DIFFERS") << std::endl;
+}
+
+int main(int argc, char** argv){
+    const std::string dir = (argc > 1)? argv[1]: ".";
+    const unsigned int fragmentNum = (argc > 2)? atoi(argv[2]): 16;
+    const unsigned int size = (argc > 3)? atoi(argv[3]): 257;
+    const unsigned int repeats = 5;
+    if(size < 5 || ((size - 1) & (size - 2)) != 0){
+        std::cerr << "size must be 2^n + 1" << std::endl;
+        return 1;
+    }
+
+    TerrainPreprocessor::Properties properties;
+    properties.numOfLODs = 4;
+    properties.maxError = 8.0f;
+    properties.LODErrorFactor = 0.25f;
+    properties.vertexLODFactor = 0.5f;
+    properties.generateSkirts = true;
+    TerrainPreprocessor preprocessor(properties);
+
+    //generate and write fragments
+    std::vector<TerrainFragmentPtr> fragments;
+    size_t files = 0;
+    size_t bytes = 0;
+    size_t chunks = 0;
+    size_t packBytes = 0;
+    size_t rawPackBytes = 0;
+    for(unsigned int i = 0; i < fragmentNum; ++i){
+        HeightMapGen<float>* heights = benchmark::createHeightMap(size, i);
+        fragments.push_back(preprocessor.process(*heights));
+        delete heights;
+
+        const TerrainFragment& fragment = *fragments.back();
+        files += writeFiles(fragment, dir, i);
+        for(TerrainFragment::QuadTreeOfChunks::const_iterator iter = fragment.tree->begin(); iter != fragment.tree->end(); ++iter){
+            bytes += iter->data.ptr->indices.size() * sizeof(TerrainChunk::index_t);
+            ++chunks;
+        }
+        for(size_t j = 0; j < fragment.vertexLODs.size(); ++j) bytes += fragment.vertexLODs[j].size() * TerrainPack::VERTEX_SIZE;
+
+        std::ofstream pack(getPackFilename(dir, i, true).c_str(), std::ios::binary);
+        std::ofstream rawPack(getPackFilename(dir, i, false).c_str(), std::ios::binary);
+        TerrainPack::write(fragment, pack);
+        TerrainPack::write(fragment, rawPack, false);
+        if(!pack || !rawPack){
+            std::cerr << "can't write to " << dir << std::endl;
+            return 1;
+        }
+        packBytes += static_cast<size_t>(pack.tellp());
+        rawPackBytes += static_cast<size_t>(rawPack.tellp());
+    }
+    std::cout << "=== " << fragmentNum << " fragments " << size << "x" << size << ", " << chunks << " chunks, "
+        << bytes / 1024 << " KB of data (" << rawPackBytes / 1024 << " KB in raw packs, "
+        << packBytes / 1024 << " KB in packs)" << std::endl;
+
+    //read
+    bool filesEqual = true;
+    bool packEqual = true;
+    bool rawPackEqual = true;
+    double filesTime = 0.0;
+    double packTime = 0.0;
+    double rawPackTime = 0.0;
+    for(unsigned int r = 0; r < repeats; ++r){
+        for(unsigned int i = 0; i < fragmentNum; ++i){
+            ReadData fromFiles;
+            ReadData fromPack;
+            ReadData fromRawPack;
+
+            Timer timer;
+            timer.start();
+            readFiles(*fragments[i], dir, i, fromFiles);
+            filesTime += timer.getMicroseconds() / 1e6;
+
+            timer.start();
+            readPack(dir, i, false, fromRawPack);
+            rawPackTime += timer.getMicroseconds() / 1e6;
+
+            timer.start();
+            readPack(dir, i, true, fromPack);
+            packTime += timer.getMicroseconds() / 1e6;
+
+            filesEqual = filesEqual && isEqual(*fragments[i], fromFiles);
+            rawPackEqual = rawPackEqual && isEqual(*fragments[i], fromRawPack);
+            packEqual = packEqual && isEqual(*fragments[i], fromPack);
+        }
+    }
+
+    printResult("per file", files, bytes * repeats, chunks * repeats, filesTime, filesEqual);
+    printResult("raw pack", fragmentNum, bytes * repeats, chunks * repeats, rawPackTime, rawPackEqual);
+    printResult("pack", fragmentNum, bytes * repeats, chunks * repeats, packTime, packEqual);
+
+    //clean up
+    for(unsigned int i = 0; i < fragmentNum; ++i){
+        const TerrainFragment& fragment = *fragments[i];
+        for(unsigned int j = 0; j < getChunkNum(fragment); ++j) std::remove(getChunkFilename(dir, i, j).c_str());
+        for(unsigned int j = 0; j < fragment.vertexLODs.size(); ++j) std::remove(getVertexLODFilename(dir, i, j).c_str());
+        std::remove(getPackFilename(dir, i, true).c_str());
+        std::remove(getPackFilename(dir, i, false).c_str());
+    }
+    return (filesEqual && packEqual && rawPackEqual)? 0: 1;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,206 @@
+//TerrainPreprocessorBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Measures time of TerrainPreprocessor::process for different numbers of LODs.
+//Height maps of fragments are generated. Checksum of results is printed,
+//so results of different versions may be compared.
+//Then the same height maps quantized to 16 and 8 bits are processed
+//with fixed errors to show how precision of input affects number of triangles.
+//Usage: TerrainPreprocessorBenchmark [size (2^n + 1), default 257] [fragments, default 4] [max LODs, default 6]
+
+#include "TerrainBenchmarkUtils.hpp"
+#include "rendering/TerrainPreprocessor.hpp"
+#include "data/TerrainFragment.hpp"
+#include "data/TerrainChunk.hpp"
+#include "data/HeightMap.hpp"
+#include "common/Timer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using hydra::rendering::TerrainPreprocessor;
+using hydra::data::TerrainFragment;
+using hydra::data::TerrainFragmentPtr;
+using hydra::data::HeightMapGen;
+using hydra::common::Timer;
+
+//statistics of processed fragments
+struct FragmentStats{
+    FragmentStats(): chunks(0), triangles(0), vertices(0), checksum(0){
+
+    }
+
+    //adds fragment's data
+    void add(const TerrainFragment& inFragment){
+        for(TerrainFragment::QuadTreeOfChunks::const_iterator iter = inFragment.tree->begin(); iter != inFragment.tree->end(); ++iter){
+            ++chunks;
+            triangles += iter->data.ptr->indices.size() / 3;
+            for(size_t i = 0; i < iter->data.ptr->indices.size(); ++i) mix(iter->data.ptr->indices[i]);
+            mix(iter->data.vertices);
+        }
+        for(size_t lod = 0; lod < inFragment.vertexLODs.size(); ++lod){
+            const TerrainFragment::VertexCont& next = inFragment.vertexLODs[lod];
+            vertices += next.size();
+            for(size_t i = 0; i < next.size(); ++i){
+                unsigned int height;
+                memcpy(&height, &next[i].y, sizeof(height));
+                mix(next[i].x);
+                mix(next[i].z);
+                mix(height);
+            }
+        }
+    }
+
+    inline void mix(unsigned int inValue){
+        checksum = (checksum ^ inValue) * 16777619u;
+    }
+
+    size_t chunks;
+    size_t triangles;
+    size_t vertices;
+    unsigned int checksum;
+};
+
+//quantizes heights (in interval [0, inMaxHeight]) to integers of type T
+template <typename T>
+HeightMapGen<T>* quantize(const HeightMapGen<float>& inHeights, float inMaxHeight){
+    const unsigned int totalSize = inHeights.getSize() * inHeights.getSize();
+    const float scale = std::numeric_limits<T>::max() / inMaxHeight;
+    T* data = new T[totalSize];
+    for(unsigned int i = 0; i < totalSize; ++i){
+        float value = std::min(std::max(inHeights.get(i) * scale + 0.5f, 0.0f), static_cast<float>(std::numeric_limits<T>::max()));
+        data[i] = static_cast<T>(value);
+    }
+    HeightMapGen<T>* result = new HeightMapGen<T>(inHeights.getSize(), data);
+    result->setMinHeight(0.0f);
+    result->setMaxHeight(inMaxHeight);
+    return result;
+}
+
+//returns number of triangles of single LOD generated with specified error
+size_t countTriangles(const std::vector<hydra::data::HeightMap*>& inHeights, float inMaxError){
+    TerrainPreprocessor::Properties properties;
+    properties.numOfLODs = 1;
+    properties.maxError = inMaxError;
+    properties.LODErrorFactor = 0.5f;
+    properties.vertexLODFactor = 0.5f;
+    properties.generateSkirts = false;
+    TerrainPreprocessor preprocessor(properties);
+
+    FragmentStats stats;
+    for(size_t i = 0; i < inHeights.size(); ++i) stats.add(*preprocessor.process(*inHeights[i]));
+    return stats.triangles;
+}
+
+int main(int argc, char** argv){
+    const unsigned int size = (argc > 1)? atoi(argv[1]): 257;
+    const unsigned int fragmentNum = (argc > 2)? atoi(argv[2]): 4;
+    const unsigned int maxLODNum = (argc > 3)? atoi(argv[3]): 6;
+    if(size < 5 || ((size - 1) & (size - 2)) != 0){
+        std::cerr << "size must be 2^n + 1" << std::endl;
+        return 1;
+    }
+
+    std::vector<HeightMapGen<float>*> heights;
+    for(unsigned int i = 0; i < fragmentNum; ++i) heights.push_back(benchmark::createHeightMap(size, i));
+    std::cout << "=== " << fragmentNum << " fragments " << size << "x" << size << std::endl;
+
+    for(unsigned int lodNum = 1; lodNum <= maxLODNum; ++lodNum){
+        TerrainPreprocessor::Properties properties;
+        properties.numOfLODs = static_cast<unsigned char>(lodNum);
+        properties.maxError = 8.0f;
+        properties.LODErrorFactor = 0.5f;
+        properties.vertexLODFactor = 0.5f;
+        properties.generateSkirts = true;
+        TerrainPreprocessor preprocessor(properties);
+
+        FragmentStats stats;
+        Timer timer;
+        timer.start();
+        for(unsigned int i = 0; i < fragmentNum; ++i){
+            TerrainFragmentPtr fragment = preprocessor.process(*heights[i]);
+            stats.add(*fragment);
+        }
+        const double seconds = timer.getMicroseconds() / 1e6;
+
+        std::cout << "LODs " << lodNum
+            << "  time " << std::setw(8) << std::fixed << std::setprecision(1) << seconds * 1000.0 << " ms"
+            << "  (" << std::setw(7) << seconds * 1000.0 / fragmentNum << " ms/fragment)"
+            << "  chunks " << std::setw(5) << stats.chunks
+            << "  triangles " << std::setw(8) << stats.triangles
+            << "  vertices " << std::setw(7) << stats.vertices
+            << "  checksum " << std::hex << stats.checksum << std::dec << std::endl;
+    }
+
+    //generated heights lie in [0, 100]
+    const float maxHeight = 100.0f;
+    std::vector<hydra::data::HeightMap*> floatHeights;
+    std::vector<hydra::data::HeightMap*> heights16;
+    std::vector<hydra::data::HeightMap*> heights8;
+    for(unsigned int i = 0; i < fragmentNum; ++i){
+        floatHeights.push_back(heights[i]);
+        heights16.push_back(quantize<unsigned short>(*heights[i], maxHeight));
+        heights8.push_back(quantize<unsigned char>(*heights[i], maxHeight));
+    }
+
+    std::cout << "=== input precision (1 LOD, no skirts), triangles" << std::endl;
+    const float errors[] = {0.05f, 0.2f, 0.5f, 1.0f, 2.0f};
+    for(size_t e = 0; e < sizeof(errors) / sizeof(errors[0]); ++e){
+        const size_t trianglesFloat = countTriangles(floatHeights, errors[e]);
+        const size_t triangles16 = countTriangles(heights16, errors[e]);
+        const size_t triangles8 = countTriangles(heights8, errors[e]);
+        std::cout << "error " << std::setw(5) << std::setprecision(2) << errors[e]
+            << "  float " << std::setw(8) << trianglesFloat
+            << "  16-bit " << std::setw(8) << triangles16
+            << "  8-bit " << std::setw(8) << triangles8
+            << "  (8-bit / 16-bit " << std::setprecision(2) << static_cast<double>(triangles8) / triangles16 << ")" << std::endl;
+    }
+
+    for(size_t i = 0; i < heights.size(); ++i){
+        delete heights[i];
+        delete heights16[i];
+        delete heights8[i];
+    }
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,158 @@
+//TerrainVertexBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Compares terrain vertex forms: TerrainFragment::CompressedVertex (16 bytes, RAM),
+//hydra::data::Vertex (36 bytes, it is uploaded to VRAM now) and
+//TerrainFragment::PackedVertex (8 bytes, both RAM and VRAM).
+//Reports memory per fragment, speed of packing and unpacking and precision.
+//Fragments are generated.
+//Usage: TerrainVertexBenchmark [size (2^n + 1), default 257] [fragments, default 4]
+
+#include "TerrainBenchmarkUtils.hpp"
+#include "rendering/TerrainPreprocessor.hpp"
+#include "data/TerrainVertexCodec.hpp"
+#include "data/TerrainFragment.hpp"
+#include "data/Vertex.hpp"
+#include "common/Timer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+
+using hydra::rendering::TerrainPreprocessor;
+using hydra::data::TerrainFragment;
+using hydra::data::TerrainFragmentPtr;
+using hydra::data::TerrainVertexCodec;
+using hydra::data::HeightMapGen;
+using hydra::data::Vertex;
+using hydra::common::Timer;
+
+//returns throughput in millions of vertices per second
+inline double getMVertPerSecond(size_t inVertices, unsigned int inRepeats, Timer& inTimer){
+    const double seconds = inTimer.getMicroseconds() / 1e6;
+    return (seconds > 0.0) ? inVertices * static_cast<double>(inRepeats) / seconds / 1e6 : 0.0;
+}
+
+int main(int argc, char** argv){
+    const unsigned int size = (argc > 1)? atoi(argv[1]): 257;
+    const unsigned int fragmentNum = (argc > 2)? atoi(argv[2]): 4;
+    const unsigned int repeats = 20;
+    if(size < 5 || ((size - 1) & (size - 2)) != 0){
+        std::cerr << "size must be 2^n + 1" << std::endl;
+        return 1;
+    }
+
+    TerrainPreprocessor::Properties properties;
+    properties.numOfLODs = 4;
+    properties.maxError = 1.0f;
+    properties.LODErrorFactor = 0.5f;
+    properties.vertexLODFactor = 0.5f;
+    properties.generateSkirts = true;
+    TerrainPreprocessor preprocessor(properties);
+
+    size_t vertexNum = 0;
+    double packSpeed = 0.0, unpackSpeed = 0.0, unpackRenderSpeed = 0.0, expandSpeed = 0.0;
+    float maxHeightError = 0.0f, maxHeightStep = 0.0f, maxNormalError = 0.0f;
+    for(unsigned int f = 0; f < fragmentNum; ++f){
+        HeightMapGen<float>* heights = benchmark::createHeightMap(size, f);
+        TerrainFragmentPtr fragment = preprocessor.process(*heights);
+        delete heights;
+
+        //all vertex levels together (as they are uploaded to VRAM)
+        TerrainFragment::VertexCont vertices;
+        for(size_t i = 0; i < fragment->vertexLODs.size(); ++i){
+            vertices.insert(vertices.end(), fragment->vertexLODs[i].begin(), fragment->vertexLODs[i].end());
+        }
+        const size_t NUM = vertices.size();
+        vertexNum += NUM;
+
+        float minHeight, heightRange;
+        TerrainVertexCodec::getHeightBounds(*fragment, minHeight, heightRange);
+        maxHeightStep = std::max(maxHeightStep, heightRange / 65535.0f);
+
+        TerrainFragment::PackedVertexCont packed(NUM);
+        TerrainFragment::VertexCont unpacked(NUM);
+        std::vector<Vertex> expanded(NUM);
+        const float texCoordScale = 1.0f / size;
+
+        Timer timer;
+        timer.start();
+        for(unsigned int r = 0; r < repeats; ++r) TerrainVertexCodec::pack(&vertices[0], NUM, minHeight, heightRange, &packed[0]);
+        packSpeed += getMVertPerSecond(NUM, repeats, timer) / fragmentNum;
+
+        timer.start();
+        for(unsigned int r = 0; r < repeats; ++r) TerrainVertexCodec::unpack(&packed[0], NUM, minHeight, heightRange, &unpacked[0]);
+        unpackSpeed += getMVertPerSecond(NUM, repeats, timer) / fragmentNum;
+
+        timer.start();
+        for(unsigned int r = 0; r < repeats; ++r) TerrainVertexCodec::expand(&vertices[0], NUM, texCoordScale, &expanded[0]);
+        expandSpeed += getMVertPerSecond(NUM, repeats, timer) / fragmentNum;
+
+        std::vector<Vertex> rendered(NUM);
+        timer.start();
+        for(unsigned int r = 0; r < repeats; ++r) TerrainVertexCodec::unpack(&packed[0], NUM, minHeight, heightRange, texCoordScale, &rendered[0]);
+        unpackRenderSpeed += getMVertPerSecond(NUM, repeats, timer) / fragmentNum;
+
+        for(size_t i = 0; i < NUM; ++i){
+            maxHeightError = std::max(maxHeightError, fabsf(vertices[i].y - unpacked[i].y));
+            const float dot = expanded[i].mNormal.x() * rendered[i].mNormal.x() + expanded[i].mNormal.y() * rendered[i].mNormal.y() +
+                              expanded[i].mNormal.z() * rendered[i].mNormal.z();
+            maxNormalError = std::max(maxNormalError, acosf(std::min(dot, 1.0f)) * 180.0f / 3.14159265f);
+        }
+    }
+
+    const size_t perFragment = vertexNum / fragmentNum;
+    std::cout << "=== " << fragmentNum << " fragments " << size << "x" << size << ", " << perFragment << " vertices per fragment" << std::endl;
+    std::cout << "memory per fragment:" << std::endl
+        << "  RAM   compressed (" << sizeof(TerrainFragment::CompressedVertex) << " B) " << std::setw(7) << perFragment * sizeof(TerrainFragment::CompressedVertex) / 1024 << " KB"
+        << "   packed (" << sizeof(TerrainFragment::PackedVertex) << " B) " << std::setw(7) << perFragment * sizeof(TerrainFragment::PackedVertex) / 1024 << " KB" << std::endl
+        << "  VRAM  vertex     (" << sizeof(Vertex) << " B) " << std::setw(7) << perFragment * sizeof(Vertex) / 1024 << " KB"
+        << "   packed (" << sizeof(TerrainFragment::PackedVertex) << " B) " << std::setw(7) << perFragment * sizeof(TerrainFragment::PackedVertex) / 1024 << " KB" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+        << "pack                        " << std::setw(8) << packSpeed << " Mvert/s" << std::endl
+        << "unpack to compressed        " << std::setw(8) << unpackSpeed << " Mvert/s" << std::endl
+        << "unpack to Vertex            " << std::setw(8) << unpackRenderSpeed << " Mvert/s" << std::endl
+        << "expand compressed to Vertex " << std::setw(8) << expandSpeed << " Mvert/s (current VRAM upload path)" << std::endl;
+    std::cout << std::setprecision(5) << "max height error " << maxHeightError << " (quantization step up to " << maxHeightStep << ")"
+        << std::setprecision(2) << ", max normal error " << maxNormalError << " degrees" << std::endl;
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
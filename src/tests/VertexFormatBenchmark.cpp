@@ -0,0 +1,123 @@
+//VertexFormatBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Reports vertex buffer size, encode/decode speed and precision
+//of packed vertex formats for specified models.
+//Usage: VertexFormatBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/VertexFormat.hpp"
+#include "data/Mesh.hpp"
+#include "data/Vertex.hpp"
+
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+using namespace hydra::data;
+using hydra::math::Vector3D;
+
+struct FormatInfo{
+    const char* name;
+    VertexFormat format;
+};
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv);
+
+    FormatInfo formats[4];
+    formats[0].name = "full (Vertex)";
+    formats[0].format = VertexFormat::createFull();
+    formats[1].name = "compact";
+    formats[1].format = VertexFormat::createCompact();
+    formats[2].name = "snorm pos, oct8";
+    formats[2].format.add(VertexFormat::POSITION, VertexFormat::SNORM16_3)
+        .add(VertexFormat::TEX_COORD, VertexFormat::HALF2).add(VertexFormat::NORMAL, VertexFormat::OCT8);
+    formats[3].name = "float pos, oct16";
+    formats[3].format.add(VertexFormat::POSITION, VertexFormat::FLOAT3)
+        .add(VertexFormat::TEX_COORD, VertexFormat::HALF2).add(VertexFormat::NORMAL, VertexFormat::OCT16);
+
+    const unsigned int repeats = 20;
+
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        size_t vertexNum = benchmark::getVertexNum(*nextModel.model);
+        std::cout << "=== " << nextModel.name << ": " << nextModel.model->mMeshes.size() << " meshes, "
+            << vertexNum << " vertices" << std::endl;
+
+        for(size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f){
+            size_t bytes = 0;
+            double encodeTime = 0.0;
+            double decodeTime = 0.0;
+            float maxPosError = 0.0f;
+            float maxTexError = 0.0f;
+            float maxNormalError = 0.0f;
+
+            BOOST_FOREACH(const MeshPtr& nextMesh, nextModel.model->mMeshes){
+                PackedVertices packed;
+                Mesh decoded;
+
+                encodeTime += benchmark::measure(boost::bind(&Mesh::packVertices, nextMesh.get(), boost::cref(formats[f].format), boost::ref(packed)), repeats);
+                decodeTime += benchmark::measure(boost::bind(&Mesh::unpackVertices, &decoded, boost::cref(packed)), repeats);
+                bytes += packed.getSize();
+
+                for(size_t i = 0; i < nextMesh->getVertexNum(); ++i){
+                    const Vertex& src = nextMesh->mVertices[i];
+                    const Vertex& dst = decoded.mVertices[i];
+                    maxPosError = std::max(maxPosError, (Vector3D(src.mCoord) - Vector3D(dst.mCoord)).getMagnitude());
+                    maxTexError = std::max(maxTexError, std::max(fabsf(src.mTexCoord.x - dst.mTexCoord.x), fabsf(src.mTexCoord.y - dst.mTexCoord.y)));
+                    if(src.mNormal.getSquareMagnitude() > 0.0f){
+                        maxNormalError = std::max(maxNormalError, (src.mNormal.getUnit() - dst.mNormal).getMagnitude());
+                    }
+                }
+            }
+
+            std::cout << std::setw(18) << formats[f].name
+                << "  stride " << std::setw(2) << formats[f].format.getStride()
+                << "  bytes " << std::setw(10) << bytes
+                << "  encode " << std::setw(8) << (encodeTime > 0.0? vertexNum / encodeTime / 1e6: 0.0) << " Mvert/s"
+                << "  decode " << std::setw(8) << (decodeTime > 0.0? vertexNum / decodeTime / 1e6: 0.0) << " Mvert/s"
+                << "  max err: pos " << maxPosError << ", uv " << maxTexError << ", normal " << maxNormalError
+                << std::endl;
+        }
+    }
+    return 0;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */
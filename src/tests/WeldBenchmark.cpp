@@ -0,0 +1,147 @@
+//WeldBenchmark.cpp
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   This file is part of Hydra project.
+ *   See <http://hydraproject.org.ua> for more info.
+ *
+ *   Hydra is free software: you can redistribute it and/or modify
+ *   it under the terms of the MIT License:
+ *   <http://www.opensource.org/licenses/mit-license.php>
+ *   See notice at the end of this file.
+ */
+
+//Compares hash-based Mesh::weldVertices with the previous std::map-based
+//implementation of Mesh::deleteRedundantVertices on triangle soups
+//(every index has its own vertex) built from specified models.
+//Checks that both produce the same set of vertices and same triangles.
+//Usage: WeldBenchmark [model files...]
+
+#include "BenchmarkUtils.hpp"
+#include "data/Mesh.hpp"
+#include "data/Vertex.hpp"
+
+#include <boost/foreach.hpp>
+#include <iostream>
+#include <map>
+#include <vector>
+
+using namespace hydra::data;
+
+//previous implementation of Mesh::deleteRedundantVertices
+void mapBasedWeld(Mesh& inoutMesh){
+    typedef std::vector<size_t> IndicesList;
+    typedef std::map<Vertex, IndicesList> VertexMap;
+    VertexMap vertexMap;
+
+    for(size_t i = 0; i < inoutMesh.mIndices.size(); ++i){
+        vertexMap[inoutMesh.mVertices[inoutMesh.mIndices[i]]].push_back(i);
+    }
+
+    inoutMesh.mVertices.clear();
+    inoutMesh.mVertices.reserve(vertexMap.size());
+
+    typedef VertexMap::value_type vertexMapPair;
+    BOOST_FOREACH(const vertexMapPair& nextPair, vertexMap){
+        inoutMesh.mVertices.push_back(nextPair.first);
+        BOOST_FOREACH(size_t nextIndexPos, nextPair.second)
+            inoutMesh.mIndices.set(nextIndexPos, inoutMesh.mVertices.size() - 1);
+    }
+}
+
+//expands indexed mesh to triangle soup
+Mesh createSoup(const Mesh& inMesh){
+    Mesh soup;
+    soup.mMode = inMesh.mMode;
+    soup.mVertices.reserve(inMesh.getIndexNum());
+    soup.mIndices.reserve(inMesh.getIndexNum());
+    for(size_t i = 0; i < inMesh.getIndexNum(); ++i){
+        soup.mVertices.push_back(inMesh.mVertices[inMesh.mIndices[i]]);
+        soup.mIndices.push_back(static_cast<Mesh::index_t>(i));
+    }
+    return soup;
+}
+
+bool sameTriangles(const Mesh& inMesh1, const Mesh& inMesh2){
+    if(inMesh1.getIndexNum() != inMesh2.getIndexNum()) return false;
+    for(size_t i = 0; i < inMesh1.getIndexNum(); ++i){
+        const Vertex& vert1 = inMesh1.mVertices[inMesh1.mIndices[i]];
+        const Vertex& vert2 = inMesh2.mVertices[inMesh2.mIndices[i]];
+        if(vert1 < vert2 || vert2 < vert1) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    std::vector<benchmark::NamedModel> models = benchmark::loadModels(argc, argv, 512);
+
+    bool allEqual = true;
+    BOOST_FOREACH(const benchmark::NamedModel& nextModel, models){
+        std::cout << "=== " << nextModel.name << std::endl;
+
+        size_t soupVertices = 0, mapVertices = 0, hashVertices = 0, epsVertices = 0;
+        double mapTime = 0.0, hashTime = 0.0, epsTime = 0.0;
+
+        BOOST_FOREACH(const MeshPtr& nextMesh, nextModel.model->mMeshes){
+            Mesh soup = createSoup(*nextMesh);
+            Mesh byMap(soup);
+            Mesh byHash(soup);
+            Mesh byEps(soup);
+            soupVertices += soup.getVertexNum();
+
+            hydra::common::Timer timer;
+            timer.start();
+            mapBasedWeld(byMap);
+            mapTime += timer.getMicroseconds() / 1e6;
+
+            timer.start();
+            byHash.weldVertices();
+            hashTime += timer.getMicroseconds() / 1e6;
+
+            timer.start();
+            byEps.weldVertices(1e-4f);
+            epsTime += timer.getMicroseconds() / 1e6;
+
+            mapVertices += byMap.getVertexNum();
+            hashVertices += byHash.getVertexNum();
+            epsVertices += byEps.getVertexNum();
+
+            if(byMap.getVertexNum() != byHash.getVertexNum() || !sameTriangles(byMap, byHash)) allEqual = false;
+        }
+
+        std::cout << "soup vertices: " << soupVertices << std::endl;
+        std::cout << "std::map weld:     " << mapVertices << " vertices, " << mapTime * 1000.0 << " ms" << std::endl;
+        std::cout << "hash weld:         " << hashVertices << " vertices, " << hashTime * 1000.0 << " ms"
+            << " (x" << (hashTime > 0.0? mapTime / hashTime: 0.0) << ")" << std::endl;
+        std::cout << "hash weld (1e-4):  " << epsVertices << " vertices, " << epsTime * 1000.0 << " ms" << std::endl;
+    }
+
+    std::cout << (allEqual? "results are equal": "RESULTS DIFFER") << std::endl;
+    return allEqual? 0: 1;
+}
+
+/*
+ *   Copyright 2010-2011 Alexander Medvedev
+ *
+ *   Permission is hereby granted, free of charge, to any person 
+ *   obtaining a copy of this software and associated documentation
+ *   files (the "Software"), to deal in the Software without
+ *   restriction, including without limitation the rightsto use, 
+ *   copy, modify, merge, publish, distribute, sublicense, and/or
+ *   sell copies of the Software, and to permit persons to whom
+ *   the Software is furnished to do so, subject to the following 
+ *   conditions:
+ *
+ *   The above copyright notice and this permission notice shall be
+ *   included in all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ *   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ *   OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ *   NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ *   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ *   OTHER DEALINGS IN THE SOFTWARE.
+ */